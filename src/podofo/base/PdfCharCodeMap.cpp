@@ -0,0 +1,191 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#include "PdfCharCodeMap.h"
+
+#include "PdfDefinesPrivate.h"
+
+namespace PoDoFo {
+
+#define PODOFO_CODE_MAP_PAGES    256
+#define PODOFO_CODE_MAP_SINGLE   0x00010000 ///< Entry is a single value in the lower 16 bits
+#define PODOFO_CODE_MAP_SEQUENCE 0x80000000 ///< Entry is an index into m_vecSequences in the lower 31 bits
+
+PdfCharCodeMap::PdfCharCodeMap()
+    : m_bEmpty( true )
+{
+}
+
+void PdfCharCodeMap::Insert( pdf_utf16be nCode, pdf_utf16be nUnicode )
+{
+    SetCode( nCode, PODOFO_CODE_MAP_SINGLE | nUnicode );
+}
+
+void PdfCharCodeMap::Insert( pdf_utf16be nCode, const std::vector<pdf_utf16be> & rvecUnicode )
+{
+    if( rvecUnicode.empty() )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidDataType );
+    }
+
+    if( rvecUnicode.size() == 1 )
+    {
+        this->Insert( nCode, rvecUnicode[0] );
+        return;
+    }
+
+    pdf_uint32 nIndex = static_cast<pdf_uint32>(m_vecSequences.size());
+    m_vecSequences.push_back( static_cast<pdf_utf16be>(rvecUnicode.size()) );
+    m_vecSequences.insert( m_vecSequences.end(), rvecUnicode.begin(), rvecUnicode.end() );
+
+    SetCode( nCode, PODOFO_CODE_MAP_SEQUENCE | nIndex );
+}
+
+void PdfCharCodeMap::InsertRange( pdf_utf16be nFirstCode, pdf_utf16be nLastCode, pdf_utf16be nUnicode )
+{
+    for( int nCode = nFirstCode; nCode <= nLastCode; nCode++ )
+    {
+        this->Insert( static_cast<pdf_utf16be>(nCode), nUnicode );
+        ++nUnicode;
+    }
+}
+
+void PdfCharCodeMap::InsertRange( pdf_utf16be nFirstCode, pdf_utf16be nLastCode, const std::vector<pdf_utf16be> & rvecUnicode )
+{
+    if( rvecUnicode.empty() )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidDataType );
+    }
+
+    std::vector<pdf_utf16be> vecUnicode( rvecUnicode );
+    for( int nCode = nFirstCode; nCode <= nLastCode; nCode++ )
+    {
+        this->Insert( static_cast<pdf_utf16be>(nCode), vecUnicode );
+        ++vecUnicode.back();
+    }
+}
+
+pdf_utf16be PdfCharCodeMap::GetUnicode( pdf_utf16be nCode ) const
+{
+    pdf_uint32 nEntry = GetEntry( m_forward, nCode );
+    if( nEntry & PODOFO_CODE_MAP_SEQUENCE )
+        return m_vecSequences[(nEntry & ~PODOFO_CODE_MAP_SEQUENCE) + 1];
+
+    return static_cast<pdf_utf16be>(nEntry & 0xFFFF);
+}
+
+bool PdfCharCodeMap::GetUnicode( pdf_utf16be nCode, std::vector<pdf_utf16be> & rvecUnicode ) const
+{
+    pdf_uint32 nEntry = GetEntry( m_forward, nCode );
+    if( !nEntry )
+        return false;
+
+    if( nEntry & PODOFO_CODE_MAP_SEQUENCE )
+    {
+        std::vector<pdf_utf16be>::const_iterator it = m_vecSequences.begin() + (nEntry & ~PODOFO_CODE_MAP_SEQUENCE);
+        rvecUnicode.insert( rvecUnicode.end(), it + 1, it + 1 + *it );
+    }
+    else
+        rvecUnicode.push_back( static_cast<pdf_utf16be>(nEntry & 0xFFFF) );
+
+    return true;
+}
+
+pdf_utf16be PdfCharCodeMap::GetCode( pdf_utf16be nUnicode ) const
+{
+    return static_cast<pdf_utf16be>(GetEntry( m_reverse, nUnicode ) & 0xFFFF);
+}
+
+void PdfCharCodeMap::SetEntry( TPageTable & rTable, pdf_utf16be nIndex, pdf_uint32 nEntry )
+{
+    if( rTable.empty() )
+        rTable.resize( PODOFO_CODE_MAP_PAGES );
+
+    TPage & rPage = rTable[nIndex >> 8];
+    if( rPage.empty() )
+    {
+        if( !nEntry )
+            return;
+
+        rPage.resize( 256, 0 );
+    }
+
+    rPage[nIndex & 0xFF] = nEntry;
+}
+
+void PdfCharCodeMap::SetCode( pdf_utf16be nCode, pdf_uint32 nEntry )
+{
+    const pdf_uint32 nOld = GetEntry( m_forward, nCode );
+    SetEntry( m_forward, nCode, nEntry );
+    m_bEmpty = false;
+
+    if( nOld == nEntry )
+        return;
+
+    if( nOld && !(nOld & PODOFO_CODE_MAP_SEQUENCE) )
+    {
+        const pdf_utf16be nUnicode = static_cast<pdf_utf16be>(nOld & 0xFFFF);
+        if( GetEntry( m_reverse, nUnicode ) == (PODOFO_CODE_MAP_SINGLE | nCode) )
+        {
+            // nCode was the reverse entry of its old value,
+            // the next higher code with that value replaces it
+            TISetCodes it = m_setOtherCodes.lower_bound( std::make_pair( nUnicode, static_cast<pdf_utf16be>(0) ) );
+            if( it != m_setOtherCodes.end() && (*it).first == nUnicode )
+            {
+                SetEntry( m_reverse, nUnicode, PODOFO_CODE_MAP_SINGLE | (*it).second );
+                m_setOtherCodes.erase( it );
+            }
+            else
+                SetEntry( m_reverse, nUnicode, 0 );
+        }
+        else
+            m_setOtherCodes.erase( std::make_pair( nUnicode, nCode ) );
+    }
+
+    if( !(nEntry & PODOFO_CODE_MAP_SEQUENCE) )
+    {
+        const pdf_utf16be nUnicode = static_cast<pdf_utf16be>(nEntry & 0xFFFF);
+        const pdf_uint32  nReverse = GetEntry( m_reverse, nUnicode );
+        if( !nReverse )
+            SetEntry( m_reverse, nUnicode, PODOFO_CODE_MAP_SINGLE | nCode );
+        else if( (nReverse & 0xFFFF) > nCode )
+        {
+            m_setOtherCodes.insert( std::make_pair( nUnicode, static_cast<pdf_utf16be>(nReverse & 0xFFFF) ) );
+            SetEntry( m_reverse, nUnicode, PODOFO_CODE_MAP_SINGLE | nCode );
+        }
+        else
+            m_setOtherCodes.insert( std::make_pair( nUnicode, nCode ) );
+    }
+}
+
+};
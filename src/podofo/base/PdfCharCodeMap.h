@@ -0,0 +1,174 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef _PDF_CHAR_CODE_MAP_H_
+#define _PDF_CHAR_CODE_MAP_H_
+
+#include "PdfDefines.h"
+
+#include <set>
+#include <vector>
+
+namespace PoDoFo {
+
+/** A map from character codes of a CMap (e.g. a /ToUnicode CMap)
+ *  to unicode values.
+ *
+ *  Character codes are stored in a two level table of pages with
+ *  256 codes each, so a code is looked up in constant time and
+ *  only pages which contain mapped codes take up memory. The same
+ *  kind of table is kept for the reverse direction.
+ *
+ *  A code can be mapped to a sequence of several unicode values,
+ *  as CMaps do for ligatures.
+ *
+ *  All character codes and unicode values are in host byte order.
+ */
+class PODOFO_API PdfCharCodeMap {
+ public:
+    PdfCharCodeMap();
+
+    /** Map a character code to a single unicode value.
+     *  An existing mapping of the code is replaced.
+     *
+     *  \param nCode a character code
+     *  \param nUnicode the unicode value of nCode
+     */
+    void Insert( pdf_utf16be nCode, pdf_utf16be nUnicode );
+
+    /** Map a character code to a sequence of unicode values.
+     *  An existing mapping of the code is replaced.
+     *
+     *  \param nCode a character code
+     *  \param rvecUnicode the unicode values of nCode, must not be empty
+     */
+    void Insert( pdf_utf16be nCode, const std::vector<pdf_utf16be> & rvecUnicode );
+
+    /** Map a range of character codes to consecutive unicode values.
+     *
+     *  \param nFirstCode first character code of the range
+     *  \param nLastCode last character code of the range
+     *  \param nUnicode the unicode value of nFirstCode
+     */
+    void InsertRange( pdf_utf16be nFirstCode, pdf_utf16be nLastCode, pdf_utf16be nUnicode );
+
+    /** Map a range of character codes to consecutive sequences
+     *  of unicode values, where the last value of the sequence 
+     *  is incremented for every code.
+     *
+     *  \param nFirstCode first character code of the range
+     *  \param nLastCode last character code of the range
+     *  \param rvecUnicode the unicode values of nFirstCode, must not be empty
+     */
+    void InsertRange( pdf_utf16be nFirstCode, pdf_utf16be nLastCode, const std::vector<pdf_utf16be> & rvecUnicode );
+
+    /**
+     * \returns true if no character code is mapped
+     */
+    inline bool IsEmpty() const;
+
+    /** Get the unicode value of a character code.
+     *
+     *  \param nCode a character code
+     *  \returns the unicode value of nCode, the first one if nCode
+     *           maps to a sequence, or 0 if nCode is not mapped
+     */
+    pdf_utf16be GetUnicode( pdf_utf16be nCode ) const;
+
+    /** Append all unicode values of a character code to a vector.
+     *
+     *  \param nCode a character code
+     *  \param rvecUnicode the unicode values are appended to this vector
+     *  \returns false if nCode is not mapped
+     */
+    bool GetUnicode( pdf_utf16be nCode, std::vector<pdf_utf16be> & rvecUnicode ) const;
+
+    /** Get the character code of a unicode value.
+     *
+     *  \param nUnicode a unicode value
+     *  \returns the lowest character code which maps to nUnicode alone
+     *           or 0 if there is none
+     */
+    pdf_utf16be GetCode( pdf_utf16be nUnicode ) const;
+
+ private:
+    typedef std::vector<pdf_uint32>     TPage;
+    typedef std::vector<TPage>          TPageTable;
+
+    typedef std::set< std::pair<pdf_utf16be,pdf_utf16be> > TSetCodes;
+    typedef TSetCodes::iterator                            TISetCodes;
+
+    /** Get the entry of a code in a page table.
+     *  \returns 0 if there is no entry
+     */
+    static inline pdf_uint32 GetEntry( const TPageTable & rTable, pdf_utf16be nIndex );
+
+    /** Set the entry of a code in a page table, allocating the page if necessary.
+     */
+    static void SetEntry( TPageTable & rTable, pdf_utf16be nIndex, pdf_uint32 nEntry );
+
+    /** Set the forward entry of a code and update the reverse table.
+     */
+    void SetCode( pdf_utf16be nCode, pdf_uint32 nEntry );
+
+ private:
+    TPageTable               m_forward;   ///< Entries of all codes: 0, a single value or an index into m_vecSequences
+    TPageTable               m_reverse;   ///< Entries of all unicode values: 0 or the lowest code mapping to it
+    std::vector<pdf_utf16be> m_vecSequences; ///< Unicode sequences, each preceded by its length
+    TSetCodes                m_setOtherCodes; ///< (unicode value, code) of all codes mapping to a single value, which are not its reverse entry
+    bool                     m_bEmpty;
+};
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+bool PdfCharCodeMap::IsEmpty() const
+{
+    return m_bEmpty;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_uint32 PdfCharCodeMap::GetEntry( const TPageTable & rTable, pdf_utf16be nIndex )
+{
+    if( rTable.empty() )
+        return 0;
+
+    const TPage & rPage = rTable[nIndex >> 8];
+    return rPage.empty() ? 0 : rPage[nIndex & 0xFF];
+}
+
+};
+
+#endif // _PDF_CHAR_CODE_MAP_H_
@@ -114,12 +114,12 @@ void PdfContentsTokenizer::SetCurrentContentsStream( const PdfObject* pObject )
 
     const PdfStream* pStream = pObject->GetStream();
 
-    PdfRefCountedBuffer buffer(0);
-    PdfBufferOutputStream stream( &buffer );
+    // Decode the stream while tokenizing instead of
+    // decoding it into a buffer first
     if( pStream )
-        pStream->GetFilteredCopy( &stream );
-
-    m_device = PdfRefCountedInputDevice( buffer.GetBuffer(), buffer.GetSize() );
+        m_device = PdfRefCountedInputDevice( new PdfInputStreamDevice( pStream->CreateFilteredInputStream() ) );
+    else
+        m_device = PdfRefCountedInputDevice( "", static_cast<size_t>(0) );
 }
 
 bool PdfContentsTokenizer::GetNextToken( const char*& pszToken , EPdfTokenType* peType )
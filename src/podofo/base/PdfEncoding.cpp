@@ -52,6 +52,35 @@
 
 namespace PoDoFo {
 
+/** Parse the hex digits of a destination in a /ToUnicode CMap.
+ *  Every 4 digits are one unicode value.
+ */
+static void ParseHexUnicode( const char* pszToken, std::vector<pdf_utf16be> & rvecUnicode )
+{
+    const size_t lLen = strlen( pszToken );
+    size_t       lPos = 0;
+    do
+    {
+        const size_t lDigits = (lLen - lPos > 4) ? 4 : lLen - lPos;
+        pdf_utf16be  nValue  = 0;
+        for( size_t i = lPos; i < lPos + lDigits; i++ )
+        {
+            const char c = pszToken[i];
+            nValue = static_cast<pdf_utf16be>(nValue << 4);
+            if( c >= '0' && c <= '9' )
+                nValue |= c - '0';
+            else if( c >= 'a' && c <= 'f' )
+                nValue |= c - 'a' + 10;
+            else if( c >= 'A' && c <= 'F' )
+                nValue |= c - 'A' + 10;
+        }
+
+        rvecUnicode.push_back( nValue );
+        lPos += lDigits;
+    }
+    while( lPos < lLen );
+}
+
 PdfEncoding::PdfEncoding( int nFirstChar, int nLastChar, PdfObject* pToUnicode )
     : m_bToUnicodeIsLoaded(false), m_nFirstChar( nFirstChar ), m_nLastChar( nLastChar ), m_pToUnicode(pToUnicode)
 {
@@ -71,18 +100,16 @@ PdfEncoding::~PdfEncoding()
 PdfString PdfEncoding::ConvertToUnicode(const PdfString & rEncodedString, const PdfFont*) const
 {
     
-    if(!m_toUnicode.empty())
+    if(!m_toUnicode.IsEmpty())
     {
         
         const pdf_utf16be* pStr = reinterpret_cast<const pdf_utf16be*>(rEncodedString.GetString());
         const size_t lLen = rEncodedString.GetLength()/2;
-        pdf_utf16be lCID, lUnicodeValue;
+        pdf_utf16be lCID;
         
-        pdf_utf16be* pszUtf16 = static_cast<pdf_utf16be*>(podofo_calloc(lLen, sizeof(pdf_utf16be)));
-        if( !pszUtf16 )
-        {
-            PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
-        }
+        // A code may map to several unicode values (e.g. ligatures)
+        std::vector<pdf_utf16be> vecUtf16;
+        vecUtf16.reserve( lLen + 1 );
         
         for(size_t i = 0 ; i<lLen ; i++)
         {
@@ -93,19 +120,19 @@ PdfString PdfEncoding::ConvertToUnicode(const PdfString & rEncodedString, const
             lCID = pStr[i];
 #endif // PODOFO_IS_LITTLE_ENDIAN
             
-            lUnicodeValue = this->GetUnicodeValue(lCID);
-            
+            if( !m_toUnicode.GetUnicode( lCID, vecUtf16 ) )
+                vecUtf16.push_back( 0 );
+        }
+        
 #ifdef PODOFO_IS_LITTLE_ENDIAN
-            pszUtf16[i] = (lUnicodeValue << 8) | (lUnicodeValue >> 8 );
-#else
-            pszUtf16[i] = lUnicodeValue;
+        for(size_t i = 0 ; i<vecUtf16.size() ; i++)
+            vecUtf16[i] = (vecUtf16[i] << 8) | (vecUtf16[i] >> 8 );
 #endif // PODOFO_IS_LITTLE_ENDIAN
-        }
         
-        PdfString ret( pszUtf16, lLen );
-        podofo_free( pszUtf16 );
+        const pdf_long lDstLen = static_cast<pdf_long>(vecUtf16.size());
+        vecUtf16.push_back( 0 );
         
-        return ret;
+        return PdfString( &vecUtf16[0], lDstLen );
         
     }
     else
@@ -114,7 +141,7 @@ PdfString PdfEncoding::ConvertToUnicode(const PdfString & rEncodedString, const
 
 PdfRefCountedBuffer PdfEncoding::ConvertToEncoding( const PdfString & rString, const PdfFont* pFont ) const
 {
-    if(!m_toUnicode.empty())
+    if(!m_toUnicode.IsEmpty())
     {
         // Get the string in UTF-16be format
         PdfString sStr = rString.ToUnicode();
@@ -226,19 +253,18 @@ void PdfEncoding::ParseToUnicode()
                         }
                         if (i % 3 == 2)
                         {
+                            // The destination may be a sequence of several unicode values
+                            std::vector<pdf_utf16be> vecUnicode;
+                            ParseHexUnicode( streamToken, vecUnicode );
                             if (inside_array == 0)
                             {
-                                for (int k = range_start; k <= range_end; k++)
-                                {
-                                    m_toUnicode[k] = num_value;
-                                    num_value++;
-                                }
+                                m_toUnicode.InsertRange( range_start, range_end, vecUnicode );
 							
                                 loop++;
                             }
                             else
                             {
-                                m_toUnicode[range_start] = num_value;
+                                m_toUnicode.Insert( range_start, vecUnicode );
                             }
 
                             range_start++;
@@ -263,7 +289,9 @@ void PdfEncoding::ParseToUnicode()
                         }
                         if (i % 2 == 1)
                         {
-                            m_toUnicode[firstvalue] = num_value;
+                            std::vector<pdf_utf16be> vecUnicode;
+                            ParseHexUnicode( streamToken, vecUnicode );
+                            m_toUnicode.Insert( firstvalue, vecUnicode );
                         }
                     }
                 }
@@ -336,26 +364,12 @@ void PdfEncoding::ParseToUnicode()
 
 pdf_utf16be PdfEncoding::GetUnicodeValue( pdf_utf16be  value ) const
 {
-    if(!m_toUnicode.empty())
-    {
-        const std::map<pdf_utf16be, pdf_utf16be>::const_iterator found = m_toUnicode.find(value);
-        return (found == m_toUnicode.end() ? 0 : found->second);
-    }
-    
-    return 0;
+    return m_toUnicode.GetUnicode( value );
 }
 
 pdf_utf16be PdfEncoding::GetCIDValue( pdf_utf16be lUnicodeValue ) const
 {
-    if(!m_toUnicode.empty())
-    {
-        // TODO: optimize
-        for(std::map<pdf_utf16be, pdf_utf16be>::const_iterator it = m_toUnicode.begin(); it != m_toUnicode.end(); ++it)
-            if(it->second == lUnicodeValue)
-                return it->first;
-    }
-    
-    return 0;
+    return m_toUnicode.GetCode( lUnicodeValue );
 }
     
 // -----------------------------------------------------
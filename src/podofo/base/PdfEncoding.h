@@ -35,6 +35,7 @@
 #define _PDF_ENCODING_H_
 
 #include "PdfDefines.h"
+#include "PdfCharCodeMap.h"
 #include "PdfName.h"
 #include "PdfString.h"
 #include "util/PdfMutex.h"
@@ -238,7 +239,7 @@ class PODOFO_API PdfEncoding {
     int     m_nLastChar;    ///< The last defined character code
     const PdfObject* m_pToUnicode;    ///< Pointer to /ToUnicode object, if any
  protected:
-    std::map<pdf_utf16be, pdf_utf16be> m_toUnicode;
+    PdfCharCodeMap m_toUnicode;
                
     pdf_utf16be GetUnicodeValue( pdf_utf16be ) const;
  private:
@@ -29,6 +29,8 @@
 #include "PdfFilter.h"
 #include "PdfDefinesPrivate.h"
 
+#include "util/PdfMutex.h"
+
 #include <stdlib.h>
 #include <string.h>
 #include <sstream>
@@ -81,8 +83,18 @@ ePdfEncryptAlgorithm_RC4V2 |
 ePdfEncryptAlgorithm_AESV2;
 #endif // PODOFO_HAVE_LIBIDN
 
+PdfEncrypt::PdfEncrypt()
+    : m_eAlgorithm( ePdfEncryptAlgorithm_AESV2 ), m_keyLength( 0 ), m_rValue( 0 ), m_pValue( 0 ),
+      m_eKeyLength( ePdfKeyLength_128 ), m_bEncryptMetadata(true), m_pMutex( new Util::PdfMutex() )
+{
+    memset( m_uValue, 0, 48 );
+    memset( m_oValue, 0, 48 );
+    memset( m_encryptionKey, 0, 32 );
+}
+
 PdfEncrypt::~PdfEncrypt()
 {
+    delete m_pMutex;
 }
     
 int PdfEncrypt::GetEnabledEncryptionAlgorithms()
@@ -112,6 +124,7 @@ class AESCryptoEngine {
     public:
     
         AESCryptoEngine()
+            : cipher( NULL )
         {
     #ifdef PODOFO_HAVE_OPENSSL_1_1
             aes = EVP_CIPHER_CTX_new();
@@ -119,6 +132,24 @@ class AESCryptoEngine {
             EVP_CIPHER_CTX_init(&aes);
     #endif
         }
+
+        /** Initialize the engine with a new key and initialization vector.
+         *  The cipher itself is only set up again if it differs from the 
+         *  last call, which is most of the work for short strings.
+         *
+         *  \returns 1 on success like EVP_CipherInit_ex
+         */
+        int init( const EVP_CIPHER* pCipher, const unsigned char* key, const unsigned char* iv, int enc )
+        {
+            int status = EVP_CipherInit_ex( getEngine(), pCipher == cipher ? NULL : pCipher, NULL, key, iv, enc );
+            cipher = status == 1 ? pCipher : NULL;
+
+            // Padding might have been disabled while computing keys
+            if( status == 1 )
+                status = EVP_CIPHER_CTX_set_padding( getEngine(), 1 );
+
+            return status;
+        }
     
         EVP_CIPHER_CTX* getEngine()
         {
@@ -145,6 +176,7 @@ class AESCryptoEngine {
     #else
         EVP_CIPHER_CTX aes;
     #endif
+        const EVP_CIPHER* cipher; ///< the cipher aes is set up for
 };
 
 #ifndef PODOFO_HAVE_OPENSSL_NO_RC4
@@ -154,6 +186,7 @@ class RC4CryptoEngine {
 public:
     
     RC4CryptoEngine()
+        : keyLen( 0 )
     {
     #ifdef PODOFO_HAVE_OPENSSL_1_1
         rc4 = EVP_CIPHER_CTX_new();
@@ -161,6 +194,34 @@ public:
         EVP_CIPHER_CTX_init(&rc4);
     #endif
     }
+
+    /** Initialize the engine with a new key.
+     *  The cipher is only set up again if the key length changed.
+     *
+     *  \returns 1 on success like EVP_EncryptInit_ex
+     */
+    int init( const unsigned char* key, int keylen )
+    {
+        EVP_CIPHER_CTX* ctx = getEngine();
+        if( keylen != keyLen ) 
+        {
+            keyLen = 0;
+
+            // Don't set the key because we will modify the parameters
+            int status = EVP_EncryptInit_ex(ctx, EVP_rc4(), NULL, NULL, NULL);
+            if(status != 1)
+                return status;
+
+            status = EVP_CIPHER_CTX_set_key_length(ctx, keylen);
+            if(status != 1)
+                return status;
+
+            keyLen = keylen;
+        }
+
+        // We finished modifying parameters so now we can set the key
+        return EVP_EncryptInit_ex(ctx, NULL, NULL, key, NULL);
+    }
     
     EVP_CIPHER_CTX* getEngine()
     {
@@ -187,6 +248,7 @@ private:
     #else
     EVP_CIPHER_CTX rc4;
     #endif
+    int keyLen; ///< the key length rc4 is set up for, 0 if none
 };
     
 /** A class that can encrypt/decrpyt streamed data block wise
@@ -329,8 +391,8 @@ private:
 class PdfRC4InputStream : public PdfInputStream {
 public:
     PdfRC4InputStream( PdfInputStream* pInputStream, unsigned char rc4key[256], unsigned char rc4last[256], 
-                      unsigned char* key, int keylen )
-    : m_pInputStream( pInputStream ), m_stream( rc4key, rc4last, key, keylen )
+                      unsigned char* key, int keylen, pdf_long lInputLen = -1 )
+    : m_pInputStream( pInputStream ), m_stream( rc4key, rc4last, key, keylen ), m_lInputLeft( lInputLen )
     {
     }
     
@@ -349,12 +411,20 @@ public:
      */
     virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* )
     {
+        if( m_lInputLeft >= 0 )
+            lLen = PDF_MIN( lLen, m_lInputLeft );
+
         // Do not encode data with no length
         if( !lLen )
             return lLen;
         
-        m_pInputStream->Read( pBuffer, lLen );
-        m_stream.Encrypt( pBuffer, lLen );
+        lLen = m_pInputStream->Read( pBuffer, lLen );
+        if( lLen > 0 )
+        {
+            m_stream.Encrypt( pBuffer, lLen );
+            if( m_lInputLeft >= 0 )
+                m_lInputLeft -= lLen;
+        }
         
         return lLen;
     }
@@ -362,97 +432,171 @@ public:
 private:
     PdfInputStream* m_pInputStream;
     PdfRC4Stream    m_stream;
+    pdf_long        m_lInputLeft;      ///< bytes left in m_pInputStream, -1 if unknown
 };
 #endif // PODOFO_HAVE_OPENSSL_NO_RC4
 
 /** A class that can encrypt/decrpyt streamed data block wise
  *  This is used in the input and output stream encryption implementation.
+ *
+ *  AES-CBC works on blocks of 16 bytes. Data which does not fill
+ *  a complete block is kept by the cipher context until more data
+ *  arrives or Finish() is called, which adds or removes the padding.
  */
 class PdfAESStream : public PdfEncryptAESBase {
 public:
-    PdfAESStream( unsigned char* key, const size_t keylen )
-		: keyLen( keylen ), bFirstRead( true ), bOnlyFinalLeft( false )
+    PdfAESStream( const unsigned char* key, const size_t keylen )
+        : m_keyLen( keylen )
     {
-		memcpy( this->key, key, keylen );
+        memcpy( m_key, key, keylen );
     }
     
     ~PdfAESStream() {}
-   
-    /** Decrypt a block
-     *  
-     *  \param pBuffer    the input/output buffer. Data is read from this buffer and also stored here
-     *  \param lLen       the size of the buffer 
-     *  \param pTotalLeft total bytes left (needed for AES IV and padding)
+
+    /** Start encryption or decryption of a new stream
+     *
+     *  \param iv       the initialization vector of AES_IV_LENGTH bytes
+     *  \param bEncrypt true to encrypt, false to decrypt
      */
-    pdf_long Decrypt( unsigned char* pBuffer, pdf_long lLen, pdf_long* pTotalLeft )
+    void Init( const unsigned char* iv, bool bEncrypt )
     {
-		if (pTotalLeft == 0)
-			PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error AES-decryption needs pTotalLeft" );
-		if( lLen % 16 != 0 )
-			PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error AES-decryption data length not a multiple of 16" );
-		EVP_CIPHER_CTX* aes = m_aes->getEngine();
-		int lOutLen = 0, lStepOutLen;
-		int status = 1;
-		int bufferOffset = 0;
-		if( bFirstRead ) {
-			if( keyLen == PdfEncrypt::ePdfKeyLength_128/8 ) {
-				status = EVP_DecryptInit_ex( aes, EVP_aes_128_cbc(), NULL, key, pBuffer );
+        const EVP_CIPHER* pCipher = NULL;
+        if( m_keyLen == PdfEncrypt::ePdfKeyLength_128/8 )
+            pCipher = EVP_aes_128_cbc();
 #ifdef PODOFO_HAVE_LIBIDN
-			} else if( keyLen == PdfEncrypt::ePdfKeyLength_256/8 ) {
-				status = EVP_DecryptInit_ex( aes, EVP_aes_256_cbc(), NULL, key, pBuffer );
+        else if( m_keyLen == PdfEncrypt::ePdfKeyLength_256/8 )
+            pCipher = EVP_aes_256_cbc();
 #endif
-			} else {
-				PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Invalid AES key length" );
-			}
-			if(status != 1)
-				PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error initializing AES encryption engine" );
+        else
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Invalid AES key length" );
 
-			bufferOffset = AES_IV_LENGTH;
-			bFirstRead = false;
-		}
+        int status = m_aes->init( pCipher, m_key, iv, bEncrypt ? 1 : 0 );
+        if( status != 1 )
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error initializing AES encryption engine" );
+    }
+
+    /** Encrypt or decrypt a block of any length
+     *  
+     *  \param pIn     the input data
+     *  \param lLen    the size of the input data, at most INT_MAX - AES_IV_LENGTH
+     *  \param pOut    the output buffer, which must have room
+     *                 for lLen + AES_IV_LENGTH bytes
+     *  \returns the number of bytes written to pOut
+     */
+    pdf_long Update( const unsigned char* pIn, pdf_long lLen, unsigned char* pOut )
+    {
+        int lOutLen = 0;
+        if( EVP_CipherUpdate( m_aes->getEngine(), pOut, &lOutLen, pIn, static_cast<int>(lLen) ) != 1 )
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error AES-decryption data" );
+
+        return lOutLen;
+    }
+
+    /** Finish encryption or decryption, i.e. write the last
+     *  padded block or remove the padding of the last block.
+     *
+     *  \param pOut    the output buffer, which must have room
+     *                 for AES_IV_LENGTH bytes
+     *  \returns the number of bytes written to pOut
+     */
+    pdf_long Finish( unsigned char* pOut )
+    {
+        int lOutLen = 0;
+        if( EVP_CipherFinal_ex( m_aes->getEngine(), pOut, &lOutLen ) != 1 )
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error AES-decryption data padding" );
 
-		if( !bOnlyFinalLeft ) {
-			// Quote openssl.org: "the decrypted data buffer out passed to EVP_DecryptUpdate() should have sufficient room
-			//  for (inl + cipher_block_size) bytes unless the cipher block size is 1 in which case inl bytes is sufficient."
-			// So we need to create a buffer that is bigger than lLen.
-			tempBuffer.resize( lLen + 16 );
-			status = EVP_DecryptUpdate( aes, &tempBuffer[0], &lOutLen, pBuffer + bufferOffset, lLen - bufferOffset );
-			memcpy( pBuffer, &tempBuffer[0], lOutLen );
-		}
-		if( status != 1 )
-			PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error AES-decryption data" );
-		if( lLen == *pTotalLeft ) {
-			// Last chunk of the stream
-			if( lLen == lOutLen ) {
-				// Buffer is full, so we need an other round for EVP_DecryptFinal_ex.
-				bOnlyFinalLeft = true;
-				*pTotalLeft += 16;
-			} else {
-				status = EVP_DecryptFinal_ex( aes, pBuffer + lOutLen, &lStepOutLen );
-				if( status != 1 )
-					PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error AES-decryption data padding" );
-				lOutLen += lStepOutLen;
-			}
-		}
-		*pTotalLeft -= lLen - lOutLen; // AES makes the resulting buffer shorter (IV and padding)
         return lOutLen;
     }
     
 private:
-	std::vector<unsigned char> tempBuffer;
-	unsigned char key[32];
-	const size_t keyLen;
-	bool bFirstRead;
-	bool bOnlyFinalLeft;
+    unsigned char m_key[32];
+    const size_t  m_keyLen;
+};
+
+/** A PdfOutputStream that encrypts all data written
+ *  using the AES encryption algorithm.
+ *
+ *  The initialization vector is written before the
+ *  first block and the last block is padded on Close().
+ */
+class PdfAESOutputStream : public PdfOutputStream {
+public:
+    PdfAESOutputStream( PdfOutputStream* pOutputStream, const unsigned char* key, int keylen, 
+                        const unsigned char iv[AES_IV_LENGTH] )
+        : m_pOutputStream( pOutputStream ), m_stream( key, keylen ), m_bClosed( false )
+    {
+        m_stream.Init( iv, true );
+        m_pOutputStream->Write( reinterpret_cast<const char*>(iv), AES_IV_LENGTH );
+    }
+    
+    virtual ~PdfAESOutputStream()
+    {
+    }
+    
+    /** Write data to the output stream
+     *  
+     *  \param pBuffer the data is read from this buffer
+     *  \param lLen    the size of the buffer 
+     */
+    virtual pdf_long Write( const char* pBuffer, pdf_long lLen )
+    {
+        unsigned char buffer[BUFFER_SIZE + AES_IV_LENGTH];
+        pdf_long      lLeft = lLen;
+
+        while( lLeft > 0 ) 
+        {
+            pdf_long lBlock = PDF_MIN( lLeft, static_cast<pdf_long>(BUFFER_SIZE) );
+            pdf_long lOut   = m_stream.Update( reinterpret_cast<const unsigned char*>(pBuffer), lBlock, buffer );
+            if( lOut )
+                m_pOutputStream->Write( reinterpret_cast<char*>(buffer), lOut );
+
+            pBuffer += lBlock;
+            lLeft   -= lBlock;
+        }
+        
+        return lLen;
+    }
+    
+    /** Close the PdfOutputStream.
+     *  This method may throw exceptions and has to be called 
+     *  before the descructor to end writing.
+     *
+     *  No more data may be written to the output device
+     *  after calling close.
+     */
+    virtual void Close() 
+    {
+        if( m_bClosed )
+            return;
+
+        unsigned char buffer[AES_IV_LENGTH];
+        pdf_long      lOut = m_stream.Finish( buffer );
+
+        m_bClosed = true;
+        m_pOutputStream->Write( reinterpret_cast<char*>(buffer), lOut );
+    }
+    
+private:
+    enum { BUFFER_SIZE = 4096 };
+
+    PdfOutputStream* m_pOutputStream;
+    PdfAESStream     m_stream;
+    bool             m_bClosed;
 };
 
 /** A PdfAESInputStream that decrypts all data read
  *  using the AES encryption algorithm
+ *
+ *  Any number of bytes can be read at once. As the padding can only
+ *  be removed from the last block, the length of the encrypted data
+ *  has to be known. It is either given to the constructor or the
+ *  input stream is read until it returns no more data.
  */
 class PdfAESInputStream : public PdfInputStream {
 public:
-    PdfAESInputStream( PdfInputStream* pInputStream, unsigned char* key, int keylen )
-    : m_pInputStream( pInputStream ), m_stream( key, keylen )
+    PdfAESInputStream( PdfInputStream* pInputStream, const unsigned char* key, int keylen, pdf_long lInputLen = -1 )
+        : m_pInputStream( pInputStream ), m_stream( key, keylen ), m_lInputLeft( lInputLen ),
+          m_lIVLen( 0 ), m_bHasData( false ), m_bEof( false ), m_lBufferPos( 0 ), m_lBufferLen( 0 )
     {
     }
     
@@ -462,27 +606,109 @@ public:
     
     /** Read data from the input stream
      *  
-     *  \param pBuffer    the data will be stored into this buffer
-     *  \param lLen       the size of the buffer and number of bytes
-     *                    that will be read
-     *  \param pTotalLeft total bytes left (needed for AES IV and padding)
+     *  \param pBuffer the data will be stored into this buffer
+     *  \param lLen    the size of the buffer and number of bytes
+     *                 that will be read
      *
      *  \returns the number of bytes read, -1 if an error ocurred
      *           and zero if no more bytes are available for reading.
      */
-    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long *pTotalLeft )
+    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* )
     {
-        // Do not encode data with no length
-        if( !lLen )
-            return lLen;
-        
-		m_pInputStream->Read( pBuffer, lLen );
-        return m_stream.Decrypt( (unsigned char*)pBuffer, lLen, pTotalLeft );
+        pdf_long lRead = 0;
+        while( lRead < lLen ) 
+        {
+            if( m_lBufferPos == m_lBufferLen ) 
+            {
+                if( m_bEof || !this->FillBuffer() )
+                    break;
+
+                continue;
+            }
+
+            pdf_long lCopy = PDF_MIN( lLen - lRead, m_lBufferLen - m_lBufferPos );
+            memcpy( pBuffer + lRead, m_buffer + m_lBufferPos, lCopy );
+            m_lBufferPos += lCopy;
+            lRead        += lCopy;
+        }
+
+        return lRead;
     }
-    
+
 private:
+    /** Decrypt the next block of the input stream into m_buffer
+     *
+     *  \returns false if no more data is available
+     */
+    bool FillBuffer()
+    {
+        unsigned char input[BUFFER_SIZE];
+        pdf_long      lInput = BUFFER_SIZE;
+        if( m_lInputLeft >= 0 )
+            lInput = PDF_MIN( lInput, m_lInputLeft );
+
+        if( lInput > 0 ) 
+        {
+            lInput = m_pInputStream->Read( reinterpret_cast<char*>(input), lInput );
+            if( lInput < 0 )
+                PODOFO_RAISE_ERROR( ePdfError_InvalidDataType );
+        }
+
+        m_lBufferPos = 0;
+        m_lBufferLen = 0;
+
+        if( !lInput ) 
+        {
+            // An empty stream or a stream containing only 
+            // the initialization vector decrypts to no data
+            if( m_bHasData ) 
+                m_lBufferLen = m_stream.Finish( m_buffer );
+
+            m_bEof = true;
+            return m_lBufferLen > 0;
+        }
+
+        if( m_lInputLeft >= 0 )
+            m_lInputLeft -= lInput;
+
+        const unsigned char* pInput = input;
+        if( m_lIVLen < AES_IV_LENGTH ) 
+        {
+            // The first 16 bytes are the initialization vector
+            pdf_long lIV = PDF_MIN( lInput, static_cast<pdf_long>(AES_IV_LENGTH) - m_lIVLen );
+            memcpy( m_iv + m_lIVLen, pInput, lIV );
+            m_lIVLen += lIV;
+            pInput   += lIV;
+            lInput   -= lIV;
+
+            if( m_lIVLen == AES_IV_LENGTH ) 
+                m_stream.Init( m_iv, false );
+        }
+
+        if( lInput > 0 ) 
+        {
+            m_lBufferLen = m_stream.Update( pInput, lInput, m_buffer );
+            m_bHasData   = true;
+        }
+
+        return true;
+    }
+
+private:
+    enum { BUFFER_SIZE = 4096 };
+
     PdfInputStream* m_pInputStream;
-    PdfAESStream m_stream;
+    PdfAESStream    m_stream;
+    pdf_long        m_lInputLeft;      ///< bytes left in m_pInputStream, -1 if unknown
+
+    unsigned char   m_iv[AES_IV_LENGTH];
+    pdf_long        m_lIVLen;
+    bool            m_bHasData;        ///< true if any data has been passed to the cipher
+    bool            m_bEof;
+
+    unsigned char   m_buffer[BUFFER_SIZE + AES_IV_LENGTH];
+    pdf_long        m_lBufferPos;
+    pdf_long        m_lBufferLen;
 };
 
 /***************************************************************************
@@ -675,6 +901,7 @@ PdfEncrypt::CreatePdfEncrypt(const PdfEncrypt & rhs )
 }
 
 PdfEncrypt::PdfEncrypt( const PdfEncrypt & rhs )
+    : m_pMutex( new Util::PdfMutex() )
 {
     m_eAlgorithm = rhs.m_eAlgorithm;
     m_eKeyLength = rhs.m_eKeyLength;
@@ -937,6 +1164,17 @@ void PdfEncryptMD5Base::CreateObjKey( unsigned char objkey[16], int* pnKeyLen )
 {
     const unsigned int n = static_cast<unsigned int>(m_curReference.ObjectNumber());
     const unsigned int g = static_cast<unsigned int>(m_curReference.GenerationNumber());
+
+    // All strings of an object share the same key, so avoid 
+    // calculating an MD5 hash for each of them
+    TObjKey & rCached = m_objKeyCache[n % OBJ_KEY_CACHE_SIZE];
+    if( rCached.nKeyLen && rCached.reference == m_curReference 
+        && memcmp( rCached.key, m_encryptionKey, m_keyLength ) == 0 )
+    {
+        memcpy( objkey, rCached.objkey, MD5_DIGEST_LENGTH );
+        *pnKeyLen = rCached.nKeyLen;
+        return;
+    }
     
     unsigned char nkey[MD5_DIGEST_LENGTH+5+4];
     int nkeylen = m_keyLength + 5;
@@ -964,6 +1202,11 @@ void PdfEncryptMD5Base::CreateObjKey( unsigned char objkey[16], int* pnKeyLen )
     
     GetMD5Binary(nkey, nkeylen, objkey);
     *pnKeyLen = (m_keyLength <= 11) ? m_keyLength+5 : 16;
+
+    rCached.reference = m_curReference;
+    rCached.nKeyLen   = *pnKeyLen;
+    memcpy( rCached.key, m_encryptionKey, m_keyLength );
+    memcpy( rCached.objkey, objkey, MD5_DIGEST_LENGTH );
 }
 
 #ifndef PODOFO_HAVE_OPENSSL_NO_RC4
@@ -991,17 +1234,7 @@ PdfEncryptRC4Base::RC4(const unsigned char* key, int keylen,
     if(textlen != textoutlen)
         PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error initializing RC4 encryption engine" );
     
-    // Don't set the key because we will modify the parameters
-    int status = EVP_EncryptInit_ex(rc4, EVP_rc4(), NULL, NULL, NULL);
-    if(status != 1)
-        PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error initializing RC4 encryption engine" );
-    
-    status = EVP_CIPHER_CTX_set_key_length(rc4, keylen);
-    if(status != 1)
-        PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error initializing RC4 encryption engine" );
-    
-    // We finished modifying parameters so now we can set the key
-    status = EVP_EncryptInit_ex(rc4, NULL, NULL, key, NULL);
+    int status = m_rc4->init(key, keylen);
     if(status != 1)
         PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Error initializing RC4 encryption engine" );
     
@@ -1181,14 +1414,14 @@ PdfEncryptRC4::Decrypt(const unsigned char* inStr, pdf_long inLen,
     Encrypt(inStr, inLen, outStr, outLen);
 }
 
-PdfInputStream* PdfEncryptRC4::CreateEncryptionInputStream( PdfInputStream* pInputStream )
+PdfInputStream* PdfEncryptRC4::CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen )
 {
     unsigned char objkey[MD5_DIGEST_LENGTH];
     int keylen;
     
     this->CreateObjKey( objkey, &keylen );
     
-    return new PdfRC4InputStream( pInputStream, m_rc4key, m_rc4last, objkey, keylen );
+    return new PdfRC4InputStream( pInputStream, m_rc4key, m_rc4last, objkey, keylen, lInputLen );
 }
 
 PdfEncryptRC4::PdfEncryptRC4(PdfString oValue, PdfString uValue, int pValue, int rValue, EPdfEncryptAlgorithm eAlgorithm, long length, bool encryptMetadata)
@@ -1284,10 +1517,10 @@ PdfEncryptAESBase::BaseDecrypt(const unsigned char* key, int keyLen, const unsig
     
     int status;
     if(keyLen == PdfEncrypt::ePdfKeyLength_128/8)
-        status = EVP_DecryptInit_ex(aes, EVP_aes_128_cbc(), NULL, key, iv);
+        status = m_aes->init(EVP_aes_128_cbc(), key, iv, 0);
 #ifdef PODOFO_HAVE_LIBIDN
     else if (keyLen == PdfEncrypt::ePdfKeyLength_256/8)
-        status = EVP_DecryptInit_ex(aes, EVP_aes_256_cbc(), NULL, key, iv);
+        status = m_aes->init(EVP_aes_256_cbc(), key, iv, 0);
 #endif
     else
         PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Invalid AES key length" );
@@ -1315,10 +1548,10 @@ PdfEncryptAESBase::BaseEncrypt(const unsigned char* key, int keyLen, const unsig
     
     int status;
     if(keyLen == PdfEncrypt::ePdfKeyLength_128/8)
-        status = EVP_EncryptInit_ex(aes, EVP_aes_128_cbc(), NULL, key, iv);
+        status = m_aes->init(EVP_aes_128_cbc(), key, iv, 1);
 #ifdef PODOFO_HAVE_LIBIDN
     else if (keyLen == PdfEncrypt::ePdfKeyLength_256/8)
-        status = EVP_EncryptInit_ex(aes, EVP_aes_256_cbc(), NULL, key, iv);
+        status = m_aes->init(EVP_aes_256_cbc(), key, iv, 1);
 #endif
     else
         PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Invalid AES key length" );
@@ -1475,24 +1708,26 @@ PdfEncryptAESV2::CalculateStreamLength(pdf_long length) const
     return realLength;
 }
     
-PdfInputStream* PdfEncryptAESV2::CreateEncryptionInputStream( PdfInputStream* pInputStream )
+PdfInputStream* PdfEncryptAESV2::CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen )
 {
     unsigned char objkey[MD5_DIGEST_LENGTH];
     int keylen;
      
     this->CreateObjKey( objkey, &keylen );
 
-	return new PdfAESInputStream( pInputStream, objkey, keylen );
+	return new PdfAESInputStream( pInputStream, objkey, keylen, lInputLen );
 }
     
-PdfOutputStream* PdfEncryptAESV2::CreateEncryptionOutputStream( PdfOutputStream* )
+PdfOutputStream* PdfEncryptAESV2::CreateEncryptionOutputStream( PdfOutputStream* pOutputStream )
 {
-    /*unsigned char objkey[MD5_DIGEST_LENGTH];
-     int keylen;
+    unsigned char objkey[MD5_DIGEST_LENGTH];
+    unsigned char iv[AES_IV_LENGTH];
+    int keylen;
      
-     this->CreateObjKey( objkey, &keylen );*/
+    this->CreateObjKey( objkey, &keylen );
+    this->GenerateInitialVector( iv );
     
-    PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "CreateEncryptionOutputStream does not yet support AESV2" );
+    return new PdfAESOutputStream( pOutputStream, objkey, keylen, iv );
 }
     
 #ifdef PODOFO_HAVE_LIBIDN
@@ -1989,14 +2224,18 @@ PdfEncryptAESV3::CalculateStreamLength(pdf_long length) const
     return realLength;
 }
 
-PdfInputStream* PdfEncryptAESV3::CreateEncryptionInputStream( PdfInputStream* pInputStream )
+PdfInputStream* PdfEncryptAESV3::CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen )
 {
-	return new PdfAESInputStream( pInputStream, m_encryptionKey, 32 );
+	return new PdfAESInputStream( pInputStream, m_encryptionKey, 32, lInputLen );
 }
 
-PdfOutputStream* PdfEncryptAESV3::CreateEncryptionOutputStream( PdfOutputStream* )
+PdfOutputStream* PdfEncryptAESV3::CreateEncryptionOutputStream( PdfOutputStream* pOutputStream )
 {
-    PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "CreateEncryptionOutputStream does not yet support AESV3" );
+    unsigned char iv[AES_IV_LENGTH];
+
+    this->GenerateInitialVector( iv );
+
+    return new PdfAESOutputStream( pOutputStream, m_encryptionKey, 32, iv );
 }
     
 #endif // PODOFO_HAVE_LIBIDN
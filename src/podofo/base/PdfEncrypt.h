@@ -37,6 +37,7 @@
 #include "PdfDefines.h"
 #include "PdfString.h"
 #include "PdfReference.h"
+#include "util/PdfMutex.h"
 
 #include <string.h>
 
@@ -227,7 +228,9 @@ public:
     /** Create a PdfOutputStream that encrypts all data written to 
      *  it using the current settings of the PdfEncrypt object.
      *
-     *  Warning: Currently only RC4 based encryption is supported using output streams!
+     *  For AES the initialization vector is written first and the
+     *  padding is added when the returned stream is closed, so
+     *  PdfOutputStream::Close() has to be called before deleting it.
      *  
      *  \param pOutputStream the created PdfOutputStream writes all encrypted
      *         data to this output stream.
@@ -239,14 +242,19 @@ public:
     /** Create a PdfInputStream that decrypts all data read from 
      *  it using the current settings of the PdfEncrypt object.
      *
-     *  Warning: Currently only RC4 based encryption is supported using output streams!
+     *  For AES the encrypted data ends with a padded block, so the stream
+     *  has to know where the data ends: either the input stream returns
+     *  no more data at the end or the length of the encrypted data is
+     *  passed as lInputLen.
      *  
      *  \param pInputStream the created PdfInputStream reads all decrypted
      *         data to this input stream.
+     *  \param lInputLen number of encrypted bytes to read from pInputStream
+     *         or -1 to read until pInputStream returns no more data.
      *
      *  \returns a PdfInputStream that decrypts all data.
      */
-    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream ) = 0;
+    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen = -1 ) = 0;
 
     /**
      * Tries to authenticate a user using either the user or owner password
@@ -402,15 +410,25 @@ public:
      */
     inline void SetCurrentReference( const PdfReference & rRef );
 
+    /** Get the mutex which guards the state of this object.
+     *
+     *  The current reference and the cipher contexts used by
+     *  Encrypt and Decrypt are shared by all objects of a document.
+     *  If a PdfEncrypt object is used from several threads, hold
+     *  this mutex from SetCurrentReference until the call of
+     *  Encrypt, Decrypt, CreateEncryptionInputStream or 
+     *  CreateEncryptionOutputStream has returned.
+     *
+     *  The streams returned by CreateEncryptionInputStream and
+     *  CreateEncryptionOutputStream have their own cipher state 
+     *  and may be used without holding the mutex.
+     *
+     *  \returns the mutex of this object
+     */
+    inline Util::PdfMutex & GetMutex() const;
+
 protected:
-    PdfEncrypt()
-        : m_eAlgorithm( ePdfEncryptAlgorithm_AESV2 ), m_keyLength( 0 ), m_rValue( 0 ), m_pValue( 0 ),
-        m_eKeyLength( ePdfKeyLength_128 ), m_bEncryptMetadata(true)
-    {
-        memset( m_uValue, 0, 48 );
-        memset( m_oValue, 0, 48 );
-        memset( m_encryptionKey, 0, 32 );
-    };
+    PdfEncrypt();
 
     PdfEncrypt( const PdfEncrypt & rhs );
     
@@ -432,6 +450,12 @@ protected:
 	bool           m_bEncryptMetadata;   ///< Is metadata encrypted
     
 private:    
+    /** Assignment is not supported, use CreatePdfEncrypt to copy a PdfEncrypt object.
+     */
+    const PdfEncrypt & operator=( const PdfEncrypt & rhs );
+
+    Util::PdfMutex* m_pMutex;            ///< Guards the current reference and the cipher contexts
+
     static int     s_nEnabledEncryptionAlgorithms; ///< Or'ed int containing the enabled encryption algorithms
 };
 
@@ -456,7 +480,7 @@ public:
      */ 
     virtual ~PdfEncryptSHABase() {};
     
-    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream ) = 0;
+    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen = -1 ) = 0;
     virtual PdfOutputStream* CreateEncryptionOutputStream( PdfOutputStream* pOutputStream ) = 0;
     
     virtual void CreateEncryptionDictionary( PdfDictionary & rDictionary ) const;
@@ -589,7 +613,7 @@ public:
      */ 
     virtual ~PdfEncryptMD5Base() {};
     
-    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream ) = 0;
+    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen = -1 ) = 0;
     virtual PdfOutputStream* CreateEncryptionOutputStream( PdfOutputStream* pOutputStream ) = 0;
     
     virtual void CreateEncryptionDictionary( PdfDictionary & rDictionary ) const;
@@ -649,7 +673,22 @@ protected:
     
     unsigned char  m_rc4key[16];         ///< last RC4 key
     unsigned char  m_rc4last[256];       ///< last RC4 state table
-    
+
+ private:
+    /** An object key cached by CreateObjKey()
+     */
+    struct TObjKey {
+        TObjKey() : nKeyLen( 0 ) {}
+
+        PdfReference  reference;         ///< the object the key belongs to
+        unsigned char key[16];           ///< the encryption key the object key was derived from
+        unsigned char objkey[16];        ///< the object key
+        int           nKeyLen;           ///< the length of objkey, 0 if the entry is unused
+    };
+
+    enum { OBJ_KEY_CACHE_SIZE = 64 };    ///< number of cached object keys
+
+    mutable TObjKey m_objKeyCache[OBJ_KEY_CACHE_SIZE]; ///< object keys indexed by object number
 };
     
 /** A class that is used to encrypt a PDF file (AES-128)
@@ -683,7 +722,7 @@ public:
 	*/ 
 	virtual ~PdfEncryptAESV2() {};
     
-	virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream );
+	virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen = -1 );
 	virtual PdfOutputStream* CreateEncryptionOutputStream( PdfOutputStream* pOutputStream );
     
     virtual bool Authenticate( const std::string & password, const PdfString & documentId );
@@ -734,7 +773,7 @@ public:
      */ 
     virtual ~PdfEncryptAESV3() {};
     
-    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream );
+    virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen = -1 );
     virtual PdfOutputStream* CreateEncryptionOutputStream( PdfOutputStream* pOutputStream );
     
     virtual bool Authenticate( const std::string & password, const PdfString & documentId );
@@ -796,7 +835,7 @@ public:
     virtual void Decrypt(const unsigned char* inStr, pdf_long inLen,
                          unsigned char* outStr, pdf_long &outLen) const;
 
-	virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream );
+	virtual PdfInputStream* CreateEncryptionInputStream( PdfInputStream* pInputStream, pdf_long lInputLen = -1 );
 	virtual PdfOutputStream* CreateEncryptionOutputStream( PdfOutputStream* pOutputStream );
     
     virtual void GenerateEncryptionKey(const PdfString & documentId);
@@ -823,6 +862,14 @@ void PdfEncrypt::SetCurrentReference( const PdfReference & rRef )
     m_curReference = rRef;
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+Util::PdfMutex & PdfEncrypt::GetMutex() const
+{
+    return *m_pMutex;
+}
+
 // -----------------------------------------------------
 // 
 // -----------------------------------------------------
@@ -35,12 +35,88 @@
 
 #include "PdfEncrypt.h"
 #include "PdfFilter.h"
+#include "PdfInputStream.h"
 #include "PdfOutputDevice.h"
 #include "PdfOutputStream.h"
 #include "PdfDefinesPrivate.h"
 
+#include "util/PdfMutexWrapper.h"
+
 namespace PoDoFo {
 
+/** Reads a range of an output device.
+ *  Keeps its own read position and restores the position of the
+ *  device after each read, so that writing can continue afterwards.
+ */
+class PdfDeviceRangeInputStream : public PdfInputStream {
+ public:
+    PdfDeviceRangeInputStream( PdfOutputDevice* pDevice, pdf_long lOffset, pdf_long lLength )
+        : m_pDevice( pDevice ), m_lOffset( lOffset ), m_lLeft( lLength )
+    {
+    }
+
+    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* = 0 )
+    {
+        lLen = PDF_MIN( lLen, m_lLeft );
+        if( lLen <= 0 )
+            return 0;
+
+        size_t lPos = m_pDevice->Tell();
+        m_pDevice->Seek( m_lOffset );
+        pdf_long lRead = static_cast<pdf_long>(m_pDevice->Read( pBuffer, lLen ));
+        m_pDevice->Seek( lPos );
+
+        if( lRead != lLen )
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_UnexpectedEOF, "Cannot read stream data back from the output device" );
+        }
+
+        m_lOffset += lRead;
+        m_lLeft   -= lRead;
+        return lRead;
+    }
+
+ private:
+    PdfOutputDevice* m_pDevice;
+    pdf_long         m_lOffset;
+    pdf_long         m_lLeft;
+};
+
+/** Reads the data of a PdfFileStream back from its output device
+ *  and decrypts it if the stream was written encrypted.
+ */
+class PdfFileStreamInputStream : public PdfInputStream {
+ public:
+    PdfFileStreamInputStream( PdfOutputDevice* pDevice, pdf_long lOffset, pdf_long lLength,
+                              PdfEncrypt* pEncrypt, const PdfReference & rRef )
+        : m_reader( pDevice, lOffset, lLength ), m_pDecrypt( NULL )
+    {
+        if( pEncrypt ) 
+        {
+            Util::PdfMutexWrapper wrapper( pEncrypt->GetMutex() );
+            pEncrypt->SetCurrentReference( rRef );
+            m_pDecrypt = pEncrypt->CreateEncryptionInputStream( &m_reader, lLength );
+        }
+    }
+
+    virtual ~PdfFileStreamInputStream()
+    {
+        delete m_pDecrypt;
+    }
+
+    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* = 0 )
+    {
+        if( m_pDecrypt )
+            return m_pDecrypt->Read( pBuffer, lLen );
+        else
+            return m_reader.Read( pBuffer, lLen );
+    }
+
+ private:
+    PdfDeviceRangeInputStream m_reader;
+    PdfInputStream*           m_pDecrypt;
+};
+
 PdfFileStream::PdfFileStream( PdfObject* pParent, PdfOutputDevice* pDevice )
     : PdfStream( pParent ), m_pDevice( pDevice ), m_pStream( NULL ), m_pDeviceStream( NULL ),
       m_pEncryptStream( NULL ), m_lLenInitial( 0 ), m_lLength( 0 ), m_pCurEncrypt( NULL )
@@ -114,22 +190,51 @@ void PdfFileStream::EndAppendImpl()
         m_pDeviceStream = NULL;
     }
 
+    // The encryption stream has already written any
+    // initialization vector and padding to the device
     m_lLength = m_pDevice->GetLength() - m_lLenInitial;
-    if( m_pCurEncrypt ) 
+    m_pLength->SetNumber( static_cast<long>(m_lLength) );
+}
+
+void PdfFileStream::GetCopy( char** pBuffer, pdf_long* lLen ) const
+{
+    if( !pBuffer || !lLen )
     {
-        m_lLength = m_pCurEncrypt->CalculateStreamLength(m_lLength);
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
     }
-    m_pLength->SetNumber( static_cast<long>(m_lLength) );
+
+    PdfMemoryOutputStream stream;
+    this->GetCopy( &stream );
+
+    *lLen    = stream.GetLength();
+    *pBuffer = stream.TakeBuffer();
 }
 
-void PdfFileStream::GetCopy( char**, pdf_long* ) const
+void PdfFileStream::GetCopy( PdfOutputStream* pStream ) const
 {
-    PODOFO_RAISE_ERROR( ePdfError_InternalLogic );
+    if( !pStream )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    PODOFO_UNIQUEU_PTR<PdfInputStream> pInput( this->CreateInputStream() );
+
+    const pdf_long BUFFER_SIZE = 65536;
+    char           buffer[BUFFER_SIZE];
+    pdf_long       lRead;
+    while( (lRead = pInput->Read( buffer, BUFFER_SIZE )) > 0 )
+        pStream->Write( buffer, lRead );
 }
 
-void PdfFileStream::GetCopy(PdfOutputStream*) const
+PdfInputStream* PdfFileStream::CreateInputStream() const
 {
-	PODOFO_RAISE_ERROR( ePdfError_InternalLogic );
+    if( m_pStream )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Cannot read a PdfFileStream while appending to it" );
+    }
+
+    return new PdfFileStreamInputStream( m_pDevice, m_lLenInitial, m_lLength, 
+                                         m_pCurEncrypt, m_pParent->Reference() );
 }
 
 void PdfFileStream::SetEncrypted( PdfEncrypt* pEncrypt ) 
@@ -92,8 +92,8 @@ class PODOFO_API PdfFileStream : public PdfStream {
      *
      *  The caller has to podofo_free() the buffer.
      *
-     *  This is currently not implemented for PdfFileStreams 
-     *  and will raise an ePdfError_InternalLogic exception
+     *  The data is read back from the output device, so this
+     *  requires a device which supports reading (e.g. a file).
      *
      *  \param pBuffer pointer to the buffer address (output parameter)
      *  \param lLen    pointer to the buffer length  (output parameter)
@@ -113,6 +113,13 @@ class PODOFO_API PdfFileStream : public PdfStream {
      */
     inline virtual pdf_long GetLength() const;
 
+    /** Create a PdfInputStream which reads the stream data back
+     *  from the output device, decrypting it if required.
+     *
+     *  \returns a new PdfInputStream that has to be deleted by the caller
+     */
+    virtual PdfInputStream* CreateInputStream() const;
+
  protected:
     /** Required for the GetFilteredCopy implementation
      *  \returns a handle to the internal buffer
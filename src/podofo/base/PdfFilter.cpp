@@ -226,6 +226,104 @@ private:
 };
 
 
+/** A PdfInputStream which decodes the data of another PdfInputStream.
+ *
+ *  Data is read from the source stream in small windows and passed
+ *  through a chain of PdfFilteredDecodeStream objects. Only the decoded
+ *  data of the current window is kept in memory, so the memory
+ *  required does not depend on the size of the source data.
+ */
+class PdfFilteredDecodeInputStream : public PdfInputStream {
+ public:
+    /** Create a decoding input stream.
+     *
+     *  \param filters a list of filters which are applied when reading
+     *  \param pInputStream read the encoded data from this stream
+     *  \param pDictionary dictionary which might contain the DecodeParms key
+     *  \param bOwnStream if true pInputStream will be deleted along with this stream
+     */
+    PdfFilteredDecodeInputStream( const TVecFilters & filters, PdfInputStream* pInputStream, 
+                                  const PdfDictionary* pDictionary, bool bOwnStream )
+        : m_pInputStream( pInputStream ), m_pDecodeStream( NULL ), m_pWindowStream( NULL ),
+          m_lOffset( 0 ), m_bOwnStream( bOwnStream ), m_bEof( false )
+    {
+        m_pWindowStream = new PdfMemoryOutputStream( PODOFO_FILTER_INTERNAL_BUFFER_SIZE );
+        try {
+            m_pDecodeStream = PdfFilterFactory::CreateDecodeStream( filters, m_pWindowStream, pDictionary );
+        }
+        catch( PdfError & e ) 
+        {
+            delete m_pWindowStream;
+            throw e;
+        }
+    }
+
+    virtual ~PdfFilteredDecodeInputStream()
+    {
+        delete m_pDecodeStream;
+        delete m_pWindowStream;
+
+        if( m_bOwnStream )
+            delete m_pInputStream;
+    }
+
+    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* = 0 )
+    {
+        pdf_long lRead = 0;
+        while( lRead < lLen ) 
+        {
+            if( m_lOffset == m_pWindowStream->GetLength() )
+            {
+                if( m_bEof || !this->FillWindow() )
+                    break;
+
+                continue;
+            }
+
+            pdf_long lCopy = PDF_MIN( lLen - lRead, m_pWindowStream->GetLength() - m_lOffset );
+            memcpy( pBuffer + lRead, m_pWindowStream->GetBuffer() + m_lOffset, lCopy );
+            m_lOffset += lCopy;
+            lRead     += lCopy;
+        }
+
+        return lRead;
+    }
+
+ private:
+    /** Decode the next window of source data.
+     *
+     *  \returns false if the end of the source stream was reached
+     *           and no more decoded data is available
+     */
+    bool FillWindow()
+    {
+        char     buffer[PODOFO_FILTER_INTERNAL_BUFFER_SIZE];
+        pdf_long lLen = m_pInputStream->Read( buffer, PODOFO_FILTER_INTERNAL_BUFFER_SIZE );
+
+        // Reuse the memory of the current window
+        m_pWindowStream->Rewind();
+        m_lOffset = 0;
+
+        if( lLen > 0 )
+            m_pDecodeStream->Write( buffer, lLen );
+        else
+        {
+            m_pDecodeStream->Close();
+            m_bEof = true;
+        }
+
+        return lLen > 0 || m_pWindowStream->GetLength();
+    }
+
+ private:
+    PdfInputStream*        m_pInputStream;
+    PdfOutputStream*       m_pDecodeStream;
+    PdfMemoryOutputStream* m_pWindowStream;
+    pdf_long               m_lOffset;
+    bool                   m_bOwnStream;
+    bool                   m_bEof;
+};
+
 // -----------------------------------------------------
 // Actual PdfFilter code
 // -----------------------------------------------------
@@ -316,12 +414,8 @@ PdfFilter* PdfFilterFactory::Create( const EPdfFilter eFilter )
 #endif // PODOFO_HAVE_JPEG_LIB
 
         case ePdfFilter_CCITTFaxDecode:
-#ifdef PODOFO_HAVE_TIFF_LIB
             pFilter = new PdfCCITTFilter();
             break;
-#else
-            break;
-#endif // PODOFO_HAVE_TIFF_LIB
 
 
         case ePdfFilter_JBIG2Decode:
@@ -375,6 +469,14 @@ PdfOutputStream* PdfFilterFactory::CreateDecodeStream( const TVecFilters & filte
     return pFilterStream;
 }
 
+PdfInputStream* PdfFilterFactory::CreateDecodeInputStream( const TVecFilters & filters, PdfInputStream* pStream,
+                                                           const PdfDictionary* pDictionary, bool bOwnStream ) 
+{
+    PODOFO_RAISE_LOGIC_IF( !filters.size(), "Cannot create an DecodeInputStream from an empty list of filters" );
+
+    return new PdfFilteredDecodeInputStream( filters, pStream, pDictionary, bOwnStream );
+}
+
 EPdfFilter PdfFilterFactory::FilterNameToType( const PdfName & name, bool bSupportShortNames )
 {
     int i = 0;
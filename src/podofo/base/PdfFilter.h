@@ -502,6 +502,28 @@ class PODOFO_API PdfFilterFactory {
     static PdfOutputStream* CreateDecodeStream( const TVecFilters & filters, PdfOutputStream* pStream, 
                                                 const PdfDictionary* pDictionary = NULL );
 
+    /** Create a PdfInputStream that applies a list of filters 
+     *  on all data read from another PdfInputStream.
+     *
+     *  The data is decoded in small windows while it is read, so
+     *  the decoded data is never held in memory as a whole.
+     *
+     *  \param filters a list of filters
+     *  \param pStream read the encoded data from this PdfInputStream
+     *  \param pDictionary pointer to a dictionary that might
+     *         contain additional parameters for stream decoding.
+     *         This method will look for a key named DecodeParms
+     *         in this dictionary and pass the information found
+     *         in that dictionary to the filters.
+     *  \param bOwnStream if true pStream is deleted along with the returned stream
+     *  \returns a new PdfInputStream that has to be deleted by the caller.
+     *
+     *  \see PdfFilterFactory::CreateFilterList
+     *  \see PdfStream::CreateFilteredInputStream
+     */
+    static PdfInputStream* CreateDecodeInputStream( const TVecFilters & filters, PdfInputStream* pStream, 
+                                                    const PdfDictionary* pDictionary = NULL, bool bOwnStream = false );
+
     /** Converts a filter name to the corresponding enum
      *  \param name of the filter without leading
      *  \param bSupportShortNames The PDF Reference supports several
@@ -49,20 +49,10 @@ extern "C" {
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef PODOFO_HAVE_TIFF_LIB
-extern "C" {
-#ifdef _WIN32		// For O_RDONLY
-    // TODO: DS
-#else
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#endif
-}
-#endif // PODOFO_HAVE_TIFF_LIB
-
 
 #define LZW_TABLE_SIZE      4096
+#define LZW_FIRST_CODE      258
+#define LZW_HASH_SIZE       8192
 
 namespace {
 
@@ -685,53 +675,144 @@ void PdfFlateFilter::EndDecodeImpl()
 // -------------------------------------------------------
 
 PdfRLEFilter::PdfRLEFilter()
-    : m_nCodeLen( 0 )
+    : m_nCodeLen( 0 ), m_bRepeat( false ), m_bEOD( false ),
+      m_nLiteralLen( 0 ), m_cRunByte( 0 ), m_nRunLen( 0 )
 {
 }
 
 void PdfRLEFilter::BeginEncodeImpl()
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    m_nLiteralLen = 0;
+    m_nRunLen     = 0;
 }
 
-void PdfRLEFilter::EncodeBlockImpl( const char*, pdf_long )
+void PdfRLEFilter::EncodeBlockImpl( const char* pBuffer, pdf_long lLen )
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    const char* pEnd = pBuffer + lLen;
+
+    while( pBuffer < pEnd )
+    {
+        if( m_nRunLen && *pBuffer == m_cRunByte )
+        {
+            while( pBuffer < pEnd && *pBuffer == m_cRunByte && m_nRunLen < 128 )
+            {
+                ++m_nRunLen;
+                ++pBuffer;
+            }
+
+            if( m_nRunLen == 128 )
+                this->FlushRun();
+        }
+        else
+        {
+            if( m_nRunLen )
+                this->FlushRun();
+
+            m_cRunByte = *pBuffer;
+            m_nRunLen  = 1;
+            ++pBuffer;
+        }
+    }
 }
 
 void PdfRLEFilter::EndEncodeImpl()
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    const char cEOD = static_cast<char>(128);
+
+    if( m_nRunLen )
+        this->FlushRun();
+
+    this->FlushLiteral();
+    GetStream()->Write( &cEOD, 1 );
+}
+
+void PdfRLEFilter::FlushLiteral()
+{
+    if( !m_nLiteralLen )
+        return;
+
+    const char cLen = static_cast<char>(m_nLiteralLen - 1);
+    GetStream()->Write( &cLen, 1 );
+    GetStream()->Write( m_literal, m_nLiteralLen );
+    m_nLiteralLen = 0;
+}
+
+void PdfRLEFilter::FlushRun()
+{
+    // A run of two bytes only saves space if it does not
+    // interrupt a literal run
+    if( m_nRunLen >= 3 || (m_nRunLen == 2 && !m_nLiteralLen) )
+    {
+        this->FlushLiteral();
+
+        char run[2];
+        run[0] = static_cast<char>(257 - m_nRunLen);
+        run[1] = m_cRunByte;
+        GetStream()->Write( run, 2 );
+    }
+    else
+    {
+        for( int i = 0; i < m_nRunLen; i++ )
+        {
+            m_literal[m_nLiteralLen++] = m_cRunByte;
+            if( m_nLiteralLen == 128 )
+                this->FlushLiteral();
+        }
+    }
+
+    m_nRunLen = 0;
 }
 
 void PdfRLEFilter::BeginDecodeImpl( const PdfDictionary* )
 { 
     m_nCodeLen = 0;
+    m_bRepeat  = false;
+    m_bEOD     = false;
 }
 
 void PdfRLEFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
 {
-    while( lLen-- )
+    char repeat[128];
+
+    while( lLen && !m_bEOD )
     {
         if( !m_nCodeLen )
         {
-            m_nCodeLen = static_cast<int>(*pBuffer);
-        } else if( m_nCodeLen == 128 )
-            break;
-        else if( m_nCodeLen <= 127 )
-        {
-            GetStream()->Write( pBuffer, 1 );
-            m_nCodeLen--;
+            int nCode = static_cast<unsigned char>(*pBuffer);
+            if( nCode == 128 )
+                m_bEOD = true;
+            else if( nCode < 128 )
+            {
+                m_nCodeLen = nCode + 1;
+                m_bRepeat  = false;
+            }
+            else
+            {
+                m_nCodeLen = 257 - nCode;
+                m_bRepeat  = true;
+            }
+
+            ++pBuffer;
+            --lLen;
         }
-        else if( m_nCodeLen >= 129 )
+        else if( m_bRepeat )
         {
-            m_nCodeLen = 257 - m_nCodeLen;
+            memset( repeat, *pBuffer, m_nCodeLen );
+            GetStream()->Write( repeat, m_nCodeLen );
+            m_nCodeLen = 0;
 
-            while( m_nCodeLen-- ) 
-                GetStream()->Write( pBuffer, 1 );
+            ++pBuffer;
+            --lLen;
         }
+        else
+        {
+            pdf_long lCopy = PDF_MIN( static_cast<pdf_long>(m_nCodeLen), lLen );
+            GetStream()->Write( pBuffer, lCopy );
 
-        ++pBuffer;
+            m_nCodeLen -= static_cast<int>(lCopy);
+            pBuffer    += lCopy;
+            lLen       -= lCopy;
+        }
     }
 }
 
@@ -752,28 +833,147 @@ PdfLZWFilter::PdfLZWFilter()
     m_code_len(0),
     m_character(0),
     m_bFirst(false),
+    m_buffer(0),
+    m_buffer_size(0),
+    m_old(0),
+    m_pEncodeKeys( NULL ),
+    m_pEncodeCodes( NULL ),
+    m_next_code(0),
+    m_prefix(-1),
+    m_out_len(0),
     m_pPredictor( 0 )
 {
 }
 
 PdfLZWFilter::~PdfLZWFilter()
 {
+    podofo_free( m_pEncodeKeys );
+    podofo_free( m_pEncodeCodes );
     delete m_pPredictor;
 }
 
 void PdfLZWFilter::BeginEncodeImpl()
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    if( !m_pEncodeKeys )
+    {
+        m_pEncodeKeys  = static_cast<pdf_int32*>(podofo_calloc( LZW_HASH_SIZE, sizeof(pdf_int32) ));
+        m_pEncodeCodes = static_cast<pdf_uint16*>(podofo_calloc( LZW_HASH_SIZE, sizeof(pdf_uint16) ));
+        if( !m_pEncodeKeys || !m_pEncodeCodes )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
+        }
+    }
+
+    InitEncodeTable();
+
+    m_code_len    = 9;
+    m_next_code   = LZW_FIRST_CODE;
+    m_prefix      = -1;
+    m_buffer      = 0;
+    m_buffer_size = 0;
+    m_out_len     = 0;
+
+    // Start with a clear code, like most other encoders do
+    PutCode( PdfLZWFilter::s_clear );
 }
 
-void PdfLZWFilter::EncodeBlockImpl( const char*, pdf_long )
+void PdfLZWFilter::EncodeBlockImpl( const char* pBuffer, pdf_long lLen )
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    while( lLen-- )
+    {
+        pdf_int32 c = static_cast<unsigned char>(*pBuffer++);
+
+        if( m_prefix < 0 )
+        {
+            m_prefix = c;
+            continue;
+        }
+
+        const pdf_int32 key = (m_prefix << 8) | c;
+        pdf_uint32      idx = ((c << 5) ^ m_prefix) & (LZW_HASH_SIZE - 1);
+        while( m_pEncodeKeys[idx] != -1 && m_pEncodeKeys[idx] != key )
+            idx = (idx + 1) & (LZW_HASH_SIZE - 1);
+
+        if( m_pEncodeKeys[idx] == key )
+        {
+            // Extend the current string
+            m_prefix = m_pEncodeCodes[idx];
+            continue;
+        }
+
+        PutCode( m_prefix );
+
+        m_pEncodeKeys[idx]  = key;
+        m_pEncodeCodes[idx] = static_cast<pdf_uint16>(m_next_code++);
+
+        if( m_next_code == LZW_TABLE_SIZE - 2 )
+        {
+            // The table is full, so start again with an empty one
+            PutCode( PdfLZWFilter::s_clear );
+            InitEncodeTable();
+            m_code_len  = 9;
+            m_next_code = LZW_FIRST_CODE;
+        }
+        else if( m_next_code > (1u << m_code_len) - 1 )
+            ++m_code_len; // The decoder switches one code early (EarlyChange 1)
+
+        m_prefix = c;
+    }
 }
 
 void PdfLZWFilter::EndEncodeImpl()
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    if( m_prefix >= 0 )
+    {
+        PutCode( m_prefix );
+
+        // The decoder adds one more entry when reading the last code
+        ++m_next_code;
+        if( m_next_code == LZW_TABLE_SIZE - 2 )
+        {
+            PutCode( PdfLZWFilter::s_clear );
+            m_code_len = 9;
+        }
+        else if( m_next_code > (1u << m_code_len) - 1 )
+            ++m_code_len;
+    }
+
+    PutCode( PdfLZWFilter::s_eod );
+
+    if( m_buffer_size )
+    {
+        m_out[m_out_len++] = static_cast<unsigned char>(m_buffer << (8 - m_buffer_size));
+        m_buffer_size = 0;
+    }
+
+    if( m_out_len )
+    {
+        GetStream()->Write( reinterpret_cast<char*>(m_out), m_out_len );
+        m_out_len = 0;
+    }
+}
+
+void PdfLZWFilter::PutCode( pdf_uint32 code )
+{
+    m_buffer       = (m_buffer << m_code_len) | code;
+    m_buffer_size += m_code_len;
+
+    while( m_buffer_size >= 8 )
+    {
+        m_buffer_size -= 8;
+        m_out[m_out_len++] = static_cast<unsigned char>(m_buffer >> m_buffer_size);
+
+        if( m_out_len == PODOFO_FILTER_INTERNAL_BUFFER_SIZE )
+        {
+            GetStream()->Write( reinterpret_cast<char*>(m_out), m_out_len );
+            m_out_len = 0;
+        }
+    }
+}
+
+void PdfLZWFilter::InitEncodeTable()
+{
+    memset( m_pEncodeKeys, 0xFF, LZW_HASH_SIZE * sizeof(pdf_int32) );
 }
 
 void PdfLZWFilter::BeginDecodeImpl( const PdfDictionary* pDecodeParms )
@@ -784,6 +984,10 @@ void PdfLZWFilter::BeginDecodeImpl( const PdfDictionary* pDecodeParms )
 
     m_bFirst     = true;
 
+    m_buffer      = 0;
+    m_buffer_size = 0;
+    m_old         = 0;
+
     m_pPredictor = pDecodeParms ? new PdfPredictorDecoder( pDecodeParms ) : NULL;
 
     InitTable();
@@ -791,12 +995,9 @@ void PdfLZWFilter::BeginDecodeImpl( const PdfDictionary* pDecodeParms )
 
 void PdfLZWFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
 {
-    unsigned int       buffer_size = 0;
     const unsigned int buffer_max  = 24;
 
-    pdf_uint32         old         = 0;
     pdf_uint32         code        = 0;
-    pdf_uint32         buffer      = 0;
 
     TLzwItem           item;
 
@@ -811,21 +1012,21 @@ void PdfLZWFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
     while( lLen ) 
     {
         // Fill the buffer
-        while( buffer_size <= (buffer_max-8) && lLen )
+        while( m_buffer_size <= (buffer_max-8) && lLen )
         {
-            buffer <<= 8;
-            buffer |= static_cast<pdf_uint32>(static_cast<unsigned char>(*pBuffer));
-            buffer_size += 8;
+            m_buffer <<= 8;
+            m_buffer |= static_cast<pdf_uint32>(static_cast<unsigned char>(*pBuffer));
+            m_buffer_size += 8;
 
             ++pBuffer;
             lLen--;
         }
 
         // read from the buffer
-        while( buffer_size >= m_code_len ) 
+        while( m_buffer_size >= m_code_len ) 
         {
-            code         = (buffer >> (buffer_size - m_code_len)) & PdfLZWFilter::s_masks[m_mask];
-            buffer_size -= m_code_len;
+            code           = (m_buffer >> (m_buffer_size - m_code_len)) & PdfLZWFilter::s_masks[m_mask];
+            m_buffer_size -= m_code_len;
 
             if( code == PdfLZWFilter::s_clear ) 
             {
@@ -843,11 +1044,11 @@ void PdfLZWFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
             {
                 if( code >= m_table.size() )
                 {
-                    if (old >= m_table.size())
+                    if (m_old >= m_table.size())
                     {
                         PODOFO_RAISE_ERROR( ePdfError_ValueOutOfRange );
                     }
-                    data = m_table[old].value;
+                    data = m_table[m_old].value;
                     data.push_back( m_character );
                 }
                 else
@@ -860,14 +1061,14 @@ void PdfLZWFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
                     GetStream()->Write( reinterpret_cast<char*>(&(data[0])), data.size());
 
                 m_character = data[0];
-                if( old < m_table.size() ) // fix the first loop
-                    data = m_table[old].value;
+                if( m_old < m_table.size() ) // fix the first loop
+                    data = m_table[m_old].value;
                 data.push_back( m_character );
 
                 item.value = data;
                 m_table.push_back( item );
 
-                old = code;
+                m_old = code;
 
                 switch( m_table.size() ) 
                 {
@@ -939,18 +1140,74 @@ void JPegErrorOutput(j_common_ptr, int)
 
 };
 
+/*
+ * A suspending data source for PdfDCTFilter
+ */
+METHODDEF(void)
+dct_init_source (j_decompress_ptr)
+{
+}
+
+METHODDEF(boolean)
+dct_fill_input_buffer (j_decompress_ptr cinfo)
+{
+    PdfDCTSource* src = reinterpret_cast<PdfDCTSource*>(cinfo->src);
+    if( !src->bEof )
+        return FALSE; // suspend until the next block of data arrives
+
+    // The data is truncated, insert a fake EOI marker to
+    // get as many scanlines as possible
+    WARNMS(cinfo, JWRN_JPEG_EOF);
+
+    src->eoi[0] = static_cast<JOCTET>(0xFF);
+    src->eoi[1] = static_cast<JOCTET>(JPEG_EOI);
+    src->pub.next_input_byte = src->eoi;
+    src->pub.bytes_in_buffer = 2;
+
+    return TRUE;
+}
+
+METHODDEF(void)
+dct_skip_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+    PdfDCTSource* src = reinterpret_cast<PdfDCTSource*>(cinfo->src);
+    if( num_bytes <= 0 )
+        return;
+
+    if( num_bytes > static_cast<long>(src->pub.bytes_in_buffer) ) 
+    {
+        // Skip the remaining bytes when the next block arrives
+        src->lSkip += num_bytes - static_cast<long>(src->pub.bytes_in_buffer);
+        src->pub.next_input_byte += src->pub.bytes_in_buffer;
+        src->pub.bytes_in_buffer  = 0;
+    }
+    else
+    {
+        src->pub.next_input_byte += static_cast<size_t>(num_bytes);
+        src->pub.bytes_in_buffer -= static_cast<size_t>(num_bytes);
+    }
+}
+
+METHODDEF(void)
+dct_term_source (j_decompress_ptr)
+{
+}
+
 /*
  * The actual filter implementation
  */
 PdfDCTFilter::PdfDCTFilter()
-    : m_pDevice( NULL )
+    : m_pScanlines( NULL ), m_eState( eDecodeState_Header )
 {
     memset( &m_cinfo, 0, sizeof( struct jpeg_decompress_struct ) );
     memset( &m_jerr, 0, sizeof( struct jpeg_error_mgr ) );
+    memset( &m_source, 0, sizeof( PdfDCTSource ) );
 }
 
 PdfDCTFilter::~PdfDCTFilter()
 {
+    // Does nothing if the decompressor was already destroyed
+    jpeg_destroy_decompress( &m_cinfo );
 }
 
 void PdfDCTFilter::BeginEncodeImpl()
@@ -975,83 +1232,108 @@ void PdfDCTFilter::BeginDecodeImpl( const PdfDictionary* )
     m_jerr.error_exit = &JPegErrorExit;
     m_jerr.emit_message = &JPegErrorOutput;
 
-
     jpeg_create_decompress( &m_cinfo );
 
-    m_pDevice = new PdfOutputDevice( &m_buffer );
+    m_source.pub.init_source       = dct_init_source;
+    m_source.pub.fill_input_buffer = dct_fill_input_buffer;
+    m_source.pub.skip_input_data   = dct_skip_input_data;
+    m_source.pub.resync_to_restart = jpeg_resync_to_restart; /* use default method */
+    m_source.pub.term_source       = dct_term_source;
+    m_source.pub.next_input_byte   = NULL;
+    m_source.pub.bytes_in_buffer   = 0;
+    m_source.bEof                  = false;
+    m_source.lSkip                 = 0;
+
+    m_cinfo.src  = &m_source.pub;
+    m_pScanlines = NULL;
+    m_eState     = eDecodeState_Header;
 }
 
 void PdfDCTFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
 {
-    m_pDevice->Write( pBuffer, lLen );
-}
+    if( m_source.lSkip ) 
+    {
+        pdf_long lSkip = PDF_MIN( lLen, static_cast<pdf_long>(m_source.lSkip) );
+        m_source.lSkip -= static_cast<long>(lSkip);
+        pBuffer        += lSkip;
+        lLen           -= lSkip;
+    }
 
-void PdfDCTFilter::EndDecodeImpl()
-{
-    delete m_pDevice;
-    m_pDevice = NULL;
+    if( lLen <= 0 || m_eState == eDecodeState_Done )
+        return;
 
-    jpeg_memory_src ( &m_cinfo, reinterpret_cast<JOCTET*>(m_buffer.GetBuffer()), m_buffer.GetSize() );
+    // Keep the data libjpeg has not yet consumed and append the new block
+    size_t lKeep = m_source.pub.bytes_in_buffer;
+    if( lKeep && m_source.pub.next_input_byte != reinterpret_cast<JOCTET*>(m_buffer.GetBuffer()) )
+        memmove( m_buffer.GetBuffer(), m_source.pub.next_input_byte, lKeep );
 
-    if( jpeg_read_header(&m_cinfo, TRUE) <= 0 )
-    {
-        (void) jpeg_destroy_decompress(&m_cinfo);
+    if( lKeep + lLen > m_buffer.GetSize() )
+        m_buffer.Resize( lKeep + lLen );
 
-        PODOFO_RAISE_ERROR( ePdfError_UnexpectedEOF );
-    }
+    memcpy( m_buffer.GetBuffer() + lKeep, pBuffer, lLen );
 
-    jpeg_start_decompress(&m_cinfo);
+    m_source.pub.next_input_byte = reinterpret_cast<JOCTET*>(m_buffer.GetBuffer());
+    m_source.pub.bytes_in_buffer = lKeep + lLen;
 
+    this->DecodeAvailable();
+}
 
-    char*      pOutBuffer;
-    JSAMPARRAY pBuffer;	
-    long       lRowBytes   = m_cinfo.output_width * m_cinfo.output_components;
-    const int  iComponents = m_cinfo.output_components;
+void PdfDCTFilter::EndDecodeImpl()
+{
+    m_source.bEof = true;
+    if( m_eState != eDecodeState_Done )
+        this->DecodeAvailable();
 
-    // pBuffer will be deleted by jpeg_destroy_decompress
-    pBuffer    = (*m_cinfo.mem->alloc_sarray)( reinterpret_cast<j_common_ptr>( &m_cinfo ), JPOOL_IMAGE, lRowBytes, 1);
-    pOutBuffer = static_cast<char*>(podofo_calloc( lRowBytes, sizeof(char)) );
-	if (!pOutBuffer)
-	{
-		PODOFO_RAISE_ERROR(ePdfError_OutOfMemory);
-	}
+    (void) jpeg_destroy_decompress( &m_cinfo );
+    m_buffer = PdfRefCountedBuffer();
+}
 
-    while( m_cinfo.output_scanline < m_cinfo.output_height ) 
+void PdfDCTFilter::DecodeAvailable()
+{
+    if( m_eState == eDecodeState_Header )
     {
-        jpeg_read_scanlines(&m_cinfo, pBuffer, 1);
-        if( iComponents == 4 ) 
-        {
-            for( unsigned int i=0, c=0; i < m_cinfo.output_width; i++, c+=4 ) 
-            {
-                pOutBuffer[c]   = pBuffer[0][i*4];
-                pOutBuffer[c+1] = pBuffer[0][i*4+1];
-                pOutBuffer[c+2] = pBuffer[0][i*4+2];
-                pOutBuffer[c+3] = pBuffer[0][i*4+3];
-            }
-        }
-        else if( iComponents == 3 ) 
-        {
-            for( unsigned int i=0, c=0; i < m_cinfo.output_width; i++, c+=3 ) 
-            {
-                pOutBuffer[c]   = pBuffer[0][i*3];
-                pOutBuffer[c+1] = pBuffer[0][i*3+1];
-                pOutBuffer[c+2] = pBuffer[0][i*3+2];
-            }
-        }
-        else if( iComponents == 1 ) 
+        int nResult = jpeg_read_header( &m_cinfo, TRUE );
+        if( nResult == JPEG_SUSPENDED )
+            return;
+        else if( nResult != JPEG_HEADER_OK )
         {
-            memcpy( pOutBuffer, pBuffer[0], m_cinfo.output_width );
+            (void) jpeg_destroy_decompress(&m_cinfo);
+
+            PODOFO_RAISE_ERROR( ePdfError_UnexpectedEOF );
         }
-        else
+
+        m_eState = eDecodeState_Start;
+    }
+
+    if( m_eState == eDecodeState_Start )
+    {
+        if( !jpeg_start_decompress( &m_cinfo ) )
+            return;
+
+        if( m_cinfo.output_components != 1 && m_cinfo.output_components != 3 && m_cinfo.output_components != 4 )
         {
             PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "DCTDecode unknown components" );
         }
-        
-        GetStream()->Write( reinterpret_cast<char*>(pOutBuffer), lRowBytes );
+
+        // m_pScanlines will be deleted by jpeg_destroy_decompress
+        m_pScanlines = (*m_cinfo.mem->alloc_sarray)( reinterpret_cast<j_common_ptr>( &m_cinfo ), JPOOL_IMAGE, 
+                                                     m_cinfo.output_width * m_cinfo.output_components,
+                                                     m_cinfo.rec_outbuf_height );
+        m_eState     = eDecodeState_Scanlines;
     }
 
-    podofo_free( pOutBuffer );
-    (void) jpeg_destroy_decompress( &m_cinfo );
+    const pdf_long lRowBytes = m_cinfo.output_width * m_cinfo.output_components;
+    while( m_cinfo.output_scanline < m_cinfo.output_height ) 
+    {
+        JDIMENSION nLines = jpeg_read_scanlines( &m_cinfo, m_pScanlines, m_cinfo.rec_outbuf_height );
+        if( !nLines )
+            return; // suspended
+
+        for( JDIMENSION i = 0; i < nLines; i++ )
+            GetStream()->Write( reinterpret_cast<char*>(m_pScanlines[i]), lRowBytes );
+    }
+
+    m_eState = eDecodeState_Done;
 }
 
 // -------------------------------------------------------
@@ -1214,55 +1496,148 @@ jpeg_memory_src (j_decompress_ptr cinfo, const JOCTET * buffer, size_t bufsize)
 
 #endif // PODOFO_HAVE_JPEG_LIB
 
-#ifdef PODOFO_HAVE_TIFF_LIB
-
-#ifdef DS_CCITT_DEVELOPMENT_CODE
 // -------------------------------------------------------
-// 
+// CCITTFaxDecode
 // -------------------------------------------------------
-static tsize_t dummy_read(thandle_t, tdata_t, tsize_t)
-{
-    return 0;
-}
 
-// -------------------------------------------------------
-// 
-// -------------------------------------------------------
-static tsize_t dummy_write(thandle_t, tdata_t, tsize_t size)
-{
-    return size;
-}
+#define CCITT_LOOKUP_BITS 13
 
-// -------------------------------------------------------
-// 
-// -------------------------------------------------------
-static toff_t dummy_seek(thandle_t, toff_t, int)
-{
+/** A run length code from ITU-T T.4
+ */
+struct TCCITTCode {
+    const char* pszBits;
+    pdf_int16   nRun;
+};
 
-}
+// Terminating and makeup codes for white runs
+static const TCCITTCode s_aCCITTWhiteCodes[] = {
+    { "00110101",     0 }, { "000111",       1 }, { "0111",         2 }, { "1000",         3 },
+    { "1011",         4 }, { "1100",         5 }, { "1110",         6 }, { "1111",         7 },
+    { "10011",        8 }, { "10100",        9 }, { "00111",       10 }, { "01000",       11 },
+    { "001000",      12 }, { "000011",      13 }, { "110100",      14 }, { "110101",      15 },
+    { "101010",      16 }, { "101011",      17 }, { "0100111",     18 }, { "0001100",     19 },
+    { "0001000",     20 }, { "0010111",     21 }, { "0000011",     22 }, { "0000100",     23 },
+    { "0101000",     24 }, { "0101011",     25 }, { "0010011",     26 }, { "0100100",     27 },
+    { "0011000",     28 }, { "00000010",    29 }, { "00000011",    30 }, { "00011010",    31 },
+    { "00011011",    32 }, { "00010010",    33 }, { "00010011",    34 }, { "00010100",    35 },
+    { "00010101",    36 }, { "00010110",    37 }, { "00010111",    38 }, { "00101000",    39 },
+    { "00101001",    40 }, { "00101010",    41 }, { "00101011",    42 }, { "00101100",    43 },
+    { "00101101",    44 }, { "00000100",    45 }, { "00000101",    46 }, { "00001010",    47 },
+    { "00001011",    48 }, { "01010010",    49 }, { "01010011",    50 }, { "01010100",    51 },
+    { "01010101",    52 }, { "00100100",    53 }, { "00100101",    54 }, { "01011000",    55 },
+    { "01011001",    56 }, { "01011010",    57 }, { "01011011",    58 }, { "01001010",    59 },
+    { "01001011",    60 }, { "00110010",    61 }, { "00110011",    62 }, { "00110100",    63 },
+    { "11011",       64 }, { "10010",      128 }, { "010111",     192 }, { "0110111",    256 },
+    { "00110110",   320 }, { "00110111",   384 }, { "01100100",   448 }, { "01100101",   512 },
+    { "01101000",   576 }, { "01100111",   640 }, { "011001100",  704 }, { "011001101",  768 },
+    { "011010010",  832 }, { "011010011",  896 }, { "011010100",  960 }, { "011010101", 1024 },
+    { "011010110", 1088 }, { "011010111", 1152 }, { "011011000", 1216 }, { "011011001", 1280 },
+    { "011011010", 1344 }, { "011011011", 1408 }, { "010011000", 1472 }, { "010011001", 1536 },
+    { "010011010", 1600 }, { "011000",    1664 }, { "010011011", 1728 },
+    { NULL, 0 }
+};
 
-// -------------------------------------------------------
-// 
-// -------------------------------------------------------
-static int dummy_close(thandle_t)
-{
+// Terminating and makeup codes for black runs
+static const TCCITTCode s_aCCITTBlackCodes[] = {
+    { "0000110111",       0 }, { "010",              1 }, { "11",               2 }, { "10",               3 },
+    { "011",              4 }, { "0011",             5 }, { "0010",             6 }, { "00011",            7 },
+    { "000101",           8 }, { "000100",           9 }, { "0000100",         10 }, { "0000101",         11 },
+    { "0000111",         12 }, { "00000100",        13 }, { "00000111",        14 }, { "000011000",       15 },
+    { "0000010111",      16 }, { "0000011000",      17 }, { "0000001000",      18 }, { "00001100111",     19 },
+    { "00001101000",     20 }, { "00001101100",     21 }, { "00000110111",     22 }, { "00000101000",     23 },
+    { "00000010111",     24 }, { "00000011000",     25 }, { "000011001010",    26 }, { "000011001011",    27 },
+    { "000011001100",    28 }, { "000011001101",    29 }, { "000001101000",    30 }, { "000001101001",    31 },
+    { "000001101010",    32 }, { "000001101011",    33 }, { "000011010010",    34 }, { "000011010011",    35 },
+    { "000011010100",    36 }, { "000011010101",    37 }, { "000011010110",    38 }, { "000011010111",    39 },
+    { "000001101100",    40 }, { "000001101101",    41 }, { "000011011010",    42 }, { "000011011011",    43 },
+    { "000001010100",    44 }, { "000001010101",    45 }, { "000001010110",    46 }, { "000001010111",    47 },
+    { "000001100100",    48 }, { "000001100101",    49 }, { "000001010010",    50 }, { "000001010011",    51 },
+    { "000000100100",    52 }, { "000000110111",    53 }, { "000000111000",    54 }, { "000000100111",    55 },
+    { "000000101000",    56 }, { "000001011000",    57 }, { "000001011001",    58 }, { "000000101011",    59 },
+    { "000000101100",    60 }, { "000001011010",    61 }, { "000001100110",    62 }, { "000001100111",    63 },
+    { "0000001111",      64 }, { "000011001000",   128 }, { "000011001001",   192 }, { "000001011011",   256 },
+    { "000000110011",   320 }, { "000000110100",   384 }, { "000000110101",   448 }, { "0000001101100",  512 },
+    { "0000001101101",  576 }, { "0000001001010",  640 }, { "0000001001011",  704 }, { "0000001001100",  768 },
+    { "0000001001101",  832 }, { "0000001110010",  896 }, { "0000001110011",  960 }, { "0000001110100", 1024 },
+    { "0000001110101", 1088 }, { "0000001110110", 1152 }, { "0000001110111", 1216 }, { "0000001010010", 1280 },
+    { "0000001010011", 1344 }, { "0000001010100", 1408 }, { "0000001010101", 1472 }, { "0000001011010", 1536 },
+    { "0000001011011", 1600 }, { "0000001100100", 1664 }, { "0000001100101", 1728 },
+    { NULL, 0 }
+};
 
-}
+// Extended makeup codes shared by white and black runs
+static const TCCITTCode s_aCCITTExtendedCodes[] = {
+    { "00000001000",  1792 }, { "00000001100",  1856 }, { "00000001101",  1920 }, { "000000010010", 1984 },
+    { "000000010011", 2048 }, { "000000010100", 2112 }, { "000000010101", 2176 }, { "000000010110", 2240 },
+    { "000000010111", 2304 }, { "000000011100", 2368 }, { "000000011101", 2432 }, { "000000011110", 2496 },
+    { "000000011111", 2560 },
+    { NULL, 0 }
+};
 
-// -------------------------------------------------------
-// 
-// -------------------------------------------------------
-static toff_t dummy_size(thandle_t)
-{
+/** Lookup tables indexed by the next CCITT_LOOKUP_BITS bits of input.
+ *  Each entry contains the code length in the upper 4 bits
+ *  and the run length in the lower 12 bits. A code length of 0
+ *  marks an invalid code.
+ */
+class PdfCCITTTables {
+ public:
+    PdfCCITTTables()
+    {
+        memset( m_aWhite, 0, sizeof(m_aWhite) );
+        memset( m_aBlack, 0, sizeof(m_aBlack) );
 
-}
-#endif
+        Fill( m_aWhite, s_aCCITTWhiteCodes );
+        Fill( m_aWhite, s_aCCITTExtendedCodes );
+        Fill( m_aBlack, s_aCCITTBlackCodes );
+        Fill( m_aBlack, s_aCCITTExtendedCodes );
+    }
+
+    static const PdfCCITTTables & Instance()
+    {
+        static PdfCCITTTables s_tables;
+        return s_tables;
+    }
+
+    pdf_uint16 m_aWhite[1 << CCITT_LOOKUP_BITS];
+    pdf_uint16 m_aBlack[1 << CCITT_LOOKUP_BITS];
+
+ private:
+    static void Fill( pdf_uint16* pTable, const TCCITTCode* pCodes )
+    {
+        for( ; pCodes->pszBits; pCodes++ ) 
+        {
+            int        nLen  = static_cast<int>(strlen( pCodes->pszBits ));
+            pdf_uint32 nCode = 0;
+            for( int i = 0; i < nLen; i++ )
+                nCode = (nCode << 1) | (pCodes->pszBits[i] == '1' ? 1 : 0);
+
+            // All entries starting with this code
+            nCode <<= CCITT_LOOKUP_BITS - nLen;
+            for( pdf_uint32 i = 0; i < (1u << (CCITT_LOOKUP_BITS - nLen)); i++ )
+                pTable[nCode + i] = static_cast<pdf_uint16>((nLen << 12) | pCodes->nRun);
+        }
+    }
+};
+
+/** Coding modes of two-dimensional encoding
+ */
+enum ECCITTMode {
+    eCCITTMode_Pass,
+    eCCITTMode_Horizontal,
+    eCCITTMode_Vertical0,
+    eCCITTMode_VerticalR1,
+    eCCITTMode_VerticalR2,
+    eCCITTMode_VerticalR3,
+    eCCITTMode_VerticalL1,
+    eCCITTMode_VerticalL2,
+    eCCITTMode_VerticalL3,
+    eCCITTMode_Invalid
+};
 
-// -------------------------------------------------------
-// Actual filter code below
-// -------------------------------------------------------
 PdfCCITTFilter::PdfCCITTFilter()
-    : m_tiff( NULL )
+    : m_nK( 0 ), m_nColumns( 1728 ), m_nRows( 0 ), m_bEncodedByteAlign( false ),
+      m_bEndOfBlock( true ), m_bBlackIs1( false ), m_lBitPos( 0 ), m_bEof( false ),
+      m_bUnderflow( false ), m_bDone( false ), m_nRow( 0 )
 {
 }
 
@@ -1285,81 +1660,369 @@ void PdfCCITTFilter::EndEncodeImpl()
     PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
 }
 
-#ifndef _MSC_VER
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
-#endif
 void PdfCCITTFilter::BeginDecodeImpl( const PdfDictionary* pDict )
 { 
-#ifdef DS_CCITT_DEVELOPMENT_CODE
+    m_nK                = 0;
+    m_nColumns          = 1728;
+    m_nRows             = 0;
+    m_bEncodedByteAlign = false;
+    m_bEndOfBlock       = true;
+    m_bBlackIs1         = false;
 
-    if( !pDict )
+    if( pDict ) 
     {
-        PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidHandle, "PdfCCITTFilter required a DecodeParms dictionary" );
-    } 
+        m_nK                = static_cast<pdf_int32>(pDict->GetKeyAsLong( PdfName("K"), 0 ));
+        m_nColumns          = static_cast<pdf_int32>(pDict->GetKeyAsLong( PdfName("Columns"), 1728 ));
+        m_nRows             = static_cast<pdf_int32>(pDict->GetKeyAsLong( PdfName("Rows"), 0 ));
+        m_bEncodedByteAlign = pDict->GetKeyAsBool( PdfName("EncodedByteAlign"), false );
+        m_bEndOfBlock       = pDict->GetKeyAsBool( PdfName("EndOfBlock"), true );
+        m_bBlackIs1         = pDict->GetKeyAsBool( PdfName("BlackIs1"), false );
+    }
+
+    if( m_nColumns <= 0 || m_nColumns > (1 << 24) )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_ValueOutOfRange, "Invalid /Columns in CCITTFaxDecode parameters" );
+    }
+
+    m_vecInput.clear();
+    m_lBitPos    = 0;
+    m_bEof       = false;
+    m_bUnderflow = false;
+    m_bDone      = false;
+    m_nRow       = 0;
+
+    // The imaginary row above the first row is white
+    m_vecRefLine.assign( 3, m_nColumns );
+    m_vecCodingLine.clear();
+    m_vecRow.resize( (m_nColumns + 7) >> 3 );
+}
+
+void PdfCCITTFilter::DecodeBlockImpl( const char* pBuffer, pdf_long lLen )
+{
+    if( m_bDone )
+        return;
 
-    m_tiff = TIFFClientOpen("podofo", "w", reinterpret_cast<thandle_t>(-1),
-                            dummy_read, dummy_write,
-                            dummy_seek, dummy_close, dummy_size, NULL, NULL);
+    m_vecInput.insert( m_vecInput.end(), 
+                       reinterpret_cast<const unsigned char*>(pBuffer),
+                       reinterpret_cast<const unsigned char*>(pBuffer) + lLen );
+
+    this->DecodeAvailable();
+}
+
+void PdfCCITTFilter::EndDecodeImpl()
+{
+    m_bEof = true;
+    this->DecodeAvailable();
 
-    if( !m_tiff ) 
+    m_vecInput.clear();
+}
+
+void PdfCCITTFilter::DecodeAvailable()
+{
+    while( !m_bDone ) 
     {
-        PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidHandle, "TIFFClientOpen failed" );
+        pdf_int64 lRowStart = m_lBitPos;
+
+        m_bUnderflow = false;
+        bool bRow    = this->ReadRow();
+        if( m_bUnderflow ) 
+        {
+            // Retry this row when more data has arrived
+            m_lBitPos = lRowStart;
+            m_bDone   = m_bEof;
+            break;
+        }
+        else if( !bRow ) 
+        {
+            m_bDone = true;
+            break;
+        }
+
+        this->WriteRow();
+
+        // The current row is the reference for the next one
+        m_vecRefLine.swap( m_vecCodingLine );
+        m_vecRefLine.insert( m_vecRefLine.end(), 3, m_nColumns );
+
+        if( m_nRows > 0 && ++m_nRow >= m_nRows )
+            m_bDone = true;
     }
 
-    m_tiff->tif_mode = O_RDONLY;
+    // Drop all data which has been decoded
+    size_t lUsed = static_cast<size_t>(PDF_MIN( m_lBitPos >> 3, static_cast<pdf_int64>(m_vecInput.size()) ));
+    m_vecInput.erase( m_vecInput.begin(), m_vecInput.begin() + lUsed );
+    m_lBitPos -= static_cast<pdf_int64>(lUsed) << 3;
+}
 
-    TIFFSetField(m_tiff, TIFFTAG_IMAGEWIDTH,      pDict->GetKeyAsLong( PdfName("Columns"), 1728 )->GetNumber() );
-    TIFFSetField(m_tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
-    TIFFSetField(m_tiff, TIFFTAG_BITSPERSAMPLE,   1);
-    TIFFSetField(m_tiff, TIFFTAG_FILLORDER,       FILLORDER_LSB2MSB);
-    TIFFSetField(m_tiff, TIFFTAG_PLANARCONFIG,    PLANARCONFIG_CONTIG);
-    TIFFSetField(m_tiff, TIFFTAG_PHOTOMETRIC,     PHOTOMETRIC_MINISWHITE);
-    TIFFSetField(m_tiff, TIFFTAG_YRESOLUTION,     196.);
-    TIFFSetField(m_tiff, TIFFTAG_RESOLUTIONUNIT,  RESUNIT_INCH);
+bool PdfCCITTFilter::ReadRow()
+{
+    bool b2D = m_nK < 0;
 
-    /*
-    m_tiff->tif_scanlinesize = TIFFSetField(m_tiff );
+    if( m_nK < 0 ) 
+    {
+        if( m_bEncodedByteAlign && (m_lBitPos & 7) )
+            this->SkipBits( 8 - static_cast<int>(m_lBitPos & 7) );
 
-    if( pDict ) 
+        // End of facsimile block (EOFB): two EOL codes
+        if( this->GetAvailableBits() < 24 && !m_bEof ) 
+        {
+            m_bUnderflow = true;
+            return false;
+        }
+
+        if( this->PeekBits( 24 ) == 0x001001 )
+            return false;
+    }
+    else
     {
-        long lEncoding = pDict->GetKeyAsLong( PdfName("K"), 0 );
-        if( lEncoding == 0 ) // pure 1D encoding, Group3 1D
+        bool bEOL = this->ReadEOL();
+        if( !bEOL && m_bEncodedByteAlign && (m_lBitPos & 7) )
         {
-            TIFFSetField(faxTIFF,TIFFTAG_GROUP3OPTIONS, GROUP3OPT_1DENCODING);
+            this->SkipBits( 8 - static_cast<int>(m_lBitPos & 7) );
+            bEOL = this->ReadEOL();
+        }
+
+        if( m_bUnderflow )
+            return false;
+
+        // The tag bit selects the encoding of this row
+        if( m_nK > 0 ) 
+        {
+            b2D = this->PeekBits( 1 ) == 0;
+            this->SkipBits( 1 );
+        }
+
+        // Return to control (RTC): several EOL codes in a row
+        if( bEOL && this->ReadEOL() )
+            return false;
+
+        if( m_bUnderflow )
+            return false;
+    }
+
+    // Only fill bits left at the end of the data
+    if( m_bEof && this->GetAvailableBits() <= 0 )
+        return false;
+
+    m_vecCodingLine.clear();
 
+    bool bOk = b2D ? this->ReadRow2D() : this->ReadRow1D();
+    if( !bOk && !m_bUnderflow )
+    {
+        PdfError::LogMessage( eLogSeverity_Warning, "Invalid data in CCITTFaxDecode stream in row %i.\n", m_nRow );
+    }
+
+    return bOk;
+}
+
+bool PdfCCITTFilter::ReadRow1D()
+{
+    pdf_int32 nPos = 0;
+    while( nPos < m_nColumns )
+    {
+        pdf_int32 nRun = this->ReadRun( (m_vecCodingLine.size() & 1) != 0 );
+        if( nRun < 0 )
+            return false;
+
+        nPos = PDF_MIN( nPos + nRun, m_nColumns );
+        this->AddChange( nPos );
+    }
+
+    return true;
+}
+
+bool PdfCCITTFilter::ReadRow2D()
+{
+    const std::vector<pdf_int32> & vecRef = m_vecRefLine;
+
+    pdf_int32 a0 = -1;
+    size_t    i  = 0;
+    while( a0 < m_nColumns ) 
+    {
+        // The color of a0 is given by the number of changes so far
+        size_t nColor = m_vecCodingLine.size() & 1;
+
+        // b1 is the first changing element on the reference line 
+        // right of a0 with the opposite color of a0
+        while( i > 0 && vecRef[i-1] > a0 )
+            --i;
+        while( vecRef[i] <= a0 || (i & 1) != nColor )
+            ++i;
+
+        pdf_int32 b1 = vecRef[i];
+        pdf_int32 b2 = vecRef[i+1];
+
+        // Read the mode code
+        ECCITTMode eMode = eCCITTMode_Invalid;
+        pdf_uint32 nBits = this->PeekBits( 7 );
+        if( nBits & 0x40 )
+        {
+            eMode = eCCITTMode_Vertical0;
+            this->SkipBits( 1 );
+        }
+        else if( (nBits >> 4) == 0x3 || (nBits >> 4) == 0x2 || (nBits >> 4) == 0x1 )
+        {
+            eMode = (nBits >> 4) == 0x3 ? eCCITTMode_VerticalR1 : 
+                ((nBits >> 4) == 0x2 ? eCCITTMode_VerticalL1 : eCCITTMode_Horizontal);
+            this->SkipBits( 3 );
+        }
+        else if( (nBits >> 3) == 0x1 )
+        {
+            eMode = eCCITTMode_Pass;
+            this->SkipBits( 4 );
+        }
+        else if( (nBits >> 1) == 0x3 || (nBits >> 1) == 0x2 )
+        {
+            eMode = (nBits >> 1) == 0x3 ? eCCITTMode_VerticalR2 : eCCITTMode_VerticalL2;
+            this->SkipBits( 6 );
+        }
+        else if( nBits == 0x3 || nBits == 0x2 )
+        {
+            eMode = nBits == 0x3 ? eCCITTMode_VerticalR3 : eCCITTMode_VerticalL3;
+            this->SkipBits( 7 );
         }
-        else if( lEncoding < 0 ) // pure 2D encoding, Group4
+        else 
         {
-            TIFFSetField(faxTIFF,TIFFTAG_GROUP4OPTIONS, GROUP4OPT_2DENCODING);
+            // Extensions and EOL codes are not supported within a row
+            if( this->GetAvailableBits() < 7 && !m_bEof )
+                m_bUnderflow = true;
+
+            return false;
         }
-        else //if( lEncoding > 0 )  // mixed, Group3 2D
+
+        if( m_bUnderflow )
+            return false;
+
+        pdf_int32 a1;
+        switch( eMode ) 
         {
-            TIFFSetField(faxTIFF,TIFFTAG_GROUP3OPTIONS, GROUP3OPT_2DENCODING);
+            case eCCITTMode_Pass:
+                a0 = b2;
+                continue;
+
+            case eCCITTMode_Horizontal:
+            {
+                pdf_int32 nStart = PDF_MAX( a0, static_cast<pdf_int32>(0) );
+                pdf_int32 nRun1  = this->ReadRun( nColor != 0 );
+                pdf_int32 nRun2  = nRun1 < 0 ? -1 : this->ReadRun( nColor == 0 );
+                if( nRun2 < 0 )
+                    return false;
+
+                a1 = PDF_MIN( nStart + nRun1, m_nColumns );
+                a0 = PDF_MIN( a1 + nRun2, m_nColumns );
+                this->AddChange( a1 );
+                this->AddChange( a0 );
+                continue;
+            }
+
+            case eCCITTMode_Vertical0:  a1 = b1;     break;
+            case eCCITTMode_VerticalR1: a1 = b1 + 1; break;
+            case eCCITTMode_VerticalR2: a1 = b1 + 2; break;
+            case eCCITTMode_VerticalR3: a1 = b1 + 3; break;
+            case eCCITTMode_VerticalL1: a1 = b1 - 1; break;
+            case eCCITTMode_VerticalL2: a1 = b1 - 2; break;
+            case eCCITTMode_VerticalL3: a1 = b1 - 3; break;
+            case eCCITTMode_Invalid:
+            default:
+                return false;
         }
 
+        // Clamp invalid positions of damaged data to the row
+        a1 = PDF_MAX( a1, PDF_MAX( a0, static_cast<pdf_int32>(0) ) );
+        a0 = PDF_MIN( a1, m_nColumns );
+        this->AddChange( a0 );
     }
-    */
 
-#else // DS_CCITT_DEVELOPMENT_CODE
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
-#endif // DS_CCITT_DEVELOPMENT_CODE
+    return true;
 }
-#ifndef _MSC_VER
-#pragma GCC diagnostic pop
-#endif
 
-void PdfCCITTFilter::DecodeBlockImpl( const char*, pdf_long )
+pdf_int32 PdfCCITTFilter::ReadRun( bool bBlack )
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    const pdf_uint16* pTable = bBlack ? PdfCCITTTables::Instance().m_aBlack : PdfCCITTTables::Instance().m_aWhite;
+
+    pdf_int32 nTotal = 0;
+    for( ;; ) 
+    {
+        pdf_uint16 nEntry = pTable[this->PeekBits( CCITT_LOOKUP_BITS )];
+        int        nLen   = nEntry >> 12;
+        if( !nLen ) 
+        {
+            if( this->GetAvailableBits() < CCITT_LOOKUP_BITS && !m_bEof )
+                m_bUnderflow = true;
+
+            return -1;
+        }
+
+        this->SkipBits( nLen );
+        if( m_bUnderflow )
+            return -1;
+
+        pdf_int32 nRun = nEntry & 0x0FFF;
+        nTotal += nRun;
+        if( nRun < 64 ) 
+            return nTotal; // terminating code
+        else if( nTotal > m_nColumns )
+            return -1;
+    }
 }
 
-void PdfCCITTFilter::EndDecodeImpl()
+bool PdfCCITTFilter::ReadEOL()
 {
-    PODOFO_RAISE_ERROR( ePdfError_UnsupportedFilter );
+    // An EOL code consists of at least 11 zero bits followed
+    // by a one bit, where any additional zeros are fill bits
+    pdf_int64 lPos   = m_lBitPos;
+    pdf_int64 lEnd   = static_cast<pdf_int64>(m_vecInput.size()) << 3;
+    pdf_int64 lZeros = 0;
+    while( lPos < lEnd && !(m_vecInput[static_cast<size_t>(lPos >> 3)] & (0x80 >> (lPos & 7))) ) 
+    {
+        ++lPos;
+        ++lZeros;
+    }
+
+    if( lPos == lEnd ) 
+    {
+        if( !m_bEof )
+            m_bUnderflow = true;
+        else if( lZeros )
+            m_lBitPos = lPos; // skip the trailing fill bits
+
+        return false;
+    }
+
+    if( lZeros < 11 )
+        return false;
+
+    m_lBitPos = lPos + 1;
+    return true;
 }
 
-#endif // PODOFO_HAVE_TIFF_LIB
+void PdfCCITTFilter::WriteRow()
+{
+    // Pixels which are 0 are black unless BlackIs1 is set
+    const unsigned char cWhite = m_bBlackIs1 ? 0x00 : 0xFF;
+    unsigned char*      pRow   = &(m_vecRow[0]);
+
+    memset( pRow, cWhite, m_vecRow.size() );
+
+    // Every other changing element starts a black run
+    for( size_t i = 0; i < m_vecCodingLine.size(); i += 2 ) 
+    {
+        pdf_int32 x0 = m_vecCodingLine[i];
+        pdf_int32 x1 = i + 1 < m_vecCodingLine.size() ? m_vecCodingLine[i+1] : m_nColumns;
+
+        x1 = PDF_MIN( x1, m_nColumns );
+        for( ; x0 < x1 && (x0 & 7); x0++ )
+            pRow[x0 >> 3] ^= static_cast<unsigned char>(0x80 >> (x0 & 7));
+
+        for( ; x0 + 8 <= x1; x0 += 8 )
+            pRow[x0 >> 3] = static_cast<unsigned char>(~cWhite);
+
+        for( ; x0 < x1; x0++ )
+            pRow[x0 >> 3] ^= static_cast<unsigned char>(0x80 >> (x0 & 7));
+    }
+
+    GetStream()->Write( reinterpret_cast<char*>(pRow), static_cast<pdf_long>(m_vecRow.size()) );
+}
 
 
 };
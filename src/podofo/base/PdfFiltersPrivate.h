@@ -538,7 +538,25 @@ class PdfRLEFilter : public PdfFilter {
     inline virtual EPdfFilter GetType() const;
 
  private:
-    int m_nCodeLen;
+    /** Write all pending literal bytes as one literal run.
+     */
+    void FlushLiteral();
+
+    /** Write the pending repeat run, either as a repeat run or,
+     *  if it is too short to save space, by appending it to the
+     *  pending literal bytes.
+     */
+    void FlushRun();
+
+ private:
+    int           m_nCodeLen;
+    bool          m_bRepeat;
+    bool          m_bEOD;
+
+    char          m_literal[128];
+    int           m_nLiteralLen;
+    char          m_cRunByte;
+    int           m_nRunLen;
 };
 
 // -----------------------------------------------------
@@ -546,7 +564,7 @@ class PdfRLEFilter : public PdfFilter {
 // -----------------------------------------------------
 bool PdfRLEFilter::CanEncode() const
 {
-    return false;
+    return true;
 }
 
 // -----------------------------------------------------
@@ -674,6 +692,18 @@ class PdfLZWFilter : public PdfFilter {
      */
     void InitTable();
 
+    /** Reset the hash table used by the encoder
+     *  to map (prefix code, character) pairs to codes.
+     */
+    void InitEncodeTable();
+
+    /** Write a code of the current code length
+     *  to the output stream.
+     *
+     *  \param code the code to write
+     */
+    void PutCode( pdf_uint32 code );
+
  private:
     static const unsigned short s_masks[4];
     static const unsigned short s_clear;
@@ -687,6 +717,21 @@ class PdfLZWFilter : public PdfFilter {
 
     bool          m_bFirst;
 
+    // Decoder bit buffer, kept across calls to DecodeBlockImpl
+    pdf_uint32    m_buffer;
+    unsigned int  m_buffer_size;
+    pdf_uint32    m_old;
+
+    // Encoder state: open addressing hash table keyed by
+    // (prefix code << 8 | character) storing the assigned code
+    pdf_int32*    m_pEncodeKeys;
+    pdf_uint16*   m_pEncodeCodes;
+    pdf_uint32    m_next_code;
+    pdf_int32     m_prefix;
+
+    unsigned char m_out[PODOFO_FILTER_INTERNAL_BUFFER_SIZE];
+    pdf_long      m_out_len;
+
     PdfPredictorDecoder* m_pPredictor;
 };
 
@@ -695,7 +740,7 @@ class PdfLZWFilter : public PdfFilter {
 // -----------------------------------------------------
 bool PdfLZWFilter::CanEncode() const
 {
-    return false;
+    return true;
 }
 
 // -----------------------------------------------------
@@ -725,8 +770,21 @@ void JPegErrorExit(j_common_ptr cinfo);
 void JPegErrorOutput(j_common_ptr, int);
 };
 
+/** A libjpeg data source which suspends the decoder when all
+ *  data passed so far to a PdfDCTFilter has been consumed.
+ */
+struct PdfDCTSource {
+    struct jpeg_source_mgr pub;     ///< public fields, has to be the first member
+    JOCTET                 eoi[2];  ///< fake EOI marker used for truncated data
+    bool                   bEof;    ///< true if no more data will be passed
+    long                   lSkip;   ///< bytes still to be skipped in the next block
+};
+
 /** The DCT filter can decoded JPEG compressed data.
  *  
+ *  Data is decoded as soon as it is passed to the filter,
+ *  so scanlines are written while the JPEG data is still read.
+ *
  *  This filter requires JPEG lib to be available
  */
 class PdfDCTFilter : public PdfFilter {
@@ -824,11 +882,27 @@ class PdfDCTFilter : public PdfFilter {
     inline virtual EPdfFilter GetType() const;
 
  private:
+    /** Decode as much of the data passed so far as possible
+     *  and write all complete scanlines to the output stream.
+     *  Returns as soon as libjpeg requires more data.
+     */
+    void DecodeAvailable();
+
+ private:
+    enum EDecodeState {
+        eDecodeState_Header,
+        eDecodeState_Start,
+        eDecodeState_Scanlines,
+        eDecodeState_Done
+    };
+
     struct jpeg_decompress_struct m_cinfo;
     struct jpeg_error_mgr         m_jerr;
+    PdfDCTSource                  m_source;
 
     PdfRefCountedBuffer           m_buffer;
-    PdfOutputDevice*              m_pDevice;
+    JSAMPARRAY                    m_pScanlines;
+    EDecodeState                  m_eState;
 };
 
 // -----------------------------------------------------
@@ -856,11 +930,13 @@ EPdfFilter PdfDCTFilter::GetType() const
 }
 #endif // PODOFO_HAVE_JPEG_LIB
 
-#ifdef PODOFO_HAVE_TIFF_LIB
-
-/** The CCITT filter can decoded CCITTFaxDecode compressed data.
+/** The CCITT filter can decode CCITTFaxDecode compressed data,
+ *  i.e. Group 3 one-dimensional (K = 0), Group 3 two-dimensional (K > 0)
+ *  and Group 4 (K < 0) encoded bilevel images.
  *  
- *  This filter requires TIFFlib to be available
+ *  Every scanline is written as soon as it has been decoded, so
+ *  only the current and the previous scanline are kept in memory.
+ *  The output has one bit per pixel, each row padded to a full byte.
  */
 class PdfCCITTFilter : public PdfFilter {
  public:
@@ -957,7 +1033,91 @@ class PdfCCITTFilter : public PdfFilter {
     inline virtual EPdfFilter GetType() const;
 
  private:
-    TIFF* m_tiff;
+    /** Decode all complete rows of the data passed so far and
+     *  write them to the output stream.
+     */
+    void DecodeAvailable();
+
+    /** Decode the next row into m_vecCodingLine, including
+     *  any EOL, tag bit and fill bits before it.
+     *
+     *  \returns false if the end of the data was reached or 
+     *           m_bUnderflow is set if more data is required
+     */
+    bool ReadRow();
+
+    /** Decode a one-dimensional (modified Huffman) encoded row
+     *  \returns false on invalid data
+     */
+    bool ReadRow1D();
+
+    /** Decode a two-dimensional (modified READ) encoded row
+     *  \returns false on invalid data
+     */
+    bool ReadRow2D();
+
+    /** Read a run length, consisting of any makeup codes 
+     *  and one terminating code.
+     *
+     *  \param bBlack if true read a black run, otherwise a white run
+     *  \returns the run length or -1 on invalid data
+     */
+    pdf_int32 ReadRun( bool bBlack );
+
+    /** Skip fill bits and an EOL code if they are at the current position
+     *  \returns true if an EOL was read
+     */
+    bool ReadEOL();
+
+    /** Append a changing element to the coding line.
+     *  Two changes at the same position cancel each other.
+     *
+     *  \param nPos position of the changing element
+     */
+    inline void AddChange( pdf_int32 nPos );
+
+    /** Peek at the next bits of the input without consuming them.
+     *  Bits beyond the available data are returned as 0.
+     *
+     *  \param nBits number of bits (at most 24)
+     *  \returns the bits in the lowest bits of the result
+     */
+    inline pdf_uint32 PeekBits( int nBits ) const;
+
+    /** Consume bits from the input and set m_bUnderflow
+     *  if more than the available bits are consumed.
+     *
+     *  \param nBits number of bits
+     */
+    inline void SkipBits( int nBits );
+
+    /**
+     * \returns the number of bits available in the input buffer
+     */
+    inline pdf_int64 GetAvailableBits() const;
+
+    /** Write the current coding line as a row of pixels
+     */
+    void WriteRow();
+
+ private:
+    pdf_int32                  m_nK;
+    pdf_int32                  m_nColumns;
+    pdf_int32                  m_nRows;
+    bool                       m_bEncodedByteAlign;
+    bool                       m_bEndOfBlock;
+    bool                       m_bBlackIs1;
+
+    std::vector<unsigned char> m_vecInput;       ///< input data not yet decoded
+    pdf_int64                  m_lBitPos;        ///< position of the next bit in m_vecInput
+    bool                       m_bEof;           ///< no more input data will be passed
+    bool                       m_bUnderflow;     ///< the current row needs more input data
+    bool                       m_bDone;          ///< all rows have been decoded
+    pdf_int32                  m_nRow;
+
+    std::vector<pdf_int32>     m_vecRefLine;     ///< changing elements of the previous row
+    std::vector<pdf_int32>     m_vecCodingLine;  ///< changing elements of the current row
+    std::vector<unsigned char> m_vecRow;         ///< pixels of the current row
 };
 
 // -----------------------------------------------------
@@ -983,7 +1143,48 @@ EPdfFilter PdfCCITTFilter::GetType() const
 {
     return ePdfFilter_CCITTFaxDecode;
 }
-#endif // PODOFO_HAVE_TIFF_LIB
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+void PdfCCITTFilter::AddChange( pdf_int32 nPos )
+{
+    if( m_vecCodingLine.size() && nPos <= m_vecCodingLine.back() )
+        m_vecCodingLine.pop_back(); // a zero length run, both changes cancel
+    else
+        m_vecCodingLine.push_back( nPos );
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_uint32 PdfCCITTFilter::PeekBits( int nBits ) const
+{
+    size_t     lByte = static_cast<size_t>(m_lBitPos >> 3);
+    pdf_uint32 nWord = 0;
+    for( int i = 0; i < 4; i++, lByte++ )
+        nWord = (nWord << 8) | (lByte < m_vecInput.size() ? m_vecInput[lByte] : 0);
+
+    return (nWord << (m_lBitPos & 7)) >> (32 - nBits);
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+void PdfCCITTFilter::SkipBits( int nBits )
+{
+    m_lBitPos += nBits;
+    if( m_lBitPos > static_cast<pdf_int64>(m_vecInput.size()) << 3 )
+        m_bUnderflow = true;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_int64 PdfCCITTFilter::GetAvailableBits() const
+{
+    return (static_cast<pdf_int64>(m_vecInput.size()) << 3) - m_lBitPos;
+}
 
 };
 
@@ -36,6 +36,7 @@
 #include "PdfFileStream.h"
 #include "PdfMemStream.h"
 #include "PdfObject.h"
+#include "PdfOutputDevice.h"
 #include "PdfXRef.h"
 #include "PdfXRefStream.h"
 #include "PdfDefinesPrivate.h"
@@ -84,21 +85,22 @@ PdfImmediateWriter::~PdfImmediateWriter()
 
 void PdfImmediateWriter::WriteObject( const PdfObject* pObject )
 {
-    const int endObjLenght = 7;
+    const pdf_long endObjLength = 7;
 
     this->FinishLastObject();
 
+    // Serialize the object once into a scratch buffer, so that its
+    // trailing "endobj\n" can be replaced by "stream\n" without
+    // seeking back on the output device.
+    PdfOutputDevice device( &m_objectBuffer );
+    pObject->WriteObject( &device, this->GetWriteMode(), m_pEncrypt );
+
     m_pXRef->AddObject( pObject->Reference(), m_pDevice->Tell(), true );
-    pObject->WriteObject( m_pDevice, this->GetWriteMode(), m_pEncrypt );
+    m_pDevice->Write( m_objectBuffer.GetBuffer(), device.GetLength() - endObjLength );
+    m_pDevice->Print( "stream\n" );
+
     // Make sure, no one will add keys now to the object
     const_cast<PdfObject*>(pObject)->SetImmutable(true);
-
-    // Let's cheat a bit:
-    // pObject has written an "endobj\n" as last data to the file.
-    // we simply overwrite this string with "stream\n" which 
-    // has excatly the same length.
-    m_pDevice->Seek( m_pDevice->Tell() - endObjLenght );
-    m_pDevice->Print( "stream\n" );
     m_pLast = const_cast<PdfObject*>(pObject);
 }
 
@@ -138,7 +140,9 @@ void PdfImmediateWriter::Finish()
         trailer.WriteObject( m_pDevice, this->GetWriteMode(), NULL );
     }
     
-    m_pDevice->Print( "startxref\n%" PDF_FORMAT_UINT64 "\n%%%%EOF\n", lXRefOffset );
+    m_pDevice->Print( "startxref\n" );
+    m_pDevice->WriteInt( static_cast<pdf_int64>(lXRefOffset) );
+    m_pDevice->Write( "\n%%EOF\n", 7 );
     m_pDevice->Flush();
 
     // we are done now
@@ -35,6 +35,7 @@
 #define _PDF_IMMEDIATE_WRITER_H_
 
 #include "PdfDefines.h"
+#include "PdfRefCountedBuffer.h"
 #include "PdfVecObjects.h"
 #include "PdfWriter.h"
 
@@ -134,6 +135,8 @@ class PODOFO_API PdfImmediateWriter : private PdfWriter,
     PdfObject*       m_pLast;
 
     bool             m_bOpenStream;
+
+    PdfRefCountedBuffer m_objectBuffer; ///< scratch buffer for objects which are followed by a stream
 };
 
 // -----------------------------------------------------
@@ -32,6 +32,7 @@
  ***************************************************************************/
 
 #include "PdfInputDevice.h"
+#include "PdfInputStream.h"
 
 #include <cstdarg>
 #include <fstream>
@@ -282,4 +283,122 @@ std::streamoff PdfInputDevice::Read( char* pBuffer, std::streamsize lLen )
 	}
 }
 
+PdfInputStreamDevice::PdfInputStreamDevice( PdfInputStream* pStream, bool bOwnStream )
+    : PdfInputDevice(), m_pInputStream( pStream ), m_bOwnStream( bOwnStream ),
+      m_lOffset( 0 ), m_lPos( 0 ), m_lEnd( 0 ), m_bEof( false )
+{
+    if( !pStream ) 
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    this->SetSeekable( false );
+}
+
+PdfInputStreamDevice::~PdfInputStreamDevice()
+{
+    if( m_bOwnStream )
+        delete m_pInputStream;
+}
+
+bool PdfInputStreamDevice::FillWindow() const
+{
+    if( m_bEof )
+        return false;
+
+    pdf_long lKeep = PDF_MIN( m_lPos, static_cast<pdf_long>(HISTORY_SIZE) );
+    memmove( m_buffer, m_buffer + m_lPos - lKeep, lKeep );
+    m_lOffset += m_lPos - lKeep;
+    m_lPos     = lKeep;
+
+    pdf_long lRead = m_pInputStream->Read( m_buffer + lKeep, WINDOW_SIZE );
+    m_lEnd = lKeep + PDF_MAX( lRead, static_cast<pdf_long>(0) );
+    if( lRead <= 0 )
+        m_bEof = true;
+
+    return m_lPos < m_lEnd;
+}
+
+std::streamoff PdfInputStreamDevice::Tell() const
+{
+    return m_lOffset + m_lPos;
+}
+
+int PdfInputStreamDevice::GetChar() const
+{
+    if( m_lPos == m_lEnd && !this->FillWindow() )
+        return EOF;
+
+    return static_cast<unsigned char>(m_buffer[m_lPos++]);
+}
+
+int PdfInputStreamDevice::Look() const
+{
+    if( m_lPos == m_lEnd && !this->FillWindow() )
+        return EOF;
+
+    return static_cast<unsigned char>(m_buffer[m_lPos]);
+}
+
+void PdfInputStreamDevice::Seek( std::streamoff off, std::ios_base::seekdir dir )
+{
+    pdf_long lTarget = 0;
+    if( dir == std::ios_base::beg )
+        lTarget = static_cast<pdf_long>(off);
+    else if( dir == std::ios_base::cur )
+        lTarget = static_cast<pdf_long>(this->Tell() + off);
+    else // if( dir == std::ios_base::end )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidDeviceOperation, "Cannot seek relative to the end of a PdfInputStream." );
+    }
+
+    if( lTarget < m_lOffset )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidDeviceOperation, "Cannot seek that far backwards in a PdfInputStream." );
+    }
+
+    // Skip forward if the position is not in the current window
+    while( lTarget > m_lOffset + m_lEnd )
+    {
+        m_lPos = m_lEnd;
+        if( !this->FillWindow() )
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidDeviceOperation, "Cannot seek beyond the end of a PdfInputStream." );
+        }
+    }
+
+    m_lPos = lTarget - m_lOffset;
+}
+
+std::streamoff PdfInputStreamDevice::Read( char* pBuffer, std::streamsize lLen )
+{
+    std::streamoff lRead = 0;
+    while( lRead < lLen )
+    {
+        if( m_lPos == m_lEnd && !this->FillWindow() )
+            break;
+
+        pdf_long lCopy = PDF_MIN( static_cast<pdf_long>(lLen - lRead), m_lEnd - m_lPos );
+        memcpy( pBuffer + lRead, m_buffer + m_lPos, lCopy );
+        m_lPos += lCopy;
+        lRead  += lCopy;
+    }
+
+    return lRead;
+}
+
+bool PdfInputStreamDevice::Eof() const
+{
+    return m_bEof && m_lPos == m_lEnd;
+}
+
+bool PdfInputStreamDevice::Bad() const
+{
+    return false;
+}
+
+void PdfInputStreamDevice::Clear( std::ios_base::iostate ) const
+{
+}
+
 }; // namespace PoDoFo
@@ -43,6 +43,8 @@
 
 namespace PoDoFo {
 
+class PdfInputStream;
+
 /** This class provides an Input device which operates 
  *  either on a file, a buffer in memory or any arbitrary std::istream
  *
@@ -51,6 +53,8 @@ namespace PoDoFo {
  *  Just override the required virtual methods.
  */
 class PODOFO_API PdfInputDevice {
+    friend class PdfOutputDevice;
+
  public:
 
     /** Construct a new PdfInputDevice that reads all data from a file.
@@ -176,6 +180,64 @@ class PODOFO_API PdfInputDevice {
     bool          m_bIsSeekable;
 };
 
+/** An input device which reads all data from a PdfInputStream,
+ *  e.g. a stream returned by PdfStream::CreateFilteredInputStream().
+ *
+ *  Only a small window of the data is kept in memory. Therefore
+ *  seeking is limited to a few bytes before the current position
+ *  and to any position after it.
+ */
+class PODOFO_API PdfInputStreamDevice : public PdfInputDevice {
+ public:
+    /** Construct a new PdfInputStreamDevice that reads all data from a PdfInputStream.
+     *
+     *  \param pStream read data from this stream
+     *  \param bOwnStream if true pStream is deleted along with this device
+     */
+    PdfInputStreamDevice( PdfInputStream* pStream, bool bOwnStream = true );
+
+    virtual ~PdfInputStreamDevice();
+
+    virtual std::streamoff Tell() const;
+
+    virtual int GetChar() const;
+
+    virtual int Look() const;
+
+    virtual void Seek( std::streamoff off, std::ios_base::seekdir dir = std::ios_base::beg );
+
+    virtual std::streamoff Read( char* pBuffer, std::streamsize lLen );
+
+    PODOFO_NOTHROW virtual bool Eof() const;
+
+    PODOFO_NOTHROW virtual bool Bad() const;
+
+    PODOFO_NOTHROW virtual void Clear( std::ios_base::iostate state = std::ios_base::goodbit ) const;
+
+ private:
+    /** Read the next window of data from the stream,
+     *  keeping a few bytes before the current position.
+     *
+     *  \returns false if no more data is available
+     */
+    bool FillWindow() const;
+
+ private:
+    enum { 
+        HISTORY_SIZE = 64,     ///< bytes which are kept before the current position
+        WINDOW_SIZE  = 4096    ///< bytes which are read at once from the stream
+    };
+
+    PdfInputStream*  m_pInputStream;
+    bool             m_bOwnStream;
+
+    mutable char     m_buffer[HISTORY_SIZE + WINDOW_SIZE];
+    mutable pdf_long m_lOffset;   ///< offset of m_buffer in the stream
+    mutable pdf_long m_lPos;      ///< current position in m_buffer
+    mutable pdf_long m_lEnd;      ///< number of valid bytes in m_buffer
+    mutable bool     m_bEof;
+};
+
 bool PdfInputDevice::IsSeekable() const
 {
     return m_bIsSeekable;
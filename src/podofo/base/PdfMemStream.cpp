@@ -277,17 +277,11 @@ void PdfMemStream::Write( PdfOutputDevice* pDevice, PdfEncrypt* pEncrypt )
     pDevice->Print( "stream\n" );
     if( pEncrypt ) 
     {
-        pdf_long  lLen = this->GetLength();
+        PdfDeviceOutputStream               stream( pDevice );
+        PODOFO_UNIQUEU_PTR<PdfOutputStream> pEncryptStream( pEncrypt->CreateEncryptionOutputStream( &stream ) );
 
-        pdf_long nOutputLen = pEncrypt->CalculateStreamLength(lLen);
-
-        char *pOutputBuffer = new char[nOutputLen];
-
-        pEncrypt->Encrypt( reinterpret_cast<const unsigned char*>(this->Get()), lLen,
-                          reinterpret_cast<unsigned char*>(pOutputBuffer), nOutputLen);
-        pDevice->Write( pOutputBuffer, nOutputLen );
-
-        delete[] pOutputBuffer;
+        pEncryptStream->Write( this->Get(), this->GetLength() );
+        pEncryptStream->Close();
     }
     else
     {
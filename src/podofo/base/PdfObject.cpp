@@ -208,7 +208,11 @@ void PdfObject::InitPdfObject()
 void PdfObject::WriteObject( PdfOutputDevice* pDevice, EPdfWriteMode eWriteMode,
                              PdfEncrypt* pEncrypt, const PdfName & keyStop ) const
 {
-    DelayedStreamLoad();
+    // Unmodified streams read from a file are copied as they are,
+    // so do not load them into memory
+    const bool bRawStream = !pEncrypt && this->HasRawStream();
+    if( !bRawStream )
+        DelayedStreamLoad();
 
     if( !pDevice )
     {
@@ -217,13 +221,17 @@ void PdfObject::WriteObject( PdfOutputDevice* pDevice, EPdfWriteMode eWriteMode,
 
     if( m_reference.IsIndirect() )
     {
+        pDevice->WriteInt( m_reference.ObjectNumber() );
+        pDevice->Write( " ", 1 );
+        pDevice->WriteInt( m_reference.GenerationNumber() );
+
         if( (eWriteMode & ePdfWriteMode_Clean) == ePdfWriteMode_Clean ) 
         {
-            pDevice->Print( "%i %i obj\n", m_reference.ObjectNumber(), m_reference.GenerationNumber() );
+            pDevice->Write( " obj\n", 5 );
         }
         else 
         {
-            pDevice->Print( "%i %i obj", m_reference.ObjectNumber(), m_reference.GenerationNumber() );
+            pDevice->Write( " obj", 4 );
         }
     }
 
@@ -233,22 +241,16 @@ void PdfObject::WriteObject( PdfOutputDevice* pDevice, EPdfWriteMode eWriteMode,
     }
 
     if( pEncrypt && m_pStream )
-    {
-        // Set length if it is a key
-        PdfFileStream* pFileStream = dynamic_cast<PdfFileStream*>(m_pStream);
-        if( !pFileStream )
-        {
-            // PdfFileStream handles encryption internally
-            pdf_long lLength = pEncrypt->CalculateStreamLength(m_pStream->GetLength());
-            PdfVariant varLength = static_cast<pdf_int64>(lLength);
-            *(const_cast<PdfObject*>(this)->GetIndirectKey( PdfName::KeyLength )) = varLength;
-        }
-    }
+        this->SetEncryptedStreamLength( pEncrypt );
 
     this->Write( pDevice, eWriteMode, pEncrypt, keyStop );
     pDevice->Print( "\n" );
 
-    if( m_pStream )
+    if( bRawStream )
+    {
+        this->WriteRawStream( pDevice );
+    }
+    else if( m_pStream )
     {
         m_pStream->Write( pDevice, pEncrypt );
     }
@@ -259,6 +261,46 @@ void PdfObject::WriteObject( PdfOutputDevice* pDevice, EPdfWriteMode eWriteMode,
     }
 }
 
+void PdfObject::SetEncryptedStreamLength( const PdfEncrypt* pEncrypt ) const
+{
+    DelayedStreamLoad();
+
+    // PdfFileStream handles encryption internally
+    if( !pEncrypt || !m_pStream || dynamic_cast<PdfFileStream*>(m_pStream) )
+        return;
+
+    // Set length if it is a key
+    const pdf_int64 lLength = pEncrypt->CalculateStreamLength( m_pStream->GetLength() );
+    PdfObject*      pLength = const_cast<PdfObject*>(this)->GetIndirectKey( PdfName::KeyLength );
+
+    // Do not modify the length if it is correct already
+    if( !pLength->IsNumber() || pLength->GetNumber() != lLength )
+        *pLength = PdfVariant( lLength );
+}
+
+void PdfObject::LoadForWrite( const PdfEncrypt* pEncrypt ) const
+{
+    // Load what WriteObject() loads: unmodified streams 
+    // are copied as they are, so do not load them
+    const bool bRawStream = !pEncrypt && this->HasRawStream();
+    if( !bRawStream )
+        DelayedStreamLoad();
+
+    if( pEncrypt && m_pStream )
+        this->SetEncryptedStreamLength( pEncrypt );
+
+    if( !m_pOwner || !(bRawStream || m_pStream) )
+        return;
+
+    const PdfObject* pLength = this->GetDictionary().GetKey( PdfName::KeyLength );
+    if( pLength && pLength->IsReference() )
+    {
+        pLength = m_pOwner->GetObject( pLength->GetReference() );
+        if( pLength )
+            pLength->DelayedLoad();
+    }
+}
+
 PdfObject* PdfObject::GetIndirectKey( const PdfName & key ) const
 {
     if ( !this->IsDictionary() )
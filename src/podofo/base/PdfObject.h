@@ -69,6 +69,7 @@ class PODOFO_API PdfObject : public PdfVariant {
     friend class PdfArray;
     friend class PdfDictionary;
     friend class PdfDocument;
+    friend class PdfUpdateSession;
 
  public:
 
@@ -202,6 +203,31 @@ class PODOFO_API PdfObject : public PdfVariant {
     void WriteObject( PdfOutputDevice* pDevice, EPdfWriteMode eWriteMode, PdfEncrypt* pEncrypt,
                       const PdfName & keyStop = PdfName::KeyNull ) const;
 
+    /** Set the /Length key of this object to the length its stream
+     *  will have after encrypting it with pEncrypt.
+     *
+     *  WriteObject() does this for every encrypted stream. Calling it
+     *  beforehand makes sure WriteObject() does not modify any
+     *  object, which is e.g. required to write objects from several threads,
+     *  as the /Length key may refer to another object.
+     *
+     *  \param pEncrypt the encryption object which will be used to write this object
+     */
+    void SetEncryptedStreamLength( const PdfEncrypt* pEncrypt ) const;
+
+    /** Load this object and every object WriteObject() will look up,
+     *  i.e. an indirect /Length of its stream.
+     *
+     *  Looking up an object may load it from the file and add it to the 
+     *  PdfVecObjects of this object. Calling this method for all objects
+     *  before they are written makes sure that WriteObject() neither
+     *  loads nor modifies any object. This is required to iterate over the
+     *  PdfVecObjects while writing and to write objects from several threads.
+     *
+     *  \param pEncrypt the encryption object which will be used to write this object
+     */
+    void LoadForWrite( const PdfEncrypt* pEncrypt ) const;
+
     /** Get the length of the object in bytes if it was written to disk now.
      *  \param eWriteMode additional options for writing the object
      *  \returns  the length of the object
@@ -317,6 +343,26 @@ class PODOFO_API PdfObject : public PdfVariant {
      */
     inline virtual void DelayedStreamLoadImpl();
 
+    /** Check whether the stream of this object has not been loaded yet
+     *  and can be copied unmodified from its source by WriteRawStream().
+     *
+     *  WriteObject() uses this to write streams of unmodified objects without
+     *  loading, decoding or buffering them. The default implementation
+     *  returns false.
+     *
+     *  \returns true if WriteRawStream() can be used to write the stream
+     */
+    inline virtual bool HasRawStream() const;
+
+    /** Write the stream of this object, including the stream and endstream
+     *  keywords, by copying it unmodified from its source.
+     *
+     *  Only called if HasRawStream() returned true.
+     *
+     *  \param pDevice write the stream to this device
+     */
+    inline virtual void WriteRawStream( PdfOutputDevice* pDevice ) const;
+
     /** Same as GetStream() but won't trigger a delayed load, so it's safe
      *  for use while a delayed load is in progress.
      *
@@ -455,6 +501,22 @@ inline void PdfObject::DelayedStreamLoadImpl()
    PODOFO_RAISE_ERROR( ePdfError_InternalLogic );
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline bool PdfObject::HasRawStream() const
+{
+    return false;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline void PdfObject::WriteRawStream( PdfOutputDevice* ) const
+{
+   PODOFO_RAISE_ERROR( ePdfError_InternalLogic );
+}
+
 inline void PdfObject::DelayedStreamLoad() const
 {
     DelayedLoad();
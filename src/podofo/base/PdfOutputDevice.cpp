@@ -32,15 +32,76 @@
  ***************************************************************************/
 
 #include "PdfOutputDevice.h"
+#include "PdfInputDevice.h"
+#include "PdfLocale.h"
 #include "PdfRefCountedBuffer.h"
 #include "PdfDefinesPrivate.h"
 
+#include <cmath>
 #include <fstream>
 #include <sstream>
 
+#if defined(PODOFO_HAVE_COPY_FILE_RANGE) || defined(PODOFO_HAVE_SENDFILE)
+#include <unistd.h>
+#endif // PODOFO_HAVE_COPY_FILE_RANGE || PODOFO_HAVE_SENDFILE
+#ifdef PODOFO_HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif // PODOFO_HAVE_SENDFILE
+
 
 namespace PoDoFo {
 
+/** Two decimal digits for each number from 0 to 99
+ */
+static const char s_szDigitPairs[] = 
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const pdf_uint64 s_nPowersOf10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+/** Write the decimal digits of nValue right aligned into a buffer.
+ *
+ *  \param nValue the number
+ *  \param pszEnd end of the buffer, which has to be at least 20 bytes
+ *  \returns pointer to the first digit
+ */
+static char* FormatDigits( pdf_uint64 nValue, char* pszEnd )
+{
+    char* p = pszEnd;
+    while( nValue >= 100 ) 
+    {
+        const char* pPair = s_szDigitPairs + 2 * (nValue % 100);
+        nValue /= 100;
+
+        p -= 2;
+        p[0] = pPair[0];
+        p[1] = pPair[1];
+    }
+
+    if( nValue >= 10 ) 
+    {
+        const char* pPair = s_szDigitPairs + 2 * nValue;
+
+        p -= 2;
+        p[0] = pPair[0];
+        p[1] = pPair[1];
+    }
+    else
+        *--p = static_cast<char>('0' + nValue);
+
+    return p;
+}
 
 PdfOutputDevice::PdfOutputDevice()
 {
@@ -56,28 +117,26 @@ PdfOutputDevice::PdfOutputDevice( const char* pszFilename, bool bTruncate )
         PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
     }
 
-    std::ios_base::openmode openmode = std::fstream::binary | std::ios_base::in | std::ios_base::out;
-    if( bTruncate )
-        openmode |= std::ios_base::trunc;
-
-    std::fstream *pStream = new std::fstream( pszFilename, openmode );
-    if( pStream->fail() )
+    // Use a FILE handle like the wchar_t overload, so that the
+    // underlying file descriptor is available for CopyFrom()
+    m_hFile = fopen( pszFilename, bTruncate ? "w+b" : "r+b" );
+    if( !m_hFile )
     {
-        delete pStream;
         PODOFO_RAISE_ERROR_INFO( ePdfError_FileNotFound, pszFilename );
     }
 
-    m_pStream = pStream;
-    m_pReadStream = pStream;
-    PdfLocaleImbue( *m_pStream );
-
     if( !bTruncate )
     {
-        m_pStream->seekp( 0, std::ios_base::end );
+        if( fseeko( m_hFile, 0, SEEK_END ) == -1 )
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_ValueOutOfRange, "Failed to seek to the end of the file" );
+        }
 
-        m_ulPosition = m_pStream->tellp();
+        m_ulPosition = ftello( m_hFile );
         m_ulLength = m_ulPosition;
     }
+
+    this->SetWriteBufferSize( DEFAULT_WRITE_BUFFER_SIZE );
 }
 
 #ifdef _WIN32
@@ -108,6 +167,8 @@ PdfOutputDevice::PdfOutputDevice( const wchar_t* pszFilename, bool bTruncate )
         m_ulPosition = ftello( m_hFile );
         m_ulLength = m_ulPosition;
     }
+
+    this->SetWriteBufferSize( DEFAULT_WRITE_BUFFER_SIZE );
 }
 #endif // _WIN32
 
@@ -135,7 +196,6 @@ PdfOutputDevice::PdfOutputDevice( const std::ostream* pOutStream )
     m_pStreamSavedLocale = m_pStream->getloc();
     PdfLocaleImbue(*m_pStream);
 #endif
-
 }
 
 PdfOutputDevice::PdfOutputDevice( PdfRefCountedBuffer* pOutBuffer )
@@ -160,6 +220,13 @@ PdfOutputDevice::PdfOutputDevice( std::iostream* pStream )
 
 PdfOutputDevice::~PdfOutputDevice()
 {
+    try {
+        this->FlushWriteBuffer();
+    } catch( PdfError & ) {
+        // Call Flush() before destruction to see this error
+    }
+    podofo_free( m_pWriteBuffer );
+
     if( m_pStreamOwned ) 
         // remember, deleting a null pointer is safe
         delete m_pStream; // will call close
@@ -185,6 +252,9 @@ void PdfOutputDevice::Init()
     m_lBufferLen        = 0;
     m_ulPosition        = 0;
     m_pStreamOwned      = true;
+    m_pWriteBuffer      = NULL;
+    m_lWriteBufferSize  = 0;
+    m_lWriteBufferUsed  = 0;
 }
 
 void PdfOutputDevice::Print( const char* pszFormat, ... )
@@ -192,6 +262,13 @@ void PdfOutputDevice::Print( const char* pszFormat, ... )
     va_list args;
     long lBytes;
 
+    if( pszFormat && !strchr( pszFormat, '%' ) )
+    {
+        // Nothing to format
+        this->Write( pszFormat, strlen( pszFormat ) );
+        return;
+    }
+
 	va_start( args, pszFormat );
 	lBytes = PrintVLen(pszFormat, args);
 	va_end( args );
@@ -210,34 +287,23 @@ long PdfOutputDevice::PrintVLen( const char* pszFormat, va_list args )
         PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
     }
 
-    if( m_hFile )
-    {
-        if( (lBytes = vfprintf( m_hFile, pszFormat, args )) < 0 )
-        {
-            perror( NULL );
-            PODOFO_RAISE_ERROR( ePdfError_UnexpectedEOF );
-        }
-    }
-    else
-    {
-        // OC 17.08.2010: Use new function _vscprintf to get the number of characters:
-        // visual c++  8.0 == 1400 (Visual Studio 2005)
-        // i am not shure if 1300 is ok here, but who cares this cruel compiler version
+    // OC 17.08.2010: Use new function _vscprintf to get the number of characters:
+    // visual c++  8.0 == 1400 (Visual Studio 2005)
+    // i am not shure if 1300 is ok here, but who cares this cruel compiler version
 #if (defined _MSC_VER && _MSC_VER >= 1400 )
-        lBytes = _vscprintf( pszFormat, args );
+    lBytes = _vscprintf( pszFormat, args );
 #elif (defined _MSC_VER || defined __hpux)  // vsnprintf without buffer does not work with MS-VC or HPUX
-        int len = 1024;
-        do
-        {
-            char * temp = new char[len+1]; // OC 17.08.2010 BugFix: +1 avoids corrupted heap
-            lBytes = vsnprintf( temp, len+1, pszFormat, args );
-            delete[] temp;
-            len *= 2;
-        } while (lBytes < 0 );
+    int len = 1024;
+    do
+    {
+        char * temp = new char[len+1]; // OC 17.08.2010 BugFix: +1 avoids corrupted heap
+        lBytes = vsnprintf( temp, len+1, pszFormat, args );
+        delete[] temp;
+        len *= 2;
+    } while (lBytes < 0 );
 #else
-        lBytes = vsnprintf( NULL, 0, pszFormat, args );
+    lBytes = vsnprintf( NULL, 0, pszFormat, args );
 #endif
-    }
 
     return lBytes;
 }
@@ -260,7 +326,7 @@ void PdfOutputDevice::PrintV( const char* pszFormat, long lBytes, va_list args )
             PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
         }
     }
-    else if( m_pStream || m_pRefCountedBuffer )
+    else if( m_hFile || m_pStream || m_pRefCountedBuffer )
     {
         ++lBytes;
         m_printBuffer.Resize( lBytes );
@@ -274,22 +340,9 @@ void PdfOutputDevice::PrintV( const char* pszFormat, long lBytes, va_list args )
         if( lBytes )
             --lBytes;
 
-        if( m_pStream ) 
-        {
-            std::string str;
-            str.assign( data, lBytes );
-            *m_pStream << str;
-        }
-        else // if( m_pRefCountedBuffer ) 
-        {
-            if( m_ulPosition + lBytes > static_cast<unsigned long>(m_pRefCountedBuffer->GetSize()) )
-            {
-                m_pRefCountedBuffer->Resize( m_ulPosition + lBytes );
-            }
-
-            memcpy( m_pRefCountedBuffer->GetBuffer() + m_ulPosition, data, lBytes );
-        }
-
+        // Goes through the write buffer and updates the position
+        PdfOutputDevice::Write( data, lBytes );
+        return;
     }
 
     m_ulPosition += static_cast<size_t>(lBytes);
@@ -302,6 +355,8 @@ void PdfOutputDevice::PrintV( const char* pszFormat, long lBytes, va_list args )
 size_t PdfOutputDevice::Read( char* pBuffer, size_t lLen )
 {
 	size_t numRead = 0;
+
+    this->FlushWriteBuffer();
     if( m_hFile )
     {
 		numRead = fread( pBuffer, sizeof(char), lLen, m_hFile );
@@ -343,12 +398,22 @@ size_t PdfOutputDevice::Read( char* pBuffer, size_t lLen )
 
 void PdfOutputDevice::Write( const char* pBuffer, size_t lLen )
 {
-    if( m_hFile )
+    if( m_pWriteBuffer )
     {
-        if( fwrite( pBuffer, sizeof(char), lLen, m_hFile ) != static_cast<size_t>(lLen) )
+        if( m_lWriteBufferUsed + lLen > m_lWriteBufferSize )
+            this->FlushWriteBuffer();
+
+        if( lLen < m_lWriteBufferSize )
         {
-            PODOFO_RAISE_ERROR( ePdfError_UnexpectedEOF );
+            memcpy( m_pWriteBuffer + m_lWriteBufferUsed, pBuffer, lLen );
+            m_lWriteBufferUsed += lLen;
         }
+        else
+            this->WriteUnbuffered( pBuffer, lLen );
+    }
+    else if( m_hFile || m_pStream )
+    {
+        this->WriteUnbuffered( pBuffer, lLen );
     }
     else if( m_pBuffer )
     {
@@ -361,10 +426,6 @@ void PdfOutputDevice::Write( const char* pBuffer, size_t lLen )
             PODOFO_RAISE_ERROR_INFO( ePdfError_OutOfMemory, "Allocated buffer to small for PdfOutputDevice. Cannot write!"  );
         }
     }
-    else if( m_pStream )
-    {
-        m_pStream->write( pBuffer, lLen );
-    }
     else if( m_pRefCountedBuffer ) 
     {
         if( m_ulPosition + lLen > m_pRefCountedBuffer->GetSize() )
@@ -377,8 +438,276 @@ void PdfOutputDevice::Write( const char* pBuffer, size_t lLen )
 	if(m_ulPosition>m_ulLength) m_ulLength = m_ulPosition;
 }
 
+void PdfOutputDevice::WriteUnbuffered( const char* pBuffer, size_t lLen )
+{
+    if( m_hFile )
+    {
+        if( fwrite( pBuffer, sizeof(char), lLen, m_hFile ) != static_cast<size_t>(lLen) )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_UnexpectedEOF );
+        }
+    }
+    else if( m_pStream )
+    {
+        m_pStream->write( pBuffer, lLen );
+    }
+}
+
+void PdfOutputDevice::FlushWriteBuffer()
+{
+    if( m_lWriteBufferUsed )
+    {
+        size_t lLen = m_lWriteBufferUsed;
+
+        m_lWriteBufferUsed = 0;
+        this->WriteUnbuffered( m_pWriteBuffer, lLen );
+    }
+}
+
+void PdfOutputDevice::SetWriteBufferSize( size_t lSize )
+{
+    this->FlushWriteBuffer();
+
+    podofo_free( m_pWriteBuffer );
+    m_pWriteBuffer     = NULL;
+    m_lWriteBufferSize = 0;
+
+    if( lSize && (m_hFile || m_pStream) )
+    {
+        m_pWriteBuffer = static_cast<char*>(podofo_malloc( lSize ));
+        if( !m_pWriteBuffer )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
+        }
+
+        m_lWriteBufferSize = lSize;
+    }
+}
+
+void PdfOutputDevice::WriteInt( pdf_int64 nValue )
+{
+    char buffer[FORMAT_BUFFER_SIZE];
+
+    this->Write( buffer, PdfOutputDevice::FormatInt( nValue, buffer ) );
+}
+
+void PdfOutputDevice::WriteReal( double dValue, int nPrecision, bool bTrimZeros )
+{
+    char        buffer[FORMAT_BUFFER_SIZE];
+    std::string sFormatted;
+    const char* pszData = buffer;
+    size_t      lLen    = PdfOutputDevice::FormatReal( dValue, nPrecision, buffer );
+
+    if( !lLen ) 
+    {
+        // Use ostringstream, so that locale does not matter
+        std::ostringstream oss;
+        PdfLocaleImbue(oss);
+        oss.flags( std::ios_base::fixed );
+        oss.precision( nPrecision );
+        oss << dValue;
+
+        sFormatted = oss.str();
+        pszData    = sFormatted.c_str();
+        lLen       = sFormatted.size();
+    }
+
+    if( bTrimZeros && memchr( pszData, '.', lLen ) )
+    {
+        while( pszData[lLen - 1] == '0' )
+            --lLen;
+        if( pszData[lLen - 1] == '.' )
+            --lLen;
+        if( lLen == 0 )
+        {
+            this->Write( "0", 1 );
+            return;
+        }
+    }
+
+    this->Write( pszData, lLen );
+}
+
+void PdfOutputDevice::WriteXRefRow( pdf_uint64 offset, pdf_uint16 generation, char cMode )
+{
+    const pdf_uint64 MAX_OFFSET = 9999999999ULL;
+
+    if( offset > MAX_OFFSET ) 
+    {
+        // Does not fit into an xref table, but keep the old behaviour
+        this->Print( "%0.10" PDF_FORMAT_UINT64 " %0.5hu %c \n", offset, generation, cMode );
+        return;
+    }
+
+    // "oooooooooo ggggg n \n"
+    char row[20];
+
+    memset( row, '0', 16 );
+    FormatDigits( offset, row + 10 );
+    FormatDigits( generation, row + 16 );
+
+    row[10] = ' ';
+    row[16] = ' ';
+    row[17] = cMode;
+    row[18] = ' ';
+    row[19] = '\n';
+
+    this->Write( row, sizeof(row) );
+}
+
+size_t PdfOutputDevice::FormatInt( pdf_int64 nValue, char* pszBuffer )
+{
+    char   digits[20];
+    char*  pszEnd   = digits + sizeof(digits);
+    size_t lLen     = 0;
+
+    // Negate as unsigned, so that the smallest pdf_int64 works as well
+    pdf_uint64 nAbs = nValue < 0 ? 0ULL - static_cast<pdf_uint64>(nValue) : static_cast<pdf_uint64>(nValue);
+    char*      p    = FormatDigits( nAbs, pszEnd );
+
+    if( nValue < 0 )
+        pszBuffer[lLen++] = '-';
+
+    memcpy( pszBuffer + lLen, p, pszEnd - p );
+    return lLen + (pszEnd - p);
+}
+
+size_t PdfOutputDevice::FormatReal( double dValue, int nPrecision, char* pszBuffer )
+{
+    if( nPrecision < 0 || nPrecision > 9 )
+        return 0;
+
+    // The result has to be exact in a double and in a pdf_uint64.
+    // This also rejects NaN and infinite values.
+    double dScaled = fabs( dValue ) * static_cast<double>(s_nPowersOf10[nPrecision]);
+    if( !(dScaled < 1e15) )
+        return 0;
+
+    // dScaled may differ from the exact product by half an ulp. If it 
+    // is that close to a tie, only printf knows how to round.
+    double dFloor = floor( dScaled );
+    double dFrac  = dScaled - dFloor;
+    if( fabs( dFrac - 0.5 ) <= dScaled * 1e-15 )
+        return 0;
+
+    pdf_uint64 nScaled = static_cast<pdf_uint64>(dFloor) + (dFrac > 0.5 ? 1 : 0);
+    pdf_uint64 nInt    = nScaled / s_nPowersOf10[nPrecision];
+    pdf_uint64 nFrac   = nScaled % s_nPowersOf10[nPrecision];
+
+    char   digits[20];
+    char*  pszEnd = digits + sizeof(digits);
+    char*  p      = FormatDigits( nInt, pszEnd );
+    size_t lLen   = 0;
+
+    // printf keeps the sign of negative numbers which are rounded to 0
+    pdf_uint64 nBits;
+    memcpy( &nBits, &dValue, sizeof(nBits) );
+    if( nBits >> 63 )
+        pszBuffer[lLen++] = '-';
+
+    memcpy( pszBuffer + lLen, p, pszEnd - p );
+    lLen += pszEnd - p;
+
+    if( nPrecision ) 
+    {
+        pszBuffer[lLen++] = '.';
+        for( int i = nPrecision - 1; i >= 0; i-- ) 
+        {
+            pszBuffer[lLen + i] = static_cast<char>('0' + nFrac % 10);
+            nFrac /= 10;
+        }
+        lLen += nPrecision;
+    }
+
+    return lLen;
+}
+
+void PdfOutputDevice::CopyFrom( PdfInputDevice* pDevice, pdf_long lLen )
+{
+    if( !pDevice )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+#if defined(PODOFO_HAVE_COPY_FILE_RANGE) || defined(PODOFO_HAVE_SENDFILE)
+    if( m_hFile && pDevice->m_pFile && lLen > 0 )
+    {
+        // Flush buffered data so that the file descriptor
+        // is positioned exactly at m_ulPosition
+        this->Flush();
+
+        int    fdIn   = fileno( pDevice->m_pFile );
+        int    fdOut  = fileno( m_hFile );
+        off_t  offIn  = static_cast<off_t>(pDevice->Tell());
+        off_t  offOut = static_cast<off_t>(m_ulPosition);
+        pdf_long lLeft = lLen;
+
+#if defined(PODOFO_HAVE_COPY_FILE_RANGE)
+        while( lLeft > 0 )
+        {
+            off64_t lIn  = offIn;
+            off64_t lOut = offOut;
+            ssize_t lCopied = copy_file_range( fdIn, &lIn, fdOut, &lOut, static_cast<size_t>(lLeft), 0 );
+            if( lCopied <= 0 )
+                break; // e.g. EXDEV or ENOSYS, try the next method
+
+            offIn  += lCopied;
+            offOut += lCopied;
+            lLeft  -= lCopied;
+        }
+#endif // PODOFO_HAVE_COPY_FILE_RANGE
+
+#if defined(PODOFO_HAVE_SENDFILE)
+        if( lLeft > 0 && lseek( fdOut, offOut, SEEK_SET ) == offOut )
+        {
+            while( lLeft > 0 )
+            {
+                ssize_t lCopied = sendfile( fdOut, fdIn, &offIn, static_cast<size_t>(lLeft) );
+                if( lCopied <= 0 )
+                    break;
+
+                offOut += lCopied;
+                lLeft  -= lCopied;
+            }
+        }
+#endif // PODOFO_HAVE_SENDFILE
+
+        // Synchronize both FILE handles with the new file positions
+        if( fseeko( m_hFile, offOut, SEEK_SET ) == -1 )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_InvalidDeviceOperation );
+        }
+        pDevice->Seek( offIn );
+
+        m_ulPosition = static_cast<size_t>(offOut);
+        if( m_ulPosition > m_ulLength )
+            m_ulLength = m_ulPosition;
+
+        lLen = lLeft;
+    }
+#endif // PODOFO_HAVE_COPY_FILE_RANGE || PODOFO_HAVE_SENDFILE
+
+    // Copy any remaining data using a fixed size buffer
+    const pdf_long BUFFER_SIZE = 65536;
+    char           buffer[BUFFER_SIZE];
+
+    while( lLen > 0 )
+    {
+        pdf_long lRead = static_cast<pdf_long>(pDevice->Read( buffer, PDF_MIN( BUFFER_SIZE, lLen ) ));
+        if( lRead <= 0 )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_UnexpectedEOF );
+        }
+
+        this->Write( buffer, static_cast<size_t>(lRead) );
+        lLen -= lRead;
+    }
+}
+
 void PdfOutputDevice::Seek( size_t offset )
 {
+    this->FlushWriteBuffer();
+
     if( m_hFile )
     {
         if( fseeko( m_hFile, offset, SEEK_SET ) == -1 )
@@ -409,6 +738,8 @@ void PdfOutputDevice::Seek( size_t offset )
 
 void PdfOutputDevice::Flush()
 {
+    this->FlushWriteBuffer();
+
     if( m_hFile )
     {
         if( fflush( m_hFile ) )
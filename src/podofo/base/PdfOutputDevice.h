@@ -44,6 +44,8 @@
 
 namespace PoDoFo {
 
+class PdfInputDevice;
+
 
 /** This class provides an output device which operates 
  *  either on a file or on a buffer in memory.
@@ -188,6 +190,87 @@ class PODOFO_API PdfOutputDevice {
      */
     virtual void Write( const char* pBuffer, size_t lLen );
 
+    /** Write an integer in decimal notation.
+     *
+     *  This is much faster than Print( "%" PDF_FORMAT_INT64, nValue ),
+     *  as no format string has to be parsed.
+     *
+     *  \param nValue the number to write
+     *
+     *  \see Write
+     */
+    void WriteInt( pdf_int64 nValue );
+
+    /** Write a real number in fixed point notation, i.e. without an exponent.
+     *  
+     *  The output is the same as of a std::ostream with std::fixed in the 
+     *  "C" locale, but most numbers are formatted without using printf.
+     *
+     *  \param dValue the number to write
+     *  \param nPrecision number of digits after the decimal point
+     *  \param bTrimZeros if true trailing zeros and a trailing decimal
+     *                    point are removed
+     *
+     *  \see Write
+     */
+    void WriteReal( double dValue, int nPrecision = 6, bool bTrimZeros = false );
+
+    /** Write a single 20 byte entry of a cross reference table.
+     *
+     *  \param offset the byte offset of the object
+     *  \param generation the generation number of the object
+     *  \param cMode 'n' for objects in use, 'f' for free objects
+     */
+    void WriteXRefRow( pdf_uint64 offset, pdf_uint16 generation, char cMode );
+
+    /** Format an integer in decimal notation.
+     *
+     *  \param nValue the number to format
+     *  \param pszBuffer a buffer of at least FORMAT_BUFFER_SIZE bytes.
+     *                   No terminating zero is written.
+     *
+     *  \returns the number of characters written to pszBuffer
+     */
+    static size_t FormatInt( pdf_int64 nValue, char* pszBuffer );
+
+    /** Format a real number in fixed point notation, like printf( "%.*f" )
+     *  does in the "C" locale.
+     *
+     *  Only numbers which can be rounded exactly without printf
+     *  are formatted, i.e. numbers with at most 9 digits after the decimal
+     *  point and 15 significant digits. A number which is exactly halfway
+     *  between two results is left to printf as well.
+     *
+     *  \param dValue the number to format
+     *  \param nPrecision number of digits after the decimal point
+     *  \param pszBuffer a buffer of at least FORMAT_BUFFER_SIZE bytes.
+     *                   No terminating zero is written.
+     *
+     *  \returns the number of characters written to pszBuffer or 0 if
+     *           dValue has to be formatted by the C library
+     */
+    static size_t FormatReal( double dValue, int nPrecision, char* pszBuffer );
+
+    enum { 
+        FORMAT_BUFFER_SIZE = 32 ///< buffer size required by FormatInt and FormatReal
+    };
+
+    /** Copy data from an input device to this device without
+     *  processing it.
+     *
+     *  Reading starts at the current position of pDevice, which is
+     *  positioned right after the copied data afterwards.
+     *  If both devices operate on files, the data is copied by the
+     *  operating system (using copy_file_range or sendfile, if available)
+     *  without passing through user space.
+     *
+     *  \param pDevice read data from this input device
+     *  \param lLen copy exactly lLen bytes
+     *
+     *  \see Write
+     */
+    virtual void CopyFrom( PdfInputDevice* pDevice, pdf_long lLen );
+
     /** Read data from the device
      *  \param pBuffer a pointer to the data buffer
      *  \param lLen length of the output buffer
@@ -210,11 +293,40 @@ class PODOFO_API PdfOutputDevice {
      */
     virtual void Flush();
 
+    /** Set the size of the buffer which combines small writes.
+     *
+     *  Files are written through a buffer of DEFAULT_WRITE_BUFFER_SIZE
+     *  bytes by default, so that the many small writes of e.g. 
+     *  PdfVariant::Write do not reach the C library one by one. 
+     *  Buffered data is passed on when the buffer is full and 
+     *  on Flush(), Seek(), Read() and destruction of the device.
+     *  Blocks larger than the buffer are not copied.
+     *
+     *  A std::ostream is not buffered by default, as callers often read
+     *  the stream (e.g. std::ostringstream::str()) while the device is
+     *  still alive. Writes to memory are never buffered.
+     *
+     *  \param lSize size of the buffer in bytes, 0 disables buffering
+     */
+    void SetWriteBufferSize( size_t lSize );
+
+    enum {
+        DEFAULT_WRITE_BUFFER_SIZE = 65536 ///< default size of the write buffer in bytes
+    };
+
  private: 
     /** Initialize all private members
      */
     void Init();
 
+    /** Pass data on to the file or std::ostream, bypassing the write buffer
+     */
+    void WriteUnbuffered( const char* pBuffer, size_t lLen );
+
+    /** Pass all data in the write buffer on to the file or std::ostream
+     */
+    void FlushWriteBuffer();
+
  protected:
     size_t        m_ulLength;
 
@@ -237,6 +349,10 @@ class PODOFO_API PdfOutputDevice {
     size_t               m_ulPosition;
 
     PdfRefCountedBuffer  m_printBuffer;
+
+    char*                m_pWriteBuffer;
+    size_t               m_lWriteBufferSize;
+    size_t               m_lWriteBufferUsed;
 };
 
 // -----------------------------------------------------
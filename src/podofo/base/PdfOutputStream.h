@@ -180,6 +180,11 @@ class PODOFO_API PdfMemoryOutputStream : public PdfOutputStream {
      */
     inline char* TakeBuffer();
 
+    /** Discard all written data. The internal buffer
+     *  is kept and reused by further calls to Write().
+     */
+    inline void Rewind();
+
  private:
     char* m_pBuffer;
 
@@ -215,6 +220,14 @@ inline char* PdfMemoryOutputStream::TakeBuffer()
     return pBuffer;
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline void PdfMemoryOutputStream::Rewind()
+{
+    m_lLen = 0;
+}
+
 /** An output stream that writes to a PdfOutputDevice
  */
 class PODOFO_API PdfDeviceOutputStream : public PdfOutputStream {
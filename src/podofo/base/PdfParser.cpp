@@ -148,6 +148,10 @@ void PdfParser::Init()
     m_lLastEOFOffset  = 0;
 
     m_nIncrementalUpdates = 0;
+
+    m_setCachedObjectStreams.clear();
+    m_vecCachedObjects.Clear();
+    m_vecCachedObjects.SetAutoDelete( true );
 }
 
 void PdfParser::ParseFile( const char* pszFilename, bool bLoadOnDemand )
@@ -234,6 +238,116 @@ void PdfParser::ParseFile( const PdfRefCountedInputDevice & rDevice, bool bLoadO
     }
 }
 
+void PdfParser::ParseStructure( const PdfRefCountedInputDevice & rDevice )
+{
+    Clear();
+
+    m_device = rDevice;
+
+    m_bLoadOnDemand = true;
+
+    try {
+        if( !IsPdfFile() )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_NoPdfFile );
+        }
+    
+        ReadDocumentStructure();
+    } catch( PdfError & e ) {
+        Clear();
+        e.AddToCallstack( __FILE__, __LINE__, "Unable to read the document structure." );
+        throw e;
+    }
+}
+
+PdfObject* PdfParser::LoadObject( const PdfReference & rRef )
+{
+    if( !m_device.Device() )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    const pdf_objnum nObjNo = rRef.ObjectNumber();
+    if( nObjNo >= m_offsets.size() || !m_offsets[nObjNo].bParsed )
+        return NULL;
+
+    const TXRefEntry & entry = m_offsets[nObjNo];
+    if( entry.cUsed == 'n' && entry.lOffset > 0 )
+    {
+        if( entry.lGeneration != static_cast<long>(rRef.GenerationNumber()) )
+            return NULL;
+
+        PdfParserObject* pObject = new PdfParserObject( m_vecObjects, m_device, m_buffer, entry.lOffset );
+        pObject->SetLoadOnDemand( m_bLoadOnDemand );
+        try {
+            pObject->ParseFile( m_pEncrypt );
+
+            if( pObject->Reference() != rRef )
+            {
+                PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidXRef, "The XRef table points to another object." );
+            }
+        } catch( PdfError & e ) {
+            std::ostringstream oss;
+            oss << "Error while loading object " << rRef.ObjectNumber() 
+                << " " << rRef.GenerationNumber() 
+                << " Offset = " << entry.lOffset << std::endl;
+            delete pObject;
+
+            e.AddToCallstack( __FILE__, __LINE__, oss.str().c_str() );
+            throw e;
+        }
+
+        m_vecObjects->push_back( pObject );
+        return pObject;
+    }
+    else if( entry.cUsed == 's' && rRef.GenerationNumber() == 0 )
+    {
+        // The generation field contains the object number of the object stream
+        const pdf_objnum nStreamNo = static_cast<pdf_objnum>(entry.lGeneration);
+        if( nStreamNo >= m_offsets.size() || m_offsets[nStreamNo].cUsed != 'n' )
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidXRef, "The object stream of a compressed object does not exist." );
+        }
+
+        // Decoding an object stream is expensive, so all of its objects are
+        // read at once and kept until they are requested. Objects which 
+        // were requested before are read again from the object stream.
+        PdfObject* pObject = m_vecCachedObjects.RemoveObject( rRef, false );
+        if( !pObject )
+        {
+            PdfObjectStreamParserObject::ObjectIdList list;
+            if( m_setCachedObjectStreams.insert( nStreamNo ).second )
+            {
+                for( size_t i = 0; i < m_offsets.size(); i++ ) 
+                {
+                    if( m_offsets[i].bParsed && m_offsets[i].cUsed == 's' &&
+                        m_offsets[i].lGeneration == static_cast<long>(nStreamNo) )
+                        list.push_back( static_cast<pdf_int64>(i) );
+                }
+            }
+            else
+                list.push_back( static_cast<pdf_int64>(nObjNo) );
+
+            // Read the object stream without adding it to m_vecObjects,
+            // but with m_vecObjects as owner to resolve an indirect /Length
+            PdfParserObject stream( m_vecObjects, m_device, m_buffer, m_offsets[nStreamNo].lOffset );
+            stream.SetLoadOnDemand( false );
+            stream.ParseFile( m_pEncrypt );
+
+            PdfObjectStreamParserObject parser( &stream, &m_vecCachedObjects, m_buffer );
+            parser.Parse( list );
+
+            pObject = m_vecCachedObjects.RemoveObject( rRef, false );
+        }
+
+        if( pObject )
+            m_vecObjects->push_back( pObject );
+
+        return pObject;
+    }
+
+    return NULL;
+}
 
 void PdfParser::Clear()
 {
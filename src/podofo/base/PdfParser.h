@@ -251,6 +251,35 @@ class PODOFO_API PdfParser : public PdfTokenizer {
      */
     void ParseFile( const PdfRefCountedInputDevice & rDevice, bool bLoadOnDemand = true );
 
+    /** Open a PDF file and read only its cross-reference
+     *  sections and the trailer, but none of its objects.
+     *
+     *  Objects can be read one by one using LoadObject afterwards.
+     *  This is useful if only a few objects of a large file are needed,
+     *  e.g. for an incremental update.
+     *
+     *  Encrypted files are not decrypted.
+     *
+     *  \param rDevice the input device to read from
+     *
+     *  \see LoadObject
+     */
+    void ParseStructure( const PdfRefCountedInputDevice & rDevice );
+
+    /** Read a single object from the file and add it 
+     *  to the vector of objects of this parser.
+     *
+     *  The object is loaded on demand, if this parser does so.
+     *
+     *  \param rRef reference of the object
+     *
+     *  \returns the object or NULL if the cross-reference 
+     *            sections do not contain this object
+     *
+     *  \see ParseStructure
+     */
+    PdfObject* LoadObject( const PdfReference & rRef );
+
     /** Quick method to detect secured PDF files, i.e.
      *  a PDF with an /Encrypt key in the trailer directory.
      *
@@ -599,6 +628,9 @@ class PODOFO_API PdfParser : public PdfTokenizer {
 
     std::set<int> m_setObjectStreams;
 
+    std::set<pdf_objnum> m_setCachedObjectStreams; ///< object streams read by LoadObject()
+    PdfVecObjects m_vecCachedObjects;              ///< objects of these streams not requested yet
+
     bool          m_bStrictParsing;
 
     int           m_nIncrementalUpdates;
@@ -38,11 +38,14 @@
 #include "PdfEncrypt.h"
 #include "PdfInputDevice.h"
 #include "PdfInputStream.h"
+#include "PdfOutputDevice.h"
 #include "PdfParser.h"
 #include "PdfStream.h"
 #include "PdfVariant.h"
 #include "PdfDefinesPrivate.h"
 
+#include "util/PdfMutexWrapper.h"
+
 #include <iostream>
 #include <sstream>
 
@@ -50,6 +53,35 @@ namespace PoDoFo {
 
 using namespace std;
 
+/** Reads the data of a stream from an input device which is shared 
+ *  with other threads. The device is locked and positioned for each
+ *  read, so that the data can be decrypted and decoded without 
+ *  holding the lock.
+ */
+class PdfSharedDeviceInputStream : public PdfInputStream {
+ public:
+    PdfSharedDeviceInputStream( const PdfRefCountedInputDevice & rDevice, pdf_long lOffset )
+        : m_device( rDevice ), m_lOffset( lOffset )
+    {
+    }
+
+    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* = 0 )
+    {
+        Util::PdfMutexWrapper lock( m_device.GetMutex() );
+
+        if( m_device.Device()->Tell() != m_lOffset )
+            m_device.Device()->Seek( m_lOffset );
+
+        pdf_long lRead = static_cast<pdf_long>(m_device.Device()->Read( pBuffer, lLen ));
+        m_lOffset += lRead;
+        return lRead;
+    }
+
+ private:
+    PdfRefCountedInputDevice m_device;
+    pdf_long                 m_lOffset;
+};
+
 static const int s_nLenEndObj    = 6; // strlen("endobj");
 static const int s_nLenStream    = 6; // strlen("stream");
 //static const int s_nLenEndStream = 9; // strlen("endstream");
@@ -104,7 +136,8 @@ void PdfParserObject::ReadObjectNumber()
         pdf_long obj = this->GetNextNumber();
         pdf_long gen = this->GetNextNumber();
 
-        m_reference = PdfReference( static_cast<unsigned int>(obj), static_cast<pdf_uint16>(gen) );
+        m_reference        = PdfReference( static_cast<unsigned int>(obj), static_cast<pdf_uint16>(gen) );
+        m_decryptReference = m_reference;
     } catch( PdfError & e ) {
         e.AddToCallstack( __FILE__, __LINE__, "Object and generation number cannot be read." );
         throw e;
@@ -183,7 +216,7 @@ void PdfParserObject::ParseFileComplete( bool bIsTrailer )
 
     m_device.Device()->Seek( m_lOffset );
     if( m_pEncrypt )
-        m_pEncrypt->SetCurrentReference( m_reference );
+        m_pEncrypt->SetCurrentReference( m_decryptReference );
 
     // Do not call GetNextVariant directly,
     // but GetNextToken, to handle empty objects like:
@@ -237,24 +270,9 @@ void PdfParserObject::ParseFileComplete( bool bIsTrailer )
 }
 
 
-// Only called during delayed loading. Must be careful to avoid
-// triggering recursive delay loading due to use of accessors of
-// PdfVariant or PdfObject.
-void PdfParserObject::ParseStream()
+pdf_long PdfParserObject::FindStreamData() const
 {
-#if defined(PODOFO_EXTRA_CHECKS)
-    PODOFO_ASSERT( DelayedLoadDone() );
-    PODOFO_ASSERT( DelayedStreamLoadInProgress() );
-    PODOFO_ASSERT( !DelayedStreamLoadDone() );
-#endif
-
-    pdf_int64         lLen  = -1;
-    int          c;
-
-    if( !m_device.Device() || !m_pOwner )
-    {
-        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
-    }
+    int c;
 
     m_device.Device()->Seek( m_lStreamOffset );
 
@@ -286,9 +304,14 @@ void PdfParserObject::ParseStream()
         }
     } 
 
-    pdf_long fLoc = m_device.Device()->Tell();	// we need to save this, since loading the Length key could disturb it!
+    return m_device.Device()->Tell();
+}
+
+pdf_int64 PdfParserObject::GetStreamLength() const
+{
+    pdf_int64 lLen = -1;
 
-    PdfObject* pObj = this->GetDictionary_NoDL().GetKey( PdfName::KeyLength );  
+    const PdfObject* pObj = this->GetDictionary_NoDL().GetKey( PdfName::KeyLength );  
     if( pObj && pObj->IsNumber() )
     {
         lLen = pObj->GetNumber();   
@@ -333,32 +356,68 @@ void PdfParserObject::ParseStream()
         PODOFO_RAISE_ERROR( ePdfError_InvalidStreamLength );
     }
 
-    m_device.Device()->Seek( fLoc );	// reset it before reading!
-    PdfDeviceInputStream reader( m_device.Device() );
-
-	if( m_pEncrypt && !m_pEncrypt->IsMetadataEncrypted() ) {
-		// If metadata is not encrypted the Filter is set to "Crypt"
-		PdfObject* pFilterObj = this->GetDictionary_NoDL().GetKey( PdfName::KeyFilter );
-        if( pFilterObj && pFilterObj->IsReference() )
-            pFilterObj = m_pOwner->GetObject( pFilterObj->GetReference() );
-		if( pFilterObj && pFilterObj->IsArray() ) {
-			PdfArray filters = pFilterObj->GetArray();
-			for(PdfArray::iterator it = filters.begin(); it != filters.end(); it++) {
-                PdfObject *filter = &*it;
-                if( filter->IsReference() )
-                    filter = m_pOwner->GetObject( filter->GetReference() );
-                if( filter && filter->IsName() )
-                    if( filter->GetName() == "Crypt" )
-						m_pEncrypt = 0;
-			}
-		}
-	}
+    return lLen;
+}
+
+// Only called during delayed loading. Must be careful to avoid
+// triggering recursive delay loading due to use of accessors of
+// PdfVariant or PdfObject.
+void PdfParserObject::ParseStream()
+{
+#if defined(PODOFO_EXTRA_CHECKS)
+    PODOFO_ASSERT( DelayedLoadDone() );
+    PODOFO_ASSERT( DelayedStreamLoadInProgress() );
+    PODOFO_ASSERT( !DelayedStreamLoadDone() );
+#endif
+
+    if( !m_device.Device() || !m_pOwner )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    pdf_long  fLoc;
+    pdf_int64 lLen;
+    {
+        Util::PdfMutexWrapper lock( m_device.GetMutex() );
+
+        fLoc = this->FindStreamData();
+        lLen = this->GetStreamLength();
+
+        if( m_pEncrypt && !m_pEncrypt->IsMetadataEncrypted() ) {
+            // If metadata is not encrypted the Filter is set to "Crypt"
+            PdfObject* pFilterObj = this->GetDictionary_NoDL().GetKey( PdfName::KeyFilter );
+            if( pFilterObj && pFilterObj->IsReference() )
+                pFilterObj = m_pOwner->GetObject( pFilterObj->GetReference() );
+            if( pFilterObj && pFilterObj->IsArray() ) {
+                PdfArray filters = pFilterObj->GetArray();
+                for(PdfArray::iterator it = filters.begin(); it != filters.end(); it++) {
+                    PdfObject *filter = &*it;
+                    if( filter->IsReference() )
+                        filter = m_pOwner->GetObject( filter->GetReference() );
+                    if( filter && filter->IsName() )
+                        if( filter->GetName() == "Crypt" )
+                            m_pEncrypt = 0;
+                }
+            }
+        }
+    }
+
+    // The device is only locked while a block is read, so several 
+    // threads can decrypt and decode their streams at the same time.
+    PdfSharedDeviceInputStream reader( m_device, fLoc );
     if( m_pEncrypt )
     {
-        m_pEncrypt->SetCurrentReference( m_reference );
-        PdfInputStream* pInput = m_pEncrypt->CreateEncryptionInputStream( &reader );
-        this->GetStream_NoDL()->SetRawData( pInput, static_cast<pdf_long>(lLen) );
-        delete pInput;
+        PdfInputStream* pInput;
+        {
+            Util::PdfMutexWrapper lock( m_pEncrypt->GetMutex() );
+
+            m_pEncrypt->SetCurrentReference( m_decryptReference );
+            pInput = m_pEncrypt->CreateEncryptionInputStream( &reader, static_cast<pdf_long>(lLen) );
+        }
+
+        // The decrypted stream knows where the encrypted data ends
+        PODOFO_UNIQUEU_PTR<PdfInputStream> pGuard( pInput );
+        this->GetStream_NoDL()->SetRawData( pInput );
     }
     else
         this->GetStream_NoDL()->SetRawData( &reader, static_cast<pdf_long>(lLen) );
@@ -381,7 +440,17 @@ void PdfParserObject::DelayedLoadImpl()
     PODOFO_ASSERT( DelayedLoadInProgress() );
 #endif
 
-    ParseFileComplete( m_bIsTrailer );
+    // Objects of one document may be loaded from several threads.
+    // They share the input device, the tokenizer buffer and the 
+    // encryption object. Always lock the device first.
+    Util::PdfMutexWrapper lock( m_device.GetMutex() );
+    if( m_pEncrypt )
+    {
+        Util::PdfMutexWrapper encryptLock( m_pEncrypt->GetMutex() );
+        ParseFileComplete( m_bIsTrailer );
+    }
+    else
+        ParseFileComplete( m_bIsTrailer );
 
     // If we complete without throwing DelayedLoadDone will be set
     // for us.
@@ -421,6 +490,33 @@ void PdfParserObject::DelayedStreamLoadImpl()
     // If we complete without throwing the stream will be flagged as loaded.
 }
 
+bool PdfParserObject::HasRawStream() const
+{
+    // Make sure m_bStream has been determined
+    DelayedLoad();
+
+    // Encrypted streams have to be decrypted first
+    return m_bStream && !m_pStream && !DelayedStreamLoadDone()
+        && !m_pEncrypt && m_device.Device() && m_pOwner;
+}
+
+void PdfParserObject::WriteRawStream( PdfOutputDevice* pDevice ) const
+{
+    if( !m_device.Device() || !m_pOwner )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    Util::PdfMutexWrapper lock( m_device.GetMutex() );
+
+    pdf_int64 lLen = this->GetStreamLength();
+    m_device.Device()->Seek( this->FindStreamData() );
+
+    pDevice->Print( "stream\n" );
+    pDevice->CopyFrom( m_device.Device(), static_cast<pdf_long>(lLen) );
+    pDevice->Print( "\nendstream\n" );
+}
+
 void PdfParserObject::FreeObjectMemory( bool bForce )
 {
     if( this->IsLoadOnDemand() && (bForce || !this->IsDirty()) )
@@ -153,6 +153,16 @@ class PODOFO_API PdfParserObject : public PdfObject, public PdfTokenizer {
      */
     virtual void DelayedStreamLoadImpl();
 
+    /** Reimplemented from PdfObject. Streams which have not been loaded
+     *  yet and are not encrypted can be copied directly from the input device.
+     */
+    virtual bool HasRawStream() const;
+
+    /** Reimplemented from PdfObject. Copies the stream data
+     *  byte for byte from the input device to pDevice.
+     */
+    virtual void WriteRawStream( PdfOutputDevice* pDevice ) const;
+
     /** Starts reading at the file position m_lStreamOffset and interprets all bytes
      *  as contents of the objects stream.
      *  It is assumed that the dictionary has a valid /Length key already.
@@ -162,6 +172,20 @@ class PODOFO_API PdfParserObject : public PdfObject, public PdfTokenizer {
     void ParseStream();
 
  private:
+    /** Seek the input device to m_lStreamOffset and skip the
+     *  end-of-line marker after the stream keyword.
+     *
+     *  \returns the offset of the first byte of the stream data
+     */
+    pdf_long FindStreamData() const;
+
+    /** Get the length of the stream data from the /Length key,
+     *  which might be an indirect object.
+     *
+     *  \returns the length of the stream data
+     */
+    pdf_int64 GetStreamLength() const;
+
     /** Initialize private members in this object with their default values
      */
     void InitPdfParserObject();
@@ -189,6 +213,11 @@ class PODOFO_API PdfParserObject : public PdfObject, public PdfTokenizer {
 
     pdf_long m_lOffset;
 
+    // The reference as read from the file, which is required to decrypt
+    // the object. It stays the same if the object is renumbered later,
+    // e.g. while writing a linearized file.
+    PdfReference m_decryptReference;
+
     bool m_bStream;
     pdf_long m_lStreamOffset;
 };
@@ -36,6 +36,9 @@
 #include "PdfInputDevice.h"
 #include "PdfDefinesPrivate.h"
 
+#include "util/PdfMutex.h"
+#include "util/PdfMutexWrapper.h"
+
 namespace PoDoFo {
 
 PdfRefCountedInputDevice::PdfRefCountedInputDevice()
@@ -49,10 +52,12 @@ PdfRefCountedInputDevice::PdfRefCountedInputDevice( const char* pszFilename, con
 {
     m_pDevice              = new TRefCountedInputDevice();
     m_pDevice->m_lRefCount = 1;
+    m_pDevice->m_pMutex    = new Util::PdfMutex();
 
     try {
         m_pDevice->m_pDevice = new PdfInputDevice( pszFilename );
     } catch( PdfError & rError ) {
+        delete m_pDevice->m_pMutex;
         delete m_pDevice;
         throw rError;
     }
@@ -64,10 +69,12 @@ PdfRefCountedInputDevice::PdfRefCountedInputDevice( const wchar_t* pszFilename,
 {
     m_pDevice              = new TRefCountedInputDevice();
     m_pDevice->m_lRefCount = 1;
+    m_pDevice->m_pMutex    = new Util::PdfMutex();
 
     try {
         m_pDevice->m_pDevice = new PdfInputDevice( pszFilename );
     } catch( PdfError & rError ) {
+        delete m_pDevice->m_pMutex;
         delete m_pDevice;
         throw rError;
     }
@@ -79,11 +86,13 @@ PdfRefCountedInputDevice::PdfRefCountedInputDevice( const char* pBuffer, size_t
 {
     m_pDevice              = new TRefCountedInputDevice();
     m_pDevice->m_lRefCount = 1;
+    m_pDevice->m_pMutex    = new Util::PdfMutex();
 
 
     try {
         m_pDevice->m_pDevice   = new PdfInputDevice( pBuffer, lLen );
     } catch( PdfError & rError ) {
+        delete m_pDevice->m_pMutex;
         delete m_pDevice;
         throw rError;
     }
@@ -94,6 +103,7 @@ PdfRefCountedInputDevice::PdfRefCountedInputDevice( PdfInputDevice* pDevice )
 {
     m_pDevice              = new TRefCountedInputDevice();
     m_pDevice->m_lRefCount = 1;
+    m_pDevice->m_pMutex    = new Util::PdfMutex();
     m_pDevice->m_pDevice   = pDevice;
 }
 
@@ -110,24 +120,50 @@ PdfRefCountedInputDevice::~PdfRefCountedInputDevice()
 
 void PdfRefCountedInputDevice::Detach()
 {
-    if( m_pDevice && !--m_pDevice->m_lRefCount ) 
+    if( !m_pDevice )
+        return;
+
+    bool bLast;
+    {
+        // Copies are created and destroyed by threads 
+        // reading streams from the shared device
+        Util::PdfMutexWrapper lock( *m_pDevice->m_pMutex );
+        bLast = !--m_pDevice->m_lRefCount;
+    }
+
+    if( bLast ) 
     {
         // last owner of the file!
         m_pDevice->m_pDevice->Close();
         delete m_pDevice->m_pDevice;
+        delete m_pDevice->m_pMutex;
         delete m_pDevice;
-        m_pDevice = NULL;
     }
 
+    m_pDevice = NULL;
+}
+
+Util::PdfMutex & PdfRefCountedInputDevice::GetMutex() const
+{
+    if( !m_pDevice )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    return *m_pDevice->m_pMutex;
 }
 
 const PdfRefCountedInputDevice & PdfRefCountedInputDevice::operator=( const PdfRefCountedInputDevice & rhs )
 {
-    Detach();
+    TRefCountedInputDevice* pDevice = rhs.m_pDevice;
+    if( pDevice )
+    {
+        Util::PdfMutexWrapper lock( *pDevice->m_pMutex );
+        pDevice->m_lRefCount++;
+    }
 
-    m_pDevice = rhs.m_pDevice;
-    if( m_pDevice )
-        m_pDevice->m_lRefCount++;
+    Detach();
+    m_pDevice = pDevice;
 
     return *this;
 }
@@ -35,6 +35,7 @@
 #define _PDF_REF_COUNTED_INPUT_DEVICE_H_
 
 #include "PdfDefines.h"
+#include "util/PdfMutex.h"
 
 namespace PoDoFo {
 
@@ -103,6 +104,18 @@ class PODOFO_API PdfRefCountedInputDevice {
      */
     PODOFO_NOTHROW inline PdfInputDevice* Device() const;
 
+    /** Get the mutex which guards the shared input device.
+     *
+     *  All copies of a PdfRefCountedInputDevice share one device,
+     *  including its read position. Lock this mutex while seeking
+     *  and reading if the device is used from several threads.
+     *  The reference count is guarded by the same mutex, so copies
+     *  can be created and destroyed from several threads.
+     *
+     *  \returns the mutex of the shared device
+     */
+    Util::PdfMutex & GetMutex() const;
+
     /** Copy an existing PdfRefCountedFile and increase
      *  the reference count
      *  \param rhs the PdfRefCountedFile to copy
@@ -119,6 +132,7 @@ class PODOFO_API PdfRefCountedInputDevice {
     typedef struct {
         PdfInputDevice* m_pDevice;
         long            m_lRefCount;
+        Util::PdfMutex* m_pMutex;
     } TRefCountedInputDevice;
 
     TRefCountedInputDevice* m_pDevice;
@@ -45,12 +45,13 @@ void PdfReference::Write( PdfOutputDevice* pDevice, EPdfWriteMode eWriteMode, co
     if( (eWriteMode & ePdfWriteMode_Compact) == ePdfWriteMode_Compact ) 
     {
         // Write space before the reference
-        pDevice->Print( " %i %hi R", m_nObjectNo, m_nGenerationNo );
-    }
-    else
-    {
-        pDevice->Print( "%i %hi R", m_nObjectNo, m_nGenerationNo );
+        pDevice->Write( " ", 1 );
     }
+
+    pDevice->WriteInt( m_nObjectNo );
+    pDevice->Write( " ", 1 );
+    pDevice->WriteInt( m_nGenerationNo );
+    pDevice->Write( " R", 2 );
 }
 
 const std::string PdfReference::ToString() const
@@ -0,0 +1,502 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#include "PdfSpillStream.h"
+
+#include "PdfEncrypt.h"
+#include "PdfFilter.h"
+#include "PdfInputStream.h"
+#include "PdfObject.h"
+#include "PdfOutputDevice.h"
+#include "PdfOutputStream.h"
+#include "PdfVariant.h"
+#include "util/PdfMutexWrapper.h"
+#include "PdfDefinesPrivate.h"
+
+#include <stdlib.h>
+
+namespace PoDoFo {
+
+/** The last output stream of the filter chain of a PdfSpillStream.
+ *  Passes all encoded data to the stream which decides where it is stored.
+ */
+class PdfSpillOutputStream : public PdfOutputStream {
+ public:
+    PdfSpillOutputStream( PdfSpillStream* pStream )
+        : m_pStream( pStream )
+    {
+    }
+
+    virtual pdf_long Write( const char* pBuffer, pdf_long lLen )
+    {
+        m_pStream->StoreData( pBuffer, lLen );
+        return lLen;
+    }
+
+    virtual void Close()
+    {
+    }
+
+ private:
+    PdfSpillStream* m_pStream;
+};
+
+/** Reads the data of a spilled PdfSpillStream from the temporary file.
+ *  Keeps its own read position, so that several readers can be used at once.
+ */
+class PdfSpillInputStream : public PdfInputStream {
+ public:
+    PdfSpillInputStream( PdfSpillStreamFactory* pFactory, const PdfSpillStream::TVecExtents & rvecExtents )
+        : m_pFactory( pFactory ), m_vecExtents( rvecExtents ), m_nExtent( 0 ), m_lOffset( 0 )
+    {
+    }
+
+    virtual pdf_long Read( char* pBuffer, pdf_long lLen, pdf_long* = 0 )
+    {
+        pdf_long lRead = 0;
+        while( lRead < lLen && m_nExtent < m_vecExtents.size() )
+        {
+            const PdfSpillStream::TExtent & rExtent = m_vecExtents[m_nExtent];
+            const pdf_long lPart = PDF_MIN( lLen - lRead, rExtent.lLength - m_lOffset );
+
+            m_pFactory->ReadScratch( pBuffer + lRead, rExtent.lOffset + m_lOffset, lPart );
+            lRead     += lPart;
+            m_lOffset += lPart;
+            if( m_lOffset == rExtent.lLength )
+            {
+                ++m_nExtent;
+                m_lOffset = 0;
+            }
+        }
+
+        return lRead;
+    }
+
+ private:
+    PdfSpillStreamFactory*      m_pFactory;
+    PdfSpillStream::TVecExtents m_vecExtents;
+    size_t                      m_nExtent;
+    pdf_long                    m_lOffset;   ///< read position in the current extent
+};
+
+PdfSpillStream::PdfSpillStream( PdfObject* pParent, PdfSpillStreamFactory* pFactory )
+    : PdfStream( pParent ), m_pFactory( pFactory ), m_pBuffer( NULL ), m_lCapacity( 0 ),
+      m_bSpilled( false ), m_lLength( 0 ),
+      m_pStream( NULL ), m_pSpillStream( NULL )
+{
+}
+
+PdfSpillStream::~PdfSpillStream()
+{
+    delete m_pStream;
+    delete m_pSpillStream;
+
+    this->Reset();
+}
+
+void PdfSpillStream::BeginAppendImpl( const TVecFilters & vecFilters )
+{
+    this->Reset();
+
+    m_pSpillStream = new PdfSpillOutputStream( this );
+    if( vecFilters.size() )
+        m_pStream = PdfFilterFactory::CreateEncodeStream( vecFilters, m_pSpillStream );
+    else
+    {
+        m_pStream      = m_pSpillStream;
+        m_pSpillStream = NULL;
+    }
+}
+
+void PdfSpillStream::AppendImpl( const char* pszString, size_t lLen )
+{
+    m_pStream->Write( pszString, lLen );
+}
+
+void PdfSpillStream::EndAppendImpl()
+{
+    if( m_pStream ) 
+    {
+        m_pStream->Close();
+        delete m_pStream;
+        m_pStream = NULL;
+    }
+
+    if( m_pSpillStream ) 
+    {
+        m_pSpillStream->Close();
+        delete m_pSpillStream;
+        m_pSpillStream = NULL;
+    }
+
+    if( m_bSpilled )
+        m_pFactory->FlushScratch();
+
+    if( m_pParent )
+        m_pParent->GetDictionary().AddKey( PdfName::KeyLength, PdfVariant(static_cast<pdf_int64>(m_lLength) ) );
+}
+
+void PdfSpillStream::StoreData( const char* pBuffer, pdf_long lLen )
+{
+    if( lLen <= 0 )
+        return;
+
+    if( !m_bSpilled 
+        && ( m_lLength + lLen > m_pFactory->m_lThreshold || !this->Grow( m_lLength + lLen ) ) )
+        this->Spill();
+
+    if( m_bSpilled ) 
+        this->WriteSpilled( pBuffer, lLen );
+    else
+        memcpy( m_pBuffer + m_lLength, pBuffer, lLen );
+
+    m_lLength += lLen;
+}
+
+bool PdfSpillStream::Grow( pdf_long lSize )
+{
+    if( lSize <= m_lCapacity )
+        return true;
+
+    // Grow exponentially, but never beyond the threshold
+    // as larger streams are spilled anyways
+    pdf_long lCapacity = PDF_MIN( PDF_MAX( lSize, m_lCapacity << 1 ), m_pFactory->m_lThreshold );
+    if( !m_pFactory->Reserve( lCapacity - m_lCapacity ) )
+    {
+        lCapacity = lSize;
+        if( !m_pFactory->Reserve( lCapacity - m_lCapacity ) )
+            return false;
+    }
+
+    char* pBuffer = static_cast<char*>(podofo_realloc( m_pBuffer, lCapacity ));
+    if( !pBuffer ) 
+    {
+        m_pFactory->Release( lCapacity - m_lCapacity );
+        PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
+    }
+
+    m_pBuffer   = pBuffer;
+    m_lCapacity = lCapacity;
+    return true;
+}
+
+void PdfSpillStream::Spill()
+{
+    if( m_lLength )
+        this->WriteSpilled( m_pBuffer, m_lLength );
+
+    m_bSpilled = true;
+    this->FreeBuffer();
+}
+
+void PdfSpillStream::WriteSpilled( const char* pBuffer, pdf_long lLen )
+{
+    // Streams of the same factory may be appended to at the same time,
+    // so the data of a stream is not always contiguous in the file
+    const pdf_long lContinue = m_vecExtents.empty() ? -1 : m_vecExtents.back().lOffset + m_vecExtents.back().lLength;
+    const pdf_long lOffset   = m_pFactory->WriteScratch( pBuffer, lLen, lContinue );
+    if( lOffset == lContinue ) 
+        m_vecExtents.back().lLength += lLen;
+    else
+    {
+        TExtent extent;
+        extent.lOffset = lOffset;
+        extent.lLength = lLen;
+        m_vecExtents.push_back( extent );
+    }
+}
+
+void PdfSpillStream::FreeBuffer()
+{
+    podofo_free( m_pBuffer );
+    m_pBuffer = NULL;
+
+    m_pFactory->Release( m_lCapacity );
+    m_lCapacity = 0;
+}
+
+void PdfSpillStream::Reset()
+{
+    TCIVecExtents it = m_vecExtents.begin();
+    while( it != m_vecExtents.end() )
+    {
+        m_pFactory->FreeScratch( (*it).lOffset, (*it).lLength );
+        ++it;
+    }
+
+    m_vecExtents.clear();
+    m_bSpilled = false;
+
+    this->FreeBuffer();
+    m_lLength = 0;
+}
+
+void PdfSpillStream::GetCopy( char** pBuffer, pdf_long* lLen ) const
+{
+    if( !pBuffer || !lLen )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    *pBuffer = static_cast<char*>(podofo_calloc( m_lLength, sizeof(char) ));
+    *lLen    = m_lLength;
+    
+    if( !*pBuffer )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
+    }
+
+    if( !m_bSpilled )
+    {
+        memcpy( *pBuffer, m_pBuffer, m_lLength );
+        return;
+    }
+
+    try {
+        char*         pPos = *pBuffer;
+        TCIVecExtents it   = m_vecExtents.begin();
+        while( it != m_vecExtents.end() )
+        {
+            m_pFactory->ReadScratch( pPos, (*it).lOffset, (*it).lLength );
+            pPos += (*it).lLength;
+            ++it;
+        }
+    } catch( PdfError & e ) {
+        podofo_free( *pBuffer );
+        *pBuffer = NULL;
+        *lLen    = 0;
+
+        e.AddToCallstack( __FILE__, __LINE__ );
+        throw e;
+    }
+}
+
+void PdfSpillStream::GetCopy( PdfOutputStream* pStream ) const
+{
+    if( !pStream )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    if( !m_bSpilled )
+    {
+        pStream->Write( m_pBuffer, m_lLength );
+        return;
+    }
+
+    const pdf_long BUFFER_SIZE = 65536;
+    char           buffer[BUFFER_SIZE];
+    TCIVecExtents  it = m_vecExtents.begin();
+    while( it != m_vecExtents.end() )
+    {
+        for( pdf_long lPos = 0; lPos < (*it).lLength; lPos += BUFFER_SIZE )
+        {
+            const pdf_long lRead = PDF_MIN( (*it).lLength - lPos, BUFFER_SIZE );
+            m_pFactory->ReadScratch( buffer, (*it).lOffset + lPos, lRead );
+            pStream->Write( buffer, lRead );
+        }
+
+        ++it;
+    }
+}
+
+void PdfSpillStream::Write( PdfOutputDevice* pDevice, PdfEncrypt* pEncrypt ) 
+{
+    pDevice->Print( "stream\n" );
+    if( pEncrypt ) 
+    {
+        // Encrypt while copying, so spilled data is never loaded as a whole
+        PdfDeviceOutputStream               stream( pDevice );
+        PODOFO_UNIQUEU_PTR<PdfOutputStream> pEncryptStream( pEncrypt->CreateEncryptionOutputStream( &stream ) );
+
+        this->GetCopy( pEncryptStream.get() );
+        pEncryptStream->Close();
+    }
+    else if( m_bSpilled ) 
+    {
+        PdfDeviceOutputStream stream( pDevice );
+        this->GetCopy( &stream );
+    }
+    else
+    {
+        pDevice->Write( m_pBuffer, m_lLength );
+    }
+    pDevice->Print( "\nendstream\n" );
+}
+
+PdfInputStream* PdfSpillStream::CreateInputStream() const
+{
+    if( m_bSpilled )
+        return new PdfSpillInputStream( m_pFactory, m_vecExtents );
+    else
+        return new PdfMemoryInputStream( m_pBuffer, m_lLength );
+}
+
+pdf_long PdfSpillStream::GetLength() const
+{
+    return m_lLength;
+}
+
+PdfSpillStreamFactory::PdfSpillStreamFactory( pdf_long lThreshold, pdf_long lMemoryBudget )
+    : m_lThreshold( lThreshold ), m_lMemoryBudget( lMemoryBudget ), m_lResident( 0 ),
+      m_pMutex( new Util::PdfMutex() ), m_hScratch( NULL ), m_lScratchSize( 0 )
+{
+}
+
+PdfSpillStreamFactory::~PdfSpillStreamFactory()
+{
+    if( m_hScratch )
+        fclose( m_hScratch );
+
+    delete m_pMutex;
+}
+
+PdfStream* PdfSpillStreamFactory::CreateStream( PdfObject* pParent )
+{
+    return new PdfSpillStream( pParent, this );
+}
+
+bool PdfSpillStreamFactory::Reserve( pdf_long lLen )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    if( m_lResident + lLen > m_lMemoryBudget )
+        return false;
+
+    m_lResident += lLen;
+    return true;
+}
+
+void PdfSpillStreamFactory::Release( pdf_long lLen )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    m_lResident -= lLen;
+}
+
+pdf_long PdfSpillStreamFactory::WriteScratch( const char* pBuffer, pdf_long lLen, pdf_long lContinue )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    if( !m_hScratch ) 
+    {
+        m_hScratch = tmpfile();
+        if( !m_hScratch ) 
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidDeviceOperation, "Cannot create temporary stream file" );
+        }
+    }
+
+    // Continue the last extent of the stream if possible,
+    // otherwise reuse the first free range large enough
+    pdf_long lOffset = m_lScratchSize;
+    if( lContinue != m_lScratchSize )
+    {
+        for( TIMapFreeRanges it = m_mapFree.begin(); it != m_mapFree.end(); ++it )
+        {
+            if( (*it).second >= lLen )
+            {
+                lOffset = (*it).first;
+                if( (*it).second > lLen )
+                    m_mapFree[lOffset + lLen] = (*it).second - lLen;
+
+                m_mapFree.erase( it );
+                break;
+            }
+        }
+    }
+
+    if( fseeko( m_hScratch, lOffset, SEEK_SET ) != 0
+        || fwrite( pBuffer, sizeof(char), lLen, m_hScratch ) != static_cast<size_t>(lLen) )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidDeviceOperation, "Cannot write to temporary stream file" );
+    }
+
+    m_lScratchSize = PDF_MAX( m_lScratchSize, lOffset + lLen );
+    return lOffset;
+}
+
+void PdfSpillStreamFactory::ReadScratch( char* pBuffer, pdf_long lOffset, pdf_long lLen )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    if( !m_hScratch
+        || fseeko( m_hScratch, lOffset, SEEK_SET ) != 0 
+        || fread( pBuffer, sizeof(char), lLen, m_hScratch ) != static_cast<size_t>(lLen) )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_UnexpectedEOF, "Cannot read from temporary stream file" );
+    }
+}
+
+void PdfSpillStreamFactory::FlushScratch()
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    if( m_hScratch && fflush( m_hScratch ) != 0 )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidDeviceOperation, "Cannot write to temporary stream file" );
+    }
+}
+
+void PdfSpillStreamFactory::FreeScratch( pdf_long lOffset, pdf_long lLen )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    // Merge with the adjacent free ranges
+    TIMapFreeRanges itNext = m_mapFree.lower_bound( lOffset );
+    if( itNext != m_mapFree.end() && lOffset + lLen == (*itNext).first )
+    {
+        lLen += (*itNext).second;
+        m_mapFree.erase( itNext++ );
+    }
+
+    if( itNext != m_mapFree.begin() )
+    {
+        TIMapFreeRanges itPrev = itNext;
+        --itPrev;
+        if( (*itPrev).first + (*itPrev).second == lOffset )
+        {
+            lOffset  = (*itPrev).first;
+            lLen    += (*itPrev).second;
+            m_mapFree.erase( itPrev );
+        }
+    }
+
+    // A range at the end of the file is written again by appending
+    if( lOffset + lLen == m_lScratchSize )
+        m_lScratchSize = lOffset;
+    else
+        m_mapFree[lOffset] = lLen;
+}
+
+};
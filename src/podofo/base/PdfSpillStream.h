@@ -0,0 +1,408 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef _PDF_SPILL_STREAM_H_
+#define _PDF_SPILL_STREAM_H_
+
+#include "PdfDefines.h"
+
+#include "PdfStream.h"
+#include "PdfVecObjects.h"
+#include "util/PdfMutex.h"
+
+#include <cstdio>
+#include <map>
+#include <vector>
+
+namespace PoDoFo {
+
+class PdfInputStream;
+class PdfOutputStream;
+class PdfSpillStreamFactory;
+
+/** A PDF stream can be appended to any PdfObject
+ *  and can contain arbitrary data.
+ *
+ *  A PdfSpillStream keeps its data in memory as long as it is small
+ *  and the PdfSpillStreamFactory which created it has not yet exceeded
+ *  its memory budget. Otherwise the data is moved ("spilled") to the
+ *  temporary file shared by all streams of the factory. The space
+ *  in the file is reused once the stream is destroyed.
+ *
+ *  Streams are not spilled back into memory once they have been written
+ *  to a temporary file, unless they are replaced by new contents.
+ *
+ *  \see PdfSpillStreamFactory
+ *  \see PdfMemStream
+ *  \see PdfFileStream
+ */
+class PODOFO_API PdfSpillStream : public PdfStream {
+    friend class PdfSpillInputStream;
+    friend class PdfSpillOutputStream;
+
+ public:
+    /** Create a new PdfSpillStream object which has a parent PdfObject.
+     *  The stream will be deleted along with the parent.
+     *  This constructor will be called by PdfSpillStreamFactory for you.
+     *
+     *  \param pParent parent object
+     *  \param pFactory the factory whose memory budget is used by this stream
+     */
+    PdfSpillStream( PdfObject* pParent, PdfSpillStreamFactory* pFactory );
+
+    virtual ~PdfSpillStream();
+
+    /** Write the stream to an output device
+     *  \param pDevice write to this outputdevice.
+     *  \param pEncrypt encrypt stream data using this object
+     */
+    virtual void Write( PdfOutputDevice* pDevice, PdfEncrypt* pEncrypt = NULL );
+
+    /** Get a malloced buffer of the current stream.
+     *  No filters will be applied to the buffer, so
+     *  if the stream is Flate compressed the compressed copy
+     *  will be returned.
+     *
+     *  The caller has to podofo_free() the buffer.
+     *
+     *  \param pBuffer pointer to where the buffer's address will be stored
+     *  \param lLen    pointer to the buffer length (output parameter)
+     */
+    virtual void GetCopy( char** pBuffer, pdf_long* lLen ) const;
+
+    /** Get a copy of a the stream and write it to a PdfOutputStream
+     *
+     *  \param pStream data is written to this stream.
+     */
+    virtual void GetCopy( PdfOutputStream* pStream ) const;
+
+    /** Get the stream's length. The length is that of the stored
+     *  data, so (eg) for a Flate-compressed stream it will be
+     *  the length of the compressed data.
+     *
+     *  \returns the length of the stream data
+     */
+    virtual pdf_long GetLength() const;
+
+    /** Create a PdfInputStream which reads the current stream data,
+     *  either from memory or from the temporary file.
+     *
+     *  \returns a new PdfInputStream that has to be deleted by the caller
+     */
+    virtual PdfInputStream* CreateInputStream() const;
+
+    /**
+     * \returns true if the stream data has been moved to a temporary file
+     */
+    inline bool IsSpilled() const;
+
+ protected:
+    /** Required for the operator= implementation
+     *  \returns a handle to the internal buffer or NULL
+     *           if the stream data is stored in a temporary file
+     */
+    inline virtual const char* GetInternalBuffer() const;
+
+    /** Required for the operator= implementation
+     *  \returns the size of the internal buffer
+     */
+    inline virtual pdf_long GetInternalBufferSize() const;
+
+    /** Begin appending data to this stream.
+     *  Clears the current stream contents.
+     *
+     *  \param vecFilters use this filters to encode any data written to the stream.
+     */
+    virtual void BeginAppendImpl( const TVecFilters & vecFilters );
+
+    /** Append a binary buffer to the current stream contents.
+     *
+     *  \param pszString a buffer
+     *  \param lLen length of the buffer
+     *
+     *  \see BeginAppend
+     *  \see Append
+     *  \see EndAppend
+     */
+    virtual void AppendImpl( const char* pszString, size_t lLen ); 
+
+    /** Finish appending data to the stream
+     */
+    virtual void EndAppendImpl();
+
+ private:
+    /** Store encoded data either in memory or in the temporary file,
+     *  spilling the in memory data first if required.
+     *
+     *  \param pBuffer encoded data
+     *  \param lLen length of the data
+     */
+    void StoreData( const char* pBuffer, pdf_long lLen );
+
+    /** Grow the in memory buffer so that it can hold lSize bytes.
+     *  The whole allocated capacity is charged to the factory's budget.
+     *
+     *  \param lSize required number of bytes
+     *  \returns false if the memory does not fit into the budget
+     */
+    bool Grow( pdf_long lSize );
+
+    /** Move all data stored in memory to the temporary file
+     *  and return the memory to the factory's budget.
+     */
+    void Spill();
+
+    /** Append data to the spilled data in the temporary file.
+     *
+     *  \param pBuffer encoded data
+     *  \param lLen length of the data
+     */
+    void WriteSpilled( const char* pBuffer, pdf_long lLen );
+
+    /** Free the in memory buffer and return its
+     *  capacity to the factory's budget.
+     */
+    void FreeBuffer();
+
+    /** Remove all stored data and return the memory and 
+     *  the space in the temporary file to the factory.
+     */
+    void Reset();
+
+ private:
+    /** A range of the temporary file holding spilled data
+     */
+    struct TExtent {
+        pdf_long lOffset;
+        pdf_long lLength;
+    };
+
+    typedef std::vector<TExtent>        TVecExtents;
+    typedef TVecExtents::const_iterator TCIVecExtents;
+
+    PdfSpillStreamFactory* m_pFactory;
+
+    char*                  m_pBuffer;
+    pdf_long               m_lCapacity;
+    bool                   m_bSpilled;
+    TVecExtents            m_vecExtents; ///< the spilled data in the order of the stream
+    pdf_long               m_lLength;
+
+    PdfOutputStream*       m_pStream;
+    PdfOutputStream*       m_pSpillStream;
+};
+
+/** A StreamFactory which creates PdfSpillStream objects.
+ *
+ *  All streams created by one factory share a common memory budget
+ *  and a single temporary file, so that thousands of spilled streams
+ *  need only one file handle. A stream is moved to the temporary file 
+ *  as soon as it grows larger than the threshold, or if keeping it in
+ *  memory would exceed the budget. Use this for documents with many 
+ *  large streams (e.g. images) which do not fit into memory.
+ *
+ *  Streams of one factory can be used from several threads at once,
+ *  e.g. while loading a document from several threads.
+ *
+ *  \code
+ *  PdfMemDocument          document;
+ *  PdfSpillStreamFactory   factory( 64 * 1024, 32 * 1024 * 1024 );
+ *  document.GetObjects().SetStreamFactory( &factory );
+ *  \endcode
+ *
+ *  The factory has to outlive all streams created by it.
+ *  Note that loading a document resets the stream factory of the
+ *  PdfVecObjects, so set it after PdfMemDocument::Load().
+ *
+ *  \see PdfVecObjects::SetStreamFactory
+ */
+class PODOFO_API PdfSpillStreamFactory : public PdfVecObjects::StreamFactory {
+    friend class PdfSpillInputStream;
+    friend class PdfSpillStream;
+
+ public:
+    /** Create a new PdfSpillStreamFactory
+     *
+     *  \param lThreshold streams larger than this number of bytes are
+     *                    always stored in a temporary file
+     *  \param lMemoryBudget maximum number of bytes of stream data that
+     *                    is kept in memory by all streams of this factory
+     */
+    PdfSpillStreamFactory( pdf_long lThreshold = 64 * 1024, pdf_long lMemoryBudget = 16 * 1024 * 1024 );
+
+    /** Closes the temporary file
+     */
+    virtual ~PdfSpillStreamFactory();
+
+    /** Creates a new PdfSpillStream
+     *
+     *  \param pParent parent object
+     *
+     *  \returns a new stream object
+     */
+    virtual PdfStream* CreateStream( PdfObject* pParent );
+
+    /**
+     * \returns the number of bytes of stream data currently kept in memory
+     */
+    inline pdf_long GetResidentSize() const;
+
+    /**
+     * \returns the size above which streams are stored in a temporary file
+     */
+    inline pdf_long GetThreshold() const;
+
+    /**
+     * \returns the maximum number of bytes kept in memory
+     */
+    inline pdf_long GetMemoryBudget() const;
+
+ private:
+    /** Try to reserve memory for stream data
+     *
+     *  \param lLen number of bytes required
+     *  \returns true if the memory fits into the budget
+     */
+    bool Reserve( pdf_long lLen );
+
+    /** Give memory back to the budget
+     *
+     *  \param lLen number of bytes to release
+     */
+    void Release( pdf_long lLen );
+
+    /** Write data to the temporary file, which is created on first use.
+     *
+     *  \param pBuffer the data
+     *  \param lLen length of the data
+     *  \param lContinue the end of the last extent of the stream, the data
+     *                   is written there if it is the end of the file
+     *  \returns the offset at which the data was written
+     */
+    pdf_long WriteScratch( const char* pBuffer, pdf_long lLen, pdf_long lContinue );
+
+    /** Read data from the temporary file
+     *
+     *  \param pBuffer read into this buffer
+     *  \param lOffset offset of the data in the file
+     *  \param lLen number of bytes to read
+     */
+    void ReadScratch( char* pBuffer, pdf_long lOffset, pdf_long lLen );
+
+    /** Flush all data written to the temporary file, 
+     *  so that write errors are reported.
+     */
+    void FlushScratch();
+
+    /** Mark a range of the temporary file as unused,
+     *  so that it can be written again.
+     *
+     *  \param lOffset offset of the range
+     *  \param lLen length of the range
+     */
+    void FreeScratch( pdf_long lOffset, pdf_long lLen );
+
+ private:
+    /** copy constructor, not implemented
+     */
+    PdfSpillStreamFactory( const PdfSpillStreamFactory & rhs );
+
+    /** assignment operator, not implemented
+     */
+    PdfSpillStreamFactory & operator=( const PdfSpillStreamFactory & rhs );
+
+ private:
+    typedef std::map<pdf_long,pdf_long> TMapFreeRanges;
+    typedef TMapFreeRanges::iterator    TIMapFreeRanges;
+
+    pdf_long         m_lThreshold;
+    pdf_long         m_lMemoryBudget;
+    pdf_long         m_lResident;
+
+    Util::PdfMutex*  m_pMutex;         ///< Synchronizes the budget and all accesses to the temporary file
+    FILE*            m_hScratch;
+    pdf_long         m_lScratchSize;   ///< the end of the used part of the temporary file
+    TMapFreeRanges   m_mapFree;        ///< unused ranges of the temporary file by offset
+};
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+bool PdfSpillStream::IsSpilled() const
+{
+    return m_bSpilled;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+const char* PdfSpillStream::GetInternalBuffer() const
+{
+    return m_bSpilled ? NULL : m_pBuffer;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_long PdfSpillStream::GetInternalBufferSize() const
+{
+    return m_bSpilled ? 0 : m_lLength;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_long PdfSpillStreamFactory::GetResidentSize() const
+{
+    return m_lResident;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_long PdfSpillStreamFactory::GetThreshold() const
+{
+    return m_lThreshold;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_long PdfSpillStreamFactory::GetMemoryBudget() const
+{
+    return m_lMemoryBudget;
+}
+
+};
+
+#endif // _PDF_SPILL_STREAM_H_
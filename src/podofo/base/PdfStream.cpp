@@ -68,7 +68,7 @@ void PdfStream::GetFilteredCopy( PdfOutputStream* pStream ) const
                                                                                m_pParent ? 
                                                                                &(m_pParent->GetDictionary()) : NULL  );
         try {
-            pDecodeStream->Write( const_cast<char*>(this->GetInternalBuffer()), this->GetInternalBufferSize() );
+            this->GetCopy( pDecodeStream );
             pDecodeStream->Close();
         }
         catch( PdfError & e ) 
@@ -81,7 +81,7 @@ void PdfStream::GetFilteredCopy( PdfOutputStream* pStream ) const
     else
     {
         // Also work on unencoded streams
-        pStream->Write( const_cast<char*>(this->GetInternalBuffer()), this->GetInternalBufferSize() );
+        this->GetCopy( pStream );
     }
 }
 
@@ -97,13 +97,13 @@ void PdfStream::GetFilteredCopy( char** ppBuffer, pdf_long* lLen ) const
                                                                                                  m_pParent ? 
                                                                                                  &(m_pParent->GetDictionary()) : NULL  ) );
 
-        pDecodeStream->Write( this->GetInternalBuffer(), this->GetInternalBufferSize() );
+        this->GetCopy( pDecodeStream.get() );
         pDecodeStream->Close();
     }
     else
     {
         // Also work on unencoded streams
-        stream.Write( const_cast<char*>(this->GetInternalBuffer()), this->GetInternalBufferSize() );
+        this->GetCopy( &stream );
         stream.Close();
     }
 
@@ -111,14 +111,39 @@ void PdfStream::GetFilteredCopy( char** ppBuffer, pdf_long* lLen ) const
     *ppBuffer = stream.TakeBuffer();
 }
 
+PdfInputStream* PdfStream::CreateInputStream() const
+{
+    return new PdfMemoryInputStream( this->GetInternalBuffer(), this->GetInternalBufferSize() );
+}
+
+PdfInputStream* PdfStream::CreateFilteredInputStream() const
+{
+    TVecFilters     vecFilters = PdfFilterFactory::CreateFilterList( m_pParent );
+    PdfInputStream* pStream    = this->CreateInputStream();
+    if( !vecFilters.size() )
+        return pStream;
+
+    try {
+        return PdfFilterFactory::CreateDecodeInputStream( vecFilters, pStream, 
+                                                          m_pParent ? &(m_pParent->GetDictionary()) : NULL, true );
+    }
+    catch( PdfError & e ) 
+    {
+        delete pStream;
+        throw e;
+    }
+}
+
 const PdfStream & PdfStream::operator=( const PdfStream & rhs )
 {
-    PdfMemoryInputStream stream( rhs.GetInternalBuffer(), rhs.GetInternalBufferSize() );
-    this->SetRawData( &stream );
+    // Read through an input stream, so that streams which
+    // are not held in memory are copied without loading them at once
+    PODOFO_UNIQUEU_PTR<PdfInputStream> pStream( rhs.CreateInputStream() );
+    this->SetRawData( pStream.get() );
 
     if( m_pParent ) 
         m_pParent->GetDictionary().AddKey( PdfName::KeyLength, 
-                                           PdfVariant(static_cast<pdf_int64>(rhs.GetInternalBufferSize())));
+                                           PdfVariant(static_cast<pdf_int64>(rhs.GetLength())));
 
     return (*this);
 }
@@ -192,11 +217,34 @@ void PdfStream::SetRawData( PdfInputStream* pStream, pdf_long lLen )
     this->EndAppend();
 }
 
-void PdfStream::BeginAppend( bool bClearExisting )
+void PdfStream::BeginAppend( bool bClearExisting, bool bPreserveFilters )
 {
     TVecFilters vecFilters;
+    bool        bPreserved = false;
 
-    if( eDefaultFilter != ePdfFilter_None )
+    if( bPreserveFilters && m_pParent && m_pParent->IsDictionary()
+        && !m_pParent->GetDictionary().HasKey( "DecodeParms" ) )
+    {
+        vecFilters = PdfFilterFactory::CreateFilterList( m_pParent );
+        bPreserved = true;
+
+        TCIVecFilters it = vecFilters.begin();
+        while( it != vecFilters.end() )
+        {
+            PODOFO_UNIQUEU_PTR<PdfFilter> pFilter( PdfFilterFactory::Create( *it ) );
+            if( !pFilter.get() || !pFilter->CanEncode() )
+            {
+                // Cannot re-encode with the original filters
+                vecFilters.clear();
+                bPreserved = false;
+                break;
+            }
+
+            ++it;
+        }
+    }
+
+    if( !bPreserved && eDefaultFilter != ePdfFilter_None )
         vecFilters.push_back( eDefaultFilter );
 
     this->BeginAppend( vecFilters, bClearExisting );
@@ -145,16 +145,22 @@ class PODOFO_API PdfStream {
     /** Start appending data to this stream.
      *
      *  This method has to be called before any of the append methods.
-     *  All appended data will be Flate-encoded.
+     *  All appended data will be Flate-encoded, unless bPreserveFilters
+     *  is set.
      *
      *  \param bClearExisting if true any existing stream contents will
      *         be cleared.
+     *  \param bPreserveFilters if true and the stream is already encoded
+     *         with filters which can all be used for encoding (and no
+     *         /DecodeParms are set), the appended data is encoded using
+     *         these filters instead of eDefaultFilter. This keeps e.g.
+     *         LZWDecode or RunLengthDecode streams in their original encoding.
      *
      *  \see Append
      *  \see EndAppend
      *  \see eDefaultFilter
      */
-    void BeginAppend( bool bClearExisting = true );
+    void BeginAppend( bool bClearExisting = true, bool bPreserveFilters = false );
 
     /** Start appending data to this stream.
      *  This method has to be called before any of the append methods.
@@ -269,6 +275,34 @@ class PODOFO_API PdfStream {
      */
     void GetFilteredCopy( PdfOutputStream* pStream ) const;
     
+    /** Create a PdfInputStream which reads the current stream data.
+     *  No filters will be applied to the data, so if the stream
+     *  is Flate-compressed the compressed data will be read.
+     *
+     *  The stream must not be modified while the returned
+     *  PdfInputStream is in use.
+     *
+     *  \returns a new PdfInputStream that has to be deleted by the caller
+     */
+    virtual PdfInputStream* CreateInputStream() const;
+
+    /** Create a PdfInputStream which reads the current stream data
+     *  filtered by all filters as specified in the dictionary's
+     *  /Filter key.
+     *
+     *  Unlike GetFilteredCopy() the data is decoded in small windows
+     *  while it is read, so the decoded stream is never held in
+     *  memory as a whole.
+     *
+     *  The stream must not be modified while the returned
+     *  PdfInputStream is in use.
+     *
+     *  \returns a new PdfInputStream that has to be deleted by the caller
+     *
+     *  \see PdfFilterFactory::CreateDecodeInputStream
+     */
+    PdfInputStream* CreateFilteredInputStream() const;
+
     /** Create a copy of a PdfStream object
      *  \param rhs the object to clone
      *  \returns a reference to this object
@@ -276,12 +310,13 @@ class PODOFO_API PdfStream {
     const PdfStream & operator=( const PdfStream & rhs );
 
  protected:
-    /** Required for the GetFilteredCopy() implementation
-     *  \returns a handle to the internal buffer
+    /** Required for the operator=() implementation
+     *  \returns a handle to the internal buffer or NULL if
+     *           the stream data is not held in memory
      */
     virtual const char* GetInternalBuffer() const = 0;
 
-    /** Required for the GetFilteredCopy() implementation
+    /** Required for the operator=() implementation
      *  \returns the size of the internal buffer
      */
     virtual pdf_long GetInternalBufferSize() const = 0;
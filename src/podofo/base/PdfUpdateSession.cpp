@@ -0,0 +1,155 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#include "PdfUpdateSession.h"
+
+#include "PdfDictionary.h"
+#include "PdfObject.h"
+#include "PdfOutputDevice.h"
+#include "PdfWriter.h"
+#include "PdfDefinesPrivate.h"
+
+namespace PoDoFo {
+
+PdfUpdateSession::PdfUpdateSession( const char* pszFilename )
+    : m_parser( &m_vecObjects ), m_pTrailer( NULL ), m_eWriteMode( ePdfWriteMode_Default ), m_bWritten( false )
+{
+    if( !pszFilename || !pszFilename[0] )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    PdfRefCountedInputDevice device( pszFilename, "rb" );
+    if( !device.Device() )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_FileNotFound, pszFilename );
+    }
+
+    this->Init( device );
+}
+
+PdfUpdateSession::PdfUpdateSession( const PdfRefCountedInputDevice & rDevice )
+    : m_parser( &m_vecObjects ), m_pTrailer( NULL ), m_eWriteMode( ePdfWriteMode_Default ), m_bWritten( false )
+{
+    this->Init( rDevice );
+}
+
+PdfUpdateSession::~PdfUpdateSession()
+{
+    m_vecObjects.SetObjectLoader( NULL );
+
+    delete m_pTrailer;
+}
+
+void PdfUpdateSession::Init( const PdfRefCountedInputDevice & rDevice )
+{
+    m_vecObjects.SetAutoDelete( true );
+
+    m_parser.ParseStructure( rDevice );
+
+    const PdfObject* pTrailer = m_parser.GetTrailer();
+    if( pTrailer->GetDictionary().HasKey( "Encrypt" ) )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_CannotEncryptedForUpdate );
+    }
+
+    m_pTrailer = new PdfObject( *pTrailer );
+    // Set owner so that GetIndirectKey will work
+    m_pTrailer->SetOwner( &m_vecObjects );
+
+    // New objects get numbers after all objects of the file
+    m_vecObjects.SetCanReuseObjectNumbers( false );
+    pdf_int64 lSize = pTrailer->GetDictionary().GetKeyAsLong( PdfName::KeySize, 0 );
+    if( lSize > 1 ) 
+        m_vecObjects.SetObjectCount( PdfReference( static_cast<pdf_objnum>(lSize - 1), 0 ) );
+
+    m_vecObjects.SetObjectLoader( this );
+}
+
+PdfObject* PdfUpdateSession::GetObject( const PdfReference & rRef )
+{
+    return m_vecObjects.GetObject( rRef );
+}
+
+PdfObject* PdfUpdateSession::CreateObject( const char* pszType )
+{
+    return m_vecObjects.CreateObject( pszType );
+}
+
+PdfObject* PdfUpdateSession::GetCatalog()
+{
+    return m_pTrailer->GetIndirectKey( "Root" );
+}
+
+void PdfUpdateSession::Write( const char* pszFilename )
+{
+    if( !pszFilename )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    PdfOutputDevice device( pszFilename, false );
+
+    this->Write( &device );
+}
+
+void PdfUpdateSession::Write( PdfOutputDevice* pDevice )
+{
+    if( !pDevice )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    if( m_bWritten )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "An update session can be written only once." );
+    }
+
+    PdfWriter writer( &m_vecObjects, m_pTrailer );
+    writer.SetPdfVersion( m_parser.GetPdfVersion() );
+    writer.SetWriteMode( m_eWriteMode );
+    // Continue a chain of XRef streams with an XRef stream
+    writer.SetUseXRefStream( m_parser.HasXRefStream() );
+    writer.SetPrevXRefOffset( m_parser.GetXRefOffset() );
+
+    writer.WriteUpdate( pDevice, NULL, false );
+
+    m_bWritten = true;
+}
+
+PdfObject* PdfUpdateSession::LoadObject( const PdfReference & rRef )
+{
+    return m_parser.LoadObject( rRef );
+}
+
+};
@@ -0,0 +1,184 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef _PDF_UPDATE_SESSION_H_
+#define _PDF_UPDATE_SESSION_H_
+
+#include "PdfDefines.h"
+
+#include "PdfParser.h"
+#include "PdfRefCountedInputDevice.h"
+#include "PdfVecObjects.h"
+
+namespace PoDoFo {
+
+class PdfObject;
+class PdfOutputDevice;
+class PdfReference;
+
+/** An incremental update of an existing PDF file, which does not
+ *  load the document.
+ *
+ *  Opening a file reads only its cross-reference sections and the
+ *  trailer. Objects are read from the file when they are accessed first,
+ *  either by GetObject or by resolving a reference of an object which
+ *  was read already. Write appends only the objects which were modified
+ *  or created, a new cross-reference section and a new trailer to the file.
+ *
+ *  This is much cheaper than PdfMemDocument::WriteUpdate for large files,
+ *  if only a few objects are changed, e.g. to fill a form field or to 
+ *  add a signature. Encrypted files are not supported.
+ *
+ *  \see PdfMemDocument::WriteUpdate
+ */
+class PODOFO_API PdfUpdateSession : private PdfVecObjects::ObjectLoader {
+ public:
+    /** Open a PDF file for an incremental update.
+     *
+     *  \param pszFilename filename of the file to update
+     */
+    PdfUpdateSession( const char* pszFilename );
+
+    /** Open a PDF file for an incremental update.
+     *
+     *  \param rDevice the input device to read from
+     */
+    PdfUpdateSession( const PdfRefCountedInputDevice & rDevice );
+
+    virtual ~PdfUpdateSession();
+
+    /** Get an object of the file. The object is read from the
+     *  file if it was not accessed before.
+     *
+     *  Modifying the object adds it to the update.
+     *
+     *  \param rRef reference of the object
+     *  \returns the object or NULL if there is no such object in the file
+     */
+    PdfObject* GetObject( const PdfReference & rRef );
+
+    /** Create a new object, which is added to the update.
+     *
+     *  \param pszType optional value of the /Type key of the object
+     *  \returns the new object
+     */
+    PdfObject* CreateObject( const char* pszType = NULL );
+
+    /** \returns the trailer of the file. The keys /Root
+     *           and /Info of the trailer are part of the update.
+     */
+    inline PdfObject* GetTrailer();
+
+    /** \returns the catalog dictionary of the file
+     */
+    PdfObject* GetCatalog();
+
+    /** \returns the objects read from the file or created so far
+     */
+    inline const PdfVecObjects & GetObjects() const;
+
+    /** Set the write mode used for writing the update
+     *  \param eWriteMode write mode
+     */
+    inline void SetWriteMode( EPdfWriteMode eWriteMode );
+
+    /** \returns the write mode used for writing the update
+     */
+    inline EPdfWriteMode GetWriteMode() const;
+
+    /** Append the update to a file.
+     *
+     *  \param pszFilename the file, which must be the file which was 
+     *                     opened or a copy of it
+     */
+    void Write( const char* pszFilename );
+
+    /** Write the update to a device.
+     *
+     *  \param pDevice the device, which must be positioned at the end
+     *                 of the file which was opened or of a copy of it
+     *
+     *  A session can be written only once, as further updates
+     *  must refer to the cross-reference section written here.
+     */
+    void Write( PdfOutputDevice* pDevice );
+
+ private:
+    void Init( const PdfRefCountedInputDevice & rDevice );
+
+    PdfObject* LoadObject( const PdfReference & rRef );
+
+ private:
+    PdfVecObjects m_vecObjects;
+    PdfParser     m_parser;
+
+    PdfObject*    m_pTrailer;
+    EPdfWriteMode m_eWriteMode;
+    bool          m_bWritten;
+};
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+PdfObject* PdfUpdateSession::GetTrailer()
+{
+    return m_pTrailer;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+const PdfVecObjects & PdfUpdateSession::GetObjects() const
+{
+    return m_vecObjects;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+void PdfUpdateSession::SetWriteMode( EPdfWriteMode eWriteMode )
+{
+    m_eWriteMode = eWriteMode;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+EPdfWriteMode PdfUpdateSession::GetWriteMode() const
+{
+    return m_eWriteMode;
+}
+
+};
+
+#endif // _PDF_UPDATE_SESSION_H_
@@ -37,11 +37,15 @@
 #include "PdfDictionary.h"
 #include "PdfMemStream.h"
 #include "PdfObject.h"
+#include "PdfOutputDevice.h"
+#include "PdfRefCountedBuffer.h"
 #include "PdfReference.h"
 #include "PdfStream.h"
 #include "PdfDefinesPrivate.h"
 
 #include <algorithm>
+#include <cstring>
+#include <map>
 
 namespace {
 
@@ -100,12 +104,243 @@ private:
     const PdfReference m_ref;
 };
 
+namespace {
+
+/** A 128 bit hash of the contents of an object
+ */
+struct TObjectHash {
+    pdf_uint64 h1;
+    pdf_uint64 h2;
+
+    bool operator<( const TObjectHash & rhs ) const
+    {
+        return h1 < rhs.h1 || (h1 == rhs.h1 && h2 < rhs.h2);
+    }
+};
+
+/** A reference to a duplicate candidate and the object containing it
+ */
+struct TMergeReference {
+    size_t        nOwner;     ///< index of the object containing the reference or the number of objects for the trailer
+    PdfReference* pReference;
+    bool          bChanged;   ///< the original value has been recorded already
+};
+
+struct ObjectReferencePredicate {
+    inline bool operator()( const PdfObject* pObj, const PdfReference & ref ) const { 
+        return pObj->Reference() < ref;
+    }
+};
+
+/** \returns the index of the object with the reference rRef 
+ *           in the sorted vector vecObjects or its size
+ */
+size_t FindObject( const TVecObjects & vecObjects, const PdfReference & rRef )
+{
+    TCIVecObjects it = std::lower_bound( vecObjects.begin(), vecObjects.end(), rRef, ObjectReferencePredicate() );
+    if( it != vecObjects.end() && (*it)->Reference() == rRef )
+        return it - vecObjects.begin();
+
+    return vecObjects.size();
+}
+
+inline pdf_uint64 MakeUInt64( pdf_uint32 nHigh, pdf_uint32 nLow )
+{
+    return (static_cast<pdf_uint64>(nHigh) << 32) | nLow;
+}
+
+inline pdf_uint64 RotateLeft( pdf_uint64 x, int r )
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline pdf_uint64 FinalMix( pdf_uint64 k )
+{
+    k ^= k >> 33;
+    k *= MakeUInt64( 0xff51afd7, 0xed558ccd );
+    k ^= k >> 33;
+    k *= MakeUInt64( 0xc4ceb9fe, 0x1a85ec53 );
+    k ^= k >> 33;
+
+    return k;
+}
+
+/** Calculate the 128 bit MurmurHash3 (x64 variant) of a buffer.
+ *  The result depends on the byte order, so it must not be stored.
+ */
+TObjectHash Hash128( const char* pBuffer, size_t lLen, pdf_uint32 nSeed )
+{
+    const pdf_uint64     c1    = MakeUInt64( 0x87c37b91, 0x114253d5 );
+    const pdf_uint64     c2    = MakeUInt64( 0x4cf5ad43, 0x2745937f );
+    const unsigned char* pData = reinterpret_cast<const unsigned char*>(pBuffer);
+    const size_t         nBlocks = lLen / 16;
+
+    pdf_uint64 h1 = nSeed;
+    pdf_uint64 h2 = nSeed;
+    pdf_uint64 k1;
+    pdf_uint64 k2;
+
+    for( size_t i = 0; i < nBlocks; i++ )
+    {
+        memcpy( &k1, pData + i * 16, sizeof(k1) );
+        memcpy( &k2, pData + i * 16 + 8, sizeof(k2) );
+
+        k1 *= c1; k1 = RotateLeft( k1, 31 ); k1 *= c2; h1 ^= k1;
+        h1 = RotateLeft( h1, 27 ); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = RotateLeft( k2, 33 ); k2 *= c1; h2 ^= k2;
+        h2 = RotateLeft( h2, 31 ); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const unsigned char* pTail = pData + nBlocks * 16;
+    k1 = 0;
+    k2 = 0;
+    const size_t lTail = lLen & 15;
+    for( size_t i = lTail; i > 8; i-- )
+        k2 ^= static_cast<pdf_uint64>(pTail[i - 1]) << ((i - 9) * 8);
+
+    if( lTail > 8 )
+    {
+        k2 *= c2; k2 = RotateLeft( k2, 33 ); k2 *= c1; h2 ^= k2;
+    }
+
+    for( size_t i = PODOFO_MIN( lTail, static_cast<size_t>(8) ); i > 0; i-- )
+        k1 ^= static_cast<pdf_uint64>(pTail[i - 1]) << ((i - 1) * 8);
+
+    if( lTail > 0 )
+    {
+        k1 *= c1; k1 = RotateLeft( k1, 31 ); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= static_cast<pdf_uint64>(lLen);
+    h2 ^= static_cast<pdf_uint64>(lLen);
+    h1 += h2;
+    h2 += h1;
+    h1 = FinalMix( h1 );
+    h2 = FinalMix( h2 );
+    h1 += h2;
+    h2 += h1;
+
+    TObjectHash hash;
+    hash.h1 = h1;
+    hash.h2 = h2;
+    return hash;
+}
+
+inline bool KeyLittle( const TCIKeyMap & it1, const TCIKeyMap & it2 )
+{
+    return (*it1).first < (*it2).first;
+}
+
+/** Write a variant so that equal variants are written to the same bytes,
+ *  i.e. dictionary keys are sorted and every token is followed by a space.
+ */
+void WriteCanonical( const PdfVariant & rVariant, PdfOutputDevice* pDevice )
+{
+    if( rVariant.IsDictionary() )
+    {
+        const TKeyMap &        rKeys = rVariant.GetDictionary().GetKeys();
+        std::vector<TCIKeyMap> vecKeys;
+
+        vecKeys.reserve( rKeys.size() );
+        for( TCIKeyMap it = rKeys.begin(); it != rKeys.end(); ++it )
+            vecKeys.push_back( it );
+
+        std::sort( vecKeys.begin(), vecKeys.end(), KeyLittle );
+
+        pDevice->Write( "<< ", 3 );
+        for( std::vector<TCIKeyMap>::const_iterator it = vecKeys.begin(); it != vecKeys.end(); ++it )
+        {
+            (**it).first.Write( pDevice, ePdfWriteMode_Compact );
+            pDevice->Write( " ", 1 );
+            WriteCanonical( *(**it).second, pDevice );
+        }
+        pDevice->Write( ">> ", 3 );
+    }
+    else if( rVariant.IsArray() )
+    {
+        const PdfArray & rArray = rVariant.GetArray();
+
+        pDevice->Write( "[ ", 2 );
+        for( PdfArray::const_iterator it = rArray.begin(); it != rArray.end(); ++it )
+            WriteCanonical( *it, pDevice );
+        pDevice->Write( "] ", 2 );
+    }
+    else
+    {
+        rVariant.Write( pDevice, ePdfWriteMode_Compact, NULL );
+        pDevice->Write( " ", 1 );
+    }
+}
+
+/** Write an object to a buffer using WriteCanonical
+ *  \returns the number of bytes written
+ */
+size_t WriteCanonical( const PdfObject* pObj, PdfRefCountedBuffer* pBuffer )
+{
+    PdfOutputDevice device( pBuffer );
+
+    WriteCanonical( *pObj, &device );
+    return device.GetLength();
+}
+
+/** Subtypes of annotation dictionaries, whose /Type key is optional
+ */
+const char* s_pszAnnotationSubtypes[] = {
+    "Text", "Link", "FreeText", "Line", "Square", "Circle", "Polygon", "PolyLine",
+    "Highlight", "Underline", "Squiggly", "StrikeOut", "Stamp", "Caret", "Ink",
+    "Popup", "FileAttachment", "Sound", "Movie", "Widget", "Screen", "PrinterMark",
+    "TrapNet", "Watermark", "3D", "Redact", "RichMedia", "Projection",
+    NULL
+};
+
+/** \returns false for objects which have to stay unique, 
+ *           even if another object has the same contents
+ */
+bool IsMergeable( const PdfObject* pObj )
+{
+    if( pObj->IsDictionary() )
+    {
+        const PdfDictionary & rDict = pObj->GetDictionary();
+        // Form fields have no /Type key
+        if( rDict.HasKey( "Parent" ) || rDict.HasKey( "FT" ) || rDict.HasKey( "T" ) )
+            return false;
+
+        const PdfObject* pType = rDict.GetKey( PdfName::KeyType );
+        if( pType && pType->IsName() )
+        {
+            const PdfName & rType = pType->GetName();
+            if( rType == PdfName( "Page" ) || rType == PdfName( "Pages" ) ||
+                rType == PdfName( "Catalog" ) || rType == PdfName( "Annot" ) ||
+                rType == PdfName( "StructElem" ) ||
+                rType == PdfName( "XRef" ) || rType == PdfName( "ObjStm" ) )
+                return false;
+        }
+
+        const PdfObject* pSubtype = rDict.GetKey( PdfName::KeySubtype );
+        if( pSubtype && pSubtype->IsName() )
+        {
+            for( int i = 0; s_pszAnnotationSubtypes[i]; i++ ) 
+            {
+                if( pSubtype->GetName() == PdfName( s_pszAnnotationSubtypes[i] ) )
+                    return false;
+            }
+        }
+    }
+
+    // Only streams held in memory can be compared
+    return !pObj->HasStream() || dynamic_cast<const PdfMemStream*>(pObj->GetStream()) != NULL;
+}
+
+};
+
 // This is static, IMHO (mabri) different values per-instance could cause confusion.
 // It has to be defined here because of the one-definition rule.
 size_t PdfVecObjects::m_nMaxReserveSize = static_cast<size_t>(8388607); // cf. Table C.1 in section C.2 of PDF32000_2008.pdf
 
 PdfVecObjects::PdfVecObjects()
-    : m_bAutoDelete( false ), m_bCanReuseObjectNumbers( true ), m_nObjectCount( 1 ), m_bSorted( true ), m_pDocument( NULL ), m_pStreamFactory( NULL )
+    : m_bAutoDelete( false ), m_bCanReuseObjectNumbers( true ), m_nObjectCount( 1 ), m_bSorted( true ), m_pDocument( NULL ), m_pStreamFactory( NULL ),
+      m_pObjectLoader( NULL )
 {
 }
 
@@ -159,6 +394,9 @@ PdfObject* PdfVecObjects::GetObject( const PdfReference & ref ) const
         return *it;
     }
 
+    if( m_pObjectLoader )
+        return m_pObjectLoader->LoadObject( ref );
+
     return NULL;
 }
 
@@ -245,6 +483,8 @@ PdfObject* PdfVecObjects::CreateObject( const char* pszType )
     PdfReference ref = this->GetNextFreeObject();
     PdfObject*  pObj = new PdfObject( ref, pszType );
     pObj->SetOwner( this );
+    // New objects are always written by incremental updates
+    pObj->SetDirty( true );
 
     this->push_back( pObj );
 
@@ -255,7 +495,9 @@ PdfObject* PdfVecObjects::CreateObject( const PdfVariant & rVariant )
 {
     PdfReference ref = this->GetNextFreeObject();
     PdfObject*  pObj = new PdfObject( ref, rVariant );
-    pObj->SetOwner( this );    
+    pObj->SetOwner( this );
+    // New objects are always written by incremental updates
+    pObj->SetDirty( true );
 
     this->push_back( pObj );
 
@@ -348,6 +590,94 @@ void PdfVecObjects::RenumberObjects( PdfObject* pTrailer, TPdfReferenceSet* pNot
     
 }
 
+void PdfVecObjects::RenumberObjects( PdfObject* pTrailer, const TVecObjects & vecOrder, TVecOriginalReferences* pOriginal )
+{
+    TReferencePointerList  lstReferences;
+    TIReferencePointerList itReferences;
+    TCIVecObjects          it;
+    pdf_objnum             i;
+
+    if( !pTrailer || !pOriginal || vecOrder.size() != m_vector.size() )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    if( !m_bSorted )
+        this->Sort();
+
+    // Collect all references before changing anything,
+    // as loading an object on demand might require a lookup
+    for( it = m_vector.begin(); it != m_vector.end(); ++it )
+        CollectReferences( *it, &lstReferences );
+
+    CollectReferences( pTrailer, &lstReferences );
+
+    std::map<PdfReference,pdf_objnum> mapNumbers;
+    for( i = 0; i < static_cast<pdf_objnum>(vecOrder.size()); i++ )
+        mapNumbers[vecOrder[i]->Reference()] = i + 1;
+
+    // Dangling references must stay dangling
+    const PdfReference unused( static_cast<pdf_objnum>(vecOrder.size()) + 1, 0 );
+
+    pOriginal->reserve( pOriginal->size() + lstReferences.size() + vecOrder.size() );
+    for( itReferences = lstReferences.begin(); itReferences != lstReferences.end(); ++itReferences )
+    {
+        std::map<PdfReference,pdf_objnum>::const_iterator itNumber = mapNumbers.find( **itReferences );
+
+        pOriginal->push_back( TOriginalReference( *itReferences, **itReferences ) );
+        **itReferences = itNumber != mapNumbers.end() ? PdfReference( (*itNumber).second, 0 ) : unused;
+    }
+
+    for( i = 0; i < static_cast<pdf_objnum>(vecOrder.size()); i++ )
+    {
+        pOriginal->push_back( TOriginalReference( &(vecOrder[i]->m_reference), vecOrder[i]->m_reference ) );
+        vecOrder[i]->m_reference = PdfReference( i + 1, 0 );
+    }
+
+    m_vector  = vecOrder;
+    m_bSorted = true;
+}
+
+void PdfVecObjects::RestoreObjectNumbers( const TVecOriginalReferences & vecOriginal )
+{
+    TCIVecOriginalReferences it = vecOriginal.begin();
+
+    while( it != vecOriginal.end() )
+    {
+        *((*it).first) = (*it).second;
+        ++it;
+    }
+
+    m_bSorted = false;
+    this->Sort();
+}
+
+void PdfVecObjects::CollectReferences( const PdfObject* pObj, TReferencePointerList* pList )
+{
+    if( pObj->IsReference() )
+    {
+        pList->push_back( const_cast<PdfReference*>(&(pObj->GetReference())) );
+    }
+    else if( pObj->IsArray() )
+    {
+        PdfArray::const_iterator itArray = pObj->GetArray().begin();
+        while( itArray != pObj->GetArray().end() )
+        {
+            CollectReferences( &(*itArray), pList );
+            ++itArray;
+        }
+    }
+    else if( pObj->IsDictionary() )
+    {
+        TCIKeyMap itKeys = pObj->GetDictionary().GetKeys().begin();
+        while( itKeys != pObj->GetDictionary().GetKeys().end() )
+        {
+            CollectReferences( (*itKeys).second, pList );
+            ++itKeys;
+        }
+    }
+}
+
 void PdfVecObjects::InsertOneReferenceIntoVector( const PdfObject* pObj, TVecReferencePointerList* pList )  
 {
     size_t                        index;
@@ -588,6 +918,188 @@ void PdfVecObjects::EndAppendStream( const PdfStream* pStream )
     }
 }
 
+size_t PdfVecObjects::MergeDuplicates( PdfObject* pTrailer, TVecObjects* pRemoved, TVecOriginalReferences* pOriginal )
+{
+    if( !pTrailer )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    if( !m_bSorted )
+        this->Sort();
+
+    const size_t nCount = m_vector.size();
+    size_t       i;
+
+    // Find all references to each object, before changing anything, 
+    // as loading an object on demand might require a lookup
+    std::vector< std::vector<TMergeReference> > vecUsers( nCount );
+    for( i = 0; i <= nCount; i++ )
+    {
+        TReferencePointerList lstReferences;
+        CollectReferences( i < nCount ? m_vector[i] : pTrailer, &lstReferences );
+
+        for( TIReferencePointerList it = lstReferences.begin(); it != lstReferences.end(); ++it )
+        {
+            TCIVecObjects itObj = std::lower_bound( m_vector.begin(), m_vector.end(), **it, ObjectReferencePredicate() );
+            if( itObj != m_vector.end() && (*itObj)->Reference() == **it )
+            {
+                TMergeReference ref = { i, *it, false };
+                vecUsers[itObj - m_vector.begin()].push_back( ref );
+            }
+        }
+    }
+
+    // Annotations and /Annots arrays belong to a single page,
+    // even if they are not recognized as such by IsMergeable
+    std::vector<bool> vecAnnotation( nCount, false );
+    for( i = 0; i < nCount; i++ )
+    {
+        const PdfObject* pAnnots = m_vector[i]->IsDictionary() ? m_vector[i]->GetDictionary().GetKey( "Annots" ) : NULL;
+        if( pAnnots && pAnnots->IsReference() ) 
+        {
+            const size_t nArray = FindObject( m_vector, pAnnots->GetReference() );
+            if( nArray < nCount )
+                vecAnnotation[nArray] = true;
+
+            pAnnots = nArray < nCount ? m_vector[nArray] : NULL;
+        }
+
+        if( !pAnnots || !pAnnots->IsArray() )
+            continue;
+
+        PdfArray::const_iterator it = pAnnots->GetArray().begin();
+        while( it != pAnnots->GetArray().end() )
+        {
+            if( (*it).IsReference() )
+            {
+                const size_t nAnnot = FindObject( m_vector, (*it).GetReference() );
+                if( nAnnot < nCount )
+                    vecAnnotation[nAnnot] = true;
+            }
+
+            ++it;
+        }
+    }
+
+    std::vector<bool>        vecRemoved( nCount, false );
+    std::vector<bool>        vecQueued( nCount, false );
+    std::vector<bool>        vecHashed( nCount, false );
+    std::vector<TObjectHash> vecHash( nCount );
+    std::deque<size_t>       queue;
+    for( i = 0; i < nCount; i++ )
+    {
+        if( !vecAnnotation[i] && IsMergeable( m_vector[i] ) )
+        {
+            queue.push_back( i );
+            vecQueued[i] = true;
+        }
+    }
+
+    // Objects are hashed in order, so the first object of each group is kept.
+    // Whenever an object is merged, all objects referencing it have changed
+    // and are hashed again, as they might be duplicates now as well.
+    std::map<TObjectHash,size_t> mapHashes;
+    PdfRefCountedBuffer          buffer;
+    PdfRefCountedBuffer          bufferOther;
+    size_t                       nRemoved = 0;
+    while( !queue.empty() )
+    {
+        i = queue.front();
+        queue.pop_front();
+        vecQueued[i] = false;
+
+        if( vecRemoved[i] )
+            continue;
+
+        if( vecHashed[i] ) 
+        {
+            std::map<TObjectHash,size_t>::iterator itHash = mapHashes.find( vecHash[i] );
+            if( itHash != mapHashes.end() && (*itHash).second == i )
+                mapHashes.erase( itHash );
+        }
+
+        const PdfObject*    pObj    = m_vector[i];
+        const PdfMemStream* pStream = pObj->HasStream() ? static_cast<const PdfMemStream*>(pObj->GetStream()) : NULL;
+        const size_t        lLen    = WriteCanonical( pObj, &buffer );
+
+        vecHash[i] = Hash128( buffer.GetBuffer(), lLen, 0 );
+        if( pStream ) 
+        {
+            const TObjectHash streamHash = Hash128( pStream->Get(), pStream->GetLength(), 1 );
+            vecHash[i].h1 ^= FinalMix( streamHash.h1 + vecHash[i].h2 );
+            vecHash[i].h2 ^= FinalMix( streamHash.h2 );
+        }
+        vecHashed[i] = true;
+
+        std::pair<std::map<TObjectHash,size_t>::iterator,bool> itInserted = 
+            mapHashes.insert( std::pair<TObjectHash,size_t>( vecHash[i], i ) );
+        if( itInserted.second )
+            continue;
+
+        // Make sure the contents are really equal
+        const size_t        nOther       = (*itInserted.first).second;
+        const PdfObject*    pOther       = m_vector[nOther];
+        const PdfMemStream* pOtherStream = pOther->HasStream() ? static_cast<const PdfMemStream*>(pOther->GetStream()) : NULL;
+        if( WriteCanonical( pOther, &bufferOther ) != lLen ||
+            memcmp( buffer.GetBuffer(), bufferOther.GetBuffer(), lLen ) != 0 ||
+            (pStream == NULL) != (pOtherStream == NULL) ||
+            (pStream && (pStream->GetLength() != pOtherStream->GetLength() ||
+                         memcmp( pStream->Get(), pOtherStream->Get(), pStream->GetLength() ) != 0)) )
+            continue;
+
+        vecRemoved[i] = true;
+        ++nRemoved;
+
+        std::vector<TMergeReference>::iterator it = vecUsers[i].begin();
+        while( it != vecUsers[i].end() )
+        {
+            // References in removed objects are kept unchanged
+            if( (*it).nOwner == nCount || !vecRemoved[(*it).nOwner] )
+            {
+                if( pOriginal && !(*it).bChanged )
+                    pOriginal->push_back( TOriginalReference( (*it).pReference, *(*it).pReference ) );
+
+                *(*it).pReference = pOther->Reference();
+                (*it).bChanged    = true;
+                vecUsers[nOther].push_back( *it );
+
+                if( (*it).nOwner != nCount && vecHashed[(*it).nOwner] && !vecQueued[(*it).nOwner] )
+                {
+                    queue.push_back( (*it).nOwner );
+                    vecQueued[(*it).nOwner] = true;
+                }
+            }
+
+            ++it;
+        }
+
+        std::vector<TMergeReference>().swap( vecUsers[i] );
+    }
+
+    if( !nRemoved )
+        return 0;
+
+    TVecObjects vecKept;
+    vecKept.reserve( nCount - nRemoved );
+    for( i = 0; i < nCount; i++ )
+    {
+        if( !vecRemoved[i] )
+            vecKept.push_back( m_vector[i] );
+        else if( pRemoved )
+            pRemoved->push_back( m_vector[i] );
+        else
+        {
+            this->AddFreeObject( m_vector[i]->Reference() );
+            if( m_bAutoDelete )
+                delete m_vector[i];
+        }
+    }
+
+    m_vector.swap( vecKept );
+    return nRemoved;
+}
+
 std::string PdfVecObjects::GetNextSubsetPrefix()
 {
 	if ( m_sSubsetPrefix == "" )
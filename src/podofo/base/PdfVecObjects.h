@@ -57,6 +57,10 @@ typedef std::set<PdfReference>                   TPdfReferenceSet;
 typedef TPdfReferenceSet::iterator               TIPdfReferenceSet;
 typedef TPdfReferenceSet::const_iterator         TCIPdfReferenceSet;
 
+typedef std::map<PdfReference,PdfReference>      TPdfReferenceMap;
+typedef TPdfReferenceMap::iterator               TIPdfReferenceMap;
+typedef TPdfReferenceMap::const_iterator         TCIPdfReferenceMap;
+
 typedef std::list<PdfReference*>                 TReferencePointerList;
 typedef TReferencePointerList::iterator          TIReferencePointerList;
 typedef TReferencePointerList::const_iterator    TCIReferencePointerList;
@@ -65,6 +69,13 @@ typedef std::vector<TReferencePointerList  >     TVecReferencePointerList;
 typedef TVecReferencePointerList::iterator       TIVecReferencePointerList;
 typedef TVecReferencePointerList::const_iterator TCIVecReferencePointerList;
 
+/** A reference changed by PdfVecObjects::RenumberObjects and its original value
+ */
+typedef std::pair<PdfReference*,PdfReference>    TOriginalReference;
+typedef std::vector<TOriginalReference>          TVecOriginalReferences;
+typedef TVecOriginalReferences::iterator         TIVecOriginalReferences;
+typedef TVecOriginalReferences::const_iterator   TCIVecOriginalReferences;
+
 /*
 typedef std::vector<PdfObject*>      TVecObjects;
 typedef TVecObjects::iterator        TIVecObjects;
@@ -148,6 +159,24 @@ class PODOFO_API PdfVecObjects {
         virtual PdfStream* CreateStream( PdfObject* pParent ) = 0;
     };
 
+    /** This class is used to load objects on demand,
+     *  which are not yet part of a PdfVecObjects.
+     */
+    class PODOFO_API ObjectLoader {
+    public:
+        virtual ~ObjectLoader()
+            {
+            }
+
+        /** Load an object and add it to the PdfVecObjects
+         *
+         *  \param rRef reference of the object to load
+         *
+         *  \returns the loaded object or NULL if there is no such object
+         */
+        virtual PdfObject* LoadObject( const PdfReference & rRef ) = 0;
+    };
+
  private:
     typedef std::vector<Observer*>        TVecObservers;
     typedef TVecObservers::iterator       TIVecObservers;
@@ -222,8 +251,10 @@ class PODOFO_API PdfVecObjects {
 
     /** Finds the object with the given reference in m_vecOffsets 
      *  and returns a pointer to it if it is found.
+     *  If an ObjectLoader is set, it is asked to load objects which are not found.
      *  \param ref the object to be found
      *  \returns the found object or NULL if no object was found.
+     *  \see SetObjectLoader
      */
     PdfObject* GetObject( const PdfReference & ref ) const;
 
@@ -303,6 +334,31 @@ class PODOFO_API PdfVecObjects {
      */
     void RenumberObjects( PdfObject* pTrailer, TPdfReferenceSet* pNotDelete = NULL, bool bDoGarbageCollection = false );
 
+    /** 
+     *  Renumbers all objects in the given order, i.e. the first object
+     *  of vecOrder gets the object number 1. All generation numbers are set to 0.
+     *  The references in all objects and in the trailer are changed accordingly.
+     *  References to objects which are not part of this vector are changed
+     *  to an object number which is not used by any object.
+     *
+     *  Unlike the other overload no object is deleted and the original 
+     *  numbers can be restored using RestoreObjectNumbers.
+     *
+     *  \param pTrailer the trailer object
+     *  \param vecOrder all objects of this vector in their new order
+     *  \param pOriginal the original values of all changed references are appended to this vector
+     *
+     *  \see RestoreObjectNumbers
+     */
+    void RenumberObjects( PdfObject* pTrailer, const TVecObjects & vecOrder, TVecOriginalReferences* pOriginal );
+
+    /** 
+     *  Restores the object numbers changed by RenumberObjects.
+     *
+     *  \param vecOriginal the original references as returned by RenumberObjects
+     */
+    void RestoreObjectNumbers( const TVecOriginalReferences & vecOriginal );
+
     /** 
      * \see insert_sorted
      *
@@ -376,6 +432,13 @@ class PODOFO_API PdfVecObjects {
      */
     inline void SetStreamFactory( StreamFactory* pFactory );
 
+    /** Sets an ObjectLoader which is asked by GetObject for
+     *  all objects which are not part of this vector.
+     *
+     *  \param pLoader an object loader or NULL to disable loading objects
+     */
+    inline void SetObjectLoader( ObjectLoader* pLoader );
+
     /** Creates a stream object
      *  This method is a factory for PdfStream objects.
      *
@@ -452,6 +515,33 @@ class PODOFO_API PdfVecObjects {
      */
     void CollectGarbage( PdfObject* pTrailer );
 
+    /**
+     * Merges objects with identical contents, e.g. fonts or images
+     * which were copied once per appended document.
+     *
+     * Objects are compared by a 128 bit hash of their serialized
+     * contents, with dictionary keys in sorted order, and of their raw
+     * stream data. Objects with equal hashes are compared byte by byte
+     * before they are merged. All references to a duplicate, including
+     * those in pTrailer, are changed to the first object with the same
+     * contents. Objects which become identical by this are merged as well.
+     *
+     * Pages, pages tree nodes, annotations, the catalog, objects with
+     * a /Parent key and objects whose stream is not held in memory are
+     * never merged.
+     *
+     * \param pTrailer trailer object of the PDF
+     * \param pRemoved if not NULL, the duplicates are appended to this vector
+     *                 and are owned by the caller. Otherwise they are deleted
+     *                 (if AutoDelete() is true) and their numbers are marked as free.
+     * \param pOriginal if not NULL, the original values of all changed references
+     *                  are appended, so that they can be restored using
+     *                  RestoreObjectNumbers after adding the duplicates again
+     *
+     * \returns the number of removed duplicates
+     */
+    size_t MergeDuplicates( PdfObject* pTrailer, TVecObjects* pRemoved = NULL, TVecOriginalReferences* pOriginal = NULL );
+
 	/** Get next unique subset-prefix
      *
      *  \returns a string to use as subset-prefix.
@@ -484,6 +574,10 @@ class PODOFO_API PdfVecObjects {
      */
     void InsertOneReferenceIntoVector( const PdfObject* pObj, TVecReferencePointerList* pList );
 
+    /** Append pointers to all references in pObj and its child objects to pList
+     */
+    void CollectReferences( const PdfObject* pObj, TReferencePointerList* pList );
+
     /** Delete all objects from the vector which do not have references to them selves
      *  \param pList must be a list created by BuildReferenceCountVector
      *  \param pTrailer must be the trailer object so that it is not deleted
@@ -506,6 +600,7 @@ class PODOFO_API PdfVecObjects {
     PdfDocument*        m_pDocument;
 
     StreamFactory*      m_pStreamFactory;
+    ObjectLoader*       m_pObjectLoader;
 
 	std::string			m_sSubsetPrefix;		 ///< Prefix for BaseFont and FontName of subsetted font
     static size_t       m_nMaxReserveSize;
@@ -617,6 +712,14 @@ inline void PdfVecObjects::SetStreamFactory( StreamFactory* pFactory )
     m_pStreamFactory = pFactory;
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline void PdfVecObjects::SetObjectLoader( ObjectLoader* pLoader )
+{
+    m_pObjectLoader = pLoader;
+}
+
 // -----------------------------------------------------
 // 
 // -----------------------------------------------------
@@ -36,7 +36,6 @@
 #include "PdfData.h"
 #include "PdfDate.h"
 #include "PdfDictionary.h"
-//#include "PdfHintStream.h"
 #include "PdfObject.h"
 #include "PdfParser.h"
 #include "PdfParserObject.h"
@@ -46,25 +45,235 @@
 #include "PdfXRefStream.h"
 #include "PdfDefinesPrivate.h"
 
+#include "doc/PdfHintStream.h"
+
+#if defined(PODOFO_MULTI_THREAD)
+#include "util/PdfMutexWrapper.h"
+#include "util/PdfThread.h"
+#endif
+
 #define PDF_MAGIC           "\xe2\xe3\xcf\xd3\n"
 // 10 spaces
 #define LINEARIZATION_PADDING "          " 
 
 #include <iostream>
+#include <map>
+#include <set>
 #include <stdlib.h>
 
 namespace PoDoFo {
 
+#if defined(PODOFO_MULTI_THREAD)
+/** Serializes a list of objects into memory buffers using several threads.
+ *  The serialized objects are retrieved in their original order by WriteNext(),
+ *  which allows the threads to serialize a few objects ahead.
+ */
+class PdfObjectSerializer {
+ public:
+    /** Create a new serializer. 
+     *
+     *  \param vecObjects the objects to serialize, in the order they are written
+     *  \param eWriteMode the write mode for all objects
+     *  \param pEncrypt encrypt all objects but pEncryptObj with a copy of this object, can be NULL
+     *  \param pEncryptObj the encryption dictionary
+     */
+    PdfObjectSerializer( const TVecObjects & vecObjects, EPdfWriteMode eWriteMode,
+                         const PdfEncrypt* pEncrypt, const PdfObject* pEncryptObj )
+        : m_vecObjects( vecObjects ), m_eWriteMode( eWriteMode ), 
+          m_pEncrypt( pEncrypt ), m_pEncryptObj( pEncryptObj ),
+          m_nNext( 0 ), m_nWritten( 0 ), m_bAbort( false )
+    {
+    }
+
+    /** Stops and joins all threads
+     */
+    ~PdfObjectSerializer()
+    {
+        m_mutex.Lock();
+        m_bAbort = true;
+        m_condWorkers.Broadcast();
+        m_mutex.UnLock();
+
+        std::vector<TWorker*>::iterator itWorker = m_vecWorkers.begin();
+        while( itWorker != m_vecWorkers.end() )
+        {
+            (*itWorker)->thread.Join();
+            delete (*itWorker)->pEncrypt;
+            delete *itWorker;
+            ++itWorker;
+        }
+
+        std::vector<TSlot>::iterator itSlot = m_vecSlots.begin();
+        while( itSlot != m_vecSlots.end() )
+        {
+            delete (*itSlot).pError;
+            ++itSlot;
+        }
+    }
+
+    /** Start serializing objects.
+     *
+     *  \param nThreads number of threads to use
+     */
+    void Start( int nThreads )
+    {
+        m_vecSlots.resize( nThreads * SLOTS_PER_THREAD );
+
+        for( int i = 0; i < nThreads; i++ )
+        {
+            TWorker* pWorker     = new TWorker();
+            pWorker->pSerializer = this;
+            pWorker->pEncrypt    = NULL;
+            m_vecWorkers.push_back( pWorker );
+
+            // Each thread needs its own encryption object, as encrypting changes its state
+            if( m_pEncrypt )
+                pWorker->pEncrypt = PdfEncrypt::CreatePdfEncrypt( *m_pEncrypt );
+
+            try {
+                pWorker->thread.Start( &PdfObjectSerializer::ThreadMain, pWorker );
+            } catch( PdfError & e ) {
+                // This worker must not be joined
+                m_vecWorkers.pop_back();
+                delete pWorker->pEncrypt;
+                delete pWorker;
+
+                if( !m_vecWorkers.size() )
+                    throw e;
+
+                break;
+            }
+        }
+    }
+
+    /** Write the next object to a device, waiting until it has been serialized
+     *
+     *  \param pObject the next object, only used for checking
+     *  \param pDevice write the object to this device
+     */
+    void WriteNext( const PdfObject* pObject, PdfOutputDevice* pDevice )
+    {
+        if( m_nWritten >= m_vecObjects.size() || m_vecObjects[m_nWritten] != pObject )
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Objects are not written in the order they were serialized." );
+        }
+
+        TSlot & slot = m_vecSlots[m_nWritten % m_vecSlots.size()];
+
+        m_mutex.Lock();
+        while( !slot.bDone )
+            m_condWriter.Wait( m_mutex );
+        m_mutex.UnLock();
+
+        if( slot.pError )
+        {
+            PdfError error( *slot.pError );
+            throw error;
+        }
+
+        pDevice->Write( slot.buffer.GetBuffer(), slot.lLength );
+
+        Util::PdfMutexWrapper lock( m_mutex );
+        slot.bDone = false;
+        ++m_nWritten;
+        m_condWorkers.Broadcast();
+    }
+
+ private:
+    struct TWorker {
+        PdfObjectSerializer* pSerializer;
+        PdfEncrypt*          pEncrypt;
+        Util::PdfThread      thread;
+    };
+
+    struct TSlot {
+        TSlot()
+            : lLength( 0 ), bDone( false ), pError( NULL )
+        {
+        }
+
+        PdfRefCountedBuffer buffer;
+        pdf_long            lLength;
+        bool                bDone;
+        PdfError*           pError; ///< the error which occurred while serializing or NULL
+    };
+
+    enum { 
+        SLOTS_PER_THREAD = 8 ///< objects which may be serialized ahead per thread
+    };
+
+    static void ThreadMain( void* pData )
+    {
+        TWorker* pWorker = static_cast<TWorker*>(pData);
+        pWorker->pSerializer->Run( pWorker->pEncrypt );
+    }
+
+    void Run( PdfEncrypt* pEncrypt )
+    {
+        for( ;; ) 
+        {
+            size_t nIndex;
+
+            m_mutex.Lock();
+            while( !m_bAbort && m_nNext < m_vecObjects.size() && m_nNext >= m_nWritten + m_vecSlots.size() )
+                m_condWorkers.Wait( m_mutex );
+
+            if( m_bAbort || m_nNext >= m_vecObjects.size() )
+            {
+                m_mutex.UnLock();
+                return;
+            }
+
+            nIndex = m_nNext++;
+            m_mutex.UnLock();
+
+            const PdfObject* pObject = m_vecObjects[nIndex];
+            TSlot &          slot    = m_vecSlots[nIndex % m_vecSlots.size()];
+            try {
+                PdfOutputDevice device( &slot.buffer );
+
+                // Make sure that we do not encrypt the encryption dictionary!
+                pObject->WriteObject( &device, m_eWriteMode, 
+                                      (pObject == m_pEncryptObj ? NULL : pEncrypt) );
+                slot.lLength = device.GetLength();
+            } catch( PdfError & e ) {
+                slot.pError = new PdfError( e );
+            } catch( std::bad_alloc & ) {
+                slot.pError = new PdfError( ePdfError_OutOfMemory, __FILE__, __LINE__ );
+            }
+
+            Util::PdfMutexWrapper lock( m_mutex );
+            slot.bDone = true;
+            m_condWriter.Signal();
+        }
+    }
+
+ private:
+    const TVecObjects &    m_vecObjects;
+    EPdfWriteMode          m_eWriteMode;
+    const PdfEncrypt*      m_pEncrypt;
+    const PdfObject*       m_pEncryptObj;
+
+    std::vector<TWorker*>  m_vecWorkers;
+    std::vector<TSlot>     m_vecSlots;
+
+    Util::PdfMutex         m_mutex;
+    Util::PdfCondition     m_condWorkers; ///< signalled when a slot is free
+    Util::PdfCondition     m_condWriter;  ///< signalled when an object has been serialized
+    size_t                 m_nNext;       ///< the next object to serialize
+    size_t                 m_nWritten;    ///< the number of objects written
+    bool                   m_bAbort;
+};
+#endif // PODOFO_MULTI_THREAD
+
 PdfWriter::PdfWriter( PdfParser* pParser )
-    : m_bXRefStream( false ), m_pEncrypt( NULL ), 
+    : m_bXRefStream( false ), m_bObjectStreams( false ),
+      m_nObjectStreamSize( DEFAULT_OBJECT_STREAM_SIZE ), m_pEncrypt( NULL ), 
       m_pEncryptObj( NULL ), 
       m_eWriteMode( ePdfWriteMode_Compact ),
       m_lPrevXRefOffset( 0 ),
-      m_bIncrementalUpdate( false ),
-      m_bLinearized( false ), m_lFirstInXRef( 0 ),
-      m_lLinearizedOffset(0),
-      m_lLinearizedLastOffset(0),
-      m_lTrailerOffset(0)
+      m_bIncrementalUpdate( false ), m_nWriteThreads( 1 ),
+      m_bLinearized( false )
 {
     if( !(pParser && pParser->GetTrailer()) )
     {
@@ -77,15 +286,13 @@ PdfWriter::PdfWriter( PdfParser* pParser )
 }
 
 PdfWriter::PdfWriter( PdfVecObjects* pVecObjects, const PdfObject* pTrailer )
-    : m_bXRefStream( false ), m_pEncrypt( NULL ), 
+    : m_bXRefStream( false ), m_bObjectStreams( false ),
+      m_nObjectStreamSize( DEFAULT_OBJECT_STREAM_SIZE ), m_pEncrypt( NULL ), 
       m_pEncryptObj( NULL ), 
       m_eWriteMode( ePdfWriteMode_Compact ),
       m_lPrevXRefOffset( 0 ),
-      m_bIncrementalUpdate( false ),
-      m_bLinearized( false ), m_lFirstInXRef( 0 ),
-      m_lLinearizedOffset(0),
-      m_lLinearizedLastOffset(0),
-      m_lTrailerOffset(0)
+      m_bIncrementalUpdate( false ), m_nWriteThreads( 1 ),
+      m_bLinearized( false )
 {
     if( !pVecObjects || !pTrailer )
     {
@@ -98,15 +305,13 @@ PdfWriter::PdfWriter( PdfVecObjects* pVecObjects, const PdfObject* pTrailer )
 }
 
 PdfWriter::PdfWriter( PdfVecObjects* pVecObjects )
-    : m_bXRefStream( false ), m_pEncrypt( NULL ), 
+    : m_bXRefStream( false ), m_bObjectStreams( false ),
+      m_nObjectStreamSize( DEFAULT_OBJECT_STREAM_SIZE ), m_pEncrypt( NULL ), 
       m_pEncryptObj( NULL ), 
       m_eWriteMode( ePdfWriteMode_Compact ),
       m_lPrevXRefOffset( 0 ),
-      m_bIncrementalUpdate( false ),
-      m_bLinearized( false ), m_lFirstInXRef( 0 ),
-      m_lLinearizedOffset(0),
-      m_lLinearizedLastOffset(0),
-      m_lTrailerOffset(0)
+      m_bIncrementalUpdate( false ), m_nWriteThreads( 1 ),
+      m_bLinearized( false )
 {
     m_eVersion     = ePdfVersion_Default;
     m_pTrailer     = new PdfObject();
@@ -167,13 +372,32 @@ void PdfWriter::Write( PdfOutputDevice* pDevice, bool bRewriteXRefTable )
         if( m_bIncrementalUpdate )
             PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Cannot write an incremental update as a linearized document." );
 
-        this->WriteLinearized( pDevice );
+        try {
+            this->WriteLinearized( pDevice );
+        } catch( PdfError & e ) {
+            // P.Zent: Delete Encryption dictionary (cannot be reused)
+            if(m_pEncryptObj) {
+                m_vecObjects->RemoveObject(m_pEncryptObj->Reference());
+                delete m_pEncryptObj;
+            }
+
+            e.AddToCallstack( __FILE__, __LINE__ );
+            throw e;
+        }
     }
     else
     {
-        PdfXRef* pXRef = m_bXRefStream ? new PdfXRefStream( m_vecObjects, this ) : new PdfXRef();
+        PdfXRef* pXRef        = NULL;
+        size_t   nObjectCount = m_vecObjects->GetObjectCount();
 
         try {
+            // Object streams have to be created before the XRef stream object,
+            // which must be the last object written
+            if( m_bObjectStreams )
+                CreateObjectStreams( *m_vecObjects );
+
+            pXRef = m_bXRefStream ? new PdfXRefStream( m_vecObjects, this ) : new PdfXRef();
+
             if( !m_bIncrementalUpdate )
                 WritePdfHeader( pDevice );
 
@@ -196,10 +420,14 @@ void PdfWriter::Write( PdfOutputDevice* pDevice, bool bRewriteXRefTable )
                 trailer.WriteObject( pDevice, m_eWriteMode, NULL ); // Do not encrypt the trailer dictionary!!!
             }
             
-            pDevice->Print( "startxref\n%" PDF_FORMAT_UINT64 "\n%%%%EOF\n", pXRef->GetOffset() );
+            pDevice->Print( "startxref\n" );
+            pDevice->WriteInt( static_cast<pdf_int64>(pXRef->GetOffset()) );
+            pDevice->Write( "\n%%EOF\n", 7 );
+            ClearObjectStreams( nObjectCount, pXRef );
             delete pXRef;
         } catch( PdfError & e ) {
             // Make sure pXRef is always deleted
+            ClearObjectStreams( nObjectCount, pXRef );
             delete pXRef;
             
             // P.Zent: Delete Encryption dictionary (cannot be reused)
@@ -212,6 +440,9 @@ void PdfWriter::Write( PdfOutputDevice* pDevice, bool bRewriteXRefTable )
             throw e;
         }
     }
+
+    // Pass on buffered data, so that write errors are reported here
+    pDevice->Flush();
     
     // P.Zent: Delete Encryption dictionary (cannot be reused)
     if(m_pEncryptObj) {
@@ -271,83 +502,613 @@ void PdfWriter::WriteUpdate( PdfOutputDevice* pDevice, PdfInputDevice* pSourceIn
     this->Write (pDevice, bRewriteXRefTable );
 }
 
-void PdfWriter::WriteLinearized( PdfOutputDevice* /* pDevice */ )
+/** The parts of a linearized PDF file, see "Linearized PDF" in the PDF reference.
+ *  The objects of the main section (parts 6 to 8) are numbered from 1 to nFirstPage,
+ *  the objects of the first page section (parts 2 to 5) get the following numbers.
+ *  Within each section the objects are written in the order of their numbers.
+ */
+struct PdfWriter::TLinearizedLayout {
+    TVecObjects                             vecOrder;   ///< all objects in the order of their new object numbers
+    size_t                                  nShared;    ///< index of the first shared object (part 7)
+    size_t                                  nOther;     ///< index of the first other object (part 8)
+    size_t                                  nFirstPage; ///< index of the linearization dictionary
+    size_t                                  nHint;      ///< index of the hint stream, which is followed by the objects of the first page (part 5)
+    NonPublic::PdfHintStream::TVecPageHints vecPages;   ///< hint information for all pages, lengths are calculated while writing
+};
+
+typedef std::set<const PdfObject*>  TSetLinearizedObjects;
+
+/** Append all objects referenced directly or indirectly by pObj to pList
+ *  in the order in which they are found. Objects in setSkip are neither added
+ *  nor followed, objects in pVisited are not added again.
+ */
+static void CollectLinearizedObjects( const PdfVecObjects* pVecObjects, const PdfObject* pObj, 
+                                      const TSetLinearizedObjects & setSkip, TSetLinearizedObjects* pVisited, 
+                                      TVecObjects* pList )
 {
-    PODOFO_RAISE_ERROR( ePdfError_NotImplemented );
+    std::vector<const PdfObject*> stack( 1, pObj );
+
+    while( !stack.empty() ) 
+    {
+        const PdfObject* pCurrent = stack.back();
+        stack.pop_back();
 
-    /*
-    PdfObject*      pLinearize  = NULL;
-    PdfPage*        pPage;
-    PdfObject*      pLast;
-    NonPublic::PdfHintStream*  pHint;
+        // Children are pushed in reverse order, so that they are found in their order
+        if( pCurrent->IsReference() )
+        {
+            PdfObject* pReferenced = pVecObjects->GetObject( pCurrent->GetReference() );
+            if( pReferenced && !setSkip.count( pReferenced ) && pVisited->insert( pReferenced ).second )
+            {
+                pList->push_back( pReferenced );
+                stack.push_back( pReferenced );
+            }
+        }
+        else if( pCurrent->IsArray() )
+        {
+            PdfArray::const_reverse_iterator it = pCurrent->GetArray().rbegin();
+            while( it != pCurrent->GetArray().rend() )
+            {
+                stack.push_back( &(*it) );
+                ++it;
+            }
+        }
+        else if( pCurrent->IsDictionary() )
+        {
+            TKeyMap::const_reverse_iterator it = pCurrent->GetDictionary().GetKeys().rbegin();
+            while( it != pCurrent->GetDictionary().GetKeys().rend() )
+            {
+                stack.push_back( (*it).second );
+                ++it;
+            }
+        }
+    }
+}
+
+/** Append all objects required to display pPage to pList, 
+ *  including the values of inherited attributes.
+ */
+static void CollectLinearizedPage( const PdfVecObjects* pVecObjects, PdfObject* pPage, 
+                                   const TSetLinearizedObjects & setSkip, TVecObjects* pList )
+{
+    static const char* const apszInherited[] = { "Resources", "MediaBox", "CropBox", "Rotate" };
+    const int                nInherited      = sizeof(apszInherited) / sizeof(apszInherited[0]);
+
+    TSetLinearizedObjects setVisited;
+    TSetLinearizedObjects setParents;
+    bool                  abFound[nInherited];
+    int                   i;
+
+    setVisited.insert( pPage );
+    CollectLinearizedObjects( pVecObjects, pPage, setSkip, &setVisited, pList );
+
+    for( i = 0; i < nInherited; i++ )
+        abFound[i] = pPage->GetDictionary().HasKey( apszInherited[i] );
+
+    PdfObject* pParent = pPage->GetIndirectKey( "Parent" );
+    while( pParent && pParent->IsDictionary() && setParents.insert( pParent ).second )
+    {
+        for( i = 0; i < nInherited; i++ )
+        {
+            if( !abFound[i] && pParent->GetDictionary().HasKey( apszInherited[i] ) )
+            {
+                abFound[i] = true;
+                CollectLinearizedObjects( pVecObjects, pParent->GetDictionary().GetKey( apszInherited[i] ), 
+                                          setSkip, &setVisited, pList );
+            }
+        }
+
+        pParent = pParent->GetIndirectKey( "Parent" );
+    }
+}
+
+/** Append all pages below pNode in document order to pPages 
+ *  and insert all nodes of the pages tree into pNodes.
+ */
+static void CollectLinearizedPages( PdfObject* pNode, TVecObjects* pPages, TSetLinearizedObjects* pNodes )
+{
+    std::vector<PdfObject*> stack( 1, pNode );
+    TSetLinearizedObjects   setVisited;
+
+    while( !stack.empty() ) 
+    {
+        pNode = stack.back();
+        stack.pop_back();
+
+        // Guard against cycles in broken files
+        if( !pNode || !pNode->IsDictionary() || !setVisited.insert( pNode ).second )
+            continue;
+
+        const PdfObject* pType = pNode->GetDictionary().GetKey( PdfName::KeyType );
+        PdfObject*       pKids = pNode->GetIndirectKey( "Kids" );
+        if( !pKids && !( pType && pType->IsName() && pType->GetName() == PdfName( "Pages" ) ) )
+        {
+            pPages->push_back( pNode );
+            continue;
+        }
+
+        pNodes->insert( pNode );
+        if( pKids && pKids->IsArray() )
+        {
+            PdfArray::const_reverse_iterator it = pKids->GetArray().rbegin();
+            while( it != pKids->GetArray().rend() )
+            {
+                if( (*it).IsReference() )
+                    stack.push_back( pNode->GetOwner()->GetObject( (*it).GetReference() ) );
+                ++it;
+            }
+        }
+    }
+}
+
+/** \returns the length of an XRef table containing the objects nBegin to nEnd of vecObjects
+ */
+static pdf_uint64 GetLinearizedXRefLength( const TVecObjects & vecObjects, size_t nBegin, size_t nEnd )
+{
     PdfOutputDevice length;
-    TVecXRefTable   vecXRef;
-    TVecXRefOffset  vecXRefOffset;
-    TIVecOffsets    it;
+    PdfXRef         xref;
 
-    // prepare the document for linearization
-    this->FetchPagesTree();
-    pPage = m_pPagesTree->GetPage( 0 );
-    
-    pLinearize = CreateLinearizationDictionary();
-    pHint      = new NonPublic::PdfHintStream( m_vecObjects, m_pPagesTree );
-    
-    this->ReorderObjectsLinearized( pLinearize, pHint, pPage, &pLast );
+    for( ; nBegin < nEnd; nBegin++ ) 
+        xref.AddObject( vecObjects[nBegin]->Reference(), 0, true );
 
-    // The file is prepared for linearization,
-    // so write it now.
-    WritePdfHeader( pDevice );
+    xref.Write( &length );
+    return length.GetLength();
+}
 
-    m_lLinearizedOffset = pDevice->GetLength();
-    pLinearize->WriteObject( pDevice );
+/** Write lLength spaces
+ */
+static void WriteLinearizationPadding( PdfOutputDevice* pDevice, pdf_uint64 lLength )
+{
+    const pdf_uint64 lPadding = sizeof(LINEARIZATION_PADDING) - 1;
 
-    // fill the XRef table with the objects
+    while( lLength )
     {
-        // Use nested scope and stack local for PdfOutputDevice
-        // rather than using a temporary to stop gcc's whining.
-        PdfOutputDevice o;
-        WritePdfObjects(&o, m_vecLinearized, &vecXRef );
+        const pdf_uint64 lWrite = PDF_MIN( lLength, lPadding );
+        pDevice->Write( LINEARIZATION_PADDING, static_cast<pdf_long>(lWrite) );
+        lLength -= lWrite;
     }
+}
 
-    // prepend the linearization dictionary to the XRef table
-    TXRefEntry entry;
-    entry.lOffset     = m_lLinearizedOffset;
-    entry.lGeneration = pLinearize->Reference().GenerationNumber();
-    entry.cUsed       = 'n';
-    
-    vecXRef[0].nCount++;
-    vecXRef[0].nFirst--; 
-    vecXRef[0].vecOffsets.insert( vecXRef[0].vecOffsets.begin(), entry );
+/** Write a trailer dictionary followed by lPadding spaces
+ */
+static void WriteLinearizedTrailer( PdfOutputDevice* pDevice, const PdfObject & trailer, EPdfWriteMode eWriteMode,
+                                    pdf_uint64 lStartXRef, pdf_uint64 lPadding )
+{
+    pDevice->Print( "trailer\n" );
+    trailer.WriteObject( pDevice, eWriteMode, NULL ); // Do not encrypt the trailer dictionary!!!
+    WriteLinearizationPadding( pDevice, lPadding );
 
-    // Calculate the length of the xref table
-    WritePdfTableOfContents( &vecXRef, &length, &vecXRefOffset, true, false );
-    
-    it = vecXRef[0].vecOffsets.begin(); 
-    it++; // skip the linearization dictionary, as it was written before the XRef table
-          // and does already have a correct offset
-    while( it != vecXRef[0].vecOffsets.end() )
+    pDevice->Print( "startxref\n" );
+    pDevice->WriteInt( static_cast<pdf_int64>(lStartXRef) );
+    pDevice->Write( "\n%%EOF\n", 7 );
+}
+
+/** Make sure that pDevice is at the offset calculated before writing
+ */
+static void CheckLinearizedOffset( const PdfOutputDevice* pDevice, pdf_uint64 lOffset )
+{
+    if( static_cast<pdf_uint64>(pDevice->Tell()) != lOffset )
     {
-        (*it).lOffset += pDevice->GetLength() + length.GetLength();
-        m_lLinearizedLastOffset = (*it).lOffset;
-        ++it;
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Unexpected offset while writing a linearized file." );
     }
-    
-    vecXRefOffset.clear();
-    WritePdfTableOfContents( &vecXRef, pDevice, &vecXRefOffset, true, false );
-    vecXRef.clear();
+}
+
+/** Restore the original object numbers and remove all objects 
+ *  which were created to write a linearized file.
+ */
+static void RemoveLinearizationObjects( PdfVecObjects* pVecObjects, const TVecOriginalReferences & vecOriginal,
+                                        PdfObject* pLinearize, NonPublic::PdfHintStream* pHint )
+{
+    pVecObjects->RestoreObjectNumbers( vecOriginal );
 
-    WritePdfObjects( pDevice, m_vecLinearized, &vecXRef );
-    vecXRef.clear();
+    delete pVecObjects->RemoveObject( pLinearize->Reference() );
+    if( pHint ) 
+    {
+        delete pVecObjects->RemoveObject( pHint->GetObject()->Reference() );
+        delete pHint;
+    }
+}
+
+void PdfWriter::WriteLinearized( PdfOutputDevice* pDevice )
+{
+    if( m_bXRefStream || m_bObjectStreams )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_NotImplemented, "Linearized files cannot be written with XRef streams or object streams." );
+    }
 
-    WritePdfObjects( pDevice, *m_vecObjects, &vecXRef );
+    PdfObject*                pLinearize = m_vecObjects->CreateObject();
+    NonPublic::PdfHintStream* pHint      = NULL;
+    TVecOriginalReferences    vecOriginal;
 
-    if( m_bXRefStream )
-        WriteXRefStream( &vecXRef, pDevice );
-    else
-        WritePdfTableOfContents( &vecXRef, pDevice, &vecXRefOffset, false, m_bLinearized );
+    try {
+        pHint = new NonPublic::PdfHintStream( m_vecObjects );
+
+        TLinearizedLayout layout;
+        this->ReorderObjectsLinearized( pLinearize, pHint->GetObject(), &layout );
 
-    this->FillLinearizationDictionary( pLinearize, pDevice, pPage, pLast, pHint, &vecXRefOffset );
-    */
+        // Both sections have to be numbered in the order in which
+        // they are written. The original numbers are restored afterwards,
+        // as the document might be modified or written again.
+        m_vecObjects->RenumberObjects( m_pTrailer, layout.vecOrder, &vecOriginal );
+
+        this->WriteLinearizedObjects( pDevice, pLinearize, pHint, layout );
+    } catch( PdfError & e ) {
+        RemoveLinearizationObjects( m_vecObjects, vecOriginal, pLinearize, pHint );
+
+        e.AddToCallstack( __FILE__, __LINE__ );
+        throw e;
+    }
+
+    RemoveLinearizationObjects( m_vecObjects, vecOriginal, pLinearize, pHint );
+}
+
+void PdfWriter::ReorderObjectsLinearized( PdfObject* pLinearize, PdfObject* pHint, TLinearizedLayout* pLayout )
+{
+    // Document level objects which are required to open the document (part 4)
+    static const char* const apszCatalogKeys[] = { "ViewerPreferences", "PageMode", "Threads", "OpenAction", "AcroForm" };
+    const int                nCatalogKeys      = sizeof(apszCatalogKeys) / sizeof(apszCatalogKeys[0]);
+    // Marks an object used by more than one page
+    const size_t             nSharedPage       = static_cast<size_t>(-1);
+
+    TVecObjects           vecPages;
+    TSetLinearizedObjects setSkip;
+    TCIVecObjects         it;
+    size_t                i;
+
+    const PdfObject* pRootRef = m_pTrailer->GetDictionary().GetKey( "Root" );
+    PdfObject*       pRoot    = pRootRef && pRootRef->IsReference() ? m_vecObjects->GetObject( pRootRef->GetReference() ) : NULL;
+    if( !pRoot || !pRoot->IsDictionary() )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_NoObject, "A linearized file requires a catalog dictionary." );
+    }
+
+    PdfObject* pPagesRoot = pRoot->GetIndirectKey( "Pages" );
+    if( pPagesRoot )
+        CollectLinearizedPages( pPagesRoot, &vecPages, &setSkip );
+
+    if( vecPages.empty() )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_PageNotFound, "A linearized file requires at least one page." );
+    }
+
+    // Pages and page tree nodes are written on their own 
+    // and never belong to the objects used by another object
+    setSkip.insert( vecPages.begin(), vecPages.end() );
+
+    // Part 4: The catalog and document level objects
+    TVecObjects           vecDocument( 1, pRoot );
+    TSetLinearizedObjects setDocument;
+
+    setDocument.insert( pRoot );
+    for( i = 0; i < nCatalogKeys; i++ ) 
+    {
+        if( pRoot->GetDictionary().HasKey( apszCatalogKeys[i] ) )
+            CollectLinearizedObjects( m_vecObjects, pRoot->GetDictionary().GetKey( apszCatalogKeys[i] ), 
+                                      setSkip, &setDocument, &vecDocument );
+    }
+
+    const PdfObject* pPageMode = pRoot->GetDictionary().GetKey( "PageMode" );
+    if( pPageMode && pPageMode->IsName() && pPageMode->GetName() == PdfName( "UseOutlines" ) 
+        && pRoot->GetDictionary().HasKey( "Outlines" ) )
+        CollectLinearizedObjects( m_vecObjects, pRoot->GetDictionary().GetKey( "Outlines" ), 
+                                  setSkip, &setDocument, &vecDocument );
+
+    if( m_pEncryptObj && setDocument.insert( m_pEncryptObj ).second )
+        vecDocument.push_back( m_pEncryptObj );
+
+    setSkip.insert( setDocument.begin(), setDocument.end() );
+
+    // Part 5: The first page and all objects used by it.
+    // These objects are the first groups of the shared object hint table.
+    TVecObjects                            vecFirstPage( 1, vecPages.front() );
+    std::map<const PdfObject*, pdf_uint32> mapShared;
+
+    CollectLinearizedPage( m_vecObjects, vecPages.front(), setSkip, &vecFirstPage );
+    for( i = 0; i < vecFirstPage.size(); i++ ) 
+        mapShared[vecFirstPage[i]] = static_cast<pdf_uint32>(i);
+
+    // Find the page using each object, which is not used by the first page
+    std::vector<TVecObjects>           vecPageObjects( vecPages.size() );
+    std::map<const PdfObject*, size_t> mapPage;
+
+    for( i = 1; i < vecPages.size(); i++ ) 
+    {
+        CollectLinearizedPage( m_vecObjects, vecPages[i], setSkip, &vecPageObjects[i] );
+
+        for( it = vecPageObjects[i].begin(); it != vecPageObjects[i].end(); ++it )
+        {
+            if( mapShared.count( *it ) ) 
+                continue;
+
+            std::pair<std::map<const PdfObject*, size_t>::iterator, bool> inserted = 
+                mapPage.insert( std::pair<const PdfObject*, size_t>( *it, i ) );
+            if( !inserted.second && (*inserted.first).second != i )
+                (*inserted.first).second = nSharedPage;
+        }
+    }
+
+    TVecObjects & vecOrder = pLayout->vecOrder;
+    vecOrder.clear();
+    vecOrder.reserve( m_vecObjects->GetSize() );
+
+    pLayout->vecPages.clear();
+    pLayout->vecPages.resize( vecPages.size() );
+    pLayout->vecPages[0].nObjects = static_cast<pdf_uint32>(vecFirstPage.size());
+    pLayout->vecPages[0].nLength  = 0;
+
+    // Part 6: All other pages, each followed by the objects only used by it
+    for( i = 1; i < vecPages.size(); i++ ) 
+    {
+        const size_t nStart = vecOrder.size();
+
+        vecOrder.push_back( vecPages[i] );
+        for( it = vecPageObjects[i].begin(); it != vecPageObjects[i].end(); ++it )
+        {
+            std::map<const PdfObject*, size_t>::const_iterator itPage = mapPage.find( *it );
+            if( itPage != mapPage.end() && (*itPage).second == i )
+                vecOrder.push_back( *it );
+        }
+
+        pLayout->vecPages[i].nObjects = static_cast<pdf_uint32>(vecOrder.size() - nStart);
+        pLayout->vecPages[i].nLength  = 0;
+    }
+
+    // Part 7: Objects used by more than one page
+    pLayout->nShared = vecOrder.size();
+    for( i = 1; i < vecPages.size(); i++ ) 
+    {
+        for( it = vecPageObjects[i].begin(); it != vecPageObjects[i].end(); ++it )
+        {
+            if( mapShared.count( *it ) || mapPage[*it] != nSharedPage )
+                continue;
+
+            mapShared[*it] = static_cast<pdf_uint32>(vecFirstPage.size() + vecOrder.size() - pLayout->nShared);
+            vecOrder.push_back( *it );
+        }
+    }
+
+    for( i = 1; i < vecPages.size(); i++ ) 
+    {
+        for( it = vecPageObjects[i].begin(); it != vecPageObjects[i].end(); ++it )
+        {
+            std::map<const PdfObject*, pdf_uint32>::const_iterator itShared = mapShared.find( *it );
+            if( itShared != mapShared.end() )
+                pLayout->vecPages[i].vecShared.push_back( (*itShared).second );
+        }
+    }
+
+    // Part 8: All other objects, including the pages tree
+    TSetLinearizedObjects setWritten( vecOrder.begin(), vecOrder.end() );
+    setWritten.insert( vecDocument.begin(), vecDocument.end() );
+    setWritten.insert( vecFirstPage.begin(), vecFirstPage.end() );
+    setWritten.insert( pLinearize );
+    setWritten.insert( pHint );
+
+    pLayout->nOther = vecOrder.size();
+    for( it = m_vecObjects->begin(); it != m_vecObjects->end(); ++it )
+    {
+        if( !setWritten.count( *it ) ) 
+            vecOrder.push_back( *it );
+    }
+
+    // The first page section
+    pLayout->nFirstPage = vecOrder.size();
+    vecOrder.push_back( pLinearize );
+    vecOrder.insert( vecOrder.end(), vecDocument.begin(), vecDocument.end() );
+
+    pLayout->nHint = vecOrder.size();
+    vecOrder.push_back( pHint );
+    vecOrder.insert( vecOrder.end(), vecFirstPage.begin(), vecFirstPage.end() );
+}
+
+void PdfWriter::WriteLinearizedObjects( PdfOutputDevice* pDevice, PdfObject* pLinearize, 
+                                        NonPublic::PdfHintStream* pHint, TLinearizedLayout & rLayout )
+{
+    const TVecObjects & vecOrder   = rLayout.vecOrder;
+    const size_t        nObjects   = vecOrder.size();
+    const size_t        nFirstPage = rLayout.nFirstPage;
+    const size_t        nHint      = rLayout.nHint;
+    const pdf_uint64    lBase      = pDevice->Tell();
+    size_t              i, j;
+
+    // The length of all objects is required for the offsets in the linearization 
+    // dictionary, the hint tables and the first trailer, which are written first.
+    // So all other objects are serialized into a buffer first, which is
+    // copied to pDevice afterwards, instead of serializing them twice.
+    PdfRefCountedBuffer     objects;
+    PdfOutputDevice         objectsDevice( &objects );
+    std::vector<pdf_uint64> vecStart( nObjects, 0 );
+    std::vector<pdf_uint64> vecLength( nObjects, 0 );
+    std::vector<pdf_uint64> vecOffset( nObjects, 0 );
+    for( i = 0; i < nObjects; i++ )
+    {
+        if( i == nFirstPage || i == nHint )
+            continue;
+
+        vecStart[i] = objectsDevice.Tell();
+        // Make sure that we do not encrypt the encryption dictionary!
+        vecOrder[i]->WriteObject( &objectsDevice, m_eWriteMode, (vecOrder[i] == m_pEncryptObj ? NULL : m_pEncrypt) );
+        vecLength[i] = objectsDevice.Tell() - vecStart[i];
+    }
+
+    objectsDevice.Flush();
+
+    PdfOutputDevice header;
+    WritePdfHeader( &header );
+
+    const pdf_uint64 lXRefFirstPage = GetLinearizedXRefLength( vecOrder, nFirstPage, nObjects );
+    const pdf_uint64 lXRefMain      = GetLinearizedXRefLength( vecOrder, 0, nFirstPage );
+
+    PdfOutputDevice xrefMainHeader;
+    xrefMainHeader.Print( "xref\n0 " );
+    xrefMainHeader.WriteInt( static_cast<pdf_int64>(nFirstPage) + 1 );
+
+    PdfObject  trailer;
+    PdfObject  mainTrailer;
+    pdf_uint64 lLinearizeReserved = 0;
+    pdf_uint64 lLinearizeLength   = 0;
+    pdf_uint64 lTrailerReserved   = 0;
+    pdf_uint64 lTrailerLength     = 0;
+    pdf_uint64 lEndOfFirstPage    = 0;
+    pdf_uint64 lMainXRef          = 0;
+    pdf_uint64 lFileLength        = 0;
+
+    // Both trailers contain the size of the whole XRef table,
+    // as some readers start with the main trailer
+    FillTrailerObject( &mainTrailer, static_cast<pdf_long>(nObjects) + 1, true );
+
+    // Space is reserved for the linearization dictionary and the first trailer,
+    // until the values calculated for this space fit into it
+    for( ;; ) 
+    {
+        // The offsets in the hint tables are calculated as if
+        // there was no hint stream
+        pdf_uint64 lOffset = lBase + header.GetLength();
+
+        vecOffset[nFirstPage] = lOffset;
+        lOffset += lLinearizeReserved + lXRefFirstPage + lTrailerReserved;
+
+        vecLength[nHint] = 0;
+        for( i = nFirstPage + 1; i < nObjects; i++ )
+        {
+            vecOffset[i]  = lOffset;
+            lOffset      += vecLength[i];
+        }
+
+        lEndOfFirstPage = lOffset;
+        for( i = 0; i < nFirstPage; i++ )
+        {
+            vecOffset[i]  = lOffset;
+            lOffset      += vecLength[i];
+        }
+
+        lMainXRef = lOffset;
+
+        rLayout.vecPages[0].nLength = static_cast<pdf_uint32>(lEndOfFirstPage - vecOffset[nHint + 1]);
+        for( i = 1, j = 0; i < rLayout.vecPages.size(); i++ ) 
+        {
+            const size_t nEnd = j + rLayout.vecPages[i].nObjects;
+
+            rLayout.vecPages[i].nLength = 0;
+            for( ; j < nEnd; j++ )
+                rLayout.vecPages[i].nLength += static_cast<pdf_uint32>(vecLength[j]);
+        }
+
+        std::vector<pdf_uint32> vecShared;
+        for( i = nHint + 1; i < nObjects; i++ )
+            vecShared.push_back( static_cast<pdf_uint32>(vecLength[i]) );
+        for( i = rLayout.nShared; i < rLayout.nOther; i++ )
+            vecShared.push_back( static_cast<pdf_uint32>(vecLength[i]) );
+
+        pHint->Create( rLayout.vecPages, static_cast<pdf_uint32>(vecOffset[nHint + 1]), 
+                       vecShared, static_cast<pdf_uint32>(nObjects - nHint - 1), 
+                       static_cast<pdf_uint32>(rLayout.nShared + 1), 
+                       static_cast<pdf_uint32>(rLayout.nShared < rLayout.nOther ? vecOffset[rLayout.nShared] : 0) );
+
+        // Move all objects following the hint stream
+        vecLength[nHint] = this->GetLinearizedObjectLength( pHint->GetObject() );
+        for( i = 0; i < nObjects; i++ ) 
+        {
+            if( i < nFirstPage || i > nHint )
+                vecOffset[i] += vecLength[nHint];
+        }
+
+        lEndOfFirstPage += vecLength[nHint];
+        lMainXRef       += vecLength[nHint];
+
+        PdfOutputDevice mainTrailerLength;
+        WriteLinearizedTrailer( &mainTrailerLength, mainTrailer, m_eWriteMode, 
+                                vecOffset[nFirstPage] + lLinearizeReserved, 0 );
+
+        lFileLength = lMainXRef + lXRefMain + mainTrailerLength.GetLength();
+
+        PdfArray hints;
+        hints.push_back( static_cast<pdf_int64>(vecOffset[nHint]) );
+        hints.push_back( static_cast<pdf_int64>(vecLength[nHint]) );
+
+        PdfDictionary & rLinearize = pLinearize->GetDictionary();
+        rLinearize.AddKey( "Linearized", 1.0 );
+        rLinearize.AddKey( "L", static_cast<pdf_int64>(lFileLength) );
+        rLinearize.AddKey( "H", hints );
+        rLinearize.AddKey( "O", static_cast<pdf_int64>(vecOrder[nHint + 1]->Reference().ObjectNumber()) );
+        rLinearize.AddKey( "E", static_cast<pdf_int64>(lEndOfFirstPage) );
+        rLinearize.AddKey( "N", static_cast<pdf_int64>(rLayout.vecPages.size()) );
+        rLinearize.AddKey( "T", static_cast<pdf_int64>(lMainXRef + xrefMainHeader.GetLength()) );
+        lLinearizeLength = this->GetLinearizedObjectLength( pLinearize );
+
+        // The first trailer contains all keys
+        FillTrailerObject( &trailer, static_cast<pdf_long>(nObjects) + 1, false );
+        trailer.GetDictionary().AddKey( "Prev", static_cast<pdf_int64>(lMainXRef) );
+
+        PdfOutputDevice trailerLength;
+        WriteLinearizedTrailer( &trailerLength, trailer, m_eWriteMode, 0, 0 );
+        lTrailerLength = trailerLength.GetLength();
+
+        if( lLinearizeLength <= lLinearizeReserved && lTrailerLength <= lTrailerReserved )
+            break;
+
+        lLinearizeReserved = PDF_MAX( lLinearizeReserved, lLinearizeLength );
+        lTrailerReserved   = PDF_MAX( lTrailerReserved, lTrailerLength );
+    }
+
+    WritePdfHeader( pDevice );
+
+    // The linearization dictionary is padded before "endobj"
+    {
+        PdfRefCountedBuffer buffer;
+        PdfOutputDevice     device( &buffer );
+
+        pLinearize->WriteObject( &device, m_eWriteMode, NULL );
+        device.Flush();
+
+        const pdf_long lEndObj = 7; // strlen("endobj\n")
+        const pdf_long lLength = static_cast<pdf_long>(device.GetLength());
+
+        CheckLinearizedOffset( pDevice, vecOffset[nFirstPage] );
+        pDevice->Write( buffer.GetBuffer(), lLength - lEndObj );
+        WriteLinearizationPadding( pDevice, lLinearizeReserved - lLinearizeLength );
+        pDevice->Write( buffer.GetBuffer() + lLength - lEndObj, lEndObj );
+    }
+
+    PdfXRef xrefFirstPage;
+    for( i = nFirstPage; i < nObjects; i++ )
+        xrefFirstPage.AddObject( vecOrder[i]->Reference(), vecOffset[i], true );
+
+    xrefFirstPage.Write( pDevice );
+    WriteLinearizedTrailer( pDevice, trailer, m_eWriteMode, 0, lTrailerReserved - lTrailerLength );
+
+    for( i = nFirstPage + 1; i < nObjects; i++ )
+    {
+        CheckLinearizedOffset( pDevice, vecOffset[i] );
+        if( i == nHint )
+            vecOrder[i]->WriteObject( pDevice, m_eWriteMode, m_pEncrypt );
+        else
+            pDevice->Write( objects.GetBuffer() + vecStart[i], static_cast<pdf_long>(vecLength[i]) );
+    }
+
+    CheckLinearizedOffset( pDevice, lEndOfFirstPage );
+    for( i = 0; i < nFirstPage; i++ )
+    {
+        CheckLinearizedOffset( pDevice, vecOffset[i] );
+        pDevice->Write( objects.GetBuffer() + vecStart[i], static_cast<pdf_long>(vecLength[i]) );
+    }
+
+    PdfXRef xrefMain;
+    for( i = 0; i < nFirstPage; i++ )
+        xrefMain.AddObject( vecOrder[i]->Reference(), vecOffset[i], true );
+
+    CheckLinearizedOffset( pDevice, lMainXRef );
+    xrefMain.Write( pDevice );
+    WriteLinearizedTrailer( pDevice, mainTrailer, m_eWriteMode, vecOffset[nFirstPage] + lLinearizeReserved, 0 );
+    CheckLinearizedOffset( pDevice, lFileLength );
+}
+
+pdf_uint64 PdfWriter::GetLinearizedObjectLength( const PdfObject* pObject ) const
+{
+    PdfOutputDevice length;
+
+    // Make sure that we do not encrypt the encryption dictionary!
+    pObject->WriteObject( &length, m_eWriteMode, (pObject == m_pEncryptObj ? NULL : m_pEncrypt) );
+    return length.GetLength();
 }
 
 void PdfWriter::WritePdfHeader( PdfOutputDevice* pDevice )
@@ -357,12 +1118,64 @@ void PdfWriter::WritePdfHeader( PdfOutputDevice* pDevice )
 
 void PdfWriter::WritePdfObjects( PdfOutputDevice* pDevice, const PdfVecObjects& vecObjects, PdfXRef* pXref, bool bRewriteXRefTable )
 {
-    TCIVecObjects itObjects, itObjectsEnd = vecObjects.end();
+    // Writing a stream may look up its /Length in an object, which is loaded 
+    // on demand and added to vecObjects. This invalidates all iterators of 
+    // vecObjects, so iterate over a copy and load everything written beforehand.
+    const TVecObjects vecAll( vecObjects.begin(), vecObjects.end() );
+    TVecObjects       vecWrite;
+    TCIVecObjects     itObjects, itObjectsEnd = vecAll.end();
+    std::vector<TCompressedObject>::const_iterator itCompressed = m_vecCompressedObjects.begin();
+
+    for( itObjects = vecAll.begin(); itObjects != itObjectsEnd; ++itObjects )
+    {
+        PdfObject *pObject = *itObjects;
+
+        if( itCompressed != m_vecCompressedObjects.end() && (*itCompressed).pObject == pObject )
+        {
+            ++itCompressed;
+            continue;
+        }
 
-    for( itObjects = vecObjects.begin(); itObjects !=  itObjectsEnd; ++itObjects )
+        if( m_bIncrementalUpdate && !pObject->IsDirty() )
+            continue;
+
+        vecWrite.push_back( pObject );
+    }
+
+    for( itObjects = vecWrite.begin(); itObjects != vecWrite.end(); ++itObjects )
+    {
+        // Make sure that we do not encrypt the encryption dictionary!
+        (*itObjects)->LoadForWrite( *itObjects == m_pEncryptObj ? NULL : m_pEncrypt );
+    }
+
+    itCompressed = m_vecCompressedObjects.begin();
+
+#if defined(PODOFO_MULTI_THREAD)
+    PODOFO_UNIQUEU_PTR<PdfObjectSerializer> pSerializer;
+
+    if( m_nWriteThreads > 1 )
+    {
+        // Objects are looked up from several threads while writing,
+        // so the list must not be sorted on demand
+        m_vecObjects->Sort();
+
+        pSerializer.reset( new PdfObjectSerializer( vecWrite, m_eWriteMode, m_pEncrypt, m_pEncryptObj ) );
+        pSerializer->Start( m_nWriteThreads );
+    }
+#endif // PODOFO_MULTI_THREAD
+
+    for( itObjects = vecAll.begin(); itObjects != itObjectsEnd; ++itObjects )
     {
         PdfObject *pObject = *itObjects;
 
+        // Objects in object streams were written along with the object stream
+        if( itCompressed != m_vecCompressedObjects.end() && (*itCompressed).pObject == pObject )
+        {
+            pXref->AddCompressedObject( pObject->Reference(), (*itCompressed).nObjectStream, (*itCompressed).nIndex );
+            ++itCompressed;
+            continue;
+        }
+
 	if( m_bIncrementalUpdate )
         {
             if( !pObject->IsDirty() )
@@ -390,6 +1203,14 @@ void PdfWriter::WritePdfObjects( PdfOutputDevice* pDevice, const PdfVecObjects&
 
         pXref->AddObject( pObject->Reference(), pDevice->Tell(), true );
 
+#if defined(PODOFO_MULTI_THREAD)
+        if( pSerializer.get() )
+        {
+            pSerializer->WriteNext( pObject, pDevice );
+            continue;
+        }
+#endif // PODOFO_MULTI_THREAD
+
         // Make sure that we do not encrypt the encryption dictionary!
         pObject->WriteObject( pDevice, m_eWriteMode, 
                               (pObject == m_pEncryptObj ? NULL : m_pEncrypt) );
@@ -402,6 +1223,134 @@ void PdfWriter::WritePdfObjects( PdfOutputDevice* pDevice, const PdfVecObjects&
     }
 }
 
+/** Check whether an object has a stream, without loading 
+ *  the stream of objects read from a file.
+ */
+static bool HasStreamNoLoad( const PdfObject* pObject )
+{
+    // Streams always belong to dictionaries
+    if( !pObject->IsDictionary() )
+        return false;
+
+    const PdfParserObject* pParserObject = dynamic_cast<const PdfParserObject*>(pObject);
+    if( pParserObject && pParserObject->HasStreamToParse() )
+        return true;
+
+    return pObject->HasStream();
+}
+
+void PdfWriter::CreateObjectStreams( const PdfVecObjects& vecObjects )
+{
+    TCIVecObjects           itObjects, itObjectsEnd = vecObjects.end();
+    TVecObjects             vecPacked;
+    pdf_objnum              nObjectStream = static_cast<pdf_objnum>(m_vecObjects->GetObjectCount());
+    pdf_uint32              nIndex        = 0;
+    PdfRefCountedBuffer     header;
+    PdfRefCountedBuffer     body;
+    PdfOutputDevice         deviceHeader( &header );
+    PdfOutputDevice         deviceBody( &body );
+
+    // Collect the objects first, as adding object streams to
+    // m_vecObjects invalidates all iterators of vecObjects
+    for( itObjects = vecObjects.begin(); itObjects != itObjectsEnd; ++itObjects )
+    {
+        PdfObject* pObject = *itObjects;
+
+        // Only objects which are written at all can be packed, but neither
+        // streams, the encryption dictionary nor objects with a
+        // generation number other than 0
+        if( (m_bIncrementalUpdate && !pObject->IsDirty())
+            || pObject == m_pEncryptObj
+            || pObject->Reference().GenerationNumber() != 0 
+            || HasStreamNoLoad( pObject ) )
+            continue;
+
+        vecPacked.push_back( pObject );
+    }
+
+    m_vecCompressedObjects.reserve( vecPacked.size() );
+
+    TCIVecObjects itPacked = vecPacked.begin();
+    while( itPacked != vecPacked.end() )
+    {
+        const PdfObject* pObject = *itPacked;
+
+        deviceHeader.WriteInt( pObject->Reference().ObjectNumber() );
+        deviceHeader.Write( " ", 1 );
+        deviceHeader.WriteInt( static_cast<pdf_int64>(deviceBody.Tell()) );
+        deviceHeader.Write( " ", 1 );
+
+        // Do not encrypt the object, as the object stream is encrypted as a whole
+        pObject->Write( &deviceBody, m_eWriteMode, NULL );
+        deviceBody.Write( "\n", 1 );
+
+        TCompressedObject compressed;
+        compressed.pObject       = pObject;
+        compressed.nObjectStream = nObjectStream;
+        compressed.nIndex        = nIndex;
+        m_vecCompressedObjects.push_back( compressed );
+
+        ++itPacked;
+        if( ++nIndex == m_nObjectStreamSize || itPacked == vecPacked.end() )
+        {
+            TVecFilters vecFilters;
+            vecFilters.push_back( ePdfFilter_FlateDecode );
+
+            // Add the object stream first, so that it can create its stream
+            PdfObject* pStream = new PdfObject( PdfReference( nObjectStream, 0 ), "ObjStm" );
+            m_vecObjects->push_back( pStream );
+            m_vecObjectStreams.push_back( pStream->Reference() );
+
+            pStream->GetDictionary().AddKey( "N", static_cast<pdf_int64>(nIndex) );
+            pStream->GetDictionary().AddKey( "First", static_cast<pdf_int64>(deviceHeader.Tell()) );
+
+            pStream->GetStream()->BeginAppend( vecFilters );
+            pStream->GetStream()->Append( header.GetBuffer(), deviceHeader.Tell() );
+            pStream->GetStream()->Append( body.GetBuffer(), deviceBody.Tell() );
+            pStream->GetStream()->EndAppend();
+
+            deviceHeader.Seek( 0 );
+            deviceBody.Seek( 0 );
+            nIndex = 0;
+            ++nObjectStream;
+        }
+    }
+}
+
+void PdfWriter::ClearObjectStreams( size_t nObjectCount, PdfXRef* pXRef )
+{
+    std::vector<PdfReference>::const_iterator it = m_vecObjectStreams.begin();
+    while( it != m_vecObjectStreams.end() )
+    {
+        delete m_vecObjects->RemoveObject( *it, false );
+        ++it;
+    }
+
+    m_vecObjectStreams.clear();
+    m_vecCompressedObjects.clear();
+
+    PdfXRefStream* pXRefStream = dynamic_cast<PdfXRefStream*>(pXRef);
+    if( pXRefStream )
+    {
+        // An object number taken from the free list is returned to it
+        const PdfReference ref = pXRefStream->GetObject()->Reference();
+        delete m_vecObjects->RemoveObject( ref, ref.ObjectNumber() < nObjectCount );
+    }
+
+    // Only lower the object count if no other object got a new number meanwhile
+    if( m_vecObjects->GetObjectCount() > nObjectCount )
+    {
+        m_vecObjects->Sort();
+
+        const TPdfReferenceList & lstFree = m_vecObjects->GetFreeObjects();
+        if( (!m_vecObjects->GetSize() || m_vecObjects->GetBack()->Reference().ObjectNumber() < nObjectCount)
+            && (lstFree.empty() || lstFree.back().ObjectNumber() < nObjectCount) )
+        {
+            m_vecObjects->m_nObjectCount = nObjectCount;
+        }
+    }
+}
+
 void PdfWriter::GetByteOffset( PdfObject* pObject, pdf_long* pulOffset )
 {
     TCIVecObjects   it     = m_vecObjects->begin();
@@ -428,13 +1377,16 @@ void PdfWriter::GetByteOffset( PdfObject* pObject, pdf_long* pulOffset )
 
 void PdfWriter::WriteToBuffer( char** ppBuffer, pdf_long* pulLen )
 {
-    PdfOutputDevice device;
+    PdfRefCountedBuffer buffer;
+    PdfOutputDevice     device( &buffer );
 
-    if( !pulLen )
+    if( !ppBuffer || !pulLen )
     {
         PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
     }
 
+    // Write the document only once and copy the result,
+    // instead of measuring its length in a separate pass
     this->Write( &device );
 
     *pulLen = device.GetLength();
@@ -444,130 +1396,16 @@ void PdfWriter::WriteToBuffer( char** ppBuffer, pdf_long* pulLen )
         PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
     }
 
-    PdfOutputDevice memDevice( *ppBuffer, *pulLen );
-    this->Write( &memDevice );
+    memcpy( *ppBuffer, buffer.GetBuffer(), *pulLen );
 }
 
-/*
-PdfObject* PdfWriter::CreateLinearizationDictionary()
-{
-    PdfObject*       pLinearize        = m_vecObjects->CreateObject();
-
-    // This will be overwritten later with valid data!
-    PdfVariant place_holder( PdfData( LINEARIZATION_PADDING ) );
-
-    PdfArray array;
-    array.push_back( place_holder );
-    array.push_back( place_holder );
-
-    pLinearize->GetDictionary().AddKey( "Linearized", 1.0 );  // Version
-    pLinearize->GetDictionary().AddKey( "L", place_holder );  // File length
-    pLinearize->GetDictionary().AddKey( "H", array );         // Hint stream offset and length as PdfArray
-    pLinearize->GetDictionary().AddKey( "E", place_holder );  // Offset of end of first page
-    pLinearize->GetDictionary().AddKey( "N",                  // Number of pages in the document 
-                                        static_cast<pdf_int64>(m_pPagesTree->GetTotalNumberOfPages()) );             
-    pLinearize->GetDictionary().AddKey( "O", place_holder );  // Object number of the first page
-    pLinearize->GetDictionary().AddKey( "T", place_holder );  // Offset of first entry in main cross reference table
-
-    return pLinearize;
-    }*/
-
-/*
-void PdfWriter::ReorderObjectsLinearized( PdfObject* pLinearize, NonPublic::PdfHintStream* pHint, PdfPage* pPage, PdfObject** ppLast ) 
-{
-    TPdfReferenceList   lstLinearizedGroup;
-    TPdfReferenceSet    setLinearizedGroup;
-    TCIPdfReferenceList it;
-    TIVecObjects        itObjects;
-    PdfObject*          pRoot;
-    PdfObject*          pTmp = NULL;
-    size_t        index, i;
-
-    // get the dependend objects that are required to display
-    // the first page. I.e. get all objects that have to be written
-    // at the start of the file.
-    // Add all depencies to lstLinearizedGroup
-    m_vecObjects->GetObjectDependencies( pPage->GetObject(), &lstLinearizedGroup );
-
-    // get the root dictionary, it has to be written at the top of the file too.
-    pRoot = m_vecObjects->GetObject( m_pTrailer->GetDictionary().GetKey( "Root" )->GetReference() );
-    // add the root dictionary
-    lstLinearizedGroup.push_back( pRoot->Reference() );
-    // add the first page itself
-    lstLinearizedGroup.push_back( pPage->GetObject()->Reference() );
-
-    // add several dependencies of the root dictionary
-    this->FindCatalogDependencies( pRoot, "ViewerPreferences", &lstLinearizedGroup, true );
-    this->FindCatalogDependencies( pRoot, "PageMode", &lstLinearizedGroup, true );
-    this->FindCatalogDependencies( pRoot, "Threads", &lstLinearizedGroup, false );
-    this->FindCatalogDependencies( pRoot, "OpenAction", &lstLinearizedGroup, true );
-    this->FindCatalogDependencies( pRoot, "AcroForm", &lstLinearizedGroup, false );
-    this->FindCatalogDependencies( pRoot, "Encrypt", &lstLinearizedGroup, true );
-
-    // add the hint stream
-    lstLinearizedGroup.push_back( pHint->GetObject()->Reference() );
-    // add the linearization dictionary
-    lstLinearizedGroup.push_back( pLinearize->Reference() );
-
-
-    // move all objects which are required to display the first page
-    // at the front of the vector of objects.
-    // We only swap objects inside of the vector to avoid reallocations.
-    // This is a fast operation therefore
-    i  = m_vecObjects->GetSize()-1;
-    it = lstLinearizedGroup.begin();
-
-    while( it != lstLinearizedGroup.end() )
-    {
-        index = m_vecObjects->GetIndex( *it );
-
-        if( index < i ) 
-        {
-            pTmp                   = (*m_vecObjects)[index];
-            (*m_vecObjects)[index] = (*m_vecObjects)[i];
-            (*m_vecObjects)[i]     = pTmp;
-        }
-
-        i--;
-        ++it;
-    }
-
-    // Renumber all objects according to their position in the vector.
-    // This is the slowest (only slow) operation when creating a 
-    // linearized PDF file. Garbage collection goes along with this step.
-    std::copy( lstLinearizedGroup.begin(), lstLinearizedGroup.end(), std::inserter(setLinearizedGroup, setLinearizedGroup.begin()) );
-    m_vecObjects->RenumberObjects( m_pTrailer, &setLinearizedGroup );
-
-    // reorder the objects in the file
-    itObjects = m_vecObjects->begin();
-    itObjects += m_vecObjects->GetSize() - setLinearizedGroup.size();
-    m_vecObjects->RemoveObject( itObjects );
-
-    while( itObjects != m_vecObjects->end() )
-    {
-        m_vecLinearized.push_back( *itObjects );
-        // reset the owner
-        (*itObjects)->SetOwner( m_vecObjects );
-        m_vecObjects->RemoveObject( itObjects ); 
-    }
-    
-    *ppLast = m_vecLinearized.GetBack();
-    }*/
-
- /*
-void PdfWriter::FindCatalogDependencies( PdfObject* pCatalog, const PdfName & rName, TPdfReferenceList* pList, bool bWithDependencies )
-{
-    if( pCatalog->GetDictionary().HasKey( rName ) && pCatalog->GetDictionary().GetKey( rName )->IsReference() )
-    {
-        if( bWithDependencies )
-            m_vecObjects->GetObjectDependencies( pCatalog->GetIndirectKey( rName ), pList );
-        else
-            pList->push_back( pCatalog->GetIndirectKey( rName )->Reference() );
-    }
-    }*/
-
 void PdfWriter::FillTrailerObject( PdfObject* pTrailer, pdf_long lSize, bool bOnlySizeKey ) const
 {
+    // An incremental update may contain only a few low object numbers,
+    // but the size refers to the XRef table of the whole file
+    if( m_bIncrementalUpdate && lSize < static_cast<pdf_long>(m_vecObjects->GetObjectCount()) )
+        lSize = static_cast<pdf_long>(m_vecObjects->GetObjectCount());
+
     pTrailer->GetDictionary().AddKey( PdfName::KeySize, static_cast<pdf_int64>(lSize) );
 
     if( !bOnlySizeKey ) 
@@ -611,71 +1449,6 @@ void PdfWriter::FillTrailerObject( PdfObject* pTrailer, pdf_long lSize, bool bOn
     }
 }
 
-/*
-void PdfWriter::FetchPagesTree() 
-{
-    if( !m_pPagesTree )
-    {
-        // try to find the pages tree
-        PdfObject* pRoot = m_pTrailer->GetDictionary().GetKey( "Root" );
-
-        if( !pRoot || !pRoot->IsReference() )
-        {
-            PODOFO_RAISE_ERROR( ePdfError_InvalidDataType );
-        }
-
-        //printf("Fetching: %lu\n", pRoot->GetReference().ObjectNumber() );
-        //printf("Size    : %i\n", static_cast<int>(m_vecObjects->GetSize()) );
-        pRoot            = m_vecObjects->GetObject( pRoot->GetReference() );
-        if( !pRoot ) 
-        {
-            PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
-        }
-
-        m_pPagesTree     = new PdfPagesTree( pRoot->GetIndirectKey( "Pages" ) );
-    }
-}
-*/
-
-/*
-void PdfWriter::FillLinearizationDictionary( PdfObject* pLinearize, PdfOutputDevice* pDevice, PdfPage* pPage, PdfObject* pLast, 
-NonPublic::PdfHintStream* pHint, TVecXRefOffset* pVecXRefOffset )
-{
-    long            lFileSize        = pDevice->GetLength();
-    PdfVariant      value( 0l );
-    PdfArray        hints;
-    PdfObject       trailer;
-
-    value.SetPaddingLength( LINEARIZATION_PADDING );
-
-    value.SetNumber( lFileSize );
-    pLinearize->GetDictionary().AddKey( "L", value );
-    value.SetNumber( pPage->GetObject()->Reference().ObjectNumber() );
-    pLinearize->GetDictionary().AddKey( "O", value );
-    value.SetNumber( m_lFirstInXRef );
-    pLinearize->GetDictionary().AddKey( "T", value );
-    value.SetNumber( m_lLinearizedLastOffset + pLast->GetObjectLength() );
-    pLinearize->GetDictionary().AddKey( "E", value );
-
-    value.SetNumber( m_lLinearizedOffset + pLinearize->GetObjectLength() );
-    hints.push_back( value );
-    value.SetNumber( pHint->GetObject()->GetObjectLength() );
-    hints.push_back( value );
-    pLinearize->GetDictionary().AddKey( "H", hints );
-
-    pDevice->Seek( m_lLinearizedOffset );
-    pLinearize->WriteObject( pDevice );
-    pDevice->Seek( lFileSize );
-
-    m_lPrevXRefOffset = pVecXRefOffset->back();
-    FillTrailerObject( &trailer, pLast->Reference().ObjectNumber()+1, false );
-
-    pDevice->Seek( m_lTrailerOffset );
-    trailer.WriteObject( pDevice );
-    pDevice->Seek( lFileSize );
-}
-*/
-
 void PdfWriter::CreateFileIdentifier( PdfString & identifier, const PdfObject* pTrailer, PdfString* pOriginalIdentifier ) const
 {
     PdfOutputDevice length;
@@ -65,6 +65,10 @@ namespace NonPublic { class PdfHintStream; }
 class PODOFO_API PdfWriter {
 
  public:
+    enum {
+        DEFAULT_OBJECT_STREAM_SIZE = 100 ///< Default number of objects packed into one object stream
+    };
+
     /** Create a PdfWriter object from a PdfParser object
      *  \param pParser a pdf parser object
      */
@@ -145,6 +149,15 @@ class PODOFO_API PdfWriter {
 
     /** Enabled linearization for this document.
      *  I.e. optimize it for web usage. Default is false.
+     *
+     *  A linearized file starts with the objects required to display
+     *  the first page and contains hint tables, so that a viewer 
+     *  can display any page before the whole file is loaded.
+     *  All objects are renumbered in the written file.
+     *
+     *  Linearized files cannot be written as incremental update or 
+     *  with XRef streams or object streams.
+     *
      *  \param bLinearize if true create a web optimized PDF file
      */
     inline void SetLinearized( bool bLinearize );
@@ -166,6 +179,60 @@ class PODOFO_API PdfWriter {
      */
     inline bool GetUseXRefStream() const;
 
+    /** Pack all objects which are no streams into compressed
+     *  object streams. This makes documents consisting of many
+     *  small objects a lot smaller, but requires at least PDF 1.5
+     *  and a XRef stream, which is enabled as well.
+     *  Default is false.
+     *
+     *  Objects with a generation number other than 0 and the
+     *  encryption dictionary are always written as normal objects.
+     *
+     *  \param bUse if true objects are written to object streams
+     *
+     *  \see SetObjectStreamSize
+     */
+    inline void SetUseObjectStreams( bool bUse );
+
+    /** 
+     *  \returns whether objects are packed into object streams
+     */
+    inline bool GetUseObjectStreams() const;
+
+    /** Set the maximum number of objects in a single object stream.
+     *  Larger object streams compress better, while smaller ones
+     *  are faster to access for a reader.
+     *  Default is DEFAULT_OBJECT_STREAM_SIZE.
+     *
+     *  \param nObjects maximum number of objects per object stream, has to be greater than 0
+     */
+    inline void SetObjectStreamSize( pdf_uint32 nObjects );
+
+    /** 
+     *  \returns the maximum number of objects in a single object stream
+     */
+    inline pdf_uint32 GetObjectStreamSize() const;
+
+    /** Set the number of threads which serialize and encrypt
+     *  objects while writing. The calling thread appends the
+     *  serialized objects in their original order, so the written
+     *  file is the same as when writing from a single thread.
+     *
+     *  The objects must not be modified by other threads while writing.
+     *  Objects loaded on demand are loaded by the calling thread before
+     *  the other threads start, see PdfObject::LoadForWrite().
+     *  Default is 1, i.e. all objects are written by the calling thread.
+     *  Without multi-thread support in PoDoFo, this setting has no effect.
+     *
+     *  \param nThreads number of threads serializing objects
+     */
+    inline void SetWriteThreads( int nThreads );
+
+    /** 
+     *  \returns the number of threads serializing objects
+     */
+    inline int GetWriteThreads() const;
+
     /** Sets an offset to the previous XRef table. Set it to lower than
      *  or equal to 0, to not write a reference to the previous XRef table.
      *  The default is 0.
@@ -275,54 +342,71 @@ class PODOFO_API PdfWriter {
      */ 
     void Write( PdfOutputDevice* pDevice, bool bRewriteXRefTable );
 
+    /** Pack all objects of vecObjects, which can be stored in object streams,
+     *  into new object stream objects. These are added to m_vecObjects
+     *  and written like all other objects by WritePdfObjects, which adds
+     *  the packed objects to the XRef table instead of writing them.
+     *
+     *  Call ClearObjectStreams after writing, even if an error occurred.
+     *
+     *  \param vecObjects pack objects from this vector
+     */
+    void CreateObjectStreams( const PdfVecObjects& vecObjects ) PODOFO_LOCAL;
+
+    /** Remove the object streams created by CreateObjectStreams and the
+     *  object of an XRef stream from m_vecObjects, so that the objects
+     *  are left as they were before writing.
+     *
+     *  \param nObjectCount the object count of m_vecObjects before writing,
+     *         it is restored so that the object numbers are used again
+     *  \param pXRef the XRef table written or NULL
+     */
+    void ClearObjectStreams( size_t nObjectCount, PdfXRef* pXRef ) PODOFO_LOCAL;
+
  protected:
     /** Writes a linearized PDF file
      *  \param pDevice write to this output device
      */       
     void PODOFO_LOCAL WriteLinearized( PdfOutputDevice* pDevice );
 
-    /** Create a linearization dictionary for the current
-     *  document and return a pointer to it after inserting
-     *  it into the vector of PdfObjects
-     *
-     *  \returns a pointer to the linearization dictionary
-     */
-    PdfObject* CreateLinearizationDictionary() PODOFO_LOCAL;
+ private:
+    struct TLinearizedLayout;
 
-    /** Reorder and renumber all object as required for linearized PDF files.
-     *  This function is very slow.
+    /** Sort all objects into the parts of a linearized PDF file,
+     *  in the order in which they are numbered and written.
      *
      *  \param pLinearize linearization dictionary
-     *  \param pHint primary hint stream dictionary
-     *  \param pPage first page to display in the document
-     *  \param ppLast the pointer will be initialized to the last object
-     *         belonging to the first page
-     */
-    //void ReorderObjectsLinearized( PdfObject* pLinearize, NonPublic::PdfHintStream* pHint, PdfPage* pPage, PdfObject** ppLast ) PODOFO_LOCAL;
-
-    /** Initialize m_pPagesTree with its correct value
-     *  Always call this function before accessing the pages tree.
+     *  \param pHint primary hint stream
+     *  \param pLayout the order of all objects and the pages is stored here
      */
-    //void FetchPagesTree();
+    void ReorderObjectsLinearized( PdfObject* pLinearize, PdfObject* pHint, TLinearizedLayout* pLayout ) PODOFO_LOCAL;
 
-    /** Find dependencies required for creating a linearized PDF of the catalog dictionary.
+    /** Write all objects of a linearized PDF file, after they have been
+     *  renumbered according to rLayout.
+     *
+     *  The linearization dictionary, the hint stream and the first trailer 
+     *  depend on the offsets of all objects, therefore the length of all 
+     *  objects is calculated before anything is written.
+     *
+     *  \param pDevice write to this output device
+     *  \param pLinearize linearization dictionary
+     *  \param pHint primary hint stream
+     *  \param rLayout the order of all objects as created by ReorderObjectsLinearized
      */
-    //void FindCatalogDependencies( PdfObject* pCatalog, const PdfName & rName, TPdfReferenceList* pList, bool bWithDependencies ) PODOFO_LOCAL;
+    void WriteLinearizedObjects( PdfOutputDevice* pDevice, PdfObject* pLinearize, 
+                                 NonPublic::PdfHintStream* pHint, TLinearizedLayout & rLayout ) PODOFO_LOCAL;
 
-    /** Fill all keys in the linearization dictionary with their values
-     *  \param pLinearize a linearization dictionary
-     *  \param pHint the hint stream
-     *  \param pPage the first page in the linearized PDF file
-     *  \param pLast pointer of the last object belonging to the first page
-     *  \param pVecXRefOffset xref table entries for previous entry
+    /** \returns the length of an object as written by WriteLinearizedObjects
      */
-    // void FillLinearizationDictionary( PdfObject* pLinearize, PdfOutputDevice* pDevice, PdfPage* pPage, PdfObject* pLast, NonPublic::PdfHintStream* pHint, TVecXRefOffset* pVecXRefOffset ) PODOFO_LOCAL;
+    pdf_uint64 GetLinearizedObjectLength( const PdfObject* pObject ) const PODOFO_LOCAL;
 
  protected:
     PdfVecObjects*  m_vecObjects;
     PdfObject*      m_pTrailer;
 
     bool            m_bXRefStream;
+    bool            m_bObjectStreams;
+    pdf_uint32      m_nObjectStreamSize;
 
     PdfEncrypt*     m_pEncrypt;    ///< If not NULL encrypt all strings and streams and create an encryption dictionary in the trailer
     PdfObject*      m_pEncryptObj; ///< Used to temporarily store the encryption dictionary
@@ -335,21 +419,20 @@ class PODOFO_API PdfWriter {
     EPdfVersion     m_eVersion;
     pdf_int64       m_lPrevXRefOffset;
     bool            m_bIncrementalUpdate;
+    int             m_nWriteThreads;
 
     bool            m_bLinearized;
- 
-    /**
-     * This value is required when writing
-     * a linearized PDF file.
-     * It represents the offset of the whitespace
-     * character before the first line in the XRef
-     * section.
-     */
-    size_t            m_lFirstInXRef;
-    size_t            m_lLinearizedOffset;
-    size_t            m_lLinearizedLastOffset;
-    size_t            m_lTrailerOffset;
-    PdfVecObjects   m_vecLinearized;
+
+    /** An object which was packed into an object stream
+     */
+    struct TCompressedObject {
+        const PdfObject* pObject;
+        pdf_objnum       nObjectStream;
+        pdf_uint32       nIndex;
+    };
+
+    std::vector<TCompressedObject> m_vecCompressedObjects; ///< Packed objects in the order of m_vecObjects
+    std::vector<PdfReference>      m_vecObjectStreams;     ///< Object streams added to m_vecObjects
 };
 
 // -----------------------------------------------------
@@ -386,6 +469,61 @@ bool PdfWriter::GetUseXRefStream() const
     return m_bXRefStream;
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+void PdfWriter::SetUseObjectStreams( bool bUse )
+{
+    if( bUse )
+        this->SetUseXRefStream( true );
+    m_bObjectStreams = bUse;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+bool PdfWriter::GetUseObjectStreams() const
+{
+    return m_bObjectStreams;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+void PdfWriter::SetObjectStreamSize( pdf_uint32 nObjects )
+{
+    if( !nObjects )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_ValueOutOfRange );
+    }
+
+    m_nObjectStreamSize = nObjects;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+pdf_uint32 PdfWriter::GetObjectStreamSize() const
+{
+    return m_nObjectStreamSize;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+void PdfWriter::SetWriteThreads( int nThreads )
+{
+    m_nWriteThreads = nThreads;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+int PdfWriter::GetWriteThreads() const
+{
+    return m_nWriteThreads;
+}
+
 // -----------------------------------------------------
 // 
 // -----------------------------------------------------
@@ -104,14 +104,28 @@ PdfXRef::~PdfXRef()
 }
 
 void PdfXRef::AddObject( const PdfReference & rRef, pdf_uint64 offset, bool bUsed )
+{
+    this->AddItem( PdfXRef::TXRefItem( rRef, offset ), bUsed );
+}
+
+void PdfXRef::AddCompressedObject( const PdfReference & rRef, pdf_objnum nObjectStream, pdf_uint32 nIndex )
+{
+    if( !nObjectStream || rRef.GenerationNumber() )
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Only objects with generation 0 can be stored in an object stream." );
+    }
+
+    this->AddItem( PdfXRef::TXRefItem( rRef, nIndex, nObjectStream ), true );
+}
+
+void PdfXRef::AddItem( const TXRefItem & rItem, bool bUsed )
 {
     TIVecXRefBlock     it = m_vecBlocks.begin();
-    PdfXRef::TXRefItem item( rRef, offset );
     bool               bInsertDone = false;
 
     while( it != m_vecBlocks.end() )
     {
-        if( (*it).InsertItem( item, bUsed ) )
+        if( (*it).InsertItem( rItem, bUsed ) )
         {
             bInsertDone = true;
             break;
@@ -123,12 +137,12 @@ void PdfXRef::AddObject( const PdfReference & rRef, pdf_uint64 offset, bool bUse
     if( !bInsertDone ) 
     {
         PdfXRefBlock block;
-        block.m_nFirst = rRef.ObjectNumber();
+        block.m_nFirst = rItem.reference.ObjectNumber();
         block.m_nCount = 1;
         if( bUsed )
-            block.items.push_back( item );
+            block.items.push_back( rItem );
         else
-            block.freeItems.push_back( rRef );
+            block.freeItems.push_back( rItem.reference );
 
         m_vecBlocks.push_back( block );
         std::sort( m_vecBlocks.begin(), m_vecBlocks.end() );
@@ -187,8 +201,12 @@ void PdfXRef::Write( PdfOutputDevice* pDevice )
                 ++itFree;
             }
 
-            this->WriteXRefEntry( pDevice, (*itItems).offset, (*itItems).reference.GenerationNumber(), 'n', 
-                                  (*itItems).reference.ObjectNumber()  );
+            if( (*itItems).objectStream )
+                this->WriteCompressedXRefEntry( pDevice, (*itItems).objectStream, 
+                                                static_cast<pdf_uint32>((*itItems).offset) );
+            else
+                this->WriteXRefEntry( pDevice, (*itItems).offset, (*itItems).reference.GenerationNumber(), 'n', 
+                                      (*itItems).reference.ObjectNumber()  );
             ++itItems;
         }
 
@@ -337,13 +355,21 @@ void PdfXRef::WriteSubSection( PdfOutputDevice* pDevice, pdf_objnum nFirst, pdf_
 #ifdef DEBUG
     PdfError::DebugMessage("Writing XRef section: %u %u\n", nFirst, nCount );
 #endif // DEBUG
-    pDevice->Print( "%u %u\n", nFirst, nCount );
+    pDevice->WriteInt( nFirst );
+    pDevice->Write( " ", 1 );
+    pDevice->WriteInt( nCount );
+    pDevice->Write( "\n", 1 );
 }
 
 void PdfXRef::WriteXRefEntry( PdfOutputDevice* pDevice, pdf_uint64 offset, 
                               pdf_gennum generation, char cMode, pdf_objnum ) 
 {
-    pDevice->Print( "%0.10" PDF_FORMAT_UINT64 " %0.5hu %c \n", offset, generation, cMode );
+    pDevice->WriteXRefRow( offset, generation, cMode );
+}
+
+void PdfXRef::WriteCompressedXRefEntry( PdfOutputDevice*, pdf_objnum, pdf_uint32 )
+{
+    PODOFO_RAISE_ERROR_INFO( ePdfError_InternalLogic, "Objects in object streams require an XRef stream." );
 }
 
 void PdfXRef::EndWrite( PdfOutputDevice* ) 
@@ -52,13 +52,14 @@ class PdfOutputDevice;
 class PdfXRef {
  protected:
     struct TXRefItem{
-        TXRefItem( const PdfReference & rRef, const pdf_uint64 & off ) 
-            : reference( rRef ), offset( off )
+        TXRefItem( const PdfReference & rRef, const pdf_uint64 & off, pdf_objnum objStream = 0 ) 
+            : reference( rRef ), offset( off ), objectStream( objStream )
             {
             }
 
         PdfReference reference;
-        pdf_uint64   offset;
+        pdf_uint64   offset;       ///< offset in the file or index in the object stream
+        pdf_objnum   objectStream; ///< number of the object stream containing the object or 0
 
         bool operator<( const TXRefItem & rhs ) const
         {
@@ -136,6 +137,17 @@ class PdfXRef {
      */
     void AddObject( const PdfReference & rRef, pdf_uint64 offset, bool bUsed );
 
+    /** Add an object which is stored in a compressed object stream
+     *  to the XRef table.
+     *
+     *  Only XRef streams can refer to such objects.
+     *  
+     *  \param rRef reference of this object
+     *  \param nObjectStream object number of the object stream containing the object
+     *  \param nIndex index of the object in the object stream
+     */
+    void AddCompressedObject( const PdfReference & rRef, pdf_objnum nObjectStream, pdf_uint32 nIndex );
+
     /** Write the XRef table to an output device.
      * 
      *  \param pDevice an output device (usually a PDF file)
@@ -194,6 +206,19 @@ class PdfXRef {
     virtual void WriteXRefEntry( PdfOutputDevice* pDevice, pdf_uint64 offset, pdf_gennum generation, 
                                  char cMode, pdf_objnum objectNumber = 0 );
 
+    /** Write a single entry for an object stored in an object stream
+     *  to the XRef table.
+     *
+     *  The default implementation raises an error, as only
+     *  XRef streams can refer to compressed objects.
+     *  
+     *  @param pDevice the output device to which the XRef table 
+     *                 should be written.
+     *  @param nObjectStream object number of the object stream containing the object
+     *  @param nIndex index of the object in the object stream
+     */
+    virtual void WriteCompressedXRefEntry( PdfOutputDevice* pDevice, pdf_objnum nObjectStream, pdf_uint32 nIndex );
+
     /** Called at the end of writing the XRef table.
      *  Sub classes can overload this method to finish a XRef table.
      *
@@ -214,6 +239,10 @@ class PdfXRef {
      */
     void MergeBlocks();
 
+    /** Add an item to the matching XRef block or create a new one.
+     */
+    void AddItem( const TXRefItem & rItem, bool bUsed );
+
  private:
     pdf_uint64 m_offset;
 
@@ -52,6 +52,7 @@ PdfXRefStream::PdfXRefStream( PdfVecObjects* pParent, PdfWriter* pWriter )
     : m_pParent( pParent ), m_pWriter( pWriter ), m_pObject( NULL )
 {
     m_bufferLen = 2 + sizeof( pdf_uint32 );
+    m_lastFieldLen = 1;
 
     m_pObject    = pParent->CreateObject( "XRef" );
     m_offset    = 0;
@@ -63,6 +64,32 @@ PdfXRefStream::~PdfXRefStream()
 
 void PdfXRefStream::BeginWrite( PdfOutputDevice* )
 {
+    // The last field holds the generation numbers of free objects
+    // and the indices of objects in object streams. Generation numbers
+    // have always been truncated to one byte, so only the indices
+    // may make the field wider.
+    pdf_uint64      nMaxIndex = 0;
+    TCIVecXRefBlock itBlock   = m_vecBlocks.begin();
+    while( itBlock != m_vecBlocks.end() )
+    {
+        TCIVecXRefItems itItems = (*itBlock).items.begin();
+        while( itItems != (*itBlock).items.end() )
+        {
+            if( (*itItems).objectStream && (*itItems).offset > nMaxIndex )
+                nMaxIndex = (*itItems).offset;
+
+            ++itItems;
+        }
+
+        ++itBlock;
+    }
+
+    m_lastFieldLen = 1;
+    while( m_lastFieldLen < sizeof(pdf_uint32) && (nMaxIndex >> (8 * m_lastFieldLen)) )
+        ++m_lastFieldLen;
+
+    m_bufferLen = 1 + sizeof( pdf_uint32 ) + m_lastFieldLen;
+
     m_pObject->GetStream()->BeginAppend();
 }
 
@@ -77,21 +104,32 @@ void PdfXRefStream::WriteSubSection( PdfOutputDevice*, pdf_objnum first, pdf_uin
 void PdfXRefStream::WriteXRefEntry( PdfOutputDevice*, pdf_uint64 offset, pdf_gennum generation, 
                                     char cMode, pdf_objnum objectNumber ) 
 {
-    std::vector<char>	bytes(m_bufferLen);
-#if (defined(_MSC_VER)  &&  _MSC_VER < 1700) || (defined(__BORLANDC__))	// MSC before VC11 has no data member, same as BorlandC
-    char * buffer = &bytes[0];
-#else
-    char * buffer = bytes.data();
-#endif
-
     if( cMode == 'n' && objectNumber == m_pObject->Reference().ObjectNumber() )
         m_offset = offset;
-    
-    buffer[0]             = static_cast<char>( cMode == 'n' ? 1 : 0 );
-    buffer[m_bufferLen-1] = static_cast<char>( cMode == 'n' ? 0 : generation );
 
-    const pdf_uint32 offset_be = ::PoDoFo::compat::podofo_htonl(static_cast<pdf_uint32>(offset));
-    memcpy( &buffer[1], reinterpret_cast<const char*>(&offset_be), sizeof(pdf_uint32) );
+    this->AppendEntry( cMode == 'n' ? 1 : 0, static_cast<pdf_uint32>(offset), 
+                       cMode == 'n' ? 0 : generation );
+}
+
+void PdfXRefStream::WriteCompressedXRefEntry( PdfOutputDevice*, pdf_objnum nObjectStream, pdf_uint32 nIndex )
+{
+    this->AppendEntry( 2, nObjectStream, nIndex );
+}
+
+void PdfXRefStream::AppendEntry( char cType, pdf_uint32 nField2, pdf_uint32 nField3 )
+{
+    char buffer[1 + 2 * sizeof(pdf_uint32)];
+
+    buffer[0] = cType;
+
+    const pdf_uint32 field2_be = ::PoDoFo::compat::podofo_htonl( nField2 );
+    memcpy( &buffer[1], reinterpret_cast<const char*>(&field2_be), sizeof(pdf_uint32) );
+
+    for( size_t i = m_bufferLen - 1; i > sizeof(pdf_uint32); --i ) 
+    {
+        buffer[i] = static_cast<char>( nField3 & 0xff );
+        nField3 >>= 8;
+    }
 
     m_pObject->GetStream()->Append( buffer, m_bufferLen );
 }
@@ -102,7 +140,7 @@ void PdfXRefStream::EndWrite( PdfOutputDevice* pDevice )
 
     w.push_back( static_cast<pdf_int64>(1) );
     w.push_back( static_cast<pdf_int64>(sizeof(pdf_uint32)) );
-    w.push_back( static_cast<pdf_int64>(1) );
+    w.push_back( static_cast<pdf_int64>(m_lastFieldLen) );
 
     // Add our self to the XRef table
     this->WriteXRefEntry( pDevice, pDevice->Tell(), 0, 'n' );
@@ -73,6 +73,12 @@ class PdfXRefStream : public PdfXRef {
      */
     inline virtual pdf_uint64 GetOffset() const;
 
+    /**
+     * \returns the object of the XRef stream, which was added to the
+     *          vector passed to the constructor
+     */
+    inline PdfObject* GetObject() const;
+
  protected:
     /** Called at the start of writing the XRef table.
      *  This method can be overwritten in subclasses
@@ -106,6 +112,15 @@ class PdfXRefStream : public PdfXRef {
     virtual void WriteXRefEntry( PdfOutputDevice* pDevice, pdf_uint64 offset, pdf_gennum generation, 
                                  char cMode, pdf_objnum objectNumber = 0 );
 
+    /** Write a single entry for an object stored in an object stream
+     *  
+     *  @param pDevice the output device to which the XRef table 
+     *                 should be written.
+     *  @param nObjectStream object number of the object stream containing the object
+     *  @param nIndex index of the object in the object stream
+     */
+    virtual void WriteCompressedXRefEntry( PdfOutputDevice* pDevice, pdf_objnum nObjectStream, pdf_uint32 nIndex );
+
     /** Called at the end of writing the XRef table.
      *  Sub classes can overload this method to finish a XRef table.
      *
@@ -114,13 +129,23 @@ class PdfXRefStream : public PdfXRef {
      */
     virtual void EndWrite( PdfOutputDevice* pDevice );
 
+ private:
+    /** Append a single binary entry to the XRef stream
+     *
+     *  @param cType the type of the entry (0 free, 1 used, 2 compressed)
+     *  @param nField2 the second field of the entry
+     *  @param nField3 the third field of the entry
+     */
+    void AppendEntry( char cType, pdf_uint32 nField2, pdf_uint32 nField3 );
+
  private:
     PdfVecObjects* m_pParent;
     PdfWriter*     m_pWriter;
     PdfObject*     m_pObject;
     PdfArray       m_indeces;
 
-    size_t         m_bufferLen; ///< The length of the internal buffer for one XRef entry
+    size_t         m_bufferLen;    ///< The length of the internal buffer for one XRef entry
+    size_t         m_lastFieldLen; ///< The length of the last field of one XRef entry
     pdf_uint64     m_offset;    ///< Offset of the XRefStream object
 };
 
@@ -132,6 +157,14 @@ inline pdf_uint64 PdfXRefStream::GetOffset() const
     return m_offset;
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline PdfObject* PdfXRefStream::GetObject() const
+{
+    return m_pObject;
+}
+
 };
 
 #endif /* _PDF_XREF_H_ */
@@ -60,6 +60,8 @@ namespace Util {
  * entirely inline.
  */
 class PdfMutexImpl {
+    friend class PdfConditionImpl; // needs the native mutex
+
     pthread_mutex_t m_mutex;
   public:
 
@@ -52,6 +52,8 @@ namespace Util {
  * A platform independent reentrant mutex, win32 implementation.
  */
 class PdfMutexImpl {
+    friend class PdfConditionImpl; // needs the native mutex
+
   public:
     /** Construct a new mutex
      */
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef PDF_PDFTHREAD_H
+#define PDF_PDFTHREAD_H
+
+#if !defined(BUILDING_PODOFO)
+#error "PdfThread is not part of PoDoFo's public API"
+#endif
+
+#if !defined(PODOFO_MULTI_THREAD)
+#error "PdfThread is only available in multi-thread builds"
+#endif
+
+#include "PdfMutex.h"
+
+/* Import the platform-specific implementation of PdfThread */
+#if defined(_WIN32)
+#  include "PdfThreadImpl_win32.h"
+#else
+#  include "PdfThreadImpl_pthread.h"
+#endif
+
+namespace PoDoFo { namespace Util {
+
+/**
+ * A condition variable implemented by a win32 CONDITION_VARIABLE
+ * or a pthread condition.
+ *
+ * Wait() has to be called with the PdfMutex locked exactly once
+ * by the calling thread. It releases the mutex while waiting and
+ * reacquires it before returning. Spurious wakeups are possible,
+ * so always check the awaited condition in a loop.
+ *
+ * PdfCondition is *NOT* part of PoDoFo's public API.
+ */
+class PdfCondition : public PdfConditionImpl
+{
+  public:
+    PdfCondition() { }
+    ~PdfCondition() { }
+};
+
+/**
+ * A thread implemented by a win32 thread or a pthread.
+ *
+ * The thread is started by Start() and has to be joined
+ * by Join() before the PdfThread is destroyed. Exceptions must
+ * not leave the thread function.
+ *
+ * PdfThread is *NOT* part of PoDoFo's public API.
+ */
+class PdfThread : public PdfThreadImpl
+{
+  public:
+    PdfThread() { }
+    ~PdfThread() { }
+};
+
+};};
+
+#endif // PDF_PDFTHREAD_H
@@ -0,0 +1,178 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef PDFTHREADIMPL_PTHREAD_H
+#define PDFTHREADIMPL_PTHREAD_H
+
+#include "../PdfDefines.h"
+#include "../PdfDefinesPrivate.h"
+
+#if ! defined(PODOFO_MULTI_THREAD)
+#error "Not a multi-thread build. PdfThread cannot be used"
+#endif
+
+#if defined(_WIN32)
+#error "win32 build. PdfThreadImpl_win32.h should be used instead"
+#endif
+
+#include <pthread.h>
+
+namespace PoDoFo {
+namespace Util {
+
+/**
+ * A platform independent condition variable, pthread implementation.
+ */
+class PdfConditionImpl {
+    pthread_cond_t m_cond;
+  public:
+
+    inline PdfConditionImpl();
+
+    inline ~PdfConditionImpl();
+
+    /**
+     * Wait until the condition is signalled.
+     *
+     * \param rMutex a mutex which is locked once by the calling thread
+     */
+    inline void Wait( PdfMutexImpl & rMutex );
+
+    /**
+     * Wake up one waiting thread
+     */
+    inline void Signal();
+
+    /**
+     * Wake up all waiting threads
+     */
+    inline void Broadcast();
+};
+
+/**
+ * A platform independent thread, pthread implementation.
+ */
+class PdfThreadImpl {
+  public:
+    typedef void (*TThreadFunction)( void* pData );
+
+    inline PdfThreadImpl();
+
+    /**
+     * Start the thread
+     *
+     * \param pFunction run this function in the new thread
+     * \param pData passed to pFunction
+     */
+    inline void Start( TThreadFunction pFunction, void* pData );
+
+    /**
+     * Wait for the thread to finish
+     */
+    inline void Join();
+
+  private:
+    static void* ThreadMain( void* pThread );
+
+  private:
+    pthread_t       m_thread;
+    TThreadFunction m_pFunction;
+    void*           m_pData;
+};
+
+PdfConditionImpl::PdfConditionImpl()
+{
+    if( pthread_cond_init( &m_cond, NULL ) != 0 )
+    {
+	    PODOFO_RAISE_ERROR( ePdfError_MutexError );
+    }
+}
+
+PdfConditionImpl::~PdfConditionImpl()
+{
+    pthread_cond_destroy( &m_cond );
+}
+
+void PdfConditionImpl::Wait( PdfMutexImpl & rMutex )
+{
+    if( pthread_cond_wait( &m_cond, &rMutex.m_mutex ) != 0 )
+    {
+	    PODOFO_RAISE_ERROR( ePdfError_MutexError );
+    }
+}
+
+void PdfConditionImpl::Signal()
+{
+    pthread_cond_signal( &m_cond );
+}
+
+void PdfConditionImpl::Broadcast()
+{
+    pthread_cond_broadcast( &m_cond );
+}
+
+PdfThreadImpl::PdfThreadImpl()
+    : m_pFunction( NULL ), m_pData( NULL )
+{
+}
+
+void PdfThreadImpl::Start( TThreadFunction pFunction, void* pData )
+{
+    m_pFunction = pFunction;
+    m_pData     = pData;
+
+    if( pthread_create( &m_thread, NULL, &PdfThreadImpl::ThreadMain, this ) != 0 )
+    {
+	    PODOFO_RAISE_ERROR_INFO( ePdfError_MutexError, "Cannot create thread" );
+    }
+}
+
+void PdfThreadImpl::Join()
+{
+    if( pthread_join( m_thread, NULL ) != 0 )
+    {
+	    PODOFO_RAISE_ERROR( ePdfError_MutexError );
+    }
+}
+
+inline void* PdfThreadImpl::ThreadMain( void* pThread )
+{
+    PdfThreadImpl* pThis = static_cast<PdfThreadImpl*>(pThread);
+    pThis->m_pFunction( pThis->m_pData );
+    return NULL;
+}
+
+}; // Util
+}; // PoDoFo
+
+#endif // PDFTHREADIMPL_PTHREAD_H
@@ -0,0 +1,180 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef PDFTHREADIMPL_WIN32_H
+#define PDFTHREADIMPL_WIN32_H
+
+#include "../PdfDefines.h"
+#include "../PdfDefinesPrivate.h"
+
+#if ! defined(PODOFO_MULTI_THREAD)
+#error "Not a multi-thread build. PdfThread cannot be used"
+#endif
+
+#if !defined(_WIN32)
+#error "Wrong PdfThread implementation included!"
+#endif
+
+#include <process.h>
+
+namespace PoDoFo {
+namespace Util {
+
+/**
+ * A platform independent condition variable, win32 implementation.
+ * Requires at least Windows Vista.
+ */
+class PdfConditionImpl {
+  public:
+    inline PdfConditionImpl();
+
+    inline ~PdfConditionImpl();
+
+    /**
+     * Wait until the condition is signalled.
+     *
+     * \param rMutex a mutex which is locked once by the calling thread
+     */
+    inline void Wait( PdfMutexImpl & rMutex );
+
+    /**
+     * Wake up one waiting thread
+     */
+    inline void Signal();
+
+    /**
+     * Wake up all waiting threads
+     */
+    inline void Broadcast();
+
+  private:
+    CONDITION_VARIABLE m_cond;
+};
+
+/**
+ * A platform independent thread, win32 implementation.
+ */
+class PdfThreadImpl {
+  public:
+    typedef void (*TThreadFunction)( void* pData );
+
+    inline PdfThreadImpl();
+
+    /**
+     * Start the thread
+     *
+     * \param pFunction run this function in the new thread
+     * \param pData passed to pFunction
+     */
+    inline void Start( TThreadFunction pFunction, void* pData );
+
+    /**
+     * Wait for the thread to finish
+     */
+    inline void Join();
+
+  private:
+    static unsigned __stdcall ThreadMain( void* pThread );
+
+  private:
+    HANDLE          m_hThread;
+    TThreadFunction m_pFunction;
+    void*           m_pData;
+};
+
+PdfConditionImpl::PdfConditionImpl()
+{
+    InitializeConditionVariable( &m_cond );
+}
+
+PdfConditionImpl::~PdfConditionImpl()
+{
+}
+
+void PdfConditionImpl::Wait( PdfMutexImpl & rMutex )
+{
+    if( !SleepConditionVariableCS( &m_cond, &rMutex.m_cs, INFINITE ) )
+    {
+	    PODOFO_RAISE_ERROR( ePdfError_MutexError );
+    }
+}
+
+void PdfConditionImpl::Signal()
+{
+    WakeConditionVariable( &m_cond );
+}
+
+void PdfConditionImpl::Broadcast()
+{
+    WakeAllConditionVariable( &m_cond );
+}
+
+PdfThreadImpl::PdfThreadImpl()
+    : m_hThread( NULL ), m_pFunction( NULL ), m_pData( NULL )
+{
+}
+
+void PdfThreadImpl::Start( TThreadFunction pFunction, void* pData )
+{
+    m_pFunction = pFunction;
+    m_pData     = pData;
+
+    m_hThread = reinterpret_cast<HANDLE>( _beginthreadex( NULL, 0, &PdfThreadImpl::ThreadMain, this, 0, NULL ) );
+    if( !m_hThread )
+    {
+	    PODOFO_RAISE_ERROR_INFO( ePdfError_MutexError, "Cannot create thread" );
+    }
+}
+
+void PdfThreadImpl::Join()
+{
+    if( WaitForSingleObject( m_hThread, INFINITE ) != WAIT_OBJECT_0 )
+    {
+	    PODOFO_RAISE_ERROR( ePdfError_MutexError );
+    }
+
+    CloseHandle( m_hThread );
+    m_hThread = NULL;
+}
+
+inline unsigned __stdcall PdfThreadImpl::ThreadMain( void* pThread )
+{
+    PdfThreadImpl* pThis = static_cast<PdfThreadImpl*>(pThread);
+    pThis->m_pFunction( pThis->m_pData );
+    return 0;
+}
+
+}; // Util
+}; // PoDoFo
+
+#endif // PDFTHREADIMPL_WIN32_H
@@ -122,11 +122,7 @@ PdfCMapEncoding::PdfCMapEncoding (PdfObject * pObject, PdfObject * pToUnicode) :
                         }
                         if (i % 3 == 2)
                         {
-                            for (int k = range_start; k <= range_end; k++)
-                            {
-                                m_cMap[k] = num_value;
-                                num_value++;
-                            }
+                            m_cMap.InsertRange( range_start, range_end, num_value );
 
                             loop++;
 
@@ -154,7 +150,7 @@ PdfCMapEncoding::PdfCMapEncoding (PdfObject * pObject, PdfObject * pToUnicode) :
                         }
                         if (i % 2 == 1)
                         {
-                            m_cMap[firstvalue] = num_value;
+                            m_cMap.Insert( firstvalue, num_value );
                         }
 
                     }
@@ -264,20 +260,17 @@ PdfString PdfCMapEncoding::ConvertToUnicode(const PdfString & rEncodedString, co
 
     if(m_bToUnicodeIsLoaded)
     {
-      if(!m_toUnicode.empty())
+      if(!m_toUnicode.IsEmpty())
       {
         
         const pdf_uint8* pStr = reinterpret_cast<const pdf_uint8*>(rEncodedString.GetString());
         const size_t lLen = rEncodedString.GetLength();
         
-        pdf_utf16be* pszUtf16 = static_cast<pdf_utf16be*>(podofo_calloc(lLen, sizeof(pdf_utf16be)));
-        if( !pszUtf16 )
-        {
-          PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
-        }
+        // A code may map to several unicode values (e.g. ligatures)
+        std::vector<pdf_utf16be> vecUtf16;
+        vecUtf16.reserve( lLen + 1 );
         
-        size_t lDstLen = 0;
-        pdf_utf16be lCID, lUnicodeValue;
+        pdf_utf16be lCID;
         pdf_uint8* const pCID = reinterpret_cast<pdf_uint8*>(&lCID);
         for(size_t iSrc = 0 ; iSrc<lLen ;)
         {
@@ -290,9 +283,7 @@ PdfString PdfCMapEncoding::ConvertToUnicode(const PdfString & rEncodedString, co
 
           iSrc++;
           
-          lUnicodeValue = this->GetUnicodeValue(lCID);
-
-          if (lUnicodeValue == 0)
+          if( this->GetUnicodeValue(lCID) == 0 )
           {
 #ifdef PODOFO_IS_LITTLE_ENDIAN
             pCID[1] = pStr[iSrc];
@@ -301,21 +292,21 @@ PdfString PdfCMapEncoding::ConvertToUnicode(const PdfString & rEncodedString, co
 #endif // PODOFO_IS_LITTLE_ENDIAN
           
             iSrc++;
-            lUnicodeValue = this->GetUnicodeValue(lCID);
           }
           
+          if( !m_toUnicode.GetUnicode( lCID, vecUtf16 ) )
+            vecUtf16.push_back( 0 );
+        }
+        
 #ifdef PODOFO_IS_LITTLE_ENDIAN
-          pszUtf16[lDstLen] = (lUnicodeValue << 8) | (lUnicodeValue >> 8 );
-#else
-          pszUtf16[lDstLen] = lUnicodeValue;
+        for(size_t i = 0 ; i<vecUtf16.size() ; i++)
+          vecUtf16[i] = (vecUtf16[i] << 8) | (vecUtf16[i] >> 8 );
 #endif // PODOFO_IS_LITTLE_ENDIAN
-          lDstLen++;
-        }
         
-        PdfString ret( pszUtf16, lDstLen );
-        podofo_free( pszUtf16 );
+        const pdf_long lDstLen = static_cast<pdf_long>(vecUtf16.size());
+        vecUtf16.push_back( 0 );
         
-        return ret;
+        return PdfString( &vecUtf16[0], lDstLen );
         
       }
       else
@@ -65,7 +65,7 @@ public:
 private:
 
     EBaseEncoding m_baseEncoding;
-    std::map<pdf_utf16be, pdf_utf16be> m_cMap;
+    PdfCharCodeMap m_cMap;
 };
 
 }; /*PoDoFo namespace end*/
@@ -37,6 +37,7 @@
 
 #include "base/PdfArray.h"
 #include "base/PdfDictionary.h"
+#include "base/util/PdfMutexWrapper.h"
 
 #include "PdfFont.h"
 
@@ -2201,6 +2202,57 @@ static struct {
     {0xFFFF, NULL}
 };
 
+// Indices into nameToUnicodeTab, sorted by name and by code point,
+// so that glyph names can be looked up with a binary search.
+// They are built on first use by InitGlyphNameIndex.
+static std::vector<int> s_vecNameIndex;
+static std::vector<int> s_vecCodeIndex;
+static bool             s_bGlyphNameIndex = false;
+static Util::PdfMutex   s_glyphNameIndexMutex;
+
+struct GlyphNameLess {
+    bool operator()( int lhs, int rhs ) const
+    {
+        return strcmp( nameToUnicodeTab[lhs].name, nameToUnicodeTab[rhs].name ) < 0;
+    }
+    bool operator()( int lhs, const char* rhs ) const
+    {
+        return strcmp( nameToUnicodeTab[lhs].name, rhs ) < 0;
+    }
+};
+
+struct GlyphCodeLess {
+    bool operator()( int lhs, int rhs ) const
+    {
+        return nameToUnicodeTab[lhs].u < nameToUnicodeTab[rhs].u;
+    }
+    bool operator()( int lhs, pdf_utf16be rhs ) const
+    {
+        return nameToUnicodeTab[lhs].u < rhs;
+    }
+};
+
+static void InitGlyphNameIndex()
+{
+    if( s_bGlyphNameIndex ) // First check
+        return;
+
+    Util::PdfMutexWrapper wrapper( s_glyphNameIndexMutex );
+    if( s_bGlyphNameIndex ) // Double check
+        return;
+
+    for( int i = 0; nameToUnicodeTab[i].name; ++i ) 
+        s_vecNameIndex.push_back( i );
+
+    // Several names map to the same code point: the stable sort keeps
+    // the first of them in front, as a linear search would find it
+    s_vecCodeIndex = s_vecNameIndex;
+    std::sort( s_vecNameIndex.begin(), s_vecNameIndex.end(), GlyphNameLess() );
+    std::stable_sort( s_vecCodeIndex.begin(), s_vecCodeIndex.end(), GlyphCodeLess() );
+
+    s_bGlyphNameIndex = true;
+}
+
 PdfEncodingDifference::PdfEncodingDifference()
 {
 }
@@ -2496,13 +2548,16 @@ pdf_utf16be PdfDifferenceEncoding::NameToUnicodeID( const PdfName & rName )
 {
     const char* pszName = rName.GetName().c_str();
 
-    for( int i = 0; nameToUnicodeTab[i].name; ++i) 
+    InitGlyphNameIndex();
+
+    std::vector<int>::const_iterator it = std::lower_bound( s_vecNameIndex.begin(), s_vecNameIndex.end(), 
+                                                            pszName, GlyphNameLess() );
+    if( it != s_vecNameIndex.end() && strcmp( nameToUnicodeTab[*it].name, pszName ) == 0 )
     {
-        if ( strcmp( nameToUnicodeTab[i].name, pszName ) == 0 )
 #ifdef PODOFO_IS_LITTLE_ENDIAN
-            return ((nameToUnicodeTab[i].u & 0xff00) >> 8) | ((nameToUnicodeTab[i].u & 0xff) << 8);
+        return ((nameToUnicodeTab[*it].u & 0xff00) >> 8) | ((nameToUnicodeTab[*it].u & 0xff) << 8);
 #else
-            return nameToUnicodeTab[i].u;
+        return nameToUnicodeTab[*it].u;
 #endif // PODOFO_IS_LITTLE_ENDIAN
     }
 
@@ -2532,19 +2587,28 @@ PdfName PdfDifferenceEncoding::UnicodeIDToName( pdf_utf16be inCodePoint )
     inCodePoint = ((inCodePoint & 0xff00) >> 8) | ((inCodePoint & 0xff) << 8);
 #endif // PODOFO_IS_LITTLE_ENDIAN
 
-    int i;
-	for( i = 0; UnicodeToNameTab[i].name; ++i) 
+    // UnicodeToNameTab is sorted by code point
+    int nLow  = 0;
+    int nHigh = sizeof(UnicodeToNameTab) / sizeof(UnicodeToNameTab[0]) - 1; // without terminator
+    while( nLow < nHigh ) 
     {
-        if ( UnicodeToNameTab[i].u == inCodePoint ) 
-            return PdfName( UnicodeToNameTab[i].name );
+        int nMid = (nLow + nHigh) / 2;
+        if( UnicodeToNameTab[nMid].u < inCodePoint )
+            nLow = nMid + 1;
+        else
+            nHigh = nMid;
     }
 
+    if( UnicodeToNameTab[nLow].name && UnicodeToNameTab[nLow].u == inCodePoint ) 
+        return PdfName( UnicodeToNameTab[nLow].name );
+
     // if we can't find in the canonical list, look in the complete list
-    for ( i = 0; nameToUnicodeTab[i].name; ++i) 
-    {
-        if ( nameToUnicodeTab[i].u == inCodePoint )
-            return PdfName( UnicodeToNameTab[i].name );
-    }
+    InitGlyphNameIndex();
+
+    std::vector<int>::const_iterator it = std::lower_bound( s_vecCodeIndex.begin(), s_vecCodeIndex.end(), 
+                                                            inCodePoint, GlyphCodeLess() );
+    if( it != s_vecCodeIndex.end() && nameToUnicodeTab[*it].u == inCodePoint )
+        return PdfName( nameToUnicodeTab[*it].name );
 
     // if we get here, then we are looking up an undefined codepoint
     // so we'll just give it SOME name..
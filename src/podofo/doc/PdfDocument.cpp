@@ -69,6 +69,146 @@ using namespace std;
 
 namespace PoDoFo {
 
+/** Copies objects of another document and all objects 
+ *  reachable from them into a PdfVecObjects.
+ *
+ *  The copies get new object numbers. A map from the old 
+ *  to the new references is used to rewrite all references,
+ *  so every object is copied and visited only once.
+ *
+ *  Page objects and pages nodes are only copied if they
+ *  are passed to Copy(), other references to them are
+ *  replaced by null.
+ */
+class PdfObjectImporter {
+ public:
+    PdfObjectImporter( PdfVecObjects & rDest, const PdfVecObjects & rSource, TPdfReferenceMap & rMap )
+        : m_rDest( rDest ), m_rSource( rSource ), m_rMap( rMap ), 
+          m_nNextObject( static_cast<pdf_objnum>(rDest.GetObjectCount()) )
+    {
+    }
+
+    /** Queue an object for copying, even if it was copied before.
+     *  \returns the reference of the copy
+     */
+    PdfReference Copy( const PdfReference & rRef )
+    {
+        const PdfReference ref( m_nNextObject++, 0 );
+        m_rMap[rRef] = ref;
+        m_queue.push_back( std::make_pair( rRef, ref ) );
+
+        return ref;
+    }
+
+    /** Rewrite all references in an object and its direct children,
+     *  queueing all objects which were not copied yet.
+     */
+    void FixReferences( PdfObject & rObject )
+    {
+        if( rObject.IsDictionary() )
+        {
+            TKeyMap::iterator it = rObject.GetDictionary().GetKeys().begin();
+            while( it != rObject.GetDictionary().GetKeys().end() )
+            {
+                FixReferences( *(*it).second );
+                ++it;
+            }
+        }
+        else if( rObject.IsArray() )
+        {
+            PdfArray::iterator it = rObject.GetArray().begin();
+            while( it != rObject.GetArray().end() )
+            {
+                FixReferences( *it );
+                ++it;
+            }
+        }
+        else if( rObject.IsReference() )
+        {
+            const PdfReference ref = rObject.GetReference();
+            TCIPdfReferenceMap it = m_rMap.find( ref );
+            if( it != m_rMap.end() )
+            {
+                rObject = (*it).second;
+                return;
+            }
+
+            const PdfObject* pSrc = m_rSource.GetObject( ref );
+            if( !pSrc || IsPageOrPages( pSrc ) )
+                rObject = PdfVariant::NullValue;
+            else
+                rObject = this->Copy( ref );
+        }
+    }
+
+    /** Get an attribute of a page from the page or its parents,
+     *  without resolving it, so that shared objects stay shared.
+     *  \returns the attribute or NULL
+     */
+    const PdfObject* GetInheritedKey( const PdfObject* pPage, const PdfName & rKey ) const
+    {
+        // Limit the depth like PdfPage does, the parent chain might contain a loop
+        const int maxDepth = 1000;
+
+        const PdfObject* pObj = pPage;
+        for( int i=0;pObj && pObj->IsDictionary() && i<maxDepth;i++ )
+        {
+            const PdfObject* pValue = pObj->GetDictionary().GetKey( rKey );
+            if( pValue && !pValue->IsNull() )
+                return pValue;
+
+            const PdfObject* pParent = pObj->GetDictionary().GetKey( PdfName( "Parent" ) );
+            pObj = pParent && pParent->IsReference() ? m_rSource.GetObject( pParent->GetReference() ) : NULL;
+        }
+
+        return NULL;
+    }
+
+    /** Copy all queued objects.
+     */
+    void Run()
+    {
+        while( !m_queue.empty() ) 
+        {
+            const std::pair<PdfReference,PdfReference> refs = m_queue.front();
+            m_queue.pop_front();
+
+            const PdfObject* pSrc = m_rSource.GetObject( refs.first );
+            if( !pSrc )
+            {
+                PODOFO_RAISE_ERROR( ePdfError_NoObject );
+            }
+
+            // Objects are created in the order their numbers were assigned,
+            // so that m_rDest stays sorted
+            PdfObject* pObj = new PdfObject( refs.second, *pSrc );
+            m_rDest.push_back( pObj );
+
+            FixReferences( *pObj );
+            if( pSrc->HasStream() )
+                *(pObj->GetStream()) = *(pSrc->GetStream());
+        }
+    }
+
+ private:
+    static bool IsPageOrPages( const PdfObject* pObject )
+    {
+        if( !pObject->IsDictionary() )
+            return false;
+
+        const PdfName & rType = pObject->GetDictionary().GetKeyAsName( PdfName::KeyType );
+        return rType == PdfName( "Page" ) || rType == PdfName( "Pages" );
+    }
+
+ private:
+    PdfVecObjects &       m_rDest;
+    const PdfVecObjects & m_rSource;
+    TPdfReferenceMap &    m_rMap;
+    pdf_objnum            m_nNextObject;
+
+    std::deque< std::pair<PdfReference,PdfReference> > m_queue;
+};
+
 PdfDocument::PdfDocument(bool bEmpty)
     : m_fontCache( &m_vecObjects ), 
       m_pTrailer(NULL),
@@ -276,6 +416,17 @@ void PdfDocument::EmbedSubsetFonts()
 
 const PdfDocument & PdfDocument::Append( const PdfMemDocument & rDoc, bool bAppendAll )
 {
+    if( bAppendAll )
+    {
+        // Copy only the objects reachable from the pages and outlines
+        TPdfReferenceMap mapReferences;
+        this->InsertPagesFrom( rDoc, 0, rDoc.GetPageCount(), -1, &mapReferences );
+        this->AppendOutlinesFrom( rDoc, mapReferences );
+        return *this;
+    }
+
+    // Copy all objects, keeping their offset to each other, 
+    // which FillXObjectFromDocumentPage() relies on
     unsigned int difference = static_cast<unsigned int>(m_vecObjects.GetSize() + m_vecObjects.GetFreeObjects().size());
 
 
@@ -311,62 +462,6 @@ const PdfDocument & PdfDocument::Append( const PdfMemDocument & rDoc, bool bAppe
         ++it;
     }
 
-    if( bAppendAll )
-    {
-        const PdfName inheritableAttributes[] = {
-            PdfName("Resources"),
-            PdfName("MediaBox"),
-            PdfName("CropBox"),
-            PdfName("Rotate"),
-            PdfName::KeyNull
-        };
-
-        // append all pages now to our page tree
-        for(int i=0;i<rDoc.GetPageCount();i++ )
-        {
-            PdfPage*      pPage = rDoc.GetPage( i );
-            if (NULL == pPage)
-            {
-                std::ostringstream oss;
-                oss << "No page " << i << " (the first is 0) found.";
-                PODOFO_RAISE_ERROR_INFO( ePdfError_PageNotFound, oss.str() );
-            }
-            PdfObject*    pObj  = m_vecObjects.MustGetObject( PdfReference( pPage->GetObject()->Reference().ObjectNumber() + difference, pPage->GetObject()->Reference().GenerationNumber() ) );
-            if( pObj->IsDictionary() && pObj->GetDictionary().HasKey( "Parent" ) )
-                pObj->GetDictionary().RemoveKey( "Parent" );
-
-            // Deal with inherited attributes
-            const PdfName* pInherited = inheritableAttributes;
-            while( pInherited->GetLength() != 0 ) 
-            {
-                const PdfObject* pAttribute = pPage->GetInheritedKey( *pInherited ); 
-                if( pAttribute )
-                {
-                    PdfObject attribute( *pAttribute );
-                    FixObjectReferences( &attribute, difference );
-                    pObj->GetDictionary().AddKey( *pInherited, attribute );
-                }
-
-                ++pInherited;
-            }
-
-            m_pPagesTree->InsertPage( this->GetPageCount()-1, pObj );
-        }
-        
-        // append all outlines
-        PdfOutlineItem* pRoot       = this->GetOutlines();
-        PdfOutlines*    pAppendRoot = const_cast<PdfMemDocument&>(rDoc).GetOutlines( PoDoFo::ePdfDontCreateObject );
-        if( pAppendRoot && pAppendRoot->First() ) 
-        {
-            // only append outlines if appended document has outlines
-            while( pRoot && pRoot->Next() ) 
-                pRoot = pRoot->Next();
-            
-            PdfReference ref( pAppendRoot->First()->GetObject()->Reference().ObjectNumber() + difference, pAppendRoot->First()->GetObject()->Reference().GenerationNumber() );
-            pRoot->InsertChild( new PdfOutlines( m_vecObjects.MustGetObject( ref ) ) );
-        }
-    }
-    
     // TODO: merge name trees
     // ToDictionary -> then iteratate over all keys and add them to the new one
     return *this;
@@ -374,42 +469,49 @@ const PdfDocument & PdfDocument::Append( const PdfMemDocument & rDoc, bool bAppe
 
 const PdfDocument &PdfDocument::InsertExistingPageAt( const PdfMemDocument & rDoc, int nPageIndex, int nAtIndex)
 {
-	/* copy of PdfDocument::Append, only restricts which page to add */
-    unsigned int difference = static_cast<unsigned int>(m_vecObjects.GetSize() + m_vecObjects.GetFreeObjects().size());
-
+    TPdfReferenceMap mapReferences;
+    if( nPageIndex >= 0 && nPageIndex < rDoc.GetPageCount() )
+        this->InsertPagesFrom( rDoc, nPageIndex, 1, nAtIndex < 0 ? 0 : nAtIndex, &mapReferences );
 
-    // Ulrich Arnold 30.7.2009: Because GetNextObject uses m_nObjectCount instead 
-    //                          of m_vecObjects.GetSize()+m_vecObjects.GetFreeObjects().size()+1
-    //                          make sure the free objects are already present before appending to
-	//                          prevent overlapping obj-numbers
+    this->AppendOutlinesFrom( rDoc, mapReferences );
+    return *this;
+}
 
-    // create all free objects again, to have a clean free object list
-    TCIPdfReferenceList itFree = rDoc.GetObjects().GetFreeObjects().begin();
-    while( itFree != rDoc.GetObjects().GetFreeObjects().end() )
+const PdfDocument & PdfDocument::InsertPagesFrom( const PdfMemDocument & rDoc, int nFirstPage, int nNumPages, 
+                                                  int nAtIndex, TPdfReferenceMap* pMap )
+{
+    if( nFirstPage < 0 || nNumPages < 0 || nFirstPage + nNumPages > rDoc.GetPageCount() ) 
     {
-        m_vecObjects.AddFreeObject( PdfReference( (*itFree).ObjectNumber() + difference, (*itFree).GenerationNumber() ) );
-
-        ++itFree;
+        PODOFO_RAISE_ERROR_INFO( ePdfError_ValueOutOfRange, "Pages to insert are not in the document" );
     }
 
-	// append all objects first and fix their references
-    TCIVecObjects it           = rDoc.GetObjects().begin();
-    while( it != rDoc.GetObjects().end() )
-    {
-        PdfObject* pObj = new PdfObject( PdfReference( 
-                                             static_cast<unsigned int>((*it)->Reference().ObjectNumber() + difference), (*it)->Reference().GenerationNumber() ), *(*it) );
-        m_vecObjects.push_back( pObj );
+    if( nAtIndex < 0 || nAtIndex > this->GetPageCount() )
+        nAtIndex = this->GetPageCount();
 
-        if( (*it)->IsDictionary() && (*it)->HasStream() )
-            *(pObj->GetStream()) = *(static_cast<const PdfObject*>(*it)->GetStream());
+    TPdfReferenceMap  mapReferences;
+    PdfObjectImporter importer( m_vecObjects, rDoc.GetObjects(), pMap ? *pMap : mapReferences );
 
-        PdfError::LogMessage( eLogSeverity_Information,
-                              "Fixing references in %i %i R by %i\n", pObj->Reference().ObjectNumber(), pObj->Reference().GenerationNumber(), difference );
-        FixObjectReferences( pObj, difference );
+    // Number all pages first, so that references between them are kept
+    std::vector<PdfPage*>      vecSrcPages;
+    std::vector<PdfReference>  vecRefs;
+    vecSrcPages.reserve( nNumPages );
+    vecRefs.reserve( nNumPages );
+    for( int i=0;i<nNumPages;i++ )
+    {
+        PdfPage* pPage = rDoc.GetPage( nFirstPage + i );
+        if( !pPage )
+        {
+            std::ostringstream oss;
+            oss << "No page " << nFirstPage + i << " (the first is 0) found.";
+            PODOFO_RAISE_ERROR_INFO( ePdfError_PageNotFound, oss.str() );
+        }
 
-        ++it;
+        vecSrcPages.push_back( pPage );
+        vecRefs.push_back( importer.Copy( pPage->GetObject()->Reference() ) );
     }
 
+    importer.Run();
+
     const PdfName inheritableAttributes[] = {
         PdfName("Resources"),
         PdfName("MediaBox"),
@@ -418,15 +520,11 @@ const PdfDocument &PdfDocument::InsertExistingPageAt( const PdfMemDocument & rDo
         PdfName::KeyNull
     };
 
-    // append all pages now to our page tree
-    for(int i=0;i<rDoc.GetPageCount();i++ )
+    std::vector<PdfObject*> vecPages;
+    vecPages.reserve( nNumPages );
+    for( int i=0;i<nNumPages;i++ )
     {
-        if (i != nPageIndex) {
-            continue;
-        }
-
-        PdfPage*      pPage = rDoc.GetPage( i );
-        PdfObject*    pObj  = m_vecObjects.MustGetObject( PdfReference( pPage->GetObject()->Reference().ObjectNumber() + difference, pPage->GetObject()->Reference().GenerationNumber() ) );
+        PdfObject* pObj = m_vecObjects.MustGetObject( vecRefs[i] );
         if( pObj->IsDictionary() && pObj->GetDictionary().HasKey( "Parent" ) )
             pObj->GetDictionary().RemoveKey( "Parent" );
 
@@ -434,38 +532,50 @@ const PdfDocument &PdfDocument::InsertExistingPageAt( const PdfMemDocument & rDo
         const PdfName* pInherited = inheritableAttributes;
         while( pInherited->GetLength() != 0 ) 
         {
-	    const PdfObject* pAttribute = pPage->GetInheritedKey( *pInherited ); 
-	    if( pAttribute )
-	    {
-	        PdfObject attribute( *pAttribute );
-	        FixObjectReferences( &attribute, difference );
-	        pObj->GetDictionary().AddKey( *pInherited, attribute );
-	    }
-
-	    ++pInherited;
+            const PdfObject* pAttribute = importer.GetInheritedKey( vecSrcPages[i]->GetObject(), *pInherited ); 
+            if( pAttribute )
+            {
+                PdfObject attribute( *pAttribute );
+                importer.FixReferences( attribute );
+                pObj->GetDictionary().AddKey( *pInherited, attribute );
+            }
+
+            ++pInherited;
         }
 
-        m_pPagesTree->InsertPage( nAtIndex <= 0 ? ePdfPageInsertionPoint_InsertBeforeFirstPage : nAtIndex - 1, pObj );
+        vecPages.push_back( pObj );
     }
 
-    // append all outlines
-    PdfOutlineItem* pRoot       = this->GetOutlines();
-    PdfOutlines*    pAppendRoot = const_cast<PdfMemDocument&>(rDoc).GetOutlines( PoDoFo::ePdfDontCreateObject );
-    if( pAppendRoot && pAppendRoot->First() ) 
-    {
-        // only append outlines if appended document has outlines
-        while( pRoot && pRoot->Next() ) 
-	    pRoot = pRoot->Next();
-    
-        PdfReference ref( pAppendRoot->First()->GetObject()->Reference().ObjectNumber() + difference, pAppendRoot->First()->GetObject()->Reference().GenerationNumber() );
-        pRoot->InsertChild( new PdfOutlines( m_vecObjects.MustGetObject( ref ) ) );
-    }
-    
-    // TODO: merge name trees
-    // ToDictionary -> then iteratate over all keys and add them to the new one
+    // Copy the objects referenced by inherited attributes
+    importer.Run();
+
+    if( !vecPages.empty() )
+        m_pPagesTree->InsertPages( nAtIndex - 1, vecPages );
+
     return *this;
 }
 
+void PdfDocument::AppendOutlinesFrom( const PdfMemDocument & rDoc, TPdfReferenceMap & rMap )
+{
+    PdfOutlines* pAppendRoot = const_cast<PdfMemDocument&>(rDoc).GetOutlines( PoDoFo::ePdfDontCreateObject );
+    if( !pAppendRoot || !pAppendRoot->First() ) 
+        return; // only append outlines if appended document has outlines
+
+    const PdfReference & rFirst = pAppendRoot->First()->GetObject()->Reference();
+    if( rMap.find( rFirst ) != rMap.end() )
+        return; // already appended using the same map
+
+    PdfObjectImporter importer( m_vecObjects, rDoc.GetObjects(), rMap );
+    const PdfReference ref = importer.Copy( rFirst );
+    importer.Run();
+
+    PdfOutlineItem* pRoot = this->GetOutlines();
+    while( pRoot && pRoot->Next() ) 
+        pRoot = pRoot->Next();
+
+    pRoot->InsertChild( new PdfOutlines( m_vecObjects.MustGetObject( ref ) ) );
+}
+
 PdfRect PdfDocument::FillXObjectFromDocumentPage( PdfXObject * pXObj, const PdfMemDocument & rDoc, int nPage, bool bUseTrimBox )
 {
     unsigned int difference = static_cast<unsigned int>(m_vecObjects.GetSize() + m_vecObjects.GetFreeObjects().size());
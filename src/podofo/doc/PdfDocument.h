@@ -342,6 +342,11 @@ class PODOFO_DOC_API PdfDocument {
     PdfPage* InsertPage( const PdfRect & rSize, int atIndex);
 
     /** Appends another PdfDocument to this document.
+     *
+     *  If bAppendAll is true, only the objects reachable from the pages and
+     *  outlines of rDoc are copied (see InsertPagesFrom()). Otherwise all objects
+     *  of rDoc are copied and keep their distance in object numbers.
+     *
      *  \param rDoc the document to append
      *  \param bAppendAll specifies whether pages and outlines are appended too
      *  \returns this document
@@ -356,6 +361,28 @@ class PODOFO_DOC_API PdfDocument {
      */
     const PdfDocument &InsertExistingPageAt( const PdfMemDocument & rDoc, int nPageIndex, int nAtIndex);
 
+    /** Inserts pages of another PdfMemDocument into this document.
+     *
+     *  Only the objects which are reachable from the inserted pages
+     *  are copied, each of them once. References to pages of rDoc
+     *  which are not inserted (e.g. from link annotations) are
+     *  replaced by null.
+     *
+     *  \param rDoc the document to insert pages from
+     *  \param nFirstPage index of the first page to insert (0-based), from rDoc
+     *  \param nNumPages number of pages to insert
+     *  \param nAtIndex index at which to insert the first page in this document (0-based),
+     *                  or -1 to append the pages
+     *  \param pMap if not NULL, maps references of objects in rDoc to the references
+     *              of their copies in this document. Objects which are already in
+     *              the map are not copied again (except for the inserted pages), 
+     *              so passing the same map when inserting pages of rDoc several times
+     *              copies shared resources like fonts and images only once.
+     *  \returns this document
+     */
+    const PdfDocument & InsertPagesFrom( const PdfMemDocument & rDoc, int nFirstPage, int nNumPages, 
+                                         int nAtIndex = -1, TPdfReferenceMap* pMap = NULL );
+
     /** Fill an existing empty PdfXObject from a page of another document.
      *  This will append the other document to this one.
      *  \param pXObj pointer to the PdfXObject
@@ -578,6 +605,17 @@ class PODOFO_DOC_API PdfDocument {
      */
     inline void SetFontConfigWrapper(const PdfFontConfigWrapper & rFontConfig);
 
+    /**
+     * Share font files, font lookups and glyph widths with other
+     * documents, so that they are loaded only once per process.
+     *
+     * \param pSharedCache a shared cache which has to outlive this
+     *                     document or NULL to stop sharing
+     *
+     * \see PdfSharedFontCache
+     */
+    inline void SetSharedFontCache( PdfSharedFontCache* pSharedCache );
+
  protected:
     /** Construct a new (empty) PdfDocument
      *  \param bEmpty if true NO default objects (such as catalog) are created.
@@ -654,6 +692,15 @@ class PODOFO_DOC_API PdfDocument {
      */
     void FixObjectReferences( PdfObject* pObject, int difference );
 
+    /** Copy the outlines of another document and append them to the outlines
+     *  of this document.
+     *
+     *  \param rDoc the document to copy the outlines from
+     *  \param rMap maps references of objects in rDoc to the references of their copies,
+     *              all copied objects are added to it
+     */
+    void AppendOutlinesFrom( const PdfMemDocument & rDoc, TPdfReferenceMap & rMap );
+
     /** Low-level APIs for setting a viewer preference.
      *  \param whichPref the dictionary key to set
      *  \param valueObj the object to be set
@@ -779,6 +826,14 @@ inline void PdfDocument::SetFontConfigWrapper(const PdfFontConfigWrapper & rFont
     m_fontCache.SetFontConfigWrapper(rFontConfig);
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline void PdfDocument::SetSharedFontCache( PdfSharedFontCache* pSharedCache )
+{
+    m_fontCache.SetSharedFontCache( pSharedCache );
+}
+
 };
 
 
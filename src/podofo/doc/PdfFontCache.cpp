@@ -44,6 +44,7 @@
 #include "PdfFontFactory.h"
 #include "PdfFontMetricsFreetype.h"
 #include "PdfFontMetricsBase14.h"
+#include "PdfSharedFontCache.h"
 #include "PdfFontTTFSubset.h"
 #include "PdfFontType1.h"
 
@@ -271,13 +272,13 @@ static bool GetDataFromLPFONT( const LOGFONTA* inFont, char** outFontBuffer, uns
 #endif // _WIN32
 
 PdfFontCache::PdfFontCache( PdfVecObjects* pParent )
-    : m_pParent( pParent )
+    : m_pParent( pParent ), m_pSharedCache( NULL )
 {
     Init();
 }
 
 PdfFontCache::PdfFontCache( const PdfFontConfigWrapper & rFontConfig, PdfVecObjects* pParent )
-    : m_pParent( pParent ), m_fontConfig( rFontConfig )
+    : m_pParent( pParent ), m_fontConfig( rFontConfig ), m_pSharedCache( NULL )
 {
     Init();
 }
@@ -305,6 +306,7 @@ void PdfFontCache::Init(void)
     p[1] = 0;
 
     m_sSubsetBasename[0]--;
+    m_bFontsSorted = true;
 
     // Initialize all the fonts stuff
     if( FT_Init_FreeType( &m_ftLibrary ) )
@@ -332,31 +334,25 @@ void PdfFontCache::EmptyCache()
 
     m_vecFonts.clear();
     m_vecFontSubsets.clear();
+    m_mapFonts.clear();
+    m_bFontsSorted = true;
 }
 
-PdfFont* PdfFontCache::GetFont( PdfObject* pObject )
+void PdfFontCache::SortFonts()
 {
-    TCISortedFontList it = m_vecFonts.begin();
-    const PdfReference & ref = pObject->Reference(); 
-
-    // Search if the object is a cached normal font
-    while( it != m_vecFonts.end() )
+    if( !m_bFontsSorted )
     {
-        if( (*it).m_pFont->GetObject()->Reference() == ref ) 
-            return (*it).m_pFont;
-
-        ++it;
+        std::sort( m_vecFonts.begin(), m_vecFonts.end() );
+        m_bFontsSorted = true;
     }
+}
 
-    // Search if the object is a cached font subset
-    it = m_vecFontSubsets.begin();
-    while( it != m_vecFontSubsets.end() )
-    {
-        if( (*it).m_pFont->GetObject()->Reference() == ref ) 
-            return (*it).m_pFont;
-
-        ++it;
-    }
+PdfFont* PdfFontCache::GetFont( PdfObject* pObject )
+{
+    // Search if the object is a cached normal font or font subset
+    TCIMapFonts itFont = m_mapFonts.find( pObject->Reference() );
+    if( itFont != m_mapFonts.end() )
+        return (*itFont).second;
 
     // Create a new font
     PdfFont* pFont = PdfFontFactory::CreateFont( &m_ftLibrary, pObject );
@@ -369,10 +365,12 @@ PdfFont* PdfFontCache::GetFont( PdfObject* pObject )
         element.m_sFontName = pFont->GetFontMetrics()->GetFontname();
         element.m_pEncoding = NULL;
         element.m_bIsSymbolCharset = pFont->GetFontMetrics()->IsSymbol();
+
+        // The font list is sorted on the next lookup by name, so that
+        // resolving the fonts of many existing objects stays linear
         m_vecFonts.push_back( element );
-        
-        // Now sort the font list
-        std::sort( m_vecFonts.begin(), m_vecFonts.end() );
+        m_bFontsSorted = false;
+        m_mapFonts[pFont->GetObject()->Reference()] = pFont;
     }
     
     return pFont;
@@ -389,6 +387,7 @@ PdfFont* PdfFontCache::GetFont( const char* pszFontName, bool bBold, bool bItali
     PdfFontMetrics*   pMetrics = NULL;
     std::pair<TISortedFontList,TCISortedFontList> it;
 
+    SortFonts();
     it = std::equal_range( m_vecFonts.begin(), m_vecFonts.end(), 
                TFontCacheElement( pszFontName, bBold, bItalic, bSymbolCharset, pEncoding ) );
 
@@ -428,6 +427,7 @@ PdfFont* PdfFontCache::GetFont( const char* pszFontName, bool bBold, bool bItali
                 // Do a sorted insert, so no need to sort again
                 //rvecContainer.insert( itSorted, element ); 
                 m_vecFonts.insert( it.first, element );
+                m_mapFonts[pFont->GetObject()->Reference()] = pFont;
                 
              }
 
@@ -450,7 +450,10 @@ PdfFont* PdfFontCache::GetFont( const char* pszFontName, bool bBold, bool bItali
             }
             else
             {
-                pMetrics = new PdfFontMetricsFreetype( &m_ftLibrary, sPath.c_str(), bSymbolCharset, bSubsetting ? genSubsetBasename() : NULL );
+                if( m_pSharedCache && PdfFontMetrics::FontTypeFromFilename( sPath.c_str() ) == ePdfFontType_TrueType )
+                    pMetrics = new PdfFontMetricsFreetype( &m_ftLibrary, m_pSharedCache, sPath.c_str(), bSymbolCharset, bSubsetting ? genSubsetBasename() : NULL );
+                else
+                    pMetrics = new PdfFontMetricsFreetype( &m_ftLibrary, sPath.c_str(), bSymbolCharset, bSubsetting ? genSubsetBasename() : NULL );
                 pFont    = this->CreateFontObject( it.first, m_vecFonts, pMetrics, 
                            bEmbedd, bBold, bItalic, pszFontName, pEncoding, bSubsetting );
             }
@@ -499,6 +502,7 @@ PdfFont* PdfFontCache::GetFont( const wchar_t* pszFontName, bool bBold, bool bIt
     element.m_pEncoding = pEncoding;
     element.m_sFontName = pmbFontName;
 
+    SortFonts();
     it = std::equal_range( m_vecFonts.begin(), m_vecFonts.end(), element );
     
     if( it.first == it.second )
@@ -517,6 +521,7 @@ PdfFont* PdfFontCache::GetFont( const LOGFONTA &logFont,
     PdfFont*          pFont;
     std::pair<TISortedFontList,TCISortedFontList> it;
 
+    SortFonts();
     it = std::equal_range( m_vecFonts.begin(), m_vecFonts.end(), 
          TFontCacheElement( logFont.lfFaceName, logFont.lfWeight >= FW_BOLD ? true : false, logFont.lfItalic ? true : false, logFont.lfCharSet == SYMBOL_CHARSET, pEncoding ) );
     if( it.first == it.second )
@@ -535,6 +540,7 @@ PdfFont* PdfFontCache::GetFont( const LOGFONTW &logFont,
     PdfFont*          pFont;
     std::pair<TISortedFontList,TCISortedFontList> it;
 
+    SortFonts();
     it = std::equal_range( m_vecFonts.begin(), m_vecFonts.end(), 
          TFontCacheElement( logFont.lfFaceName, logFont.lfWeight >= FW_BOLD ? true : false, logFont.lfItalic ? true : false, logFont.lfCharSet == SYMBOL_CHARSET, pEncoding ) );
     if( it.first == it.second )
@@ -562,6 +568,7 @@ PdfFont* PdfFontCache::GetFont( FT_Face face, bool bSymbolCharset, bool bEmbedd,
     bool bBold   = ((face->style_flags & FT_STYLE_FLAG_BOLD)   != 0);
     bool bItalic = ((face->style_flags & FT_STYLE_FLAG_ITALIC) != 0);
 
+    SortFonts();
     it = std::equal_range( m_vecFonts.begin(), m_vecFonts.end(), 
                TFontCacheElement( sName.c_str(), bBold, bItalic, bSymbolCharset, pEncoding ) );
     if( it.first == it.second )
@@ -617,10 +624,12 @@ PdfFont* PdfFontCache::GetDuplicateFontType1( PdfFont * pFont, const char* pszSu
         element.m_sFontName = name;
         element.m_pEncoding = newFont->GetEncoding();
           element.m_bIsSymbolCharset = pFont->GetFontMetrics()->IsSymbol();
-        m_vecFonts  .push_back( element );
-        
-        // Now sort the font list
-        std::sort( m_vecFonts.begin(), m_vecFonts.end() );
+
+        // The font list is sorted on the next lookup by name, so that
+        // resolving the fonts of many existing objects stays linear
+        m_vecFonts.push_back( element );
+        m_bFontsSorted = false;
+        m_mapFonts[newFont->GetObject()->Reference()] = newFont;
     }
 
     return newFont;
@@ -658,7 +667,12 @@ PdfFont* PdfFontCache::GetFontSubset( const char* pszFontName, bool bBold, bool
             sPath = pszFileName;
         }
         
-        pMetrics = PdfFontMetricsFreetype::CreateForSubsetting( &m_ftLibrary, sPath.c_str(), bSymbolCharset, genSubsetBasename() );
+        // The shared file contents are the same data CreateForSubsetting
+        // would load from the font file
+        if( m_pSharedCache && PdfFontMetrics::FontTypeFromFilename( sPath.c_str() ) == ePdfFontType_TrueType )
+            pMetrics = new PdfFontMetricsFreetype( &m_ftLibrary, m_pSharedCache, sPath.c_str(), bSymbolCharset, genSubsetBasename() );
+        else
+            pMetrics = PdfFontMetricsFreetype::CreateForSubsetting( &m_ftLibrary, sPath.c_str(), bSymbolCharset, genSubsetBasename() );
         pFont = this->CreateFontObject( it.first, m_vecFontSubsets, pMetrics, 
                                         true, bBold, bItalic, pszFontName, pEncoding, true );
     }
@@ -859,6 +873,10 @@ std::string PdfFontCache::GetFontConfigFontPath( FcConfig* pConfig, const char*
 
 std::string PdfFontCache::GetFontPath( const char* pszFontName, bool bBold, bool bItalic )
 {
+    std::string sCachedPath;
+    if( m_pSharedCache && m_pSharedCache->GetFontPath( pszFontName, bBold, bItalic, sCachedPath ) )
+        return sCachedPath;
+
 #if defined(PODOFO_HAVE_FONTCONFIG)
     Util::PdfMutexWrapper mutex(m_fontConfig.GetFontConfigMutex());
     FcConfig* pFcConfig = static_cast<FcConfig*>(m_fontConfig.GetFontConfig());
@@ -867,6 +885,9 @@ std::string PdfFontCache::GetFontPath( const char* pszFontName, bool bBold, bool
 #else
     std::string sPath = "";
 #endif
+    if( m_pSharedCache )
+        m_pSharedCache->AddFontPath( pszFontName, bBold, bItalic, sPath );
+
     return sPath;
 }
 
@@ -905,6 +926,7 @@ PdfFont* PdfFontCache::CreateFontObject( TISortedFontList itSorted, TSortedFontL
             
             // Do a sorted insert, so no need to sort again
             rvecContainer.insert( itSorted, element );
+            m_mapFonts[pFont->GetObject()->Reference()] = pFont;
         }
     } catch( PdfError & e ) {
         e.AddToCallstack( __FILE__, __LINE__ );
@@ -38,10 +38,13 @@
 #include "podofo/base/Pdf3rdPtyForwardDecl.h"
 #include "podofo/base/PdfEncoding.h"
 #include "podofo/base/PdfEncodingFactory.h"
+#include "podofo/base/PdfReference.h"
 
 #include "PdfFont.h"
 #include "PdfFontConfigWrapper.h"
 
+#include <map>
+
 #ifdef _WIN32
 
 // to have LOGFONTA/LOGFONTW available
@@ -67,6 +70,7 @@
 namespace PoDoFo {
 
 class PdfFontMetrics;
+class PdfSharedFontCache;
 class PdfVecObjects;
 
 /** A private structure,
@@ -171,6 +175,10 @@ class PODOFO_DOC_API PdfFontCache {
     typedef TSortedFontList::iterator       TISortedFontList;
     typedef TSortedFontList::const_iterator TCISortedFontList;
 
+    typedef std::map<PdfReference,PdfFont*> TMapFonts;
+    typedef TMapFonts::iterator             TIMapFonts;
+    typedef TMapFonts::const_iterator       TCIMapFonts;
+
  public:
 
     /**
@@ -349,6 +357,22 @@ class PODOFO_DOC_API PdfFontCache {
      */
     inline void SetFontConfigWrapper(const PdfFontConfigWrapper & rFontConfig);
 
+    /**
+     * Use a cache of font files, font lookups and glyph widths
+     * which is shared with the font caches of other documents.
+     *
+     * Only fonts created after this call use the shared cache.
+     *
+     * \param pSharedCache a shared cache which has to outlive this
+     *                     object or NULL to stop using a shared cache
+     */
+    inline void SetSharedFontCache( PdfSharedFontCache* pSharedCache );
+
+    /**
+     * \returns the shared cache used by this object or NULL
+     */
+    inline PdfSharedFontCache* GetSharedFontCache() const;
+
  private:
     /**
      * Get the path to a font file for a certain fontname
@@ -430,15 +454,23 @@ class PODOFO_DOC_API PdfFontCache {
 
  protected:
     void Init(void);
+
+    /** Sort m_vecFonts if fonts were appended to it,
+     *  which has to be done before searching it by name.
+     */
+    void SortFonts();
 	
  private:
     TSortedFontList m_vecFonts;              ///< Sorted list of all fonts, currently in the cache
     TSortedFontList m_vecFontSubsets;
+    TMapFonts       m_mapFonts;              ///< All fonts of m_vecFonts and m_vecFontSubsets by the reference of their font object
+    bool            m_bFontsSorted;          ///< False if fonts were appended to m_vecFonts since it was last sorted
     FT_Library      m_ftLibrary;             ///< Handle to the freetype library
 
     PdfVecObjects*  m_pParent;               ///< Handle to parent for creating new fonts and objects
 
     PdfFontConfigWrapper m_fontConfig;       ///< Handle to the fontconfig library
+    PdfSharedFontCache*  m_pSharedCache;     ///< Font data shared with other documents, may be NULL
 
     char m_sSubsetBasename[SUBSET_BASENAME_LEN + 2]; //< For genSubsetBasename()
 };
@@ -460,6 +492,22 @@ inline void PdfFontCache::SetFontConfigWrapper(const PdfFontConfigWrapper & rFon
     m_fontConfig = rFontConfig;
 }
 
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline void PdfFontCache::SetSharedFontCache( PdfSharedFontCache* pSharedCache )
+{
+    m_pSharedCache = pSharedCache;
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline PdfSharedFontCache* PdfFontCache::GetSharedFontCache() const
+{
+    return m_pSharedCache;
+}
+
 };
 
 #endif /* _PDF_FONT_CACHE_H_ */
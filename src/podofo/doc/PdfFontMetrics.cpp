@@ -984,6 +984,47 @@ double PdfFontMetrics::StringWidth( const pdf_utf16be* pszText, unsigned int nLe
     return dWidth;
 }
 
+double PdfFontMetrics::StringWidths( const pdf_utf16be* pszText, unsigned int nLength, std::vector<double> & rvecWidths ) const
+{
+    double dWidth = 0.0;
+    unsigned short uChar;
+
+    rvecWidths.clear();
+    if( !pszText )
+        return dWidth;
+
+    if( !nLength )
+    {
+        const pdf_utf16be* pszCount = pszText;
+        while( *pszCount )
+        {
+            ++pszCount;
+            ++nLength;
+        }
+    }
+
+    // The word spacing is the same for all spaces
+    const double dWordSpace = m_fWordSpace * this->GetFontScale() / 100.0;
+
+    rvecWidths.resize( nLength );
+    for ( unsigned int i=0; i<nLength; i++ )
+    {
+#ifdef PODOFO_IS_LITTLE_ENDIAN
+        uChar = static_cast<unsigned short>(((pszText[i] & 0x00ff) << 8 | (pszText[i] & 0xff00) >> 8));
+#else
+        uChar = static_cast<unsigned short>(pszText[i]);
+#endif // PODOFO_IS_LITTLE_ENDIAN
+        double dCharWidth = UnicodeCharWidth( uChar );
+        if ( uChar == 0x0020 )
+            dCharWidth += dWordSpace;
+
+        rvecWidths[i] = dCharWidth;
+        dWidth       += dCharWidth;
+    }
+
+    return dWidth;
+}
+
 #ifndef _WCHAR_T_DEFINED
 #if defined(_MSC_VER)  &&  _MSC_VER <= 1200    // not for MS Visual Studio 6
 #else
@@ -111,6 +111,21 @@ class PODOFO_DOC_API PdfFontMetrics {
      */
     double StringWidth( const pdf_utf16be* pszText, unsigned int nLength = 0 ) const;
 
+    /** Retrieve the widths of all characters of a given text string
+     *  in PDF units when drawn with the current font.
+     *
+     *  The width of any substring is the sum of its character widths,
+     *  so callers that measure many parts of the same text (e.g. for
+     *  line breaking) have to measure the text only once.
+     *
+     *  \param pszText a text string of which the widths should be calculated
+     *  \param nLength if != 0 only the widths of the nLength first characters are calculated
+     *  \param rvecWidths the width of each character, including the word spacing
+     *                    of spaces, is stored in this vector
+     *  \returns the width of the whole string, the same as StringWidth
+     */
+    double StringWidths( const pdf_utf16be* pszText, unsigned int nLength, std::vector<double> & rvecWidths ) const;
+
 #ifndef _WCHAR_T_DEFINED
 #if defined(_MSC_VER)  &&  _MSC_VER <= 1200    // not for MS Visual Studio 6
 #else
@@ -80,6 +80,39 @@ PdfFontMetricsBase14::PdfFontMetricsBase14(const char      *mfont_name,
     m_dLineSpacing        = (static_cast<double>(ascent + abs(descent)) / units_per_EM);
     m_dAscent             = static_cast<double>(ascent) /  units_per_EM;
     m_dDescent            = static_cast<double>(descent) /  units_per_EM;
+
+    InitGlyphTables();
+}
+
+#define PODOFO_NO_GLYPH 0xFFFF
+
+void PdfFontMetricsBase14::InitGlyphTables()
+{
+    // GetGlyphId and GetGlyphIdUnicode are called for every character
+    // that is measured, so do the linear searches of widths_table only once
+    m_vecCharGlyph.resize( 256, 0 );
+    m_vecUnicodeGlyph.resize( 256 );
+    if( !widths_table ) // terminating entry of PODOFO_BUILTIN_FONTS
+        return;
+
+    std::vector<bool> vecCharFound( 256, false );
+    for( int i = 0; widths_table[i].unicode != 0xFFFF; ++i ) 
+    {
+        // The first entry of a character wins, like in a linear search
+        const int nCode = widths_table[i].char_cd;
+        if( nCode >= 0 && nCode < 256 && !vecCharFound[nCode] ) 
+        {
+            m_vecCharGlyph[nCode] = static_cast<pdf_uint16>(i);
+            vecCharFound[nCode]   = true;
+        }
+
+        std::vector<pdf_uint16> & rPage = m_vecUnicodeGlyph[widths_table[i].unicode >> 8];
+        if( rPage.empty() )
+            rPage.resize( 256, PODOFO_NO_GLYPH );
+
+        if( rPage[widths_table[i].unicode & 0xFF] == PODOFO_NO_GLYPH )
+            rPage[widths_table[i].unicode & 0xFF] = static_cast<pdf_uint16>(i);
+    }
 }
 
 PdfFontMetricsBase14::~PdfFontMetricsBase14()
@@ -189,18 +222,23 @@ long PdfFontMetricsBase14::GetGlyphIdUnicode( long lUnicode ) const
       lUnicode = lUnicode | 0xf000;
       }
     */
-    
-    for(int i = 0; widths_table[i].unicode != 0xFFFF ; ++i)
+
+    // Use the first entry of widths_table which matches
+    // either byte order of the character
+    long lFound = PODOFO_NO_GLYPH;
+    if( lUnicode >= 0 && lUnicode <= 0xFFFF ) 
     {
-        if( widths_table[i].unicode == lUnicode ||
-            widths_table[i].unicode == lSwappedUnicode )
-        {
-            lGlyph = i; //widths_table[i].char_cd ;
-            break;
-        }
+        const std::vector<pdf_uint16> & rPage = m_vecUnicodeGlyph[lUnicode >> 8];
+        if( !rPage.empty() )
+            lFound = rPage[lUnicode & 0xFF];
     }
-    
-    //FT_Get_Char_Index( m_face, lUnicode );
+
+    const std::vector<pdf_uint16> & rSwappedPage = m_vecUnicodeGlyph[lSwappedUnicode >> 8];
+    if( !rSwappedPage.empty() && rSwappedPage[lSwappedUnicode & 0xFF] < lFound )
+        lFound = rSwappedPage[lSwappedUnicode & 0xFF];
+
+    if( lFound != PODOFO_NO_GLYPH )
+        lGlyph = lFound;
 	
     return lGlyph;
 }
@@ -217,6 +255,9 @@ long PdfFontMetricsBase14::GetGlyphId( long charId ) const
       }
     */
     
+    if( charId >= 0 && charId < 256 )
+        return m_vecCharGlyph[charId];
+
     for(int i = 0; widths_table[i].unicode != 0xFFFF  ; ++i)
     {
         if (widths_table[i].char_cd == charId) 
@@ -226,8 +267,6 @@ long PdfFontMetricsBase14::GetGlyphId( long charId ) const
         }
     }
     
-    //FT_Get_Char_Index( m_face, lUnicode );
-
     return lGlyph;
 }
 
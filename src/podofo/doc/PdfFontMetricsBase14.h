@@ -277,6 +277,12 @@ private :
 
 	int units_per_EM;
 
+    /** Build the glyph lookup tables below from widths_table.
+     */
+    void InitGlyphTables();
+
+    std::vector<pdf_uint16> m_vecCharGlyph;    ///< Glyph id of each character code < 256
+    std::vector< std::vector<pdf_uint16> > m_vecUnicodeGlyph; ///< Glyph ids of unicode characters, in pages of 256 characters. Pages without glyphs are empty.
 };
 
 
@@ -40,6 +40,7 @@
 #include "base/PdfVariant.h"
 
 #include "PdfFontFactory.h"
+#include "PdfSharedFontCache.h"
 
 #include <iostream>
 #include <sstream>
@@ -51,6 +52,8 @@
 
 #define PODOFO_FIRST_READABLE 31
 #define PODOFO_WIDTH_CACHE_SIZE 256
+#define PODOFO_WIDTH_UNKNOWN (-1.0) ///< Marks characters of m_vecUnicodeWidth that were not measured yet
+#define PODOFO_WIDTH_MISSING (-2.0) ///< Marks characters of m_vecUnicodeWidth that FreeType could not load
 
 namespace PoDoFo {
 
@@ -118,6 +121,19 @@ PdfFontMetricsFreetype::PdfFontMetricsFreetype( FT_Library* pLibrary, const char
     InitFromFace(pIsSymbol);
 }
 
+PdfFontMetricsFreetype::PdfFontMetricsFreetype( FT_Library* pLibrary, PdfSharedFontCache* pSharedCache, 
+                                                const char* pszFilename, bool pIsSymbol,
+                                                const char* pszSubsetPrefix )
+    : PdfFontMetrics( PdfFontMetrics::FontTypeFromFilename( pszFilename ),
+                      pszFilename, pszSubsetPrefix ),
+      m_pLibrary( pLibrary ),
+      m_pFace( NULL ),
+      m_bSymbol( pIsSymbol ),
+      m_bufFontData( pSharedCache->GetFontFile( pszFilename ) )
+{
+    InitFromBuffer(pIsSymbol, pSharedCache);
+}
+
 PdfFontMetricsFreetype::PdfFontMetricsFreetype( FT_Library* pLibrary, 
                                                 const char* pBuffer, unsigned int nBufLen,
                                                                 bool pIsSymbol,
@@ -174,7 +190,7 @@ PdfFontMetricsFreetype::~PdfFontMetricsFreetype()
     }
 }
 
-void PdfFontMetricsFreetype::InitFromBuffer(bool pIsSymbol)
+void PdfFontMetricsFreetype::InitFromBuffer(bool pIsSymbol, PdfSharedFontCache* pSharedCache)
 {
     FT_Open_Args openArgs;
     memset(&openArgs, 0, sizeof(openArgs));
@@ -187,16 +203,16 @@ void PdfFontMetricsFreetype::InitFromBuffer(bool pIsSymbol)
         PdfError::LogMessage( eLogSeverity_Critical, "FreeType returned the error %i when calling FT_New_Face for a buffered font.", error );
         PODOFO_RAISE_ERROR( ePdfError_FreeType );
     }
-    else
+    else if( m_eFontType == ePdfFontType_Unknown )
     {
         // asume true type
         this->SetFontType( ePdfFontType_TrueType );
     }
 
-    InitFromFace(pIsSymbol);
+    InitFromFace(pIsSymbol, pSharedCache);
 }
 
-void PdfFontMetricsFreetype::InitFromFace(bool pIsSymbol)
+void PdfFontMetricsFreetype::InitFromFace(bool pIsSymbol, PdfSharedFontCache* pSharedCache)
 {
     if ( m_eFontType == ePdfFontType_Unknown ) {
         // We need to have identified the font type by this point
@@ -242,29 +258,35 @@ void PdfFontMetricsFreetype::InitFromFace(bool pIsSymbol)
     
         // we cache the 256 first width entries as they
         // are most likely needed quite often
-        m_vecWidth.clear();
-        m_vecWidth.reserve( PODOFO_WIDTH_CACHE_SIZE );
-        for( unsigned int i=0; i < PODOFO_WIDTH_CACHE_SIZE; i++ )
+        if( !pSharedCache || !pSharedCache->GetWidths( m_sFilename.c_str(), pIsSymbol, m_vecWidth ) )
         {
-            if( i < PODOFO_FIRST_READABLE || !m_pFace )
-                m_vecWidth.push_back( 0.0  );
-            else
+            m_vecWidth.clear();
+            m_vecWidth.reserve( PODOFO_WIDTH_CACHE_SIZE );
+            for( unsigned int i=0; i < PODOFO_WIDTH_CACHE_SIZE; i++ )
             {
-                int index = i;
-                // Handle symbol fonts
-                if( m_bSymbol ) 
+                if( i < PODOFO_FIRST_READABLE || !m_pFace )
+                    m_vecWidth.push_back( 0.0  );
+                else
                 {
-                    index = index | 0xf000;
-                }
-
-                if( FT_Load_Char( m_pFace, index, FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP) == 0 )  // | FT_LOAD_NO_RENDER
-                {
-                    m_vecWidth.push_back( static_cast<double>(m_pFace->glyph->metrics.horiAdvance) * 1000.0 / m_pFace->units_per_EM );
-                    continue;
-                }
+                    int index = i;
+                    // Handle symbol fonts
+                    if( m_bSymbol ) 
+                    {
+                        index = index | 0xf000;
+                    }
+
+                    if( FT_Load_Char( m_pFace, index, FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP) == 0 )  // | FT_LOAD_NO_RENDER
+                    {
+                        m_vecWidth.push_back( static_cast<double>(m_pFace->glyph->metrics.horiAdvance) * 1000.0 / m_pFace->units_per_EM );
+                        continue;
+                    }
                 
-                m_vecWidth.push_back( 0.0  );
+                    m_vecWidth.push_back( 0.0  );
+                }
             }
+
+            if( pSharedCache )
+                pSharedCache->AddWidths( m_sFilename.c_str(), pIsSymbol, m_vecWidth );
         }
     }
 
@@ -399,11 +421,25 @@ double PdfFontMetricsFreetype::UnicodeCharWidth( unsigned short c ) const
     }
     else
     {
-        ftErr = FT_Load_Char( m_pFace, static_cast<FT_UInt>(c), FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP );
-        if( ftErr )
+        if( m_vecUnicodeWidth.empty() )
+            m_vecUnicodeWidth.resize( 0x10000 / PODOFO_WIDTH_CACHE_SIZE );
+
+        std::vector<double> & rPage = m_vecUnicodeWidth[c / PODOFO_WIDTH_CACHE_SIZE];
+        if( rPage.empty() )
+            rPage.resize( PODOFO_WIDTH_CACHE_SIZE, PODOFO_WIDTH_UNKNOWN );
+
+        double & rdCached = rPage[c % PODOFO_WIDTH_CACHE_SIZE];
+        if( rdCached == PODOFO_WIDTH_UNKNOWN ) 
+        {
+            ftErr = FT_Load_Char( m_pFace, static_cast<FT_UInt>(c), FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP );
+            rdCached = ftErr ? PODOFO_WIDTH_MISSING : 
+                m_pFace->glyph->metrics.horiAdvance * 1000.0 / m_pFace->units_per_EM;
+        }
+
+        if( rdCached == PODOFO_WIDTH_MISSING )
             return dWidth;
 
-        dWidth = m_pFace->glyph->metrics.horiAdvance * 1000.0 / m_pFace->units_per_EM;
+        dWidth = rdCached;
     }
 
     return dWidth * static_cast<double>(this->GetFontSize() * this->GetFontScale() / 100.0) / 1000.0 +
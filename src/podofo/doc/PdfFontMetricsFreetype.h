@@ -43,6 +43,7 @@ namespace PoDoFo {
 
 class PdfArray;
 class PdfObject;
+class PdfSharedFontCache;
 class PdfVariant;
 
 class PODOFO_DOC_API PdfFontMetricsFreetype : public PdfFontMetrics {
@@ -56,6 +57,19 @@ class PODOFO_DOC_API PdfFontMetricsFreetype : public PdfFontMetrics {
     PdfFontMetricsFreetype( FT_Library* pLibrary, const char* pszFilename, 
 			 bool pIsSymbol, const char* pszSubsetPrefix = NULL );
 
+    /** Create a font metrics object for a given true type file
+     *  whose contents and glyph widths are taken from a cache,
+     *  which is shared with other documents.
+     *
+     *  \param pLibrary handle to an initialized FreeType2 library handle
+     *  \param pSharedCache the shared cache, which has to outlive this object
+     *  \param pszFilename filename of a truetype file
+     *  \param pIsSymbol whether use a symbol encoding, rather than unicode
+     *  \param pszSubsetPrefix unique prefix for font subsets (see GetFontSubsetPrefix)
+     */
+    PdfFontMetricsFreetype( FT_Library* pLibrary, PdfSharedFontCache* pSharedCache, const char* pszFilename,
+                            bool pIsSymbol, const char* pszSubsetPrefix = NULL );
+
     /** Create a font metrics object for a given memory buffer
      *  \param pLibrary handle to an initialized FreeType2 library handle
      *  \param pBuffer block of memory representing the font data (PdfFontMetricsFreetype will copy the buffer)
@@ -273,14 +287,16 @@ class PODOFO_DOC_API PdfFontMetricsFreetype : public PdfFontMetrics {
     /** Initialize this object from an in memory buffer
      *  Called internally by the constructors
 	  * \param pIsSymbol Whether use a symbol charset, rather than unicode
+     * \param pSharedCache if not NULL, widths are looked up in and added to this cache
      */
-    void InitFromBuffer(bool pIsSymbol);
+    void InitFromBuffer(bool pIsSymbol, PdfSharedFontCache* pSharedCache = NULL);
 
     /** Load the metric data from the FTFace data
      *		Called internally by the constructors
 	  * \param pIsSymbol Whether use a symbol charset, rather than unicode
+     * \param pSharedCache if not NULL, widths are looked up in and added to this cache
      */
-    void InitFromFace(bool pIsSymbol);
+    void InitFromFace(bool pIsSymbol, PdfSharedFontCache* pSharedCache = NULL);
 
     void InitFontSizes();
  protected:
@@ -308,6 +324,12 @@ class PODOFO_DOC_API PdfFontMetricsFreetype : public PdfFontMetrics {
 
     PdfRefCountedBuffer m_bufFontData;
     std::vector<double> m_vecWidth;
+
+    /** Widths of all other characters of the BMP, in pages of 256
+     *  characters which are allocated on first use and filled
+     *  as characters are measured.
+     */
+    mutable std::vector< std::vector<double> > m_vecUnicodeWidth;
 };
 
 // -----------------------------------------------------
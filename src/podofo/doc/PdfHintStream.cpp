@@ -35,85 +35,28 @@
 
 #include "base/PdfDefinesPrivate.h"
 
-#include "base/PdfData.h"
 #include "base/PdfDictionary.h"
 #include "base/PdfStream.h"
 #include "base/PdfVariant.h"
 #include "base/PdfVecObjects.h"
 
-#include "PdfPage.h"
-#include "PdfPagesTree.h"
-
-// See PdfWriter.cpp
-#define LINEARIZATION_PADDING "1234567890"
-
 using namespace PoDoFo;
 
 namespace {
 
-struct TPageEntrySharedObjectInfo {
-    pdf_uint16 nIndex;
-    pdf_uint16 nNumerator;
-};
-
-typedef std::vector<TPageEntrySharedObjectInfo>       TVecPageEntrySharedObjectInfo;
-typedef TVecPageEntrySharedObjectInfo::iterator       TIVecPageEntrySharedObjectInfo;
-typedef TVecPageEntrySharedObjectInfo::const_iterator TCIVecPageEntrySharedObjectInfo;
-
-#if 0
-class PdfPageOffsetEntry {
-public:
-    PdfPageOffsetEntry()
-        : nObjectsPerPage( 0 ),
-          nPageLength( 0 ),
-          nSharedObjects( 0 ),
-
-          nContentsOffset( 0 ),
-          nContentsLength( 0 )
-    {
-        vecSharedObjects.resize( 0 );
-    }
-
-    pdf_uint16 nObjectsPerPage;
-    pdf_uint16 nPageLength;
-    pdf_uint16 nSharedObjects;
-
-    // item4 and item5:
-    TVecPageEntrySharedObjectInfo vecSharedObjects;
-
-    pdf_uint16 nContentsOffset;
-    pdf_uint16 nContentsLength;
-
-public:
-    void Write( PoDoFo::NonPublic::PdfHintStream* pHint );
-};
-
-void PdfPageOffsetEntry::Write( PoDoFo::NonPublic::PdfHintStream* pHint )
+/** \returns the number of bits required to represent value
+ */
+pdf_uint16 BitsRequired( pdf_uint32 value )
 {
-    TCIVecPageEntrySharedObjectInfo it;
-
-    pHint->WriteUInt16( nObjectsPerPage );
-    pHint->WriteUInt16( nPageLength );
-    pHint->WriteUInt16( nSharedObjects );
-
-    it = vecSharedObjects.begin();
-    while( it != vecSharedObjects.end() )
-    {
-        pHint->WriteUInt16( (*it).nIndex );
-        ++it;
-    }
-
-    it = vecSharedObjects.begin();
-    while( it != vecSharedObjects.end() )
+    pdf_uint16 nBits = 0;
+    while( value )
     {
-        pHint->WriteUInt16( (*it).nNumerator );
-        ++it;
+        ++nBits;
+        value >>= 1;
     }
 
-    pHint->WriteUInt16( nContentsOffset );
-    pHint->WriteUInt16( nContentsLength );
+    return nBits;
 }
-#endif
 
 class PdfPageOffsetHeader {
 public:
@@ -138,7 +81,7 @@ public:
     // item1: The least number of objects in a page including the page itself
     pdf_uint32 nLeastNumberOfObjects;
     // item2: The location of the first pages page object
-    pdf_uint32 nFirstPageObject; // (*pXRef)[0].vecOffsets[ m_pPagesTree->GetPage( 0 )->Object()->Reference().ObjectNumber() ].lOffset;
+    pdf_uint32 nFirstPageObject;
     // item3: The number of bits needed to represent the difference between the 
     //        greatest and least number of objects in a page
     pdf_uint16 nBitsPageObject; // (pdf_uint16)ceil( logb( (double)(max-least) ) );
@@ -167,9 +110,10 @@ public:
     // item11: The number of bits needed to represent the nummerically 
     //         greatest shared object identifyer used by pages
     pdf_uint16 nBitsGreatestSharedObject;
-    // item12: 
+    // item12: The number of bits needed to represent the numerator
+    //         of the fractional position of a shared object
     pdf_uint16 nItem12;
-    // item13:
+    // item13: The denominator of the fractional position of a shared object
     pdf_uint16 nItem13;
 
     void Write( PoDoFo::NonPublic::PdfHintStream* pHint )
@@ -231,12 +175,9 @@ namespace PoDoFo {
 
 namespace NonPublic {
 
-PdfHintStream::PdfHintStream( PdfVecObjects* pParent, PdfPagesTree* pPagesTree )
-    : PdfElement( NULL, pParent ), m_pPagesTree( pPagesTree )
+PdfHintStream::PdfHintStream( PdfVecObjects* pParent )
+    : PdfElement( NULL, pParent ), m_lLength( 0 ), m_nBitBuffer( 0 ), m_nBitCount( 0 )
 {
-    // This is overwritten later with valid data!
-    PdfVariant place_holder( PdfData( LINEARIZATION_PADDING ) );
-    this->GetObject()->GetDictionary().AddKey( "S", place_holder ); // shared object hint table
 }
 
 PdfHintStream::~PdfHintStream()
@@ -244,130 +185,164 @@ PdfHintStream::~PdfHintStream()
 
 }
 
-/*
-void PdfHintStream::Create( TVecXRefTable* pXRef )
-{
-    this->CreatePageHintTable( pXRef );
-    this->CreateSharedObjectHintTable();
-}
-
-void PdfHintStream::CreatePageHintTable( TVecXRefTable* pXRef )
+void PdfHintStream::Create( const TVecPageHints & vecPages, pdf_uint32 lFirstPageOffset, 
+                            const std::vector<pdf_uint32> & vecShared, pdf_uint32 nFirstPageShared, 
+                            pdf_uint32 nFirstSharedObject, pdf_uint32 lFirstSharedOffset )
 {
-    TPdfReferenceList   lstPages;
-    TCIPdfReferenceList it;
-    int                 i;
-    int                 nPageCount = m_pPagesTree->GetTotalNumberOfPages();
-
-    PdfPageOffsetHeader header;
-#if 1
-	// this will init/construct each of the objects in the vector
-	// AND it compiles on all platforms - where the below code
-	// isn't 100% valid for all C++ compilers
-	std::vector< PdfPageOffsetEntry >	vecPages( nPageCount );
-#else
-    // use an array instead of an vector,
-    // to make sure the constructors are called,
-    // which they are apparently not when using vector.resize
-    PdfPageOffsetEntry  vecPages[nPageCount];
-#endif
-
-    pdf_uint32        max;
-    pdf_uint32        least = 0;
-    pdf_uint32        maxNumberOfObjects = 0;
-    pdf_uint32        maxPageLength      = 0;
-    pdf_uint32        value;
-    PdfReference      maxRef;
-
-    for( i=0;i<nPageCount;i++ )
+    if( vecPages.empty() || nFirstPageShared > vecShared.size() )
     {
-        lstPages.clear();
-
-        this->GetObject()->GetParent()->GetObjectDependencies( m_pPagesTree->GetPage( i )->GetObject(), &lstPages );
-        vecPages[i].nObjectsPerPage = lstPages.size();
-
-        if( !header.nLeastNumberOfObjects || header.nLeastNumberOfObjects > lstPages.size() )
-            header.nLeastNumberOfObjects = lstPages.size();
-
-        if( !maxNumberOfObjects || maxNumberOfObjects < lstPages.size() )
-            maxNumberOfObjects = lstPages.size();
-
-        it    = lstPages.begin();
-        least = 0;
-        max   = 0;
-        while( it != lstPages.end() ) 
-        {
-            value = (*pXRef)[0].vecOffsets[ (*it).ObjectNumber() ].lOffset;
-
-            if( !least || least > value )
-                least = value;
-
-            if( !max || max < value )
-            {
-                max    = value;
-                maxRef = *it;
-            }
-
-            ++it;
-        }
-
-        max += this->GetObject()->GetParent()->GetObject( maxRef )->GetObjectLength();
-
-        vecPages[i].nPageLength     = max - least;
-
-        if( !header.nLeastPageLength || header.nLeastPageLength > vecPages[i].nPageLength )
-            header.nLeastPageLength = vecPages[i].nPageLength;
+        PODOFO_RAISE_ERROR( ePdfError_ValueOutOfRange );
+    }
 
-        if( !maxPageLength || maxPageLength < max )
-            maxPageLength = max;
+    m_lLength    = 0;
+    m_nBitBuffer = 0;
+    m_nBitCount  = 0;
 
-        vecPages[i].nSharedObjects  = 0;
-        vecPages[i].nContentsOffset = 0;
-        vecPages[i].nContentsLength = 0;
-    }
+    this->GetObject()->GetStream()->BeginAppend();
+    this->CreatePageHintTable( vecPages, lFirstPageOffset );
 
-    header.nFirstPageObject              = (*pXRef)[0].vecOffsets[ m_pPagesTree->GetPage( 0 )->GetObject()->Reference().ObjectNumber() ].lOffset;
-    header.nBitsPageObject               = (pdf_uint16)ceil( logb( static_cast<double>(maxNumberOfObjects-header.nLeastNumberOfObjects) ) );
-    header.nBitsPageLength               = (pdf_uint16)ceil( logb( static_cast<double>(maxPageLength - header.nLeastPageLength) ) );
-    header.nOffsetContentStream          = 0; // acrobat sets this to 0 and ignores it
-    header.nBitsContentStream            = 0; // acrobat sets this to 0 and ignores it
-    header.nLeastContentStreamLength     = 0; // acrobat sets this to 0 and ignores it
-    header.nBitsLeastContentStreamLength = 0; // acrobat sets this to 0 and ignores it
-    header.nBitsNumSharedObjects         = 0;
-    header.nBitsGreatestSharedObject     = 0;
-    header.nItem12                       = 0;
-    header.nItem13                       = 0;
+    // The shared object hint table follows the page offset hint table
+    this->GetObject()->GetDictionary().AddKey( "S", static_cast<pdf_int64>(m_lLength) );
+    this->CreateSharedObjectHintTable( vecShared, nFirstPageShared, nFirstSharedObject, lFirstSharedOffset );
+    this->GetObject()->GetStream()->EndAppend();
+}
 
-    for( i=0;i<nPageCount;i++ )
+void PdfHintStream::CreatePageHintTable( const TVecPageHints & vecPages, pdf_uint32 lFirstPageOffset )
+{
+    PdfPageOffsetHeader header;
+    TCIVecPageHints     it;
+    pdf_uint32          nMaxObjects   = 0;
+    pdf_uint32          nMaxLength    = 0;
+    pdf_uint32          nMaxShared    = 0;
+    pdf_uint32          nMaxSharedId  = 0;
+
+    header.nLeastNumberOfObjects = vecPages.front().nObjects;
+    header.nLeastPageLength      = vecPages.front().nLength;
+    for( it = vecPages.begin(); it != vecPages.end(); ++it )
     {
-        vecPages[i].nObjectsPerPage -= header.nLeastNumberOfObjects;
-        vecPages[i].nPageLength     -= header.nLeastPageLength;
-        vecPages[i].Write( this );
+        header.nLeastNumberOfObjects = PDF_MIN( header.nLeastNumberOfObjects, (*it).nObjects );
+        header.nLeastPageLength      = PDF_MIN( header.nLeastPageLength, (*it).nLength );
+        nMaxObjects                  = PDF_MAX( nMaxObjects, (*it).nObjects );
+        nMaxLength                   = PDF_MAX( nMaxLength, (*it).nLength );
+        nMaxShared                   = PDF_MAX( nMaxShared, static_cast<pdf_uint32>((*it).vecShared.size()) );
+
+        for( std::vector<pdf_uint32>::const_iterator itShared = (*it).vecShared.begin(); 
+             itShared != (*it).vecShared.end(); ++itShared )
+            nMaxSharedId = PDF_MAX( nMaxSharedId, *itShared );
     }
 
+    header.nFirstPageObject              = lFirstPageOffset;
+    header.nBitsPageObject               = BitsRequired( nMaxObjects - header.nLeastNumberOfObjects );
+    header.nBitsPageLength               = BitsRequired( nMaxLength - header.nLeastPageLength );
+    // Content streams are not written separately from the other 
+    // objects of a page, so the page length is used as content 
+    // stream length, like acrobat does.
+    header.nOffsetContentStream          = 0;
+    header.nBitsContentStream            = 0;
+    header.nLeastContentStreamLength     = header.nLeastPageLength;
+    header.nBitsLeastContentStreamLength = header.nBitsPageLength;
+    header.nBitsNumSharedObjects         = BitsRequired( nMaxShared );
+    header.nBitsGreatestSharedObject     = BitsRequired( nMaxSharedId );
+    header.nItem12                       = 0;
+    header.nItem13                       = 4;
     header.Write( this );
+
+    // Each item is written for all pages, starting at a byte boundary
+    for( it = vecPages.begin(); it != vecPages.end(); ++it )
+        this->WriteBits( (*it).nObjects - header.nLeastNumberOfObjects, header.nBitsPageObject );
+    this->FlushBits();
+
+    for( it = vecPages.begin(); it != vecPages.end(); ++it )
+        this->WriteBits( (*it).nLength - header.nLeastPageLength, header.nBitsPageLength );
+    this->FlushBits();
+
+    for( it = vecPages.begin(); it != vecPages.end(); ++it )
+        this->WriteBits( static_cast<pdf_uint32>((*it).vecShared.size()), header.nBitsNumSharedObjects );
+    this->FlushBits();
+
+    for( it = vecPages.begin(); it != vecPages.end(); ++it )
+        for( std::vector<pdf_uint32>::const_iterator itShared = (*it).vecShared.begin(); 
+             itShared != (*it).vecShared.end(); ++itShared )
+            this->WriteBits( *itShared, header.nBitsGreatestSharedObject );
+    this->FlushBits();
+
+    // The numerators of the shared objects and the content 
+    // stream offsets use 0 bits, so only the content stream
+    // lengths are left
+    for( it = vecPages.begin(); it != vecPages.end(); ++it )
+        this->WriteBits( (*it).nLength - header.nLeastContentStreamLength, header.nBitsLeastContentStreamLength );
+    this->FlushBits();
 }
 
-void PdfHintStream::CreateSharedObjectHintTable()
+void PdfHintStream::CreateSharedObjectHintTable( const std::vector<pdf_uint32> & vecShared, pdf_uint32 nFirstPageShared, 
+                                                 pdf_uint32 nFirstSharedObject, pdf_uint32 lFirstSharedOffset )
 {
-    PdfVariant offset( static_cast<long>(this->GetObject()->GetStream()->GetLength()) );
-    offset.SetPaddingLength( LINEARIZATION_PADDING );
+    PdfSharedObjectHeader                   header;
+    std::vector<pdf_uint32>::const_iterator it;
+    pdf_uint32                              nMaxLength = 0;
 
-    this->GetObject()->GetDictionary().AddKey( "S", offset ); // shared object hint table
+    header.nLeastLength = vecShared.empty() ? 0 : vecShared.front();
+    for( it = vecShared.begin(); it != vecShared.end(); ++it )
+    {
+        header.nLeastLength = PDF_MIN( header.nLeastLength, *it );
+        nMaxLength          = PDF_MAX( nMaxLength, *it );
+    }
+
+    const bool bSharedSection = vecShared.size() > nFirstPageShared;
+
+    header.nFirstObjectNumber         = bSharedSection ? nFirstSharedObject : 0;
+    header.nFirstObjectLocation       = bSharedSection ? lFirstSharedOffset : 0;
+    header.nNumSharedObjectsFirstPage = nFirstPageShared;
+    header.nNumSharedObjects          = static_cast<pdf_uint32>(vecShared.size());
+    header.nNumBits                   = 0; // every group is a single object
+    header.nNumBitsLengthDifference   = BitsRequired( nMaxLength - header.nLeastLength );
+    header.Write( this );
 
+    for( it = vecShared.begin(); it != vecShared.end(); ++it )
+        this->WriteBits( *it - header.nLeastLength, header.nNumBitsLengthDifference );
+    this->FlushBits();
 
+    // No group has a MD5 signature
+    for( it = vecShared.begin(); it != vecShared.end(); ++it )
+        this->WriteBits( 0, 1 );
+    this->FlushBits();
 }
-*/
 
 void PdfHintStream::WriteUInt16( pdf_uint16 val )
 {
     val = ::PoDoFo::compat::podofo_htons(val);
     this->GetObject()->GetStream()->Append( reinterpret_cast<char*>(&val), 2 );
+    m_lLength += 2;
 }
 
 void PdfHintStream::WriteUInt32( pdf_uint32 val )
 {
     val = ::PoDoFo::compat::podofo_htonl(val);
     this->GetObject()->GetStream()->Append( reinterpret_cast<char*>(&val), 4 );
+    m_lLength += 4;
+}
+
+void PdfHintStream::WriteBits( pdf_uint32 val, pdf_uint16 nBits )
+{
+    while( nBits-- ) 
+    {
+        m_nBitBuffer = (m_nBitBuffer << 1) | ((val >> nBits) & 0x01);
+        if( ++m_nBitCount == 8 ) 
+        {
+            char c = static_cast<char>(m_nBitBuffer);
+            this->GetObject()->GetStream()->Append( &c, 1 );
+            ++m_lLength;
+
+            m_nBitBuffer = 0;
+            m_nBitCount  = 0;
+        }
+    }
+}
+
+void PdfHintStream::FlushBits()
+{
+    if( m_nBitCount )
+        this->WriteBits( 0, static_cast<pdf_uint16>(8 - m_nBitCount) );
 }
 
 }; // end namespace PoDoFo::NonPublic
@@ -35,27 +35,55 @@
 #define _PDF_HINT_STREAM_H_
 
 #include "podofo/base/PdfDefines.h"
-#include "podofo/base/PdfWriter.h"
 #include "PdfElement.h"
 
 namespace PoDoFo {
 
-class PdfPagesTree;
-
 namespace NonPublic {
 
 // PdfHintStream is not part of the public API and is NOT exported as part of
 // the DLL/shared library interface. Do not rely on it.
 
+/** The primary hint stream of a linearized PDF file,
+ *  which contains the page offset hint table and
+ *  the shared object hint table.
+ *
+ *  \see PdfWriter::SetLinearized
+ */
 class PdfHintStream : public PdfElement {
  public:
-    PdfHintStream( PdfVecObjects* pParent, PdfPagesTree* pPagesTree );
+    /** Information about a single page, which is required
+     *  for the page offset hint table.
+     */
+    struct TPageHint {
+        pdf_uint32              nObjects;  ///< number of objects of the page including the page object
+        pdf_uint32              nLength;   ///< length of all objects of the page in bytes
+        std::vector<pdf_uint32> vecShared; ///< indexes of all shared object groups used by the page
+    };
+
+    typedef std::vector<TPageHint>          TVecPageHints;
+    typedef TVecPageHints::const_iterator   TCIVecPageHints;
+
+    PdfHintStream( PdfVecObjects* pParent );
     ~PdfHintStream();
 
-    /** Create the hint stream 
-     *  \param pXRef pointer to a valid XREF table structure
+    /** Create the hint stream.
+     *
+     *  All offsets have to be calculated as if the hint stream 
+     *  was not part of the file.
+     *
+     *  \param vecPages information about all pages in document order
+     *  \param lFirstPageOffset offset of the page object of the first page
+     *  \param vecShared lengths of all shared object groups, each consisting of a single object.
+     *         The first nFirstPageShared groups are the objects of the first page,
+     *         all others are the objects of the shared objects section.
+     *  \param nFirstPageShared number of groups belonging to the first page
+     *  \param nFirstSharedObject object number of the first object in the shared objects section
+     *  \param lFirstSharedOffset offset of the first object in the shared objects section
      */
-    //void Create( TVecXRefTable* pXRef );
+    void Create( const TVecPageHints & vecPages, pdf_uint32 lFirstPageOffset, 
+                 const std::vector<pdf_uint32> & vecShared, pdf_uint32 nFirstPageShared, 
+                 pdf_uint32 nFirstSharedObject, pdf_uint32 lFirstSharedOffset );
 
     /** Write a pdf_uint16 to the stream in big endian format.
      *  \param val the value to write to the stream
@@ -67,12 +95,28 @@ class PdfHintStream : public PdfElement {
      */
     void WriteUInt32( pdf_uint32 );
 
+    /** Write the nBits lowest bits of a value to the stream.
+     *  Call FlushBits to finish the last byte.
+     *
+     *  \param val the value to write to the stream
+     *  \param nBits number of bits to write, at most 32
+     */
+    void WriteBits( pdf_uint32 val, pdf_uint16 nBits );
+
+    /** Write any pending bits written by WriteBits to the
+     *  stream, padding the last byte with zeros.
+     */
+    void FlushBits();
+
  private:
-    //void CreatePageHintTable( TVecXRefTable* pXRef );
-    void CreateSharedObjectHintTable();
- 
+    void CreatePageHintTable( const TVecPageHints & vecPages, pdf_uint32 lFirstPageOffset );
+    void CreateSharedObjectHintTable( const std::vector<pdf_uint32> & vecShared, pdf_uint32 nFirstPageShared, 
+                                      pdf_uint32 nFirstSharedObject, pdf_uint32 lFirstSharedOffset );
+
  private:
-    PdfPagesTree* m_pPagesTree;
+    pdf_uint32 m_lLength;    ///< number of bytes written to the stream
+    pdf_uint32 m_nBitBuffer; ///< bits not yet written by WriteBits
+    pdf_uint16 m_nBitCount;  ///< number of valid bits in m_nBitBuffer
 };
 
 }; // end namespace NonPublic
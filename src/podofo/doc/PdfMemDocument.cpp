@@ -67,7 +67,7 @@ using namespace std;
 namespace PoDoFo {
 
 PdfMemDocument::PdfMemDocument()
-    : PdfDocument(), m_pEncrypt( NULL ), m_pParser( NULL ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
+    : PdfDocument(), m_pEncrypt( NULL ), m_pParser( NULL ), m_nWriteThreads( 1 ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
 #ifdef _WIN32
       m_wchar_pszUpdatingFilename( NULL ),
 #endif
@@ -80,7 +80,7 @@ PdfMemDocument::PdfMemDocument()
 }
 
 PdfMemDocument::PdfMemDocument(bool bOnlyTrailer)
-    : PdfDocument(bOnlyTrailer), m_pEncrypt( NULL ), m_pParser( NULL ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
+    : PdfDocument(bOnlyTrailer), m_pEncrypt( NULL ), m_pParser( NULL ), m_nWriteThreads( 1 ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
 #ifdef _WIN32
       m_wchar_pszUpdatingFilename( NULL ),
 #endif
@@ -93,7 +93,7 @@ PdfMemDocument::PdfMemDocument(bool bOnlyTrailer)
 }
 
 PdfMemDocument::PdfMemDocument( const char* pszFilename, bool bForUpdate )
-    : PdfDocument(), m_pEncrypt( NULL ), m_pParser( NULL ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
+    : PdfDocument(), m_pEncrypt( NULL ), m_pParser( NULL ), m_nWriteThreads( 1 ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
 #ifdef _WIN32
       m_wchar_pszUpdatingFilename( NULL ),
 #endif
@@ -106,7 +106,7 @@ PdfMemDocument::PdfMemDocument( const char* pszFilename, bool bForUpdate )
 #if defined(_MSC_VER)  &&  _MSC_VER <= 1200    // not for MS Visual Studio 6
 #else
 PdfMemDocument::PdfMemDocument( const wchar_t* pszFilename, bool bForUpdate )
-    : PdfDocument(), m_pEncrypt( NULL ), m_pParser( NULL ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
+    : PdfDocument(), m_pEncrypt( NULL ), m_pParser( NULL ), m_nWriteThreads( 1 ), m_bSoureHasXRefStream( false ), m_lPrevXRefOffset( -1 ),
       m_wchar_pszUpdatingFilename( NULL ), m_pszUpdatingFilename( NULL ), m_pUpdatingInputDevice( NULL )
 {
     this->Load( pszFilename, bForUpdate );
@@ -480,6 +480,7 @@ void PdfMemDocument::Write( PdfOutputDevice* pDevice )
     PdfWriter writer( &(this->GetObjects()), this->GetTrailer() );
     writer.SetPdfVersion( this->GetPdfVersion() );
     writer.SetWriteMode( m_eWriteMode );
+    writer.SetWriteThreads( m_nWriteThreads );
 
     if( m_pEncrypt ) 
         writer.SetEncrypted( *m_pEncrypt );
@@ -487,6 +488,15 @@ void PdfMemDocument::Write( PdfOutputDevice* pDevice )
     writer.Write( pDevice );    
 }
 
+size_t PdfMemDocument::MergeDuplicateObjects()
+{
+    // Pending subset fonts are embedded first, 
+    // so that they are compared to other fonts as well
+    m_fontCache.EmbedSubsetFonts();
+
+    return this->GetObjects().MergeDuplicates( PdfDocument::GetTrailer() );
+}
+
 void PdfMemDocument::WriteUpdate( const char* pszFilename )
 {
     if( !IsLoadedForUpdate() )
@@ -556,6 +566,7 @@ void PdfMemDocument::WriteUpdate( PdfOutputDevice* pDevice, bool bTruncate )
     PdfWriter writer( &(this->GetObjects()), this->GetTrailer() );
     writer.SetPdfVersion( this->GetPdfVersion() );
     writer.SetWriteMode( m_eWriteMode );
+    writer.SetWriteThreads( m_nWriteThreads );
     writer.SetIncrementalUpdate( true ); // PdfWriter::WriteUpdate() does it too, but let's make it explicit
 
     if( m_pEncrypt ) 
@@ -644,42 +655,11 @@ void PdfMemDocument::DeletePages( int inFirstPage, int inNumPages )
 
 const PdfMemDocument & PdfMemDocument::InsertPages( const PdfMemDocument & rDoc, int inFirstPage, int inNumPages )
 {
-    /*
-      This function works a bit different than one might expect. 
-      Rather than copying one page at a time - we copy the ENTIRE document
-      and then delete the pages we aren't interested in.
-      
-      We do this because 
-      1) SIGNIFICANTLY simplifies the process
-      2) Guarantees that shared objects aren't copied multiple times
-      3) offers MUCH faster performance for the common cases
-      
-      HOWEVER: because PoDoFo doesn't currently do any sort of "object garbage collection" during
-      a Write() - we will end up with larger documents, since the data from unused pages
-      will also be in there.
-    */
-
-    // calculate preliminary "left" and "right" page ranges to delete
-    // then offset them based on where the pages were inserted
-    // NOTE: some of this will change if/when we support insertion at locations
-    //       OTHER than the end of the document!
-    int leftStartPage = 0 ;
-    int leftCount = inFirstPage ;
-    int rightStartPage = inFirstPage + inNumPages ;
-    int rightCount = rDoc.GetPageCount() - rightStartPage ;
-    int pageOffset = this->GetPageCount();	
-
-    leftStartPage += pageOffset ;
-    rightStartPage += pageOffset ;
-    
-    // append in the whole document
-    this->Append( rDoc );
-
-    // delete
-    if( rightCount > 0 )
-        this->DeletePages( rightStartPage, rightCount ) ;
-    if( leftCount > 0 )
-        this->DeletePages( leftStartPage, leftCount ) ;
+    // Only the objects reachable from the inserted pages and
+    // the outlines are copied, shared objects only once
+    TPdfReferenceMap mapReferences;
+    this->InsertPagesFrom( rDoc, inFirstPage, inNumPages, -1, &mapReferences );
+    this->AppendOutlinesFrom( rDoc, mapReferences );
     
     return *this;
 }
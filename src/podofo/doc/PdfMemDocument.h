@@ -317,6 +317,31 @@ class PODOFO_DOC_API PdfMemDocument : public PdfDocument {
      */
     virtual EPdfWriteMode GetWriteMode() const { return m_eWriteMode; }
 
+    /** Set the number of threads which serialize objects when writing the PDF.
+     *  The document must not be modified while it is written.
+     *  \param nThreads number of threads, 1 writes all objects from the calling thread
+     *  \see PdfWriter::SetWriteThreads
+     */
+    void SetWriteThreads( int nThreads ) { m_nWriteThreads = nThreads; }
+
+    /** Get the number of threads which serialize objects when writing the PDF.
+     *  \returns the number of threads
+     */
+    int GetWriteThreads() const { return m_nWriteThreads; }
+
+    /** Merge objects with identical contents, e.g. fonts and images
+     *  which were appended several times, so that they are written only once.
+     *  All references to a removed duplicate point to the kept object afterwards.
+     *
+     *  Call this before Write(). The document is changed permanently,
+     *  and fonts which were loaded from a removed object must not be
+     *  used afterwards.
+     *
+     *  \returns the number of removed duplicates
+     *  \see PdfVecObjects::MergeDuplicates
+     */
+    size_t MergeDuplicateObjects();
+
     /** Set the PDF Version of the document. Has to be called before Write() to
      *  have an effect.
      *  \param eVersion  version of the pdf document
@@ -649,6 +674,7 @@ private:
 
     PdfParser*      m_pParser; ///< This will be temporarily initialized to a PdfParser object so that SetPassword can work
     EPdfWriteMode   m_eWriteMode;
+    int             m_nWriteThreads;
 
     bool m_bSoureHasXRefStream;
     EPdfVersion m_eSourceVersion;
@@ -46,6 +46,17 @@
 
 namespace PoDoFo {
 
+/** The keys of the inheritable attributes, in the order of EPdfPageAttribute
+ */
+static const PdfName s_aInheritedKeys[] = {
+    PdfName( "Resources" ),
+    PdfName( "MediaBox" ),
+    PdfName( "CropBox" ),
+    PdfName( "Rotate" )
+};
+
+static const PdfName s_parentKey( "Parent" );
+
 PdfPage::PdfPage( const PdfRect & rSize, PdfDocument* pParent )
     : PdfElement( "Page", pParent ), PdfCanvas(), m_pContents( NULL )
 {
@@ -261,6 +272,61 @@ const PdfObject* PdfPage::GetInheritedKeyFromObject( const char* inKey, const Pd
     return pObj;
 }
 
+const PdfObject* PdfPage::GetInheritedKey( const PdfName & rName ) const
+{
+    for( int i = 0; i < ePdfPageAttribute_Count; i++ )
+    {
+        if( rName == s_aInheritedKeys[i] )
+            return this->GetInheritedAttribute( static_cast<EPdfPageAttribute>(i) );
+    }
+
+    return this->GetInheritedKeyFromObject( rName.GetName().c_str(), this->GetObject() );
+}
+
+const PdfObject* PdfPage::GetInheritedAttribute( EPdfPageAttribute eAttribute ) const
+{
+    // CVE-2017-5852 - prevent endless loops if the Parent chain contains a loop
+    const int maxDepth = 1000;
+
+    // The nodes are read again every time instead of caching their values, 
+    // so that changes anywhere in the pages tree are seen immediately
+    const PdfObject* pNode = this->GetObject();
+    int              depth = 0;
+    while( pNode && pNode->IsDictionary() )
+    {
+        if( pNode->GetDictionary().HasKey( s_aInheritedKeys[eAttribute] ) ) 
+        {
+            const PdfObject* pObj = pNode->MustGetIndirectKey( s_aInheritedKeys[eAttribute] );
+            if( !pObj->IsNull() ) 
+                return pObj;
+        }
+
+        const PdfObject* pParent = pNode->GetIndirectKey( s_parentKey );
+        if( pParent == pNode )
+        {
+            std::ostringstream oss;
+            oss << "Object " << pNode->Reference().ObjectNumber() << " "
+                << pNode->Reference().GenerationNumber() << " references itself as Parent";
+            PODOFO_RAISE_ERROR_INFO( ePdfError_BrokenFile, oss.str().c_str() );
+        }
+
+        if( pParent && ++depth > maxDepth )
+            PODOFO_RAISE_ERROR( ePdfError_ValueOutOfRange );
+
+        pNode = pParent;
+    }
+
+    return NULL;
+}
+
+void PdfPage::ClearCache()
+{
+    // The resources might be inherited from another node now
+    m_pResources = this->GetObject()->GetIndirectKey( "Resources" );
+    if( !m_pResources ) 
+        m_pResources = const_cast<PdfObject*>(this->GetInheritedKeyFromObject( "Resources", this->GetObject() ));
+}
+
 const PdfRect PdfPage::GetPageBox( const char* inBox ) const
 {
     PdfRect	 pageBox;
@@ -274,19 +340,31 @@ const PdfRect PdfPage::GetPageBox( const char* inBox ) const
     {
         pageBox.FromArray( pObj->GetArray() );
     }
-    else if ( strcmp( inBox, "ArtBox" ) == 0   ||
-              strcmp( inBox, "BleedBox" ) == 0 ||
-              strcmp( inBox, "TrimBox" ) == 0  )
+    else
     {
         // If those page boxes are not specified then
         // default to CropBox per PDF Spec (3.6.2)
-        pageBox = GetPageBox( "CropBox" );
+        pageBox = GetPageBox( ePdfPageAttribute_CropBox );
+    }
+    
+    return pageBox;
+}
+
+const PdfRect PdfPage::GetPageBox( EPdfPageAttribute eBox ) const
+{
+    PdfRect	 pageBox;
+    const PdfObject* pObj = GetInheritedAttribute( eBox );
+    
+    // assign the value of the box from the array
+    if ( pObj && pObj->IsArray() )
+    {
+        pageBox.FromArray( pObj->GetArray() );
     }
-    else if ( strcmp( inBox, "CropBox" ) == 0 )
+    else if ( eBox == ePdfPageAttribute_CropBox )
     {
         // If crop box is not specified then
         // default to MediaBox per PDF Spec (3.6.2)
-        pageBox = GetPageBox( "MediaBox" );
+        pageBox = GetPageBox( ePdfPageAttribute_MediaBox );
     }
     
     return pageBox;
@@ -296,7 +374,7 @@ int PdfPage::GetRotation() const
 { 
     int rot = 0;
     
-    const PdfObject* pObj = GetInheritedKeyFromObject( "Rotate", this->GetObject() ); 
+    const PdfObject* pObj = GetInheritedAttribute( ePdfPageAttribute_Rotate ); 
     if ( pObj && pObj->IsNumber() )
         rot = static_cast<int>(pObj->GetNumber());
     
@@ -685,27 +763,23 @@ PdfObject* PdfPage::GetFromResources( const PdfName & rType, const PdfName & rKe
     {
         PODOFO_RAISE_ERROR_INFO( ePdfError_InvalidHandle, "No Resources" );
     } 
-    if( m_pResources->GetDictionary().HasKey( rType ) ) 
+
+    // OC 15.08.2010 BugFix: Ghostscript creates here sometimes an indirect reference to a directory
+    PdfObject* pType = m_pResources->GetIndirectKey( rType );
+    if( pType && pType->IsDictionary() && pType->GetDictionary().HasKey( rKey ) )
     {
-        // OC 15.08.2010 BugFix: Ghostscript creates here sometimes an indirect reference to a directory
-     // PdfObject* pType = m_pResources->GetDictionary().GetKey( rType );
-        PdfObject* pType = m_pResources->GetIndirectKey( rType );
-        if( pType && pType->IsDictionary() && pType->GetDictionary().HasKey( rKey ) )
+        PdfObject* pObj = pType->GetDictionary().GetKey( rKey ); // CB 08.12.2017 Can be an array
+        if (pObj->IsReference())
         {
-            PdfObject* pObj = pType->GetDictionary().GetKey( rKey ); // CB 08.12.2017 Can be an array
-            if (pObj->IsReference())
-            {
-                const PdfReference & ref = pType->GetDictionary().GetKey( rKey )->GetReference();
-                return this->GetObject()->GetOwner()->GetObject( ref );
-            }
-            return pObj; // END
+            const PdfReference & ref = pObj->GetReference();
+            return this->GetObject()->GetOwner()->GetObject( ref );
         }
+        return pObj; // END
     }
     
     return NULL;
 }
 
-
 PdfObject* PdfPage::GetOwnAnnotationsArray( bool bCreate, PdfDocument *pDocument)
 {
    PdfObject* pObj;
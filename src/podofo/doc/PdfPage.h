@@ -157,12 +157,12 @@ class PODOFO_DOC_API PdfPage : public PdfElement, public PdfCanvas {
     /** Get the current MediaBox (physical page size) in PDF units.
      *  \returns PdfRect the page box
      */
-    virtual const PdfRect GetMediaBox() const { return GetPageBox( "MediaBox" ); }
+    virtual const PdfRect GetMediaBox() const { return GetPageBox( ePdfPageAttribute_MediaBox ); }
 
     /** Get the current CropBox (visible page size) in PDF units.
      *  \returns PdfRect the page box
      */
-    virtual const PdfRect GetCropBox() const { return GetPageBox( "CropBox" ); }
+    virtual const PdfRect GetCropBox() const { return GetPageBox( ePdfPageAttribute_CropBox ); }
 
     /** Get the current TrimBox (cut area) in PDF units.
      *  \returns PdfRect the page box
@@ -261,10 +261,22 @@ class PODOFO_DOC_API PdfPage : public PdfElement, public PdfCanvas {
     /** Method for getting a value that can be inherited
      *  Possible names that can be inherited according to 
      *  the PDF specification are: Resources, MediaBox, CropBox and Rotate
+     *
+     *  These four keys are looked up with prebuilt names, 
+     *  changes to the pages tree are always seen.
      *  
      *  \returns PdfObject - the result of the key fetching or NULL
      */
-    inline const PdfObject* GetInheritedKey( const PdfName & rName ) const; 
+    const PdfObject* GetInheritedKey( const PdfName & rName ) const; 
+
+    /** Look up the resources returned by GetResources() again,
+     *  as they might be inherited from another node now.
+     *
+     *  Call this after modifying the /Resources of the pages tree 
+     *  nodes above this page. PdfPagesTree calls it for the cached 
+     *  pages it moves to new pages nodes.
+     */
+    void ClearCache();
 
 
     PdfObject* GetOwnAnnotationsArray( bool bCreate, PdfDocument *pDocument);
@@ -281,6 +293,16 @@ class PODOFO_DOC_API PdfPage : public PdfElement, public PdfCanvas {
     virtual void SetICCProfile( const char* pszCSTag, PdfInputStream* pStream, pdf_int64 nColorComponents,
                                 EPdfColorSpace eAlternateColorSpace = ePdfColorSpace_DeviceRGB );
  private:
+    /** Attributes which are inherited from the parents of a page
+     */
+    enum EPdfPageAttribute {
+        ePdfPageAttribute_Resources = 0,
+        ePdfPageAttribute_MediaBox,
+        ePdfPageAttribute_CropBox,
+        ePdfPageAttribute_Rotate,
+
+        ePdfPageAttribute_Count
+    };
 
     /**
      * Initialize a new page object.
@@ -302,6 +324,17 @@ class PODOFO_DOC_API PdfPage : public PdfElement, public PdfCanvas {
      *  \returns PdfRect the page box
      */
     const PdfRect GetPageBox( const char* inBox ) const;
+
+    /** Get the bounds of the MediaBox or the CropBox in PDF units.
+     *  \returns PdfRect the page box
+     */
+    const PdfRect GetPageBox( EPdfPageAttribute eBox ) const;
+
+    /** Get an inheritable attribute of this page or the 
+     *  nearest node above it in the pages tree.
+     *  \returns the attribute or NULL
+     */
+    const PdfObject* GetInheritedAttribute( EPdfPageAttribute eAttribute ) const;
     
     /** Method for getting a key value that could be inherited (such as the boxes, resources, etc.)
      *  \returns PdfObject - the result of the key fetching or NULL
@@ -339,14 +372,6 @@ inline const PdfRect PdfPage::GetPageSize() const
     return this->GetMediaBox();
 }
 
-// -----------------------------------------------------
-// 
-// -----------------------------------------------------
-inline const PdfObject* PdfPage::GetInheritedKey( const PdfName & rName ) const
-{
-    return this->GetInheritedKeyFromObject( rName.GetName().c_str(), this->GetObject() );
-}
-
 };
 
 #endif // _PDF_PAGE_H_
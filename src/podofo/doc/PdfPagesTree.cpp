@@ -45,11 +45,28 @@
 #include "PdfPage.h"
 
 #include <iostream>
+
+/** Default maximum number of kids of a pages node
+ */
+#define PODOFO_PAGES_TREE_MAX_KIDS 64
+
 namespace PoDoFo {
 
+/** Keys which a page inherits from its pages nodes,
+ *  and which are copied when a pages node is split.
+ */
+static const char* s_pszInheritableKeys[] = {
+    "Resources",
+    "MediaBox",
+    "CropBox",
+    "Rotate",
+    NULL
+};
+
 PdfPagesTree::PdfPagesTree( PdfVecObjects* pParent )
     : PdfElement( "Pages", pParent ),
-      m_cache( 0 )
+      m_cache( 0 ), m_nMaxKids( PODOFO_PAGES_TREE_MAX_KIDS ), 
+      m_bPageIndexBuilt( false ), m_bPageIndexValid( false )
 {
     GetObject()->GetDictionary().AddKey( "Kids", PdfArray() ); // kids->Reference() 
     GetObject()->GetDictionary().AddKey( "Count", PdfObject( static_cast<pdf_int64>(PODOFO_LL_LITERAL(0)) ) );
@@ -57,7 +74,8 @@ PdfPagesTree::PdfPagesTree( PdfVecObjects* pParent )
 
 PdfPagesTree::PdfPagesTree( PdfObject* pPagesRoot )
     : PdfElement( "Pages", pPagesRoot ),
-      m_cache( GetChildCount( pPagesRoot ) )
+      m_cache( GetChildCount( pPagesRoot ) ), m_nMaxKids( PODOFO_PAGES_TREE_MAX_KIDS ), 
+      m_bPageIndexBuilt( false ), m_bPageIndexValid( false )
 {
     if( !this->GetObject() ) 
     {
@@ -87,9 +105,9 @@ PdfPage* PdfPagesTree::GetPage( int nIndex )
     if( pPage )
         return pPage;
 
-    // Not in cache -> search tree
+    // Not in cache -> search page index or tree
     PdfObjectList lstParents;
-    PdfObject* pObj = this->GetPageNode(nIndex, this->GetRoot(), lstParents);
+    PdfObject* pObj = this->GetPageNode( nIndex, lstParents );
     if( pObj ) 
     {
         pPage = new PdfPage( pObj, lstParents );
@@ -102,7 +120,19 @@ PdfPage* PdfPagesTree::GetPage( int nIndex )
 
 PdfPage* PdfPagesTree::GetPage( const PdfReference & ref )
 {
-    // We have to search through all pages,
+    if( this->EnsurePageIndex() ) 
+    {
+        if( m_mapPageNumbers.empty() )
+        {
+            for( int i=0;i<static_cast<int>(m_vecPageIndex.size());i++ ) 
+                m_mapPageNumbers[m_vecPageIndex[i]->Reference()] = i;
+        }
+
+        TPageReferenceMap::const_iterator it = m_mapPageNumbers.find( ref );
+        return it == m_mapPageNumbers.end() ? NULL : this->GetPage( (*it).second );
+    }
+
+    // The tree cannot be indexed, so we have to search through all pages,
     // as this is the only way
     // to instantiate the PdfPage with a correct list of parents
     for( int i=0;i<this->GetTotalNumberOfPages();i++ ) 
@@ -145,8 +175,7 @@ void PdfPagesTree::InsertPage( int nAfterPageIndex, PdfObject* pPage )
     //printf("Searching page=%i\n", nAfterPageIndex );
     if( this->GetTotalNumberOfPages() != 0 ) // no GetPageNode call w/o pages
     {
-        pPageBefore = this->GetPageNode( nAfterPageIndex, this->GetRoot(),
-                                        lstParents );
+        pPageBefore = this->GetPageNode( nAfterPageIndex, lstParents );
     }
     //printf("pPageBefore=%p lstParents=%i\n", pPageBefore,lstParents.size() );
     if( !pPageBefore || lstParents.size() == 0 ) 
@@ -161,10 +190,10 @@ void PdfPagesTree::InsertPage( int nAfterPageIndex, PdfObject* pPage )
         else
         {
             // We insert the first page into an empty pages tree
-            PdfObjectList lstPagesTree;
-            lstPagesTree.push_back( this->GetObject() );
+            lstParents.push_back( this->GetObject() );
             // Use -1 as index to insert before the empty kids array
-            InsertPageIntoNode( this->GetObject(), lstPagesTree, -1, pPage );
+            InsertPageIntoNode( this->GetObject(), lstParents, -1, pPage );
+            InsertIntoPageIndex( 0, this->GetObject(), std::vector<PdfObject*>( 1, pPage ) );
         }
     }
     else
@@ -175,9 +204,14 @@ void PdfPagesTree::InsertPage( int nAfterPageIndex, PdfObject* pPage )
         //printf("Inserting into node: %p at pos %i\n", pParent, nKidsIndex );
 
         InsertPageIntoNode( pParent, lstParents, nKidsIndex, pPage );
+        InsertIntoPageIndex( bInsertBefore ? 0 : nAfterPageIndex + 1, pParent, std::vector<PdfObject*>( 1, pPage ) );
     }
 
     m_cache.InsertPage( (bInsertBefore && nAfterPageIndex == 0) ? ePdfPageInsertionPoint_InsertBeforeFirstPage : nAfterPageIndex );
+
+    // Balance after updating the cache, so that the cached
+    // pages of split nodes are found at their page numbers
+    BalanceNode( lstParents );
 }
 
 void PdfPagesTree::InsertPages( int nAfterPageIndex, const std::vector<PdfObject*>& vecPages )
@@ -201,8 +235,7 @@ void PdfPagesTree::InsertPages( int nAfterPageIndex, const std::vector<PdfObject
     PdfObject* pPageBefore = NULL;
     if( this->GetTotalNumberOfPages() != 0 ) // no GetPageNode call w/o pages
     {
-        pPageBefore = this->GetPageNode( nAfterPageIndex, this->GetRoot(),
-                                        lstParents );
+        pPageBefore = this->GetPageNode( nAfterPageIndex, lstParents );
     }
     if( !pPageBefore || lstParents.size() == 0 ) 
     {
@@ -216,10 +249,10 @@ void PdfPagesTree::InsertPages( int nAfterPageIndex, const std::vector<PdfObject
         else
         {
             // We insert the first page into an empty pages tree
-            PdfObjectList lstPagesTree;
-            lstPagesTree.push_back( this->GetObject() );
+            lstParents.push_back( this->GetObject() );
             // Use -1 as index to insert before the empty kids array
-            InsertPagesIntoNode( this->GetObject(), lstPagesTree, -1, vecPages );
+            InsertPagesIntoNode( this->GetObject(), lstParents, -1, vecPages );
+            InsertIntoPageIndex( 0, this->GetObject(), vecPages );
         }
     }
     else
@@ -228,9 +261,14 @@ void PdfPagesTree::InsertPages( int nAfterPageIndex, const std::vector<PdfObject
         int nKidsIndex = bInsertBefore  ? -1 : this->GetPosInKids( pPageBefore, pParent );
 
         InsertPagesIntoNode( pParent, lstParents, nKidsIndex, vecPages );
+        InsertIntoPageIndex( bInsertBefore ? 0 : nAfterPageIndex + 1, pParent, vecPages );
     }
 
     m_cache.InsertPages( (bInsertBefore && nAfterPageIndex == 0) ? ePdfPageInsertionPoint_InsertBeforeFirstPage : nAfterPageIndex,  vecPages.size() );
+
+    // Balance after updating the cache, so that the cached
+    // pages of split nodes are found at their page numbers
+    BalanceNode( lstParents );
 }
 
 PdfPage* PdfPagesTree::CreatePage( const PdfRect & rSize )
@@ -281,7 +319,7 @@ void PdfPagesTree::DeletePage( int nPageNumber )
     
     // Delete from pages tree
     PdfObjectList lstParents;
-    PdfObject* pPageNode = this->GetPageNode( nPageNumber, this->GetRoot(), lstParents );
+    PdfObject* pPageNode = this->GetPageNode( nPageNumber, lstParents );
 
     if( !pPageNode ) 
     {
@@ -297,6 +335,18 @@ void PdfPagesTree::DeletePage( int nPageNumber )
         int nKidsIndex = this->GetPosInKids( pPageNode, pParent );
         
         DeletePageFromNode( pParent, lstParents, nKidsIndex, pPageNode );
+
+        if( m_bPageIndexValid ) 
+        {
+            m_mapNodeParents.erase( pPageNode );
+            m_vecPageIndex.erase( m_vecPageIndex.begin() + nPageNumber );
+
+            // The page numbers of all following pages have changed
+            if( nPageNumber == static_cast<int>(m_vecPageIndex.size()) )
+                m_mapPageNumbers.erase( pPageNode->Reference() );
+            else
+                m_mapPageNumbers.clear();
+        }
     }
     else
     {
@@ -307,6 +357,15 @@ void PdfPagesTree::DeletePage( int nPageNumber )
     }
 }
 
+void PdfPagesTree::SetMaxKidsPerNode( int nMaxKids )
+{
+    if( nMaxKids < 0 || nMaxKids == 1 ) 
+    {
+        PODOFO_RAISE_ERROR_INFO( ePdfError_ValueOutOfRange, "A pages node must be allowed to have at least 2 kids" );
+    }
+
+    m_nMaxKids = nMaxKids;
+}
 
 ////////////////////////////////////////////////////
 // Private methods
@@ -437,6 +496,156 @@ PdfObject* PdfPagesTree::GetPageNode( int nPageNum, PdfObject* pParent,
     return NULL;
 }
 
+PdfObject* PdfPagesTree::GetPageNode( int nPageNum, PdfObjectList & rLstParents ) 
+{
+    if( nPageNum < 0 || !this->EnsurePageIndex() || 
+        nPageNum >= static_cast<int>(m_vecPageIndex.size()) )
+    {
+        return this->GetPageNode( nPageNum, this->GetRoot(), rLstParents );
+    }
+
+    PdfObject* pPage = m_vecPageIndex[nPageNum];
+
+    // Walk up to the root, which has no parent
+    TNodeParentMap::const_iterator it = m_mapNodeParents.find( pPage );
+    while( it != m_mapNodeParents.end() && (*it).second ) 
+    {
+        rLstParents.push_front( (*it).second );
+        it = m_mapNodeParents.find( (*it).second );
+    }
+
+    return pPage;
+}
+
+bool PdfPagesTree::EnsurePageIndex()
+{
+    // Catch modifications of the pages nodes without a call to ClearCache()
+    if( m_bPageIndexValid && static_cast<int>(m_vecPageIndex.size()) != this->GetTotalNumberOfPages() )
+        this->InvalidatePageIndex();
+
+    if( m_bPageIndexBuilt )
+        return m_bPageIndexValid;
+
+    m_bPageIndexBuilt = true;
+    m_mapNodeParents[this->GetRoot()] = NULL;
+
+    int nCount = 0;
+    try {
+        m_bPageIndexValid = this->BuildPageIndex( this->GetRoot(), nCount );
+    } 
+    catch( PdfError & )
+    {
+        // e.g. the tree is too deep
+        m_bPageIndexValid = false;
+    }
+
+    if( !m_bPageIndexValid ) 
+    {
+        // Use GetPageNode() for this tree, which logs all errors
+        m_vecPageIndex.clear();
+        m_mapNodeParents.clear();
+    }
+
+    return m_bPageIndexValid;
+}
+
+bool PdfPagesTree::BuildPageIndex( PdfObject* pNode, int & rnCount ) 
+{
+    PdfTokenizer::RecursionGuard guard;
+
+    int nCount = 0;
+    const PdfObject* pKids = pNode->GetIndirectKey( "Kids" );
+    if( pKids ) 
+    {
+        if( !pKids->IsArray() )
+            return false;
+
+        const PdfArray & rKidsArray = pKids->GetArray(); 
+        for( PdfArray::const_iterator it = rKidsArray.begin(); it != rKidsArray.end(); ++it ) 
+        {
+            if( !(*it).IsReference() ) 
+                return false;
+
+            PdfObject* pChild = GetRoot()->GetOwner()->GetObject( (*it).GetReference() );
+            // Every node may appear only once, which also excludes cycles
+            if( !pChild || m_mapNodeParents.find( pChild ) != m_mapNodeParents.end() ) 
+                return false;
+
+            m_mapNodeParents[pChild] = pNode;
+
+            if( this->IsTypePages( pChild ) ) 
+            {
+                if( !this->BuildPageIndex( pChild, nCount ) )
+                    return false;
+            }
+            else if( this->IsTypePage( pChild ) ) 
+            {
+                m_vecPageIndex.push_back( pChild );
+                ++nCount;
+            }
+            else
+                return false;
+        }
+    }
+
+    // GetPageNode() skips subtrees using /Count, 
+    // so the index is only equivalent if all counts are correct
+    if( nCount != GetChildCount( pNode ) )
+        return false;
+
+    rnCount += nCount;
+    return true;
+}
+
+void PdfPagesTree::InvalidatePageIndex()
+{
+    m_bPageIndexBuilt = false;
+    m_bPageIndexValid = false;
+    m_vecPageIndex.clear();
+    m_mapPageNumbers.clear();
+    m_mapNodeParents.clear();
+}
+
+void PdfPagesTree::InsertIntoPageIndex( int nIndex, PdfObject* pParent, const std::vector<PdfObject*> & vecPages )
+{
+    // Nothing to do if the index is built later or not used at all
+    if( !m_bPageIndexValid )
+        return;
+
+    if( nIndex > static_cast<int>(m_vecPageIndex.size()) )
+    {
+        this->InvalidatePageIndex();
+        return;
+    }
+
+    std::vector<PdfObject*>::const_iterator it = vecPages.begin();
+    while( it != vecPages.end() ) 
+    {
+        if( m_mapNodeParents.find( *it ) != m_mapNodeParents.end() ) 
+        {
+            // A page object which is in the tree twice cannot be indexed
+            this->InvalidatePageIndex();
+            return;
+        }
+
+        m_mapNodeParents[*it] = pParent;
+        ++it;
+    }
+
+    if( nIndex < static_cast<int>(m_vecPageIndex.size()) )
+    {
+        // The page numbers of all following pages have changed
+        m_mapPageNumbers.clear();
+    }
+    else if( !m_mapPageNumbers.empty() )
+    {
+        for( int i=0;i<static_cast<int>(vecPages.size());i++ ) 
+            m_mapPageNumbers[vecPages[i]->Reference()] = nIndex + i;
+    }
+
+    m_vecPageIndex.insert( m_vecPageIndex.begin() + nIndex, vecPages.begin(), vecPages.end() );
+}
+
 bool PdfPagesTree::IsTypePage(const PdfObject* pObject) const 
 {
     if( !pObject )
@@ -618,6 +827,147 @@ void PdfPagesTree::InsertPagesIntoNode( PdfObject* pParent, const PdfObjectList
     }
 }
 
+void PdfPagesTree::BalanceNode( const PdfObjectList & rlstNodes )
+{
+    if( !m_nMaxKids || rlstNodes.empty() )
+        return;
+
+    PdfObject* pNode = rlstNodes.back();
+    const PdfObject* pKids = pNode->GetIndirectKey( "Kids" );
+    if( !pKids || !pKids->IsArray() || static_cast<int>(pKids->GetArray().size()) <= m_nMaxKids ) 
+        return;
+
+    // Copy the kids, as the kids array of pNode is replaced below
+    const PdfArray kids = pKids->GetArray();
+    std::vector<PdfObject*> vecKids;
+    std::vector<int>        vecCounts;
+    vecKids.reserve( kids.size() );
+    vecCounts.reserve( kids.size() );
+    for( PdfArray::const_iterator it = kids.begin(); it != kids.end(); ++it ) 
+    {
+        PdfObject* pKid = (*it).IsReference() ? GetRoot()->GetOwner()->GetObject( (*it).GetReference() ) : NULL;
+        if( this->IsTypePage( pKid ) )
+            vecCounts.push_back( 1 );
+        else if( this->IsTypePages( pKid ) )
+            vecCounts.push_back( GetChildCount( pKid ) );
+        else
+            return; // Do not restructure invalid trees
+
+        vecKids.push_back( pKid );
+    }
+
+    // The root node must stay the same object, so it gets new
+    // pages nodes for all of its kids. Any other node keeps the 
+    // first group of its kids and gets new siblings for the others.
+    const bool bIsRoot  = (rlstNodes.size() == 1);
+    PdfObject* pParent  = bIsRoot ? pNode : *(rlstNodes.rbegin() + 1);
+    const int  nKids    = static_cast<int>(vecKids.size());
+    const int  nGroups  = (nKids + m_nMaxKids - 1) / m_nMaxKids;
+    int        nPage    = bIsRoot ? 0 : this->GetFirstPageNumber( rlstNodes );
+    PdfArray   newNodes;
+
+    for( int nGroup = 0; nGroup < nGroups; nGroup++ ) 
+    {
+        PdfObject* pGroup = pNode;
+        if( bIsRoot || nGroup > 0 ) 
+        {
+            pGroup = GetRoot()->GetOwner()->CreateObject( "Pages" );
+            pGroup->GetDictionary().AddKey( PdfName("Parent"), pParent->Reference() );
+            if( !bIsRoot ) 
+            {
+                // The root node stays the parent of all pages and keeps
+                // their inherited keys, but a sibling must copy them
+                for( const char** ppszKey = s_pszInheritableKeys; *ppszKey; ++ppszKey ) 
+                {
+                    const PdfObject* pValue = pNode->GetDictionary().GetKey( *ppszKey );
+                    if( pValue )
+                        pGroup->GetDictionary().AddKey( *ppszKey, *pValue );
+                }
+            }
+
+            newNodes.push_back( pGroup->Reference() );
+            if( m_bPageIndexValid )
+                m_mapNodeParents[pGroup] = pParent;
+        }
+
+        PdfArray groupKids;
+        int      nCount = 0;
+        for( int i = nGroup * nKids / nGroups; i < (nGroup + 1) * nKids / nGroups; i++ ) 
+        {
+            groupKids.push_back( kids[i] );
+            nCount += vecCounts[i];
+
+            if( pGroup != pNode ) 
+            {
+                vecKids[i]->GetDictionary().AddKey( PdfName("Parent"), pGroup->Reference() );
+                if( m_bPageIndexValid )
+                    m_mapNodeParents[vecKids[i]] = pGroup;
+            }
+        }
+
+        pGroup->GetDictionary().AddKey( PdfName("Kids"), groupKids );
+        pGroup->GetDictionary().AddKey( "Count", PdfVariant( static_cast<pdf_int64>(nCount) ) );
+
+        // Cached pages moved to a sibling inherit from the
+        // sibling's copies of the keys of pNode from now on
+        if( !bIsRoot && pGroup != pNode ) 
+            m_cache.UpdateParents( nPage, nCount );
+
+        nPage += nCount;
+    }
+
+    if( bIsRoot ) 
+    {
+        // /Count of the root is unchanged
+        pNode->GetDictionary().AddKey( PdfName("Kids"), newNodes );
+        
+        // The root may have too many kids again in huge trees
+        BalanceNode( rlstNodes );
+    }
+    else
+    {
+        PdfArray parentKids = pParent->MustGetIndirectKey( PdfName("Kids") )->GetArray();
+        const int nPos = this->GetPosInKids( pNode, pParent );
+        parentKids.insert( parentKids.begin() + nPos + 1, newNodes.begin(), newNodes.end() );
+        pParent->GetDictionary().AddKey( PdfName("Kids"), parentKids );
+
+        PdfObjectList lstParents( rlstNodes );
+        lstParents.pop_back();
+        BalanceNode( lstParents );
+    }
+}
+
+int PdfPagesTree::GetFirstPageNumber( const PdfObjectList & rlstNodes )
+{
+    int nPage = 0;
+    for( PdfObjectList::const_iterator it = rlstNodes.begin(); it + 1 < rlstNodes.end(); ++it ) 
+    {
+        const PdfObject* pKids  = (*it)->GetIndirectKey( "Kids" );
+        const PdfObject* pChild = *(it + 1);
+        if( !pKids || !pKids->IsArray() )
+            continue;
+
+        // Count the pages of all kids before the next node
+        const PdfArray & kids = pKids->GetArray();
+        for( PdfArray::const_iterator itKid = kids.begin(); itKid != kids.end(); ++itKid ) 
+        {
+            if( !(*itKid).IsReference() )
+                continue;
+
+            if( (*itKid).GetReference() == pChild->Reference() )
+                break;
+
+            PdfObject* pKid = GetRoot()->GetOwner()->GetObject( (*itKid).GetReference() );
+            if( this->IsTypePage( pKid ) )
+                ++nPage;
+            else if( this->IsTypePages( pKid ) )
+                nPage += GetChildCount( pKid );
+        }
+    }
+
+    return nPage;
+}
+
 void PdfPagesTree::DeletePageFromNode( PdfObject* pParent, const PdfObjectList & rlstParents, 
                                        int nIndex, PdfObject* pPage )
 {
@@ -656,6 +1006,7 @@ void PdfPagesTree::DeletePageFromNode( PdfObject* pParent, const PdfObjectList &
             DeletePageNode( pParentOfNode, nKidsIndex );
 
             // Delete empty page nodes
+            m_mapNodeParents.erase( *itParents );
             delete this->GetObject()->GetOwner()->RemoveObject( (*itParents)->Reference() );
         }
 
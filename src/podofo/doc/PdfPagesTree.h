@@ -183,14 +183,92 @@ class PODOFO_DOC_API PdfPagesTree : public PdfElement
      * It is only useful if one modified the page nodes 
      * of the pagestree manually.
      *
+     * The index of page numbers and references is rebuilt
+     * when it is used the next time.
+     *
      */
     inline void ClearCache();
 
+    /** Set the maximum number of kids of a pages node.
+     *
+     *  A pages node which gets more kids when pages are inserted
+     *  is split into several pages nodes, so that the tree stays
+     *  balanced and inserting a page does not become slower
+     *  with the number of pages in the document.
+     *
+     *  \param nMaxKids maximum number of kids of a pages node, at least 2.
+     *                  The default is 64. Pass 0 to append all pages to the
+     *                  existing pages nodes as older PoDoFo versions did.
+     */
+    void SetMaxKidsPerNode( int nMaxKids );
+
+    /**
+     * \returns the maximum number of kids of a pages node or 0 if pages nodes are never split
+     * \see SetMaxKidsPerNode
+     */
+    inline int GetMaxKidsPerNode() const;
+
  private:
     PdfPagesTree();	// don't allow construction from nothing!
 
     PdfObject* GetPageNode( int nPageNum, PdfObject* pParent, PdfObjectList & rLstParents );
 
+    /** Get a page object and all of its parents.
+     *  The page index is used if possible, otherwise the tree is traversed.
+     *
+     *  \param nPageNum page index, 0-based
+     *  \param rLstParents all parents of the page object are added to this list
+     *  \returns the page object or NULL
+     */
+    PdfObject* GetPageNode( int nPageNum, PdfObjectList & rLstParents );
+
+    /** Build the page index in one pass over the tree, unless it is built already.
+     *
+     *  The page index is not used for trees which cannot be indexed,
+     *  e.g. because of cycles, invalid kids or wrong /Count values.
+     *  Lookups in such trees traverse the tree as before.
+     *
+     *  \returns true if the page index can be used
+     */
+    bool EnsurePageIndex();
+
+    /** Add all page objects below a pages node to the page index
+     *
+     *  \param pNode a pages node which is already in m_mapNodeParents
+     *  \param rnCount the number of page objects below pNode is added to it
+     *  \returns false if the subtree of pNode cannot be indexed
+     */
+    bool BuildPageIndex( PdfObject* pNode, int & rnCount );
+
+    /** Split a pages node which has more than m_nMaxKids kids into several
+     *  pages nodes. Parents of the node are split as well if necessary.
+     *  The root node is never split, it gets new pages nodes as kids instead.
+     *
+     *  \param rlstNodes the pages node to split and all of its parents,
+     *                   i.e. the node is the last element and the root the first
+     */
+    void BalanceNode( const PdfObjectList & rlstNodes );
+
+    /** Get the page number of the first page below a pages node.
+     *
+     *  \param rlstNodes the pages node and all of its parents,
+     *                   i.e. the node is the last element and the root the first
+     *  \returns the 0-based page number of the first page below the node
+     */
+    int GetFirstPageNumber( const PdfObjectList & rlstNodes );
+
+    /** Drop the page index, so that it is rebuilt when it is used the next time.
+     */
+    void InvalidatePageIndex();
+
+    /** Update the page index after page objects were inserted into the tree
+     *
+     *  \param nIndex page index of the first inserted page
+     *  \param pParent the pages node the pages were inserted into
+     *  \param vecPages the inserted page objects
+     */
+    void InsertIntoPageIndex( int nIndex, PdfObject* pParent, const std::vector<PdfObject*> & vecPages );
+
     int GetChildCount( const PdfObject* pNode ) const;
 
     /**
@@ -297,7 +375,17 @@ class PODOFO_DOC_API PdfPagesTree : public PdfElement
     const PdfObject* GetRoot() const	{ return this->GetObject(); }
 
 private:
+    typedef std::map<PdfReference, int>            TPageReferenceMap;
+    typedef std::map<const PdfObject*, PdfObject*> TNodeParentMap;
+
     PdfPagesTreeCache m_cache;
+    int               m_nMaxKids;     ///< Pages nodes with more kids are split, 0 to disable
+
+    bool                    m_bPageIndexBuilt;  ///< If true, building the page index was tried
+    bool                    m_bPageIndexValid;  ///< If true, the page index can be used
+    std::vector<PdfObject*> m_vecPageIndex;     ///< All page objects in page order
+    TPageReferenceMap       m_mapPageNumbers;   ///< Page numbers by reference, rebuilt from m_vecPageIndex if empty
+    TNodeParentMap          m_mapNodeParents;   ///< Direct parent of every indexed page and pages node, NULL for the root
 };
 
 // -----------------------------------------------------
@@ -306,6 +394,15 @@ private:
 inline void PdfPagesTree::ClearCache() 
 {
     m_cache.ClearCache();
+    this->InvalidatePageIndex();
+}
+
+// -----------------------------------------------------
+// 
+// -----------------------------------------------------
+inline int PdfPagesTree::GetMaxKidsPerNode() const
+{
+    return m_nMaxKids;
 }
 
 };
@@ -118,6 +118,16 @@ void PdfPagesTreeCache::InsertPages( int nAfterPageIndex, int nCount )
         m_deqPageObjs.insert( m_deqPageObjs.begin() + nBeforeIndex + i, static_cast<PdfPage*>(NULL) );
 }
 
+void PdfPagesTreeCache::UpdateParents( int nIndex, int nCount )
+{
+    const int nEnd = PDF_MIN( nIndex + nCount, static_cast<int>(m_deqPageObjs.size()) );
+    for( int i = PDF_MAX( nIndex, 0 ); i < nEnd; i++ )
+    {
+        if( m_deqPageObjs[i] )
+            m_deqPageObjs[i]->ClearCache();
+    }
+}
+
 void PdfPagesTreeCache::DeletePage( int nIndex )
 {
     if( nIndex < 0 || nIndex >= static_cast<int>(m_deqPageObjs.size()) ) 
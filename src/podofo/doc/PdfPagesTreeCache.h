@@ -102,6 +102,15 @@ class PODOFO_DOC_API PdfPagesTreeCache
      */
     virtual void InsertPages( int nAfterPageIndex, int nCount );
 
+    /**
+     * Pages were moved to other pages nodes, therefore the cached
+     * pages have to look up the values inherited from their parents again
+     *
+     * @param nIndex zero based index of the first moved page
+     * @param nCount number of pages that were moved
+     */
+    virtual void UpdateParents( int nIndex, int nCount );
+
     /**
      * Delete a PdfPage from the cache
      * @param nIndex index of the page
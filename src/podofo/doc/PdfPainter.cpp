@@ -35,8 +35,10 @@
 #pragma warning(disable: 4786)
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <locale>
 #include <vector>
 
 #include "PdfPainter.h"
@@ -47,6 +49,7 @@
 #include "base/PdfDictionary.h"
 #include "base/PdfFilter.h"
 #include "base/PdfName.h"
+#include "base/PdfOutputDevice.h"
 #include "base/PdfRect.h"
 #include "base/PdfStream.h"
 #include "base/PdfString.h"
@@ -108,6 +111,35 @@ static inline bool IsSpaceChar(pdf_utf16be ch)
 	return iswspace( SwapCharBytesIfRequired(ch) ) != 0;
 }
 
+/** Formats the numbers written to the content stream with 
+ *  PdfOutputDevice::FormatReal instead of printf, which is
+ *  much slower. The output does not change.
+ */
+class PdfPainterNumPut : public std::num_put<char> {
+ protected:
+    virtual iter_type do_put( iter_type out, std::ios_base & str, char_type fill, double v ) const
+    {
+        const std::ios_base::fmtflags flags = std::ios_base::floatfield | std::ios_base::showpos 
+            | std::ios_base::showpoint | std::ios_base::uppercase;
+
+        char   buffer[PdfOutputDevice::FORMAT_BUFFER_SIZE];
+        size_t lLen = 0;
+        if( (str.flags() & flags) == std::ios_base::fixed && !str.width() )
+            lLen = PdfOutputDevice::FormatReal( v, static_cast<int>(str.precision()), buffer );
+
+        if( !lLen )
+            return std::num_put<char>::do_put( out, str, fill, v );
+
+        return std::copy( buffer, buffer + lLen, out );
+    }
+};
+
+static void PdfPainterImbue( std::ios_base & s )
+{
+    PdfLocaleImbue( s );
+    s.imbue( std::locale( s.getloc(), new PdfPainterNumPut() ) );
+}
+
 PdfPainter::PdfPainter()
 : m_pCanvas( NULL ), m_pPage( NULL ), m_pFont( NULL ), m_nTabWidth( 4 ),
   m_curColor( PdfColor( 0.0, 0.0, 0.0 ) ),
@@ -115,11 +147,11 @@ PdfPainter::PdfPainter()
 {
     m_oss.flags( std::ios_base::fixed );
     m_oss.precision( clPainterDefaultPrecision );
-    PdfLocaleImbue(m_oss);
+    PdfPainterImbue(m_oss);
 
     m_curPath.flags( std::ios_base::fixed );
     m_curPath.precision( clPainterDefaultPrecision );
-    PdfLocaleImbue(m_curPath);
+    PdfPainterImbue(m_curPath);
 
     lpx  = 
     lpy  = 
@@ -979,111 +1011,115 @@ void PdfPainter::DrawMultiLineText( double dX, double dY, double dWidth, double
     this->Restore();
 }
 
-std::vector<PdfString> PdfPainter::GetMultiLineTextAsLines( double dWidth, const PdfString & rsText, bool bSkipSpaces )
+/** Convert a text to utf16, which allows us fast and
+ *  easy individual characters access.
+ *
+ *  \returns the number of characters in rvecText, which
+ *           is terminated by an additional zero character
+ */
+static pdf_long ConvertToUtf16( const PdfString & rsText, std::vector<pdf_utf16be> & rvecText )
 {
-    PODOFO_RAISE_LOGIC_IF( !m_pCanvas, "Call SetPage() first before doing drawing operations." );
-
-    if( !m_pFont || !m_pPage || !rsText.IsValid() )
-    {
-        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
-    }
-     
-    if( dWidth <= 0.0 ) // nonsense arguments
-	    return std::vector<PdfString>();
-    
-    if( rsText.GetCharacterLength() == 0 ) // empty string
-        return std::vector<PdfString>(1, rsText);
-	        
-    // We will work with utf16 encoded string because it allows us 
-    // fast and easy individual characters access    
     const std::string& stringUtf8 = rsText.GetStringUtf8();
-    std::vector<pdf_utf16be> stringUtf16(stringUtf8.length() + 1, 0);
-    PODOFO_ASSERT( stringUtf16.size() > 0 );
+    rvecText.assign( stringUtf8.length() + 1, 0 );
+    PODOFO_ASSERT( rvecText.size() > 0 );
     const pdf_long converted = PdfString::ConvertUTF8toUTF16(
-	    reinterpret_cast<const pdf_utf8*>(stringUtf8.c_str()), &stringUtf16[0], stringUtf16.size());
+	    reinterpret_cast<const pdf_utf8*>(stringUtf8.c_str()), &rvecText[0], rvecText.size());
 	//const pdf_long len = rsText.GetCharacterLength();
     PODOFO_ASSERT( converted == (rsText.GetCharacterLength() + 1) );
 
-	const pdf_utf16be* const stringUtf16Begin = &stringUtf16[0];
-    const pdf_utf16be* pszLineBegin = stringUtf16Begin;
-    const pdf_utf16be* pszCurrentCharacter = stringUtf16Begin;
-    const pdf_utf16be* pszStartOfCurrentWord  = stringUtf16Begin;
-    bool startOfWord = true;
-    double dCurWidthOfLine = 0.0;
-	std::vector<PdfString> vecLines;
+    return converted - 1;
+}
 
-    // do simple word wrapping
-    while( *pszCurrentCharacter ) 
+/** Do simple word wrapping of a utf16 text.
+ *
+ *  The width of each character is retrieved only once, before
+ *  the text is wrapped. Like GetMultiLineTextAsLines always did, the word spacing of the
+ *  font is not added to the widths of single spaces.
+ */
+static void GetLineBreaks( const PdfFontMetrics* pMetrics, const pdf_utf16be* pszText, pdf_long lLength,
+                           double dWidth, bool bSkipSpaces, std::vector< std::pair<pdf_long,pdf_long> > & rvecBreaks )
+{
+    std::vector<double> vecWidths( lLength );
+    for( pdf_long i = 0; i < lLength; i++ )
+        vecWidths[i] = pMetrics->UnicodeCharWidth( SwapCharBytesIfRequired( pszText[i] ) );
+
+    pdf_long lLineBegin       = 0;
+    pdf_long lCur             = 0;
+    pdf_long lStartOfWord     = 0;
+    bool     startOfWord      = true;
+    double   dCurWidthOfLine  = 0.0;
+
+    rvecBreaks.clear();
+    while( lCur < lLength && pszText[lCur] ) 
     {
-        if( IsNewLineChar( *pszCurrentCharacter ) ) // hard-break! 
+        if( IsNewLineChar( pszText[lCur] ) ) // hard-break! 
         {
-            vecLines.push_back( PdfString( pszLineBegin, pszCurrentCharacter - pszLineBegin ) );
+            rvecBreaks.push_back( std::make_pair( lLineBegin, lCur ) );
 
-            pszLineBegin = pszCurrentCharacter + 1;// skip the line feed
+            lLineBegin = lCur + 1;// skip the line feed
             startOfWord = true;
             dCurWidthOfLine = 0.0;
         }
-        else if( IsSpaceChar( *pszCurrentCharacter ) )
+        else if( IsSpaceChar( pszText[lCur] ) )
         {
             if( dCurWidthOfLine > dWidth )
             {
                 // The previous word does not fit in the current line.
                 // -> Move it to the next one.
-                if( pszStartOfCurrentWord > pszLineBegin )
+                if( lStartOfWord > lLineBegin )
                 {
-                    vecLines.push_back( PdfString( pszLineBegin, pszStartOfCurrentWord - pszLineBegin ) );
+                    rvecBreaks.push_back( std::make_pair( lLineBegin, lStartOfWord ) );
                 }
                 else
                 {
-                    vecLines.push_back( PdfString( pszLineBegin, pszCurrentCharacter - pszLineBegin ) );
+                    rvecBreaks.push_back( std::make_pair( lLineBegin, lCur ) );
                     if (bSkipSpaces)
                     {
                         // Skip all spaces at the end of the line
-                        while( IsSpaceChar( *( pszCurrentCharacter + 1 ) ) )
-                            pszCurrentCharacter++;
+                        while( lCur + 1 < lLength && IsSpaceChar( pszText[lCur + 1] ) )
+                            lCur++;
 
-                        pszStartOfCurrentWord = pszCurrentCharacter + 1;
+                        lStartOfWord = lCur + 1;
                     }
                     else
                     {
-                        pszStartOfCurrentWord = pszCurrentCharacter;
+                        lStartOfWord = lCur;
                     }
                     startOfWord=true;
                 }
-                pszLineBegin = pszStartOfCurrentWord;
+                lLineBegin = lStartOfWord;
 
                 if (!startOfWord)
                 {
-                    dCurWidthOfLine = m_pFont->GetFontMetrics()->StringWidth( 
-						pszStartOfCurrentWord, pszCurrentCharacter - pszStartOfCurrentWord );
+                    dCurWidthOfLine = pMetrics->StringWidth( pszText + lStartOfWord, static_cast<unsigned int>(lCur - lStartOfWord) );
                 }
                 else
                 {
                     dCurWidthOfLine = 0.0;
                 }
             }
-            else if( ( dCurWidthOfLine + m_pFont->GetFontMetrics()->UnicodeCharWidth( SwapCharBytesIfRequired( *pszCurrentCharacter ) ) ) > dWidth )
+            else if( ( dCurWidthOfLine + vecWidths[lCur] ) > dWidth )
             {
-                vecLines.push_back( PdfString( pszLineBegin, pszCurrentCharacter - pszLineBegin ) );
+                rvecBreaks.push_back( std::make_pair( lLineBegin, lCur ) );
                 if( bSkipSpaces )
                 {
                     // Skip all spaces at the end of the line
-                    while( IsSpaceChar( *( pszCurrentCharacter + 1 ) ) )
-                        pszCurrentCharacter++;
+                    while( lCur + 1 < lLength && IsSpaceChar( pszText[lCur + 1] ) )
+                        lCur++;
 
-                    pszStartOfCurrentWord = pszCurrentCharacter + 1;
+                    lStartOfWord = lCur + 1;
                 }
                 else
                 {
-                    pszStartOfCurrentWord = pszCurrentCharacter;
+                    lStartOfWord = lCur;
                 }
-                pszLineBegin = pszStartOfCurrentWord;
+                lLineBegin = lStartOfWord;
                 startOfWord = true;
                 dCurWidthOfLine = 0.0;
             }
             else 
             {           
-                dCurWidthOfLine += m_pFont->GetFontMetrics()->UnicodeCharWidth( SwapCharBytesIfRequired( *pszCurrentCharacter ) );
+                dCurWidthOfLine += vecWidths[lCur];
             }
 
             startOfWord = true;
@@ -1092,70 +1128,126 @@ std::vector<PdfString> PdfPainter::GetMultiLineTextAsLines( double dWidth, const
         {
             if (startOfWord)
             {
-                pszStartOfCurrentWord = pszCurrentCharacter;
+                lStartOfWord = lCur;
                 startOfWord = false;
             }
             //else do nothing
 
-            if ((dCurWidthOfLine + m_pFont->GetFontMetrics()->UnicodeCharWidth( SwapCharBytesIfRequired( *pszCurrentCharacter ))) > dWidth)
+            if ((dCurWidthOfLine + vecWidths[lCur]) > dWidth)
             {
-                if ( pszLineBegin == pszStartOfCurrentWord )
+                if ( lLineBegin == lStartOfWord )
                 {
                     // This word takes up the whole line.
                     // Put as much as possible on this line.                    
-                    if (pszLineBegin == pszCurrentCharacter)
+                    if (lLineBegin == lCur)
                     {
-                        vecLines.push_back( PdfString( pszCurrentCharacter, 1 ) );
-                        pszLineBegin = pszCurrentCharacter + 1;
-                        pszStartOfCurrentWord = pszCurrentCharacter + 1;
+                        rvecBreaks.push_back( std::make_pair( lCur, lCur + 1 ) );
+                        lLineBegin = lCur + 1;
+                        lStartOfWord = lCur + 1;
                         dCurWidthOfLine = 0;
                     }
                     else
                     {
-                        vecLines.push_back(PdfString(pszLineBegin, pszCurrentCharacter - pszLineBegin));
-                        pszLineBegin = pszCurrentCharacter;
-                        pszStartOfCurrentWord = pszCurrentCharacter;
-                        dCurWidthOfLine = m_pFont->GetFontMetrics()->UnicodeCharWidth( SwapCharBytesIfRequired( *pszCurrentCharacter ) );
+                        rvecBreaks.push_back( std::make_pair( lLineBegin, lCur ) );
+                        lLineBegin = lCur;
+                        lStartOfWord = lCur;
+                        dCurWidthOfLine = vecWidths[lCur];
                     }
                 }
                 else
                 {
                     // The current word does not fit in the current line.
                     // -> Move it to the next one.                    
-                    vecLines.push_back( PdfString( pszLineBegin, pszStartOfCurrentWord - pszLineBegin ) );
-                    pszLineBegin = pszStartOfCurrentWord;
-                    dCurWidthOfLine = m_pFont->GetFontMetrics()->StringWidth( pszStartOfCurrentWord, (pszCurrentCharacter - pszStartOfCurrentWord) + 1);
+                    rvecBreaks.push_back( std::make_pair( lLineBegin, lStartOfWord ) );
+                    lLineBegin = lStartOfWord;
+                    dCurWidthOfLine = pMetrics->StringWidth( pszText + lStartOfWord, static_cast<unsigned int>(lCur - lStartOfWord + 1) );
                 }
             }
             else 
             {
-                dCurWidthOfLine += m_pFont->GetFontMetrics()->UnicodeCharWidth( SwapCharBytesIfRequired( *pszCurrentCharacter ) );
+                dCurWidthOfLine += vecWidths[lCur];
             }
         }
-        ++pszCurrentCharacter;
+        ++lCur;
     }
 
-    if( (pszCurrentCharacter - pszLineBegin) > 0 ) 
+    if( (lCur - lLineBegin) > 0 ) 
     {
-        if( dCurWidthOfLine > dWidth && pszStartOfCurrentWord > pszLineBegin )
+        if( dCurWidthOfLine > dWidth && lStartOfWord > lLineBegin )
         {
             // The previous word does not fit in the current line.
             // -> Move it to the next one.
-            vecLines.push_back( PdfString( pszLineBegin, pszStartOfCurrentWord - pszLineBegin) );
-            pszLineBegin = pszStartOfCurrentWord;
+            rvecBreaks.push_back( std::make_pair( lLineBegin, lStartOfWord ) );
+            lLineBegin = lStartOfWord;
         }
         //else do nothing
 
-        if( pszCurrentCharacter - pszLineBegin > 0 ) 
+        if( lCur - lLineBegin > 0 ) 
         {
-            vecLines.push_back( PdfString( pszLineBegin, pszCurrentCharacter - pszLineBegin) );
+            rvecBreaks.push_back( std::make_pair( lLineBegin, lCur ) );
         }
         //else do nothing
     }
+}
+
+std::vector<PdfString> PdfPainter::GetMultiLineTextAsLines( double dWidth, const PdfString & rsText, bool bSkipSpaces )
+{
+    PODOFO_RAISE_LOGIC_IF( !m_pCanvas, "Call SetPage() first before doing drawing operations." );
+
+    if( !m_pFont || !m_pPage || !rsText.IsValid() )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+     
+    if( dWidth <= 0.0 ) // nonsense arguments
+	    return std::vector<PdfString>();
+    
+    if( rsText.GetCharacterLength() == 0 ) // empty string
+        return std::vector<PdfString>(1, rsText);
+	        
+    std::vector<pdf_utf16be> stringUtf16;
+    const pdf_long           lLength = ConvertToUtf16( rsText, stringUtf16 );
+
+    std::vector< std::pair<pdf_long,pdf_long> > vecBreaks;
+    GetLineBreaks( m_pFont->GetFontMetrics(), &stringUtf16[0], lLength, dWidth, bSkipSpaces, vecBreaks );
+
+	std::vector<PdfString> vecLines;
+    vecLines.reserve( vecBreaks.size() );
+    for( size_t i = 0; i < vecBreaks.size(); i++ ) 
+    {
+        vecLines.push_back( PdfString( &stringUtf16[0] + vecBreaks[i].first, 
+                                       vecBreaks[i].second - vecBreaks[i].first ) );
+    }
 
     return vecLines;
 }
 
+void PdfPainter::GetMultiLineTextBreaks( double dWidth, const PdfString & rsText, 
+                                         std::vector< std::pair<pdf_long,pdf_long> > & rvecBreaks, bool bSkipSpaces )
+{
+    PODOFO_RAISE_LOGIC_IF( !m_pCanvas, "Call SetPage() first before doing drawing operations." );
+
+    if( !m_pFont || !m_pPage || !rsText.IsValid() )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    rvecBreaks.clear();
+    if( dWidth <= 0.0 ) // nonsense arguments
+	    return;
+    
+    if( rsText.GetCharacterLength() == 0 ) // empty string
+    {
+        rvecBreaks.push_back( std::make_pair( static_cast<pdf_long>(0), static_cast<pdf_long>(0) ) );
+        return;
+    }
+
+    std::vector<pdf_utf16be> stringUtf16;
+    const pdf_long           lLength = ConvertToUtf16( rsText, stringUtf16 );
+
+    GetLineBreaks( m_pFont->GetFontMetrics(), &stringUtf16[0], lLength, dWidth, bSkipSpaces, rvecBreaks );
+}
+
 void PdfPainter::DrawTextAligned( double dX, double dY, double dWidth, const PdfString & rsText, EPdfAlignment eAlignment )
 {
     PODOFO_RAISE_LOGIC_IF( !m_pCanvas, "Call SetPage() first before doing drawing operations." );
@@ -434,6 +434,21 @@ class PODOFO_DOC_API PdfPainter {
      */
     std::vector<PdfString> GetMultiLineTextAsLines( double dWidth, const PdfString & rsText, bool bSkipSpaces = true);
 
+    /** Gets the positions where the text is divided into individual lines
+     *  by GetMultiLineTextAsLines, using the current font.
+     *
+     *  The text is measured only once, so this is also fast for long texts.
+     *
+     *  \param dWidth width of the text area
+     *  \param rsText the text which should be drawn
+     *  \param rvecBreaks for each line the index of its first character and
+     *         the index after its last character in the UTF-16 representation
+     *         of rsText are stored in this vector
+     *  \param bSkipSpaces whether the trailing whitespaces should be skipped, so that next line doesn't start with whitespace
+     */
+    void GetMultiLineTextBreaks( double dWidth, const PdfString & rsText, 
+                                 std::vector< std::pair<pdf_long,pdf_long> > & rvecBreaks, bool bSkipSpaces = true );
+
     /** Draw a single line of text horizontally aligned.
      *  \param dX the x coordinate of the text line
      *  \param dY the y coordinate of the text line
@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#include "PdfSharedFontCache.h"
+
+#include "base/PdfDefinesPrivate.h"
+#include "base/PdfInputStream.h"
+#include "base/util/PdfMutexWrapper.h"
+
+namespace PoDoFo {
+
+/** Build the key used for a font lookup by name and style.
+ */
+static std::string FontPathKey( const char* pszFontName, bool bBold, bool bItalic )
+{
+    std::string sKey( pszFontName ? pszFontName : "" );
+    sKey += bBold   ? "|B" : "|-";
+    sKey += bItalic ? "I"  : "-";
+    return sKey;
+}
+
+/** Build the key used for the width table of a font file.
+ */
+static std::string WidthsKey( const char* pszFilename, bool bSymbol )
+{
+    std::string sKey( pszFilename ? pszFilename : "" );
+    sKey += bSymbol ? "|S" : "|U";
+    return sKey;
+}
+
+PdfSharedFontCache::PdfSharedFontCache()
+    : m_pMutex( new Util::PdfMutex() )
+{
+}
+
+PdfSharedFontCache::~PdfSharedFontCache()
+{
+    TIMapFontFiles it = m_mapFontFiles.begin();
+    while( it != m_mapFontFiles.end() )
+    {
+        podofo_free( (*it).second.m_pData );
+        ++it;
+    }
+
+    delete m_pMutex;
+}
+
+PdfRefCountedBuffer PdfSharedFontCache::GetFontFile( const char* pszFilename )
+{
+    if( !pszFilename )
+    {
+        PODOFO_RAISE_ERROR( ePdfError_InvalidHandle );
+    }
+
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    TCIMapFontFiles it = m_mapFontFiles.find( pszFilename );
+    if( it == m_mapFontFiles.end() ) 
+    {
+        PdfFileInputStream stream( pszFilename );
+        pdf_long           lLen = stream.GetFileLength();
+        if( lLen <= 0 )
+        {
+            PODOFO_RAISE_ERROR_INFO( ePdfError_UnsupportedFontFormat, pszFilename );
+        }
+
+        TFontFile file;
+        file.m_lSize = static_cast<size_t>(lLen);
+        file.m_pData = static_cast<char*>(podofo_malloc( file.m_lSize ));
+        if( !file.m_pData )
+        {
+            PODOFO_RAISE_ERROR( ePdfError_OutOfMemory );
+        }
+
+        if( stream.Read( file.m_pData, lLen ) != lLen )
+        {
+            podofo_free( file.m_pData );
+            PODOFO_RAISE_ERROR_INFO( ePdfError_UnexpectedEOF, pszFilename );
+        }
+
+        it = m_mapFontFiles.insert( TMapFontFiles::value_type( pszFilename, file ) ).first;
+    }
+
+    // The data is freed only by our destructor, so documents
+    // can reference it without taking possession
+    PdfRefCountedBuffer buffer( (*it).second.m_pData, (*it).second.m_lSize );
+    buffer.SetTakePossesion( false );
+    return buffer;
+}
+
+bool PdfSharedFontCache::GetFontPath( const char* pszFontName, bool bBold, bool bItalic, std::string & rsPath ) const
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    TCIMapFontPaths it = m_mapFontPaths.find( FontPathKey( pszFontName, bBold, bItalic ) );
+    if( it == m_mapFontPaths.end() )
+        return false;
+
+    rsPath = (*it).second;
+    return true;
+}
+
+void PdfSharedFontCache::AddFontPath( const char* pszFontName, bool bBold, bool bItalic, const std::string & rsPath )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    m_mapFontPaths[FontPathKey( pszFontName, bBold, bItalic )] = rsPath;
+}
+
+bool PdfSharedFontCache::GetWidths( const char* pszFilename, bool bSymbol, std::vector<double> & rvecWidth ) const
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    TCIMapWidths it = m_mapWidths.find( WidthsKey( pszFilename, bSymbol ) );
+    if( it == m_mapWidths.end() )
+        return false;
+
+    rvecWidth = (*it).second;
+    return true;
+}
+
+void PdfSharedFontCache::AddWidths( const char* pszFilename, bool bSymbol, const std::vector<double> & rvecWidth )
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    m_mapWidths[WidthsKey( pszFilename, bSymbol )] = rvecWidth;
+}
+
+size_t PdfSharedFontCache::GetFontFileCount() const
+{
+    Util::PdfMutexWrapper mutex( *m_pMutex );
+
+    return m_mapFontFiles.size();
+}
+
+};
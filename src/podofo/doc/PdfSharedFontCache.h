@@ -0,0 +1,150 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *   In addition, as a special exception, the copyright holders give       *
+ *   permission to link the code of portions of this program with the      *
+ *   OpenSSL library under certain conditions as described in each         *
+ *   individual source file, and distribute linked combinations            *
+ *   including the two.                                                    *
+ *   You must obey the GNU General Public License in all respects          *
+ *   for all of the code used other than OpenSSL.  If you modify           *
+ *   file(s) with this exception, you may extend this exception to your    *
+ *   version of the file(s), but you are not obligated to do so.  If you   *
+ *   do not wish to do so, delete this exception statement from your       *
+ *   version.  If you delete this exception statement from all source      *
+ *   files in the program, then also delete it here.                       *
+ ***************************************************************************/
+
+#ifndef _PDF_SHARED_FONT_CACHE_H_
+#define _PDF_SHARED_FONT_CACHE_H_
+
+#include "podofo/base/PdfDefines.h"
+#include "podofo/base/PdfRefCountedBuffer.h"
+#include "podofo/base/util/PdfMutex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PoDoFo {
+
+/**
+ * A cache of font data which can be shared by the PdfFontCache
+ * of many documents, even if they are used in different threads.
+ *
+ * Loading a font file and measuring its glyphs is done only once
+ * per process instead of once per document. The cache keeps the
+ * contents of font files, the results of font lookups by name and
+ * the width tables of PdfFontMetricsFreetype in memory until it
+ * is destroyed.
+ *
+ * FreeType faces are not shared, as they must not be used from
+ * several threads at once: every document still opens its own
+ * faces, but from the shared font data.
+ *
+ * The cache has to outlive all documents that use it.
+ *
+ * \see PdfDocument::SetSharedFontCache
+ */
+class PODOFO_DOC_API PdfSharedFontCache {
+ public:
+    PdfSharedFontCache();
+    ~PdfSharedFontCache();
+
+    /** Get the contents of a font file. The file is read
+     *  on first use only.
+     *
+     *  \param pszFilename path to a font file
+     *  \returns a buffer which references the shared contents
+     *           of the file without owning them
+     */
+    PdfRefCountedBuffer GetFontFile( const char* pszFilename );
+
+    /** Get the result of an earlier font lookup by name.
+     *
+     *  \param pszFontName a fontname
+     *  \param bBold if true a bold font was searched
+     *  \param bItalic if true an italic font was searched
+     *  \param rsPath the path of the font file is stored here
+     *  \returns true if the lookup was found in the cache
+     */
+    bool GetFontPath( const char* pszFontName, bool bBold, bool bItalic, std::string & rsPath ) const;
+
+    /** Remember the result of a font lookup by name.
+     *
+     *  \param pszFontName a fontname
+     *  \param bBold if true a bold font was searched
+     *  \param bItalic if true an italic font was searched
+     *  \param rsPath path of the font file, empty if none was found
+     */
+    void AddFontPath( const char* pszFontName, bool bBold, bool bItalic, const std::string & rsPath );
+
+    /** Get the width table of a font file.
+     *
+     *  \param pszFilename path to a font file
+     *  \param bSymbol whether the widths were measured for a symbol encoding
+     *  \param rvecWidth the widths are copied to this vector
+     *  \returns true if the widths were found in the cache
+     */
+    bool GetWidths( const char* pszFilename, bool bSymbol, std::vector<double> & rvecWidth ) const;
+
+    /** Store the width table of a font file.
+     *
+     *  \param pszFilename path to a font file
+     *  \param bSymbol whether the widths were measured for a symbol encoding
+     *  \param rvecWidth the widths of the font
+     */
+    void AddWidths( const char* pszFilename, bool bSymbol, const std::vector<double> & rvecWidth );
+
+    /**
+     * \returns the number of font files kept in memory
+     */
+    size_t GetFontFileCount() const;
+
+ private:
+    /** Copying is not allowed.
+     */
+    PdfSharedFontCache( const PdfSharedFontCache & rhs );
+    const PdfSharedFontCache & operator=( const PdfSharedFontCache & rhs );
+
+ private:
+    struct TFontFile {
+        char*  m_pData;
+        size_t m_lSize;
+    };
+
+    typedef std::map<std::string,TFontFile>                  TMapFontFiles;
+    typedef TMapFontFiles::iterator                          TIMapFontFiles;
+    typedef TMapFontFiles::const_iterator                    TCIMapFontFiles;
+
+    typedef std::map<std::string,std::string>                TMapFontPaths;
+    typedef TMapFontPaths::const_iterator                    TCIMapFontPaths;
+
+    typedef std::map<std::string,std::vector<double> >       TMapWidths;
+    typedef TMapWidths::const_iterator                       TCIMapWidths;
+
+    TMapFontFiles          m_mapFontFiles;       ///< Contents of all font files by their path
+    TMapFontPaths          m_mapFontPaths;       ///< Font files by fontname and style
+    TMapWidths             m_mapWidths;          ///< Width tables by font file path and encoding
+    Util::PdfMutex*        m_pMutex;             ///< Synchronizes all accesses to the maps
+};
+
+};
+
+#endif // _PDF_SHARED_FONT_CACHE_H_
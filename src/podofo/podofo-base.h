@@ -41,6 +41,7 @@
 #include "base/Pdf3rdPtyForwardDecl.h"
 #include "base/PdfArray.h"
 #include "base/PdfCanvas.h"
+#include "base/PdfCharCodeMap.h"
 #include "base/PdfColor.h"
 #include "base/PdfContentsTokenizer.h"
 #include "base/PdfData.h"
@@ -71,9 +72,11 @@
 #include "base/PdfRefCountedBuffer.h"
 #include "base/PdfRefCountedInputDevice.h"
 #include "base/PdfReference.h"
+#include "base/PdfSpillStream.h"
 #include "base/PdfStream.h"
 #include "base/PdfString.h"
 #include "base/PdfTokenizer.h"
+#include "base/PdfUpdateSession.h"
 #include "base/PdfVariant.h"
 #include "base/PdfVecObjects.h"
 #include "base/PdfWriter.h"
@@ -90,6 +90,7 @@
 #include "doc/PdfPainter.h"
 #include "doc/PdfPainterMM.h"
 #include "doc/PdfShadingPattern.h"
+#include "doc/PdfSharedFontCache.h"
 #include "doc/PdfSignatureField.h"
 #include "doc/PdfSignOutputDevice.h"
 #include "doc/PdfStreamedDocument.h"
@@ -21,6 +21,8 @@
 #include "DeviceTest.h"
 #include <podofo.h>
 
+#include <sstream>
+
 #include <stdio.h>
 #include <string.h>
 #define BUFFER_SIZE 4096
@@ -120,3 +122,131 @@ void DeviceTest::testDevices()
     
 }
 
+static std::string WrittenReal( double dValue, int nPrecision, bool bTrimZeros = false )
+{
+    PdfRefCountedBuffer buffer;
+    PdfOutputDevice     device( &buffer );
+
+    device.WriteReal( dValue, nPrecision, bTrimZeros );
+    return std::string( buffer.GetBuffer(), device.GetLength() );
+}
+
+void DeviceTest::testNumbers()
+{
+    const pdf_int64 ints[] = { 0, 1, -1, 9, 10, 99, 100, -4711, PODOFO_LL_LITERAL(2147483648),
+                               PODOFO_LL_LITERAL(9223372036854775807),
+                               -PODOFO_LL_LITERAL(9223372036854775807) - 1 };
+    char            szExpected[128];
+
+    for( size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++ ) 
+    {
+        PdfRefCountedBuffer buffer;
+        PdfOutputDevice     device( &buffer );
+
+        device.WriteInt( ints[i] );
+        snprintf( szExpected, sizeof(szExpected), "%" PDF_FORMAT_INT64, ints[i] );
+        CPPUNIT_ASSERT_EQUAL( std::string( szExpected ), std::string( buffer.GetBuffer(), device.GetLength() ) );
+    }
+
+    // Includes ties, negative zero and numbers which are 
+    // not handled by the fast path
+    const double reals[] = { 0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.0005, 2.0005, -0.0001, 
+                             0.1, 595.276, 841.89, -123.4565, 1e-10, 999999.9999999, 1e20 };
+
+    for( size_t i = 0; i < sizeof(reals) / sizeof(reals[0]); i++ ) 
+    {
+        for( int nPrecision = 0; nPrecision <= 10; nPrecision++ )
+        {
+            snprintf( szExpected, sizeof(szExpected), "%.*f", nPrecision, reals[i] );
+            CPPUNIT_ASSERT_EQUAL( std::string( szExpected ), WrittenReal( reals[i], nPrecision ) );
+        }
+    }
+
+    CPPUNIT_ASSERT_EQUAL( std::string( "1.5" ), WrittenReal( 1.5, 6, true ) );
+    CPPUNIT_ASSERT_EQUAL( std::string( "100" ), WrittenReal( 100.0, 6, true ) );
+    CPPUNIT_ASSERT_EQUAL( std::string( "-0" ), WrittenReal( -0.0000001, 6, true ) );
+
+    PdfRefCountedBuffer buffer;
+    PdfOutputDevice     device( &buffer );
+
+    device.WriteXRefRow( 0, 65535, 'f' );
+    device.WriteXRefRow( PODOFO_ULL_LITERAL(1234567890), 0, 'n' );
+    device.WriteXRefRow( 15, 7, 'n' );
+    CPPUNIT_ASSERT_EQUAL( std::string( "0000000000 65535 f \n1234567890 00000 n \n0000000015 00007 n \n" ),
+                          std::string( buffer.GetBuffer(), device.GetLength() ) );
+}
+
+void DeviceTest::testWriteBuffer()
+{
+    // std::ostreams are not buffered by default
+    std::ostringstream unbuffered;
+    PdfOutputDevice    unbufferedDevice( &unbuffered );
+    unbufferedDevice.Write( "xyz", 3 );
+    CPPUNIT_ASSERT_EQUAL( std::string( "xyz" ), unbuffered.str() );
+
+    std::ostringstream stream;
+    PdfOutputDevice    device( &stream );
+
+    device.SetWriteBufferSize( 8 );
+    device.Write( "abc", 3 );
+    device.Print( "%i", 4711 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(7), device.Tell() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(7), device.GetLength() );
+    CPPUNIT_ASSERT_EQUAL( std::string( "" ), stream.str() );
+
+    // Larger than the buffer
+    device.Write( "0123456789", 10 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(17), device.Tell() );
+    CPPUNIT_ASSERT_EQUAL( std::string( "abc47110123456789" ), stream.str() );
+
+    device.Write( "xy", 2 );
+    device.Seek( 1 );
+    CPPUNIT_ASSERT_EQUAL( std::string( "abc47110123456789xy" ), stream.str() );
+
+    device.Write( "B", 1 );
+    device.Flush();
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(2), device.Tell() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(19), device.GetLength() );
+    CPPUNIT_ASSERT_EQUAL( std::string( "aBc47110123456789xy" ), stream.str() );
+}
+
+void DeviceTest::testInputStreamDevice()
+{
+    std::string sData;
+    for( int i = 0; i < 10000; i++ )
+        sData += static_cast<char>('a' + i % 26);
+
+    PdfMemoryInputStream stream( sData.c_str(), sData.length() );
+    PdfInputStreamDevice device( &stream, false );
+
+    CPPUNIT_ASSERT_EQUAL( static_cast<int>('a'), device.Look() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<int>('a'), device.GetChar() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<int>('b'), device.GetChar() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<std::streamoff>(2), device.Tell() );
+
+    // Forward beyond the current window
+    device.Seek( 5000 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<std::streamoff>(5000), device.Tell() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<int>(sData[5000]), device.GetChar() );
+
+    // A few bytes backwards, as the tokenizer does
+    device.Seek( -10, std::ios_base::cur );
+    CPPUNIT_ASSERT_EQUAL( static_cast<std::streamoff>(4991), device.Tell() );
+
+    char buffer[5000];
+    CPPUNIT_ASSERT_EQUAL( static_cast<std::streamoff>(4500), device.Read( buffer, 4500 ) );
+    CPPUNIT_ASSERT( sData.substr( 4991, 4500 ) == std::string( buffer, 4500 ) );
+
+    // The start of the data is no longer available
+    CPPUNIT_ASSERT_THROW( device.Seek( 0 ), PdfError );
+    CPPUNIT_ASSERT_THROW( device.Seek( 0, std::ios_base::end ), PdfError );
+
+    // Read the rest
+    CPPUNIT_ASSERT( !device.Eof() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<std::streamoff>(509), device.Read( buffer, sizeof(buffer) ) );
+    CPPUNIT_ASSERT( sData.substr( 9491 ) == std::string( buffer, 509 ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<int>(EOF), device.Look() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<int>(EOF), device.GetChar() );
+    CPPUNIT_ASSERT( device.Eof() );
+    CPPUNIT_ASSERT_THROW( device.Seek( 20000 ), PdfError );
+}
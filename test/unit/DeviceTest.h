@@ -27,12 +27,30 @@ class DeviceTest : public CppUnit::TestFixture
 {
     CPPUNIT_TEST_SUITE( DeviceTest );
     CPPUNIT_TEST( testDevices );
+    CPPUNIT_TEST( testNumbers );
+    CPPUNIT_TEST( testWriteBuffer );
+    CPPUNIT_TEST( testInputStreamDevice );
     CPPUNIT_TEST_SUITE_END();
 public:
     void setUp();
     void tearDown();
 
     void testDevices();
+
+    /** Compare WriteInt, WriteReal and WriteXRefRow 
+     *  with the output of printf.
+     */
+    void testNumbers();
+
+    /** Check positions and content of a 
+     *  std::ostream written through a small write buffer.
+     */
+    void testWriteBuffer();
+
+    /** Read, look and seek in a PdfInputStreamDevice
+     *  across the boundaries of its window.
+     */
+    void testInputStreamDevice();
 };
 
 #endif // _DEVICE_TEST_H_
@@ -289,6 +289,24 @@ void EncodingTest::testUnicodeNames()
     CPPUNIT_ASSERT_EQUAL_MESSAGE( "Compared codes count", 65422, nCount );
 }
 
+void EncodingTest::testUnicodeNamesLookup()
+{
+    std::vector<PdfName> vecNames;
+    vecNames.reserve( 0x10000 );
+    for( int i = 0;i<=0xFFFF; i++ ) 
+        vecNames.push_back( PdfDifferenceEncoding::UnicodeIDToName( static_cast<pdf_utf16be>(i) ) );
+
+    int nFound = 0;
+    for( size_t i = 0; i < vecNames.size(); i++ ) 
+    {
+        if( PdfDifferenceEncoding::NameToUnicodeID( vecNames[i] ) )
+            ++nFound;
+    }
+
+    // Only the name of 0x0000 (.notdef) has no code point
+    CPPUNIT_ASSERT_EQUAL( 0x10000 - 1, nFound );
+}
+
 void EncodingTest::testGetCharCode()
 {
     std::string msg;
@@ -412,6 +430,86 @@ void EncodingTest::testToUnicodeParse()
     }
 }
 
+void EncodingTest::testToUnicodeLigatures()
+{
+    const char *toUnicode =
+        "2 beginbfchar\n"
+        "<0001> <00660069>\n"
+        "<0002> <0041>\n"
+        "endbfchar\n"
+        "1 beginbfrange\n"
+        "<0003> <0004> <00660066>\n"
+        "endbfrange\n";
+    const pdf_utf16be *encodedStr = reinterpret_cast< const pdf_utf16be *>( "\x0\x1\x0\x2\x0\x3\x0\x4\x0\x0" );
+    const pdf_utf16be expected[] = {
+        0x0066, 0x0069,
+        0x0041,
+        0x0066, 0x0066,
+        0x0066, 0x0067,
+        0 };
+    PdfVecObjects vec;
+    PdfObject *strmObject;
+
+    vec.SetAutoDelete( true );
+
+    strmObject = vec.CreateObject( PdfVariant( PdfDictionary() ) );
+    strmObject->GetStream()->Set( toUnicode, strlen( toUnicode ) );
+
+    PdfIdentityEncoding encoding(0x0001, 0x0004, true, strmObject);
+
+    PdfString unicodeString = encoding.ConvertToUnicode( PdfString( encodedStr ), NULL );
+    const pdf_utf16be *unicodeStr = reinterpret_cast<const pdf_utf16be *>( unicodeString.GetString() );
+    int ii;
+
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(sizeof(expected) - sizeof(pdf_utf16be)), unicodeString.GetLength() );
+    for( ii = 0; expected[ii]; ii++ ) {
+        pdf_utf16be expects = expected[ii];
+#ifdef PODOFO_IS_LITTLE_ENDIAN
+        expects = (expects << 8) | (expects >> 8 );
+#endif
+        CPPUNIT_ASSERT_EQUAL( expects, unicodeStr[ii] );
+    }
+
+    // Only codes which map to a single unicode value can be encoded
+    PdfRefCountedBuffer encoded = encoding.ConvertToEncoding( PdfString( "A" ), NULL );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(2), encoded.GetSize() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<char>(0x00), encoded.GetBuffer()[0] );
+    CPPUNIT_ASSERT_EQUAL( static_cast<char>(0x02), encoded.GetBuffer()[1] );
+}
+
+void EncodingTest::testCharCodeMapOverwrite()
+{
+    PdfCharCodeMap map;
+    map.Insert( 0x0005, 0x0041 );
+    map.Insert( 0x0003, 0x0041 );
+    map.Insert( 0x0007, 0x0041 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0003), map.GetCode( 0x0041 ) );
+
+    // Overwriting the lowest code of a value makes the next higher code its code
+    map.Insert( 0x0003, 0x0042 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0005), map.GetCode( 0x0041 ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0003), map.GetCode( 0x0042 ) );
+
+    std::vector<pdf_utf16be> vecLigature;
+    vecLigature.push_back( 0x0066 );
+    vecLigature.push_back( 0x0069 );
+    map.Insert( 0x0005, vecLigature );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0007), map.GetCode( 0x0041 ) );
+
+    // Inserting the same mapping again changes nothing
+    map.Insert( 0x0007, 0x0041 );
+    map.Insert( 0x0001, 0x0041 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0001), map.GetCode( 0x0041 ) );
+
+    map.Insert( 0x0001, 0x0043 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0007), map.GetCode( 0x0041 ) );
+
+    map.Insert( 0x0007, 0x0043 );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0000), map.GetCode( 0x0041 ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0001), map.GetCode( 0x0043 ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_utf16be>(0x0043), map.GetUnicode( 0x0007 ) );
+}
+
 bool EncodingTest::outofRangeHelper( PdfEncoding* pEncoding, std::string & rMsg, const char* pszName )
 {
     bool exception = false;
@@ -36,8 +36,11 @@ class EncodingTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testDifferencesEncoding );
   CPPUNIT_TEST( testDifferencesObject );
   CPPUNIT_TEST( testUnicodeNames );
+  CPPUNIT_TEST( testUnicodeNamesLookup );
   CPPUNIT_TEST( testGetCharCode );
   CPPUNIT_TEST( testToUnicodeParse );
+  CPPUNIT_TEST( testToUnicodeLigatures );
+  CPPUNIT_TEST( testCharCodeMapOverwrite );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -48,8 +51,14 @@ class EncodingTest : public CppUnit::TestFixture
   void testDifferencesObject();
   void testDifferencesEncoding();
   void testUnicodeNames();
+
+  /** Look up the glyph names of all code points as done for /Differences arrays
+   */
+  void testUnicodeNamesLookup();
   void testGetCharCode();
   void testToUnicodeParse();
+  void testToUnicodeLigatures();
+  void testCharCodeMapOverwrite();
 
  private:
 
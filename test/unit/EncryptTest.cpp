@@ -148,9 +148,7 @@ void EncryptTest::testAESV2()
                                                          PdfEncrypt::ePdfKeyLength_128 );
 
     TestAuthenticate( pEncrypt, 128, 4 );
-    // AES decryption is not yet implemented.
-    // Therefore we have to disable this test.
-    // TestEncrypt( pEncrypt );
+    TestEncrypt( pEncrypt );
 
     delete pEncrypt;
 }
@@ -163,9 +161,7 @@ void EncryptTest::testAESV3()
                                                         PdfEncrypt::ePdfKeyLength_256 );
     
     TestAuthenticate( pEncrypt, 256, 5 );
-    // AES decryption is not yet implemented.
-    // Therefore we have to disable this test.
-    // TestEncrypt( pEncrypt );
+    TestEncrypt( pEncrypt );
     
     delete pEncrypt;
 }
@@ -177,9 +173,7 @@ void EncryptTest::testAESV3R6()
                                                         PdfEncrypt::ePdfKeyLength_256 );
 
     TestAuthenticate( pEncrypt, 256, 5 );
-    // AES decryption is not yet implemented.
-    // Therefore we have to disable this test.
-    // TestEncrypt( pEncrypt );
+    TestEncrypt( pEncrypt );
 
     delete pEncrypt;
 }
@@ -232,6 +226,70 @@ void EncryptTest::TestEncrypt( PdfEncrypt* pEncrypt )
     CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare encrypted and decrypted buffers",
                                   0, memcmp( m_pEncBuffer, pDecryptedBuffer, m_lLen ) );
 
+    // Encrypt using a stream in several blocks
+    // which are not aligned to the AES block size
+    try {
+        PdfMemoryOutputStream mem( nOutputLen );
+        PODOFO_UNIQUEU_PTR<PdfOutputStream> pStream( pEncrypt->CreateEncryptionOutputStream( &mem ) );
+        pStream->Write( m_pEncBuffer, 5 );
+        pStream->Write( m_pEncBuffer + 5, m_lLen - 5 );
+        pStream->Close();
+        mem.Close();
+
+        CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare length of encrypted stream and buffer",
+                                      static_cast<long>(nOutputLen), static_cast<long>(mem.GetLength()) );
+        CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare encrypted stream and buffer",
+                                      0, memcmp( pEncryptedBuffer, mem.GetBuffer(), nOutputLen ) );
+    } catch (PdfError &e) {
+        CPPUNIT_FAIL(e.ErrorMessage(e.GetError()));
+    }
+
+    // Decrypt using a stream with small reads
+    try {
+        PdfMemoryInputStream mem( reinterpret_cast<const char*>(pEncryptedBuffer), nOutputLen );
+        PODOFO_UNIQUEU_PTR<PdfInputStream> pStream( pEncrypt->CreateEncryptionInputStream( &mem ) );
+
+        pdf_long lDecrypted = 0;
+        pdf_long lRead;
+        while( (lRead = pStream->Read( reinterpret_cast<char*>(pDecryptedBuffer) + lDecrypted, 7 )) > 0 )
+            lDecrypted += lRead;
+
+        CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare length of decrypted stream and buffer",
+                                      static_cast<long>(m_lLen), static_cast<long>(lDecrypted) );
+        CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare decrypted stream and buffer",
+                                      0, memcmp( m_pEncBuffer, pDecryptedBuffer, m_lLen ) );
+    } catch (PdfError &e) {
+        CPPUNIT_FAIL(e.ErrorMessage(e.GetError()));
+    }
+
+    // Decrypt only the given length of an input stream 
+    // that continues after the encrypted data (like "endstream")
+    try {
+        const char*    pszTrailer = "\nendstream";
+        const pdf_long lTrailer   = static_cast<pdf_long>(strlen( pszTrailer ));
+        std::string    input( reinterpret_cast<const char*>(pEncryptedBuffer), nOutputLen );
+        input.append( pszTrailer );
+
+        PdfMemoryInputStream mem( input.c_str(), static_cast<pdf_long>(input.length()) );
+        PODOFO_UNIQUEU_PTR<PdfInputStream> pStream( pEncrypt->CreateEncryptionInputStream( &mem, nOutputLen ) );
+
+        pdf_long lDecrypted = 0;
+        pdf_long lRead;
+        while( (lRead = pStream->Read( reinterpret_cast<char*>(pDecryptedBuffer) + lDecrypted, 7 )) > 0 )
+            lDecrypted += lRead;
+
+        CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare length of decrypted stream and buffer",
+                                      static_cast<long>(m_lLen), static_cast<long>(lDecrypted) );
+        CPPUNIT_ASSERT_EQUAL_MESSAGE( "compare decrypted stream and buffer",
+                                      0, memcmp( m_pEncBuffer, pDecryptedBuffer, m_lLen ) );
+
+        char trailer[32];
+        CPPUNIT_ASSERT_EQUAL( static_cast<long>(lTrailer), static_cast<long>(mem.Read( trailer, sizeof(trailer), NULL )) );
+        CPPUNIT_ASSERT_EQUAL( 0, memcmp( trailer, pszTrailer, lTrailer ) );
+    } catch (PdfError &e) {
+        CPPUNIT_FAIL(e.ErrorMessage(e.GetError()));
+    }
+
     delete[] pEncryptedBuffer;
     delete[] pDecryptedBuffer;
 }
@@ -308,6 +366,81 @@ void EncryptTest::testLoadEncrypedFilePdfMemDocument()
     TestUtils::deleteFile(sFilename.c_str());
 }
 
+void EncryptTest::testDecryptManyStrings()
+{
+    const int nObjects = 2000;
+    const int nStrings = 50;
+
+    std::string              sFilename = TestUtils::getTempFilename();
+    std::vector<PdfReference> vecRefs;
+    char                     szBuffer[64];
+
+    try {
+        {
+            PdfMemDocument writer;
+            writer.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+
+            for( int i = 0; i < nObjects; i++ ) 
+            {
+                PdfObject* pObject = writer.GetObjects().CreateObject( PdfArray() );
+                vecRefs.push_back( pObject->Reference() );
+                for( int j = 0; j < nStrings; j++ ) 
+                {
+                    snprintf( szBuffer, sizeof(szBuffer), "String %i of object %i", j, i );
+                    pObject->GetArray().push_back( PdfString( szBuffer ) );
+                }
+            }
+
+            writer.SetEncrypted( "user", "owner", PdfEncrypt::ePdfPermissions_Print, 
+                                 PdfEncrypt::ePdfEncryptAlgorithm_AESV2 );
+            writer.Write( sFilename.c_str() );
+        }
+
+        PdfMemDocument document;
+        try {
+            document.Load( sFilename.c_str() );
+            CPPUNIT_FAIL("Encrypted file not recognized!");
+        } catch( PdfError & e ) {
+            if( e.GetError() != ePdfError_InvalidPassword ) 
+            {
+                CPPUNIT_FAIL("Invalid encryption exception thrown!");
+            }
+        }
+        document.SetPassword( "user" );
+
+        int nFound = 0;
+        for( int i = 0; i < nObjects; i++ ) 
+        {
+            PdfObject* pObject = document.GetObjects().GetObject( vecRefs[i] );
+            CPPUNIT_ASSERT( pObject != NULL );
+            CPPUNIT_ASSERT( pObject->IsArray() );
+
+            const PdfArray & rArray = pObject->GetArray();
+            CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(nStrings), rArray.size() );
+            for( int j = 0; j < nStrings; j++ ) 
+            {
+                snprintf( szBuffer, sizeof(szBuffer), "String %i of object %i", j, i );
+
+                CPPUNIT_ASSERT( rArray[j].IsString() || rArray[j].IsHexString() );
+                CPPUNIT_ASSERT_EQUAL( std::string( szBuffer ), std::string( rArray[j].GetString().GetString() ) );
+                ++nFound;
+            }
+        }
+
+        CPPUNIT_ASSERT_EQUAL( nObjects * nStrings, nFound );
+    } catch( PdfError & e ) {
+        e.PrintErrorMsg();
+
+        printf("Removing temp file: %s\n", sFilename.c_str());
+        TestUtils::deleteFile(sFilename.c_str());
+
+        throw e;
+    }
+
+    printf("Removing temp file: %s\n", sFilename.c_str());
+    TestUtils::deleteFile(sFilename.c_str());
+}
+
 void EncryptTest::CreateEncryptedPdf( const char* pszFilename )
 {
     PdfMemDocument  writer;
@@ -50,6 +50,7 @@ class EncryptTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testLoadEncrypedFilePdfParser );
   CPPUNIT_TEST( testLoadEncrypedFilePdfMemDocument );
   CPPUNIT_TEST( testEnableAlgorithms );
+  CPPUNIT_TEST( testDecryptManyStrings );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -75,6 +76,10 @@ class EncryptTest : public CppUnit::TestFixture
   void testLoadEncrypedFilePdfMemDocument();
 
   void testEnableAlgorithms();
+
+  /** Load a document with many small encrypted strings and check each string
+   */
+  void testDecryptManyStrings();
     
  private:
   void TestAuthenticate( PoDoFo::PdfEncrypt* pEncrypt, int keyLength, int rValue );
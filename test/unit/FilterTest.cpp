@@ -22,6 +22,8 @@
 
 #include <cppunit/Asserter.h>
 
+#include <sstream>
+
 #include <stdlib.h>
 
 // prefer std::unique_ptr over std::auto_ptr
@@ -137,5 +139,375 @@ void FilterTest::testCCITT()
         return;
     }
 
+    // A 16x4 image encoded with Group 4 and Group 3 (1D)
+    const unsigned char pG4[] = { 0x9B, 0x16, 0x4D, 0x45, 0xCA, 0xE6, 0xA0, 0x02, 0x00, 0x20 };
+    const unsigned char pG3[] = { 0x00, 0x1A, 0x80, 0x06, 0xC5, 0xB0, 0x01, 0x35, 0x16, 0x60, 0x02, 0x6A, 0xBB, 0xE4 };
+    const unsigned char pExpected[] = { 0xFF, 0xFF, 0xF0, 0x0F, 0x00, 0xFF, 0x7E, 0x7E };
+
+    for( int i = 0; i < 2; i++ ) 
+    {
+        PdfDictionary parms;
+        parms.AddKey( PdfName("K"), PdfVariant( static_cast<pdf_int64>(i == 0 ? -1 : 0) ) );
+        parms.AddKey( PdfName("Columns"), PdfVariant( static_cast<pdf_int64>(16) ) );
+        parms.AddKey( PdfName("Rows"), PdfVariant( static_cast<pdf_int64>(4) ) );
+
+        const char* pEncoded = reinterpret_cast<const char*>(i == 0 ? pG4 : pG3);
+        pdf_long    lEncoded = i == 0 ? sizeof(pG4) : sizeof(pG3);
+        char*       pDecoded;
+        pdf_long    lDecoded;
+
+        pFilter->Decode( pEncoded, lEncoded, &pDecoded, &lDecoded, &parms );
+
+        CPPUNIT_ASSERT_EQUAL( static_cast<long>(sizeof(pExpected)), static_cast<long>(lDecoded) );
+        CPPUNIT_ASSERT_EQUAL( memcmp( pExpected, pDecoded, sizeof(pExpected) ), 0 );
+
+        podofo_free( pDecoded );
+    }
+}
+
+void FilterTest::testCCITT2D()
+{
+    PODOFO_UNIQUEU_PTR<PdfFilter> pFilter( PdfFilterFactory::Create( ePdfFilter_CCITTFaxDecode ) );
+
+    // The 16x4 image of testCCITT, encoded by libtiff with Group 3 2D 
+    // options, with and without fill bits before each EOL
+    const unsigned char pG3[]      = { 0x00, 0x1D, 0x40, 0x02, 0x36, 0x2C, 0x00, 0x66, 0xA2, 0xCC, 0x00, 0x52, 0xB9, 0xA8 };
+    const unsigned char pG3Fill[]  = { 0x00, 0x01, 0xD4, 0x00, 0x01, 0x1B, 0x16, 0x00, 0x01, 0x9A, 0x8B, 0x30, 0x01, 0x4A, 0xE6, 0xA0 };
+    const unsigned char pExpected[] = { 0xFF, 0xFF, 0xF0, 0x0F, 0x00, 0xFF, 0x7E, 0x7E };
+
+    for( int i = 0; i < 2; i++ ) 
+    {
+        PdfDictionary parms;
+        parms.AddKey( PdfName("K"), PdfVariant( static_cast<pdf_int64>(2) ) );
+        parms.AddKey( PdfName("Columns"), PdfVariant( static_cast<pdf_int64>(16) ) );
+        parms.AddKey( PdfName("Rows"), PdfVariant( static_cast<pdf_int64>(4) ) );
+        parms.AddKey( PdfName("EncodedByteAlign"), PdfVariant( i == 1 ) );
+
+        const char* pEncoded = reinterpret_cast<const char*>(i == 0 ? pG3 : pG3Fill);
+        pdf_long    lEncoded = i == 0 ? sizeof(pG3) : sizeof(pG3Fill);
+
+        // Decode at once and byte by byte
+        for( int j = 0; j < 2; j++ ) 
+        {
+            PdfMemoryOutputStream output;
+            pFilter->BeginDecode( &output, &parms );
+            if( j == 0 )
+                pFilter->DecodeBlock( pEncoded, lEncoded );
+            else
+            {
+                for( pdf_long k = 0; k < lEncoded; k++ )
+                    pFilter->DecodeBlock( pEncoded + k, 1 );
+            }
+            pFilter->EndDecode();
+
+            CPPUNIT_ASSERT_EQUAL( static_cast<long>(sizeof(pExpected)), static_cast<long>(output.GetLength()) );
+            CPPUNIT_ASSERT_EQUAL( memcmp( pExpected, output.GetBuffer(), sizeof(pExpected) ), 0 );
+        }
+    }
+}
+
+void FilterTest::testDCT()
+{
+    PODOFO_UNIQUEU_PTR<PdfFilter> pFilter( PdfFilterFactory::Create( ePdfFilter_DCTDecode ) );
+    if( !pFilter.get() )
+    {
+        printf("!!! ePdfFilter_DCTDecode not implemented skipping test!\n");
+        return;
+    }
+
+    // A 16x16 grayscale image of four solid 8x8 blocks, encoded
+    // by libjpeg with quality 100, as baseline and progressive JPEG
+    const unsigned char pBaseline[] = {
+        0xFF, 0xD8, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0xFF, 0xC0, 0x00, 0x0B, 0x08, 0x00, 0x10, 0x00, 0x10,
+        0x01, 0x01, 0x11, 0x00, 0xFF, 0xC4, 0x00, 0x15, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0x14, 0x10,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00, 0x9F, 0xF9, 0x00, 0x10, 0x01,
+        0xFC, 0x3F, 0xFF, 0xD9
+    };
+    const unsigned char pProgressive[] = {
+        0xFF, 0xD8, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0xFF, 0xC2, 0x00, 0x0B, 0x08, 0x00, 0x10, 0x00, 0x10,
+        0x01, 0x01, 0x11, 0x00, 0xFF, 0xC4, 0x00, 0x15, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x0A, 0xFF, 0xDA, 0x00, 0x08, 0x01,
+        0x01, 0x00, 0x00, 0x00, 0x01, 0x9F, 0xF4, 0x01, 0x00, 0x7F, 0x3F, 0xFF, 0xC4, 0x00, 0x14, 0x10,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x20, 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02, 0x1F, 0xFF, 0xC4, 0x00, 0x14,
+        0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x20, 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x06, 0x3F, 0x02, 0x1F, 0xFF, 0xC4, 0x00,
+        0x14, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x20, 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3F, 0x21, 0x1F, 0xFF, 0xDA,
+        0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x00, 0x10, 0x0F, 0xFF, 0xC4, 0x00, 0x14, 0x10, 0x01, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0xFF,
+        0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3F, 0x10, 0x1F, 0xFF, 0xD9
+    };
+    const int pBlocks[] = { 0x00, 0x40, 0x80, 0xFF };
+
+    for( int i = 0; i < 2; i++ ) 
+    {
+        const char* pEncoded = reinterpret_cast<const char*>(i == 0 ? pBaseline : pProgressive);
+        pdf_long    lEncoded = i == 0 ? sizeof(pBaseline) : sizeof(pProgressive);
+
+        // Decode at once and byte by byte
+        for( int j = 0; j < 2; j++ ) 
+        {
+            PdfMemoryOutputStream output;
+            pFilter->BeginDecode( &output );
+            if( j == 0 )
+                pFilter->DecodeBlock( pEncoded, lEncoded );
+            else
+            {
+                for( pdf_long k = 0; k < lEncoded; k++ )
+                    pFilter->DecodeBlock( pEncoded + k, 1 );
+            }
+            pFilter->EndDecode();
+
+            CPPUNIT_ASSERT_EQUAL( static_cast<long>(16 * 16), static_cast<long>(output.GetLength()) );
+            for( int y = 0; y < 16; y++ ) 
+            {
+                for( int x = 0; x < 16; x++ ) 
+                {
+                    int nExpected = pBlocks[(y / 8) * 2 + x / 8];
+                    int nPixel    = static_cast<unsigned char>(output.GetBuffer()[y * 16 + x]);
+                    CPPUNIT_ASSERT( nPixel >= nExpected - 1 && nPixel <= nExpected + 1 );
+                }
+            }
+        }
+    }
+
+    // Truncated data is an error
+    char*    pDecoded;
+    pdf_long lDecoded;
+    CPPUNIT_ASSERT_THROW( pFilter->Decode( reinterpret_cast<const char*>(pBaseline), 20, &pDecoded, &lDecoded ), PdfError );
+}
+
+static std::string ReadAll( PdfInputStream* pStream )
+{
+    std::string sData;
+    char        buffer[333];
+    pdf_long    lRead;
+
+    // Read in small and odd sized pieces
+    while( (lRead = pStream->Read( buffer, 1 + sData.size() % sizeof(buffer) )) > 0 )
+        sData.append( buffer, lRead );
+
+    return sData;
+}
+
+void FilterTest::testDecodeInputStream()
+{
+    // Large enough for several windows of the decoding stream
+    std::string sData;
+    for( int i = 0; sData.size() < 100000; i++ ) 
+    {
+        std::ostringstream oss;
+        oss << i << ' ' << s_pTestBuffer1 << '\n';
+        sData += oss.str();
+    }
+
+    PdfVecObjects objects;
+    PdfObject*    pObject = objects.CreateObject();
+    TVecFilters   vecFilters;
+    vecFilters.push_back( ePdfFilter_ASCIIHexDecode );
+    vecFilters.push_back( ePdfFilter_FlateDecode );
+    pObject->GetStream()->Set( sData.c_str(), sData.length(), vecFilters );
+
+    PODOFO_UNIQUEU_PTR<PdfInputStream> pStream( pObject->GetStream()->CreateFilteredInputStream() );
+    CPPUNIT_ASSERT( sData == ReadAll( pStream.get() ) );
+
+    // The same through the filter factory on top of any PdfInputStream
+    char*    pRaw;
+    pdf_long lRaw;
+    pObject->GetStream()->GetCopy( &pRaw, &lRaw );
+
+    PdfMemoryInputStream raw( pRaw, lRaw );
+    pStream.reset( PdfFilterFactory::CreateDecodeInputStream( PdfFilterFactory::CreateFilterList( pObject ), &raw ) );
+    CPPUNIT_ASSERT( sData == ReadAll( pStream.get() ) );
+    podofo_free( pRaw );
+
+    // Streams without filters are read unchanged
+    pObject->GetStream()->Set( sData.c_str(), sData.length(), TVecFilters() );
+    pStream.reset( pObject->GetStream()->CreateFilteredInputStream() );
+    CPPUNIT_ASSERT( sData == ReadAll( pStream.get() ) );
+
+    // Corrupt data is reported while reading
+    PdfMemoryInputStream garbage( s_pTestBuffer1, s_lTestLength1 );
+    pStream.reset( PdfFilterFactory::CreateDecodeInputStream( TVecFilters( 1, ePdfFilter_FlateDecode ), &garbage ) );
+    CPPUNIT_ASSERT_THROW( ReadAll( pStream.get() ), PdfError );
+}
+
+static std::string Encode( EPdfFilter eFilter, const std::string & sData, size_t lBlock )
+{
+    PODOFO_UNIQUEU_PTR<PdfFilter> pFilter( PdfFilterFactory::Create( eFilter ) );
+    PdfMemoryOutputStream         output;
+
+    pFilter->BeginEncode( &output );
+    for( size_t i = 0; i < sData.size(); i += lBlock ) 
+        pFilter->EncodeBlock( sData.c_str() + i, PDF_MIN( lBlock, sData.size() - i ) );
+    pFilter->EndEncode();
+
+    return std::string( output.GetBuffer(), output.GetLength() );
+}
+
+static std::string Decode( EPdfFilter eFilter, const std::string & sData, size_t lBlock )
+{
+    PODOFO_UNIQUEU_PTR<PdfFilter> pFilter( PdfFilterFactory::Create( eFilter ) );
+    PdfMemoryOutputStream         output;
+
+    pFilter->BeginDecode( &output );
+    for( size_t i = 0; i < sData.size(); i += lBlock ) 
+        pFilter->DecodeBlock( sData.c_str() + i, PDF_MIN( lBlock, sData.size() - i ) );
+    pFilter->EndDecode();
+
+    return std::string( output.GetBuffer(), output.GetLength() );
+}
+
+static void TestRoundTrip( EPdfFilter eFilter, const std::string & sData )
+{
+    const std::string sEncoded = Encode( eFilter, sData, sData.size() );
+
+    CPPUNIT_ASSERT( sData == Decode( eFilter, sEncoded, sEncoded.size() ) );
+    CPPUNIT_ASSERT( sEncoded == Encode( eFilter, sData, 7 ) );
+
+    // Codes and runs are split between blocks
+    const size_t alBlocks[] = { 1, 2, 3, 5, 127, 128, 129 };
+    for( size_t i = 0; i < sizeof(alBlocks) / sizeof(alBlocks[0]); i++ )
+        CPPUNIT_ASSERT( sData == Decode( eFilter, sEncoded, alBlocks[i] ) );
+}
+
+void FilterTest::testLZW()
+{
+    // Every code adds an entry to the table, so pseudo random bytes
+    // fill the 4096 entries after a few KB and force a clear code
+    std::string  sRandom( 100000, '\0' );
+    unsigned int seed = 12345;
+    for( size_t i = 0; i < sRandom.size(); i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        sRandom[i] = static_cast<char>(seed >> 16);
+    }
+
+    TestRoundTrip( ePdfFilter_LZWDecode, sRandom );
+
+    // Long repetitions grow the entries to their maximum length
+    std::string sText;
+    while( sText.size() < 100000 )
+        sText.append( s_pTestBuffer1, s_lTestLength1 );
+
+    TestRoundTrip( ePdfFilter_LZWDecode, sText );
+    TestRoundTrip( ePdfFilter_LZWDecode, std::string( 100000, 'a' ) );
+    TestRoundTrip( ePdfFilter_LZWDecode, sText + sRandom + sText );
+
+    TestRoundTrip( ePdfFilter_LZWDecode, std::string() );
+    TestRoundTrip( ePdfFilter_LZWDecode, std::string( "a" ) );
+}
+
+void FilterTest::testRLE()
+{
+    // A repeat run is at most 128 bytes long
+    CPPUNIT_ASSERT( std::string( "\x81" "a" "\x80" ) 
+                    == Encode( ePdfFilter_RunLengthDecode, std::string( 128, 'a' ), 128 ) );
+    CPPUNIT_ASSERT( std::string( "\x81" "a" "\x00" "a" "\x80", 5 )
+                    == Encode( ePdfFilter_RunLengthDecode, std::string( 129, 'a' ), 1 ) );
+    CPPUNIT_ASSERT( std::string( "\x81" "a" "\x81" "a" "\xd5" "a" "\x80" )
+                    == Encode( ePdfFilter_RunLengthDecode, std::string( 300, 'a' ), 300 ) );
+
+    // A literal run is at most 128 bytes long
+    std::string sLiteral;
+    for( int i = 0; i < 129; i++ )
+        sLiteral += static_cast<char>(i);
+
+    CPPUNIT_ASSERT( std::string( "\x7f" ) + sLiteral.substr( 0, 128 ) + std::string( "\x80" )
+                    == Encode( ePdfFilter_RunLengthDecode, sLiteral.substr( 0, 128 ), 5 ) );
+    CPPUNIT_ASSERT( std::string( "\x7f" ) + sLiteral.substr( 0, 128 ) + std::string( "\x00" "\x80" "\x80", 3 )
+                    == Encode( ePdfFilter_RunLengthDecode, sLiteral, 129 ) );
+
+    // Runs of two bytes do not interrupt literal runs
+    CPPUNIT_ASSERT( std::string( "\x03" "abbc" "\xfe" "d" "\x80" )
+                    == Encode( ePdfFilter_RunLengthDecode, "abbcddd", 2 ) );
+
+    // Data after the end of data marker is ignored
+    CPPUNIT_ASSERT( std::string( "abcxxx" )
+                    == Decode( ePdfFilter_RunLengthDecode, "\x02" "abc" "\xfe" "x" "\x80" "junk", 1 ) );
+
+    std::string sData;
+    for( int i = 0; i < 2000; i++ ) 
+    {
+        sData.append( i % 300, static_cast<char>(i) );
+        sData.append( sLiteral.substr( 0, i % 260 ) );
+    }
+
+    TestRoundTrip( ePdfFilter_RunLengthDecode, sData );
+    TestRoundTrip( ePdfFilter_RunLengthDecode, std::string() );
+}
+
+static std::string GetFilteredCopy( PdfObject* pObject )
+{
+    char*    pBuffer;
+    pdf_long lLen;
+    pObject->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+
+    std::string sData( pBuffer, lLen );
+    podofo_free( pBuffer );
+    return sData;
+}
+
+void FilterTest::testPreserveFilters()
+{
+    const std::string sData( s_pTestBuffer1, s_lTestLength1 );
+    PdfVecObjects     objects;
+    PdfObject*        pObject = objects.CreateObject();
+
+    pObject->GetStream()->Set( sData.c_str(), sData.size(), TVecFilters( 1, ePdfFilter_LZWDecode ) );
+    pObject->GetStream()->BeginAppend( true, true );
+    pObject->GetStream()->Append( sData.c_str(), sData.size() );
+    pObject->GetStream()->EndAppend();
+
+    CPPUNIT_ASSERT( PdfName( "LZWDecode" ) == pObject->GetDictionary().GetKey( PdfName::KeyFilter )->GetName() );
+    CPPUNIT_ASSERT( sData == GetFilteredCopy( pObject ) );
+
+    // The existing data is re-encoded as well
+    pObject->GetStream()->BeginAppend( false, true );
+    pObject->GetStream()->Append( sData.c_str(), sData.size() );
+    pObject->GetStream()->EndAppend();
+
+    CPPUNIT_ASSERT( PdfName( "LZWDecode" ) == pObject->GetDictionary().GetKey( PdfName::KeyFilter )->GetName() );
+    CPPUNIT_ASSERT( sData + sData == GetFilteredCopy( pObject ) );
+
+    // Filter chains are kept in their order
+    TVecFilters vecFilters;
+    vecFilters.push_back( ePdfFilter_ASCIIHexDecode );
+    vecFilters.push_back( ePdfFilter_RunLengthDecode );
+    pObject->GetStream()->Set( sData.c_str(), sData.size(), vecFilters );
+    pObject->GetStream()->BeginAppend( false, true );
+    pObject->GetStream()->Append( sData.c_str(), sData.size() );
+    pObject->GetStream()->EndAppend();
+
+    CPPUNIT_ASSERT( vecFilters == PdfFilterFactory::CreateFilterList( pObject ) );
+    CPPUNIT_ASSERT( sData + sData == GetFilteredCopy( pObject ) );
+
+    // Without bPreserveFilters the default filter is used
+    pObject->GetStream()->BeginAppend( true, false );
+    pObject->GetStream()->Append( sData.c_str(), sData.size() );
+    pObject->GetStream()->EndAppend();
+
+    CPPUNIT_ASSERT( PdfName( "FlateDecode" ) == pObject->GetDictionary().GetKey( PdfName::KeyFilter )->GetName() );
+    CPPUNIT_ASSERT( sData == GetFilteredCopy( pObject ) );
+
+    // Filters which cannot encode fall back to the default filter
+    pObject->GetStream()->Set( sData.c_str(), sData.size(), TVecFilters() );
+    pObject->GetDictionary().AddKey( PdfName::KeyFilter, PdfName( "DCTDecode" ) );
+    pObject->GetStream()->BeginAppend( true, true );
+    pObject->GetStream()->Append( sData.c_str(), sData.size() );
+    pObject->GetStream()->EndAppend();
 
+    CPPUNIT_ASSERT( PdfName( "FlateDecode" ) == pObject->GetDictionary().GetKey( PdfName::KeyFilter )->GetName() );
+    CPPUNIT_ASSERT( sData == GetFilteredCopy( pObject ) );
 }
@@ -32,6 +32,12 @@ class FilterTest : public CppUnit::TestFixture
   CPPUNIT_TEST_SUITE( FilterTest );
   CPPUNIT_TEST( testFilters );
   CPPUNIT_TEST( testCCITT );
+  CPPUNIT_TEST( testCCITT2D );
+  CPPUNIT_TEST( testDCT );
+  CPPUNIT_TEST( testDecodeInputStream );
+  CPPUNIT_TEST( testLZW );
+  CPPUNIT_TEST( testRLE );
+  CPPUNIT_TEST( testPreserveFilters );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -42,6 +48,32 @@ class FilterTest : public CppUnit::TestFixture
 
   void testCCITT();
 
+  /** Decode Group 3 data with mixed one- and two-dimensional rows (K > 0)
+   */
+  void testCCITT2D();
+
+  /** Decode baseline and progressive JPEG data, at once and byte by byte
+   */
+  void testDCT();
+
+  /** Decode a stream through the filter chain in small reads
+   */
+  void testDecodeInputStream();
+
+  /** Encode and decode LZW data which fills the code table several times,
+   *  at once and in small blocks
+   */
+  void testLZW();
+
+  /** Encode and decode RunLength data with long repeat and literal runs,
+   *  at once and in small blocks
+   */
+  void testRLE();
+
+  /** Re-encode a stream with its own filters in BeginAppend()
+   */
+  void testPreserveFilters();
+
  private:
   void TestFilter( PoDoFo::EPdfFilter eFilter, const char * pTestBuffer, const long lTestLength );
 };
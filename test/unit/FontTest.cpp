@@ -19,12 +19,16 @@
  ***************************************************************************/
 
 #include "FontTest.h"
+#include "TestUtils.h"
 
 #include <cppunit/Asserter.h>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <set>
+#include <sstream>
+
 using namespace PoDoFo;
 
 CPPUNIT_TEST_SUITE_REGISTRATION( FontTest );
@@ -144,6 +148,81 @@ void FontTest::testCreateFontFtFace()
     }
 }
 
+void FontTest::testSharedFontCache()
+{
+    FcConfig* pConfig = FcInitLoadConfigAndFonts();
+    CPPUNIT_ASSERT_EQUAL( !pConfig, false );
+
+    // Find any TrueType font
+    FcPattern*   pattern   = FcPatternCreate();
+    FcObjectSet* objectSet = FcObjectSetBuild( FC_FILE, NULL );
+    FcFontSet*   fontSet   = FcFontList( pConfig, pattern, objectSet );
+    FcObjectSetDestroy( objectSet );
+    FcPatternDestroy( pattern );
+
+    std::string sPath;
+    for( int i = 0; fontSet && i < fontSet->nfont && sPath.empty(); i++ )
+    {
+        FcChar8* file;
+        if( FcPatternGetString( fontSet->fonts[i], FC_FILE, 0, &file ) == FcResultMatch 
+            && PdfFontMetrics::FontTypeFromFilename( reinterpret_cast<const char*>(file) ) == ePdfFontType_TrueType )
+            sPath = reinterpret_cast<const char*>(file);
+    }
+
+    if( fontSet )
+        FcFontSetDestroy( fontSet );
+
+    if( sPath.empty() ) 
+    {
+        printf("Ignoring testSharedFontCache, no TrueType font was found\n");
+        return;
+    }
+
+    PdfMemDocument unshared;
+    PdfFont* pReference = unshared.CreateFont( "SharedFont", false, false, false,
+                                               PdfEncodingFactory::GlobalWinAnsiEncodingInstance(),
+                                               PdfFontCache::eFontCreationFlags_None, true, sPath.c_str() );
+    CPPUNIT_ASSERT( pReference != NULL );
+
+    PdfSharedFontCache sharedCache;
+    const int nDocuments = 3;
+    for( int i = 0; i < nDocuments; i++ )
+    {
+        PdfMemDocument document;
+        document.SetSharedFontCache( &sharedCache );
+
+        PdfFont* pFont = document.CreateFont( "SharedFont", false, false, false,
+                                              PdfEncodingFactory::GlobalWinAnsiEncodingInstance(),
+                                              PdfFontCache::eFontCreationFlags_None, true, sPath.c_str() );
+        CPPUNIT_ASSERT( pFont != NULL );
+        CPPUNIT_ASSERT_EQUAL( std::string( pReference->GetFontMetrics()->GetFontname() ),
+                              std::string( pFont->GetFontMetrics()->GetFontname() ) );
+        for( int c = 32; c < 256; c++ ) 
+        {
+            CPPUNIT_ASSERT_EQUAL( pReference->GetFontMetrics()->CharWidth( static_cast<unsigned char>(c) ),
+                                  pFont->GetFontMetrics()->CharWidth( static_cast<unsigned char>(c) ) );
+        }
+
+        // The embedded font file is taken from the shared data
+        PdfFileInputStream file( sPath.c_str() );
+        CPPUNIT_ASSERT_EQUAL( file.GetFileLength(), pFont->GetFontMetrics()->GetFontDataLen() );
+
+        PdfPage*   pPage = document.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+        PdfPainter painter;
+        painter.SetPage( pPage );
+        painter.SetFont( pFont );
+        painter.DrawText( 100.0, 100.0, "Hello shared fonts" );
+        painter.FinishPage();
+
+        PdfRefCountedBuffer buffer;
+        PdfOutputDevice     device( &buffer );
+        document.Write( &device );
+        CPPUNIT_ASSERT( buffer.GetSize() > static_cast<size_t>(0) );
+    }
+
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(1), sharedCache.GetFontFileCount() );
+}
+
 bool FontTest::GetFontInfo( FcPattern* pFont, std::string & rsFamily, std::string & rsPath, 
                             bool & rbBold, bool & rbItalic )
 {
@@ -215,3 +294,101 @@ void FontTest::testBig2Little()
             throw;
     }
 }
+
+void FontTest::testGetFontsOfPages()
+{
+    const char* ppszBase14[] = { "Helvetica", "Times-Roman", "Courier", "Symbol" };
+    const int   nPages       = 500;
+    const int   nFontsOfPage = 4;
+
+    std::string sFilename = TestUtils::getTempFilename();
+
+    try {
+        {
+            PdfMemDocument writer;
+            PdfObject*     pShared = writer.GetObjects().CreateObject( "Font" );
+            pShared->GetDictionary().AddKey( PdfName::KeySubtype, PdfName( "Type1" ) );
+            pShared->GetDictionary().AddKey( "BaseFont", PdfName( "Helvetica" ) );
+
+            // Every page uses one shared font and some fonts of its own
+            for( int i = 0; i < nPages; i++ )
+            {
+                PdfPage*      pPage = writer.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+                PdfDictionary fonts;
+                fonts.AddKey( "F0", pShared->Reference() );
+
+                for( int j = 1; j < nFontsOfPage; j++ )
+                {
+                    std::ostringstream oss;
+                    oss << "F" << j;
+
+                    PdfObject* pFont = writer.GetObjects().CreateObject( "Font" );
+                    pFont->GetDictionary().AddKey( PdfName::KeySubtype, PdfName( "Type1" ) );
+                    pFont->GetDictionary().AddKey( "BaseFont", PdfName( ppszBase14[(i + j) % 4] ) );
+                    fonts.AddKey( PdfName( oss.str() ), pFont->Reference() );
+                }
+
+                pPage->GetResources()->GetDictionary().AddKey( "Font", fonts );
+            }
+
+            writer.Write( sFilename.c_str() );
+        }
+
+        PdfMemDocument document( sFilename.c_str() );
+        CPPUNIT_ASSERT_EQUAL( nPages, document.GetPageCount() );
+
+        // The second pass finds all fonts in the cache
+        std::vector<PdfFont*> vecFonts;
+        for( int nPass = 0; nPass < 2; nPass++ )
+        {
+            size_t nIndex = 0;
+            for( int i = 0; i < nPages; i++ )
+            {
+                PdfObject* pFonts = document.GetPage( i )->GetResources()->GetIndirectKey( "Font" );
+                CPPUNIT_ASSERT( pFonts != NULL );
+                CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(nFontsOfPage), pFonts->GetDictionary().GetSize() );
+
+                TCIKeyMap it = pFonts->GetDictionary().GetKeys().begin();
+                for( ; it != pFonts->GetDictionary().GetKeys().end(); ++it )
+                {
+                    PdfObject* pObject = document.GetObjects().GetObject( (*it).second->GetReference() );
+                    PdfFont*   pFont   = document.GetFont( pObject );
+                    CPPUNIT_ASSERT( pFont != NULL );
+                    CPPUNIT_ASSERT( pFont->GetObject() == pObject );
+
+                    if( nPass == 0 )
+                        vecFonts.push_back( pFont );
+                    else
+                        CPPUNIT_ASSERT( vecFonts[nIndex] == pFont );
+
+                    ++nIndex;
+                }
+            }
+
+            CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(nPages * nFontsOfPage), nIndex );
+        }
+
+        // F0 of every page is the shared font, all other fonts are distinct
+        std::set<PdfFont*> setFonts( vecFonts.begin(), vecFonts.end() );
+        CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(1 + nPages * (nFontsOfPage - 1)), setFonts.size() );
+
+        for( int i = 0; i < nPages; i++ )
+        {
+            PdfObject* pFonts = document.GetPage( i )->GetResources()->GetIndirectKey( "Font" );
+            PdfObject* pShared = document.GetObjects().GetObject( pFonts->GetDictionary().GetKey( "F0" )->GetReference() );
+            CPPUNIT_ASSERT( document.GetFont( pShared ) == vecFonts[0] );
+        }
+
+        // Fonts resolved from objects can still be found by name afterwards
+        PdfFont* pHelvetica = document.CreateFont( "Helvetica" );
+        CPPUNIT_ASSERT( pHelvetica != NULL );
+        CPPUNIT_ASSERT( pHelvetica == document.CreateFont( "Helvetica" ) );
+    } catch( PdfError & e ) {
+        e.PrintErrorMsg();
+
+        TestUtils::deleteFile( sFilename.c_str() );
+        throw e;
+    }
+
+    TestUtils::deleteFile( sFilename.c_str() );
+}
@@ -37,8 +37,10 @@ class FontTest : public CppUnit::TestFixture
 #if defined(PODOFO_HAVE_FONTCONFIG)
   CPPUNIT_TEST( testFonts );
   CPPUNIT_TEST( testCreateFontFtFace );
+  CPPUNIT_TEST( testSharedFontCache );
 #endif
   CPPUNIT_TEST( testBig2Little );
+  CPPUNIT_TEST( testGetFontsOfPages );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -48,9 +50,18 @@ class FontTest : public CppUnit::TestFixture
 #if defined(PODOFO_HAVE_FONTCONFIG)
   void testFonts();
   void testCreateFontFtFace();
+
+  /** Create the same font in several documents sharing a PdfSharedFontCache
+   */
+  void testSharedFontCache();
 #endif
   void testBig2Little();
 
+  /** Resolve the fonts of all pages of a document with many fonts
+   *  and check that each font object maps to one cached font
+   */
+  void testGetFontsOfPages();
+
 private:
 #if defined(PODOFO_HAVE_FONTCONFIG)
     void testSingleFont(FcPattern* pFont, FcConfig* pConfig);
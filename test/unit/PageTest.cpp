@@ -76,3 +76,109 @@ void PageTest::testEmptyContentsStream()
     TestUtils::deleteFile( sFilename.c_str() );
 }
 
+
+void PageTest::testInheritedAttributes()
+{
+    PdfMemDocument doc;
+    PdfPage*       pPage = doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+    PdfObject*     pRoot = doc.GetPagesTree()->GetObject();
+
+    // Move the media box up to the pages tree root
+    PdfRect  mediaBox( 0.0, 0.0, 200.0, 100.0 );
+    PdfVariant array;
+    mediaBox.ToVariant( array );
+    pPage->GetObject()->GetDictionary().RemoveKey( "MediaBox" );
+    pRoot->GetDictionary().AddKey( "MediaBox", array );
+    pRoot->GetDictionary().AddKey( "Rotate", PdfVariant( static_cast<pdf_int64>(90) ) );
+
+    CPPUNIT_ASSERT_EQUAL( 200.0, pPage->GetMediaBox().GetWidth() );
+    CPPUNIT_ASSERT_EQUAL( 100.0, pPage->GetMediaBox().GetHeight() );
+    CPPUNIT_ASSERT_EQUAL( 200.0, pPage->GetCropBox().GetWidth() );
+    CPPUNIT_ASSERT_EQUAL( 200.0, pPage->GetTrimBox().GetWidth() );
+    CPPUNIT_ASSERT_EQUAL( 90, pPage->GetRotation() );
+    CPPUNIT_ASSERT( NULL != pPage->GetInheritedKey( PdfName( "MediaBox" ) ) );
+    CPPUNIT_ASSERT( NULL == pPage->GetInheritedKey( PdfName( "BleedBox" ) ) );
+
+    // Keys of the page itself are always seen
+    pPage->SetRotation( 180 );
+    CPPUNIT_ASSERT_EQUAL( 180, pPage->GetRotation() );
+    pPage->GetObject()->GetDictionary().RemoveKey( "Rotate" );
+    CPPUNIT_ASSERT_EQUAL( 90, pPage->GetRotation() );
+
+    // Replaced and removed keys of the parents are seen as well
+    pRoot->GetDictionary().AddKey( "Rotate", PdfVariant( static_cast<pdf_int64>(270) ) );
+    CPPUNIT_ASSERT_EQUAL( 270, pPage->GetRotation() );
+
+    PdfRect  smallBox( 0.0, 0.0, 50.0, 40.0 );
+    smallBox.ToVariant( array );
+    pRoot->GetDictionary().AddKey( "MediaBox", array );
+    CPPUNIT_ASSERT_EQUAL( 50.0, pPage->GetMediaBox().GetWidth() );
+    CPPUNIT_ASSERT_EQUAL( 40.0, pPage->GetCropBox().GetHeight() );
+
+    pRoot->GetDictionary().RemoveKey( "MediaBox" );
+    CPPUNIT_ASSERT_EQUAL( 0.0, pPage->GetMediaBox().GetWidth() );
+    CPPUNIT_ASSERT( NULL == pPage->GetInheritedKey( PdfName( "MediaBox" ) ) );
+
+
+    // Resources dictionaries are resolved through references
+    PdfObject*    pFont = doc.GetObjects().CreateObject( "Font" );
+    PdfDictionary fonts;
+    fonts.AddKey( "F1", pFont->Reference() );
+    PdfObject*    pFonts = doc.GetObjects().CreateObject( fonts );
+    pPage->GetResources()->GetDictionary().AddKey( "Font", pFonts->Reference() );
+
+    CPPUNIT_ASSERT( pFont == pPage->GetFromResources( PdfName( "Font" ), PdfName( "F1" ) ) );
+    CPPUNIT_ASSERT( pFont == pPage->GetFromResources( PdfName( "Font" ), PdfName( "F1" ) ) );
+    CPPUNIT_ASSERT( NULL == pPage->GetFromResources( PdfName( "Font" ), PdfName( "F2" ) ) );
+    CPPUNIT_ASSERT( NULL == pPage->GetFromResources( PdfName( "XObject" ), PdfName( "F1" ) ) );
+}
+
+void PageTest::testInheritedAttributesAdded()
+{
+    PdfMemDocument doc;
+    PdfPage*       pPage = doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+    PdfObject*     pRoot = doc.GetPagesTree()->GetObject();
+
+    pPage->GetObject()->GetDictionary().RemoveKey( "MediaBox" );
+    CPPUNIT_ASSERT_EQUAL( 0, pPage->GetRotation() );
+    CPPUNIT_ASSERT_EQUAL( 0.0, pPage->GetMediaBox().GetWidth() );
+
+    // Keys added to the root after the first lookup
+    PdfRect  mediaBox( 0.0, 0.0, 200.0, 100.0 );
+    PdfVariant array;
+    mediaBox.ToVariant( array );
+    pRoot->GetDictionary().AddKey( "MediaBox", array );
+    pRoot->GetDictionary().AddKey( "Rotate", PdfVariant( static_cast<pdf_int64>(90) ) );
+
+    CPPUNIT_ASSERT_EQUAL( 90, pPage->GetRotation() );
+    CPPUNIT_ASSERT_EQUAL( 200.0, pPage->GetMediaBox().GetWidth() );
+    CPPUNIT_ASSERT_EQUAL( 200.0, pPage->GetCropBox().GetWidth() );
+
+    // Insert a pages node between the root and the page
+    PdfObject* pNode = doc.GetObjects().CreateObject( "Pages" );
+    PdfArray   kids;
+    kids.push_back( pPage->GetObject()->Reference() );
+    pNode->GetDictionary().AddKey( "Kids", kids );
+    pNode->GetDictionary().AddKey( "Count", PdfVariant( static_cast<pdf_int64>(1) ) );
+    pNode->GetDictionary().AddKey( "Parent", pRoot->Reference() );
+    kids.Clear();
+    kids.push_back( pNode->Reference() );
+    pRoot->GetDictionary().AddKey( "Kids", kids );
+    pPage->GetObject()->GetDictionary().AddKey( "Parent", pNode->Reference() );
+
+    CPPUNIT_ASSERT_EQUAL( 90, pPage->GetRotation() );
+    CPPUNIT_ASSERT_EQUAL( 200.0, pPage->GetMediaBox().GetWidth() );
+
+    // Keys added to the node nearer to the page than the root
+    PdfRect  smallBox( 0.0, 0.0, 50.0, 40.0 );
+    smallBox.ToVariant( array );
+    pNode->GetDictionary().AddKey( "MediaBox", array );
+    pNode->GetDictionary().AddKey( "Rotate", PdfVariant( static_cast<pdf_int64>(180) ) );
+
+    CPPUNIT_ASSERT_EQUAL( 180, pPage->GetRotation() );
+    CPPUNIT_ASSERT_EQUAL( 50.0, pPage->GetMediaBox().GetWidth() );
+    CPPUNIT_ASSERT_EQUAL( 40.0, pPage->GetCropBox().GetHeight() );
+
+    pNode->GetDictionary().RemoveKey( "Rotate" );
+    CPPUNIT_ASSERT_EQUAL( 90, pPage->GetRotation() );
+}
@@ -34,6 +34,8 @@ class PageTest : public CppUnit::TestFixture
   CPPUNIT_TEST_SUITE( PageTest );
   CPPUNIT_TEST( testEmptyContents );
   CPPUNIT_TEST( testEmptyContentsStream );
+  CPPUNIT_TEST( testInheritedAttributes );
+  CPPUNIT_TEST( testInheritedAttributesAdded );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -42,6 +44,8 @@ class PageTest : public CppUnit::TestFixture
 
   void testEmptyContents();
   void testEmptyContentsStream();
+  void testInheritedAttributes();
+  void testInheritedAttributesAdded();
 };
 
 #endif // _PAGE_TEST_H_
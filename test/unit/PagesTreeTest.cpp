@@ -365,6 +365,202 @@ void PagesTreeTest::testDeleteAll( PdfMemDocument & doc )
     CPPUNIT_ASSERT_EQUAL( doc.GetPageCount(), 0 );
 }
 
+void PagesTreeTest::testGetPageByReferenceCustom() 
+{
+    PdfMemDocument doc;
+
+    CreateTestTreeCustom( doc );
+
+    testGetPageByReference( doc );
+}
+
+void PagesTreeTest::testGetPageByReferencePoDoFo() 
+{
+    PdfMemDocument doc;
+
+    CreateTestTreePoDoFo( doc );
+
+    testGetPageByReference( doc );
+}
+
+void PagesTreeTest::testGetPageByReference( PdfMemDocument & doc ) 
+{
+    std::vector<PdfReference> vecRefs;
+    for(int i=0; i<PODOFO_TEST_NUM_PAGES; i++) 
+        vecRefs.push_back( doc.GetPage( i )->GetObject()->Reference() );
+
+    // Look up in reverse order, so that no page is cached before
+    doc.GetPagesTree()->ClearCache();
+    for(int i=PODOFO_TEST_NUM_PAGES-1; i>=0; i--)
+    {
+        PdfPage* pPage = doc.GetPagesTree()->GetPage( vecRefs[i] );
+
+        CPPUNIT_ASSERT_EQUAL( pPage != NULL, true );
+        CPPUNIT_ASSERT_EQUAL( IsPageNumber( pPage, i ), true );
+        CPPUNIT_ASSERT_EQUAL( pPage, doc.GetPage( i ) );
+    }
+
+    // Insert a page in the middle and delete the first page
+    PdfPage* pPage = new PdfPage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ),
+                                  &(doc.GetObjects()) );
+    const PdfReference insertedRef = pPage->GetObject()->Reference();
+    doc.GetPagesTree()->InsertPage( 49, pPage );
+    delete pPage;
+
+    doc.GetPagesTree()->DeletePage( 0 );
+    CPPUNIT_ASSERT_EQUAL( doc.GetPagesTree()->GetPage( vecRefs[0] ), static_cast<PdfPage*>(NULL) );
+
+    // Pages before the inserted page moved down by one
+    pPage = doc.GetPagesTree()->GetPage( insertedRef );
+    CPPUNIT_ASSERT_EQUAL( pPage, doc.GetPage( 49 ) );
+    CPPUNIT_ASSERT_EQUAL( IsPageNumber( doc.GetPagesTree()->GetPage( vecRefs[49] ), 49 ), true );
+    CPPUNIT_ASSERT_EQUAL( doc.GetPage( 48 ), doc.GetPagesTree()->GetPage( vecRefs[49] ) );
+    CPPUNIT_ASSERT_EQUAL( doc.GetPage( 50 ), doc.GetPagesTree()->GetPage( vecRefs[50] ) );
+
+    // Every page is still found at its position
+    for(int i=0; i<doc.GetPageCount(); i++) 
+    {
+        pPage = doc.GetPage( i );
+        CPPUNIT_ASSERT_EQUAL( doc.GetPagesTree()->GetPage( pPage->GetObject()->Reference() ), pPage );
+    }
+}
+
+void PagesTreeTest::testBalancedTree() 
+{
+    const int MAX_KIDS = 4;
+    PdfMemDocument doc;
+    doc.GetPagesTree()->SetMaxKidsPerNode( MAX_KIDS );
+
+    // Append pages one by one
+    for(int i=0; i<PODOFO_TEST_NUM_PAGES; i++) 
+    {
+        PdfPage* pPage = doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+        pPage->GetObject()->GetDictionary().AddKey( PODOFO_TEST_PAGE_KEY, static_cast<pdf_int64>(i) );
+    }
+
+    CPPUNIT_ASSERT_EQUAL( CheckBalancedNode( doc.GetPagesTree()->GetObject(), MAX_KIDS ), PODOFO_TEST_NUM_PAGES );
+
+    // Insert several pages at once in the middle
+    std::vector<PdfObject*> vecPages;
+    for(int i=0; i<10; i++) 
+    {
+        PdfPage* pPage = new PdfPage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ),
+                                      &(doc.GetObjects()) );
+        pPage->GetObject()->GetDictionary().AddKey( PODOFO_TEST_PAGE_KEY, 
+                                                    static_cast<pdf_int64>(1000 + i) );
+        vecPages.push_back( pPage->GetObject() );
+        delete pPage;
+    }
+
+    doc.GetPagesTree()->InsertPages( 49, vecPages );
+    CPPUNIT_ASSERT_EQUAL( CheckBalancedNode( doc.GetPagesTree()->GetObject(), MAX_KIDS ), PODOFO_TEST_NUM_PAGES + 10 );
+
+    // Check the page order, with and without the page index
+    for(int pass=0; pass<2; pass++) 
+    {
+        for(int i=0; i<doc.GetPageCount(); i++) 
+        {
+            PdfPage* pPage = doc.GetPage( i );
+            const int nNumber = i < 50 ? i : (i < 60 ? 1000 + i - 50 : i - 10);
+
+            CPPUNIT_ASSERT_EQUAL( IsPageNumber( pPage, nNumber ), true );
+            CPPUNIT_ASSERT_EQUAL( pPage->GetPageNumber(), static_cast<unsigned int>(i + 1) );
+        }
+
+        doc.GetPagesTree()->ClearCache();
+    }
+
+    // Deleting all pages removes all pages nodes below the root
+    while( doc.GetPageCount() )
+        doc.GetPagesTree()->DeletePage( doc.GetPageCount() / 2 );
+
+    CPPUNIT_ASSERT_EQUAL( CheckBalancedNode( doc.GetPagesTree()->GetObject(), MAX_KIDS ), 0 );
+}
+
+void PagesTreeTest::testInsertPagesFrom() 
+{
+    PdfMemDocument src;
+    PdfObject* pResources = src.GetObjects().CreateObject();
+    pResources->GetDictionary().AddKey( "ProcSet", PdfArray( PdfName( "PDF" ) ) );
+
+    for(int i=0; i<PODOFO_TEST_NUM_PAGES; i++) 
+    {
+        PdfPage* pPage = src.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+        pPage->GetObject()->GetDictionary().AddKey( PODOFO_TEST_PAGE_KEY, static_cast<pdf_int64>(i) );
+        pPage->GetObject()->GetDictionary().AddKey( "Resources", pResources->Reference() );
+    }
+
+    // Objects which are not reachable from the pages are not copied
+    for(int i=0; i<100; i++) 
+        src.GetObjects().CreateObject( "Unused" );
+
+    PdfMemDocument doc;
+    TPdfReferenceMap mapReferences;
+    const size_t nObjects = doc.GetObjects().GetSize();
+    doc.InsertPagesFrom( src, 20, 5, -1, &mapReferences );
+    doc.InsertPagesFrom( src, 10, 5, 0, &mapReferences );
+
+    // 10 pages and the resources shared by them
+    CPPUNIT_ASSERT_EQUAL( doc.GetPageCount(), 10 );
+    CPPUNIT_ASSERT_EQUAL( doc.GetObjects().GetSize() - nObjects, static_cast<size_t>(11) );
+
+    const PdfReference resourcesRef = doc.GetPage( 0 )->GetObject()->GetDictionary().GetKey( "Resources" )->GetReference();
+    CPPUNIT_ASSERT( mapReferences[pResources->Reference()] == resourcesRef );
+
+    for(int i=0; i<doc.GetPageCount(); i++) 
+    {
+        PdfPage* pPage = doc.GetPage( i );
+        CPPUNIT_ASSERT_EQUAL( IsPageNumber( pPage, i < 5 ? 10 + i : 15 + i ), true );
+        CPPUNIT_ASSERT( pPage->GetObject()->GetDictionary().GetKey( "Resources" )->GetReference() == resourcesRef );
+        CPPUNIT_ASSERT_EQUAL( pPage->GetPageNumber(), static_cast<unsigned int>(i + 1) );
+    }
+
+    // Pages which are not in the document cannot be inserted
+    CPPUNIT_ASSERT_THROW( doc.InsertPagesFrom( src, PODOFO_TEST_NUM_PAGES - 1, 2 ), PdfError );
+}
+
+void PagesTreeTest::testBalancedTreeCachedPages() 
+{
+    const int MAX_KIDS = 4;
+    PdfMemDocument doc;
+    doc.GetPagesTree()->SetMaxKidsPerNode( MAX_KIDS );
+
+    // The root gets two pages nodes with 2 and 3 pages
+    for(int i=0; i<MAX_KIDS + 1; i++) 
+        doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+
+    CPPUNIT_ASSERT_EQUAL( CheckBalancedNode( doc.GetPagesTree()->GetObject(), MAX_KIDS ), MAX_KIDS + 1 );
+
+    // The pages of the second node inherit direct resources from it
+    PdfObject* pNode = doc.GetPage( 2 )->GetObject()->GetIndirectKey( "Parent" );
+    PdfDictionary resources;
+    resources.AddKey( "Marker", PdfName( "Node" ) );
+    pNode->GetDictionary().AddKey( "Resources", resources );
+    for(int i=2; i<MAX_KIDS + 1; i++) 
+        doc.GetPage( i )->GetObject()->GetDictionary().RemoveKey( "Resources" );
+
+    doc.GetPagesTree()->ClearCache();
+
+    PdfPage* pLast = doc.GetPage( MAX_KIDS );
+    CPPUNIT_ASSERT( pLast->GetResources() == pNode->GetIndirectKey( "Resources" ) );
+
+    // Appending 2 pages splits the node, the last page moves to a new sibling
+    doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+    doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+    CPPUNIT_ASSERT_EQUAL( CheckBalancedNode( doc.GetPagesTree()->GetObject(), MAX_KIDS ), MAX_KIDS + 3 );
+
+    PdfObject* pSibling = pLast->GetObject()->GetIndirectKey( "Parent" );
+    CPPUNIT_ASSERT( pSibling != pNode );
+    CPPUNIT_ASSERT( pLast == doc.GetPage( MAX_KIDS ) );
+    CPPUNIT_ASSERT( pLast->GetResources() == pSibling->GetIndirectKey( "Resources" ) );
+    CPPUNIT_ASSERT( doc.GetPage( 2 )->GetResources() == pNode->GetIndirectKey( "Resources" ) );
+
+    // Resources added through the cached page belong to the page
+    pLast->GetResources()->GetDictionary().AddKey( "Added", PdfName( "Page" ) );
+    CPPUNIT_ASSERT( pSibling->GetIndirectKey( "Resources" )->GetDictionary().HasKey( "Added" ) );
+    CPPUNIT_ASSERT( !pNode->GetIndirectKey( "Resources" )->GetDictionary().HasKey( "Added" ) );
+}
+
 void PagesTreeTest::CreateTestTreePoDoFo( PoDoFo::PdfMemDocument & rDoc )
 {
     for(int i=0; i<PODOFO_TEST_NUM_PAGES; i++) 
@@ -555,6 +751,27 @@ void PagesTreeTest::CreateNestedArrayTree( PoDoFo::PdfMemDocument & rDoc )
     pRoot->GetDictionary().AddKey( PdfName("Kids"), nested);
 }
 
+int PagesTreeTest::CheckBalancedNode( PoDoFo::PdfObject* pNode, int nMaxKids )
+{
+    const PdfArray & kids = pNode->GetIndirectKey( "Kids" )->GetArray();
+    CPPUNIT_ASSERT( static_cast<int>(kids.size()) <= nMaxKids );
+
+    int nCount = 0;
+    for( PdfArray::const_iterator it = kids.begin(); it != kids.end(); ++it ) 
+    {
+        PdfObject* pKid = pNode->GetOwner()->GetObject( (*it).GetReference() );
+        CPPUNIT_ASSERT( pKid->GetDictionary().GetKey( "Parent" )->GetReference() == pNode->Reference() );
+
+        if( pKid->GetDictionary().GetKeyAsName( PdfName( "Type" ) ) == PdfName( "Pages" ) )
+            nCount += CheckBalancedNode( pKid, nMaxKids );
+        else
+            ++nCount;
+    }
+
+    CPPUNIT_ASSERT_EQUAL( pNode->GetDictionary().GetKeyAsLong( "Count", -1 ), static_cast<pdf_int64>(nCount) );
+    return nCount;
+}
+
 bool PagesTreeTest::IsPageNumber( PoDoFo::PdfPage* pPage, int nNumber )
 {
     pdf_int64 lPageNumber = pPage->GetObject()->GetDictionary().GetKeyAsLong( PODOFO_TEST_PAGE_KEY, -1 );
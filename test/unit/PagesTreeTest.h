@@ -50,6 +50,11 @@ class PagesTreeTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testInsertPoDoFo );
   CPPUNIT_TEST( testDeleteAllCustom );
   CPPUNIT_TEST( testDeleteAllPoDoFo );
+  CPPUNIT_TEST( testGetPageByReferenceCustom );
+  CPPUNIT_TEST( testGetPageByReferencePoDoFo );
+  CPPUNIT_TEST( testBalancedTree );
+  CPPUNIT_TEST( testBalancedTreeCachedPages );
+  CPPUNIT_TEST( testInsertPagesFrom );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -70,12 +75,18 @@ class PagesTreeTest : public CppUnit::TestFixture
   void testInsertPoDoFo();
   void testDeleteAllCustom();
   void testDeleteAllPoDoFo();
+  void testGetPageByReferenceCustom();
+  void testGetPageByReferencePoDoFo();
+  void testBalancedTree();
+  void testBalancedTreeCachedPages();
+  void testInsertPagesFrom();
     
  private:
   void testGetPages( PoDoFo::PdfMemDocument & doc );
   void testGetPagesReverse( PoDoFo::PdfMemDocument & doc );
   void testInsert( PoDoFo::PdfMemDocument & doc );
   void testDeleteAll( PoDoFo::PdfMemDocument & doc );
+  void testGetPageByReference( PoDoFo::PdfMemDocument & doc );
 
   /**
    * Create a pages tree with 100 pages,
@@ -156,6 +167,14 @@ class PagesTreeTest : public CppUnit::TestFixture
   std::vector<PoDoFo::PdfObject*> CreateNodes( PoDoFo::PdfMemDocument & rDoc,
                                                int nNodeCount);
 
+  /**
+   * Check that a pages node and all nodes below it have
+   * at most nMaxKids kids, correct /Count and /Parent keys.
+   *
+   * @returns the number of pages below pNode
+   */
+  int CheckBalancedNode( PoDoFo::PdfObject* pNode, int nMaxKids );
+
   bool IsPageNumber( PoDoFo::PdfPage* pPage, int nNumber );
 
   void AppendChildNode(PoDoFo::PdfObject* pParent, PoDoFo::PdfObject* pChild);
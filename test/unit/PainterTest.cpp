@@ -70,3 +70,61 @@ void PainterTest::testAppend()
 
     this->CompareStreamContent(pPage->GetContents()->GetStream(), newContent.c_str());
 }
+
+void PainterTest::testMultiLineTextBreaks()
+{
+    // All characters are 0.556 wide in Helvetica, the space is 0.278
+    const char*    pszText     = "aaa bbb eee\nnnnnnnnnnn";
+    const char*    ppszLines[] = { "aaa bbb ", "eee", "nnnnnnn", "nnn" };
+    const pdf_long plBreaks[]  = { 0, 8, 8, 11, 12, 19, 19, 22 };
+    const size_t   nLines      = 4;
+
+    PdfMemDocument doc;
+    PdfPage* pPage = doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+
+    PdfPainter painter;
+    painter.SetPage( pPage );
+    painter.SetFont( doc.CreateFont( "Helvetica" ) );
+    painter.GetFont()->SetFontSize( 10.0 );
+
+    PdfString text( reinterpret_cast<const pdf_utf8*>(pszText) );
+    const PdfFontMetrics* pMetrics = painter.GetFont()->GetFontMetrics();
+
+    // Line breaking never included the word spacing in the width of
+    // spaces, so a word spacing that would move "bbb" to the next line
+    // does not change the lines.
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        painter.GetFont()->SetWordSpace( nPass ? 10.0f : 0.0f );
+
+        std::vector<PdfString> vecLines = painter.GetMultiLineTextAsLines( 40.0, text );
+        CPPUNIT_ASSERT_EQUAL( nLines, vecLines.size() );
+        for( size_t i = 0; i < nLines; i++ )
+            CPPUNIT_ASSERT_EQUAL( std::string( ppszLines[i] ), vecLines[i].GetStringUtf8() );
+
+        std::vector< std::pair<pdf_long,pdf_long> > vecBreaks;
+        painter.GetMultiLineTextBreaks( 40.0, text, vecBreaks );
+        CPPUNIT_ASSERT_EQUAL( nLines, vecBreaks.size() );
+        for( size_t i = 0; i < nLines; i++ )
+        {
+            CPPUNIT_ASSERT_EQUAL( plBreaks[2 * i], vecBreaks[i].first );
+            CPPUNIT_ASSERT_EQUAL( plBreaks[2 * i + 1], vecBreaks[i].second );
+        }
+
+        // StringWidths measures like StringWidth, including the word spacing
+        std::vector<double> vecWidths;
+        double dWidth = pMetrics->StringWidths( text.GetUnicode(), 0, vecWidths );
+        CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(text.GetCharacterLength()), vecWidths.size() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( pMetrics->StringWidth( text.GetUnicode() ), dWidth, 1e-6 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 5.56, vecWidths[0], 1e-6 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( nPass ? 12.78 : 2.78, vecWidths[3], 1e-6 );
+    }
+
+    // Without skipping spaces the space after "bbb" starts the next line
+    std::vector<PdfString> vecLines = painter.GetMultiLineTextAsLines( 38.0, PdfString( "aaa bbb eee" ), false );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(2), vecLines.size() );
+    CPPUNIT_ASSERT_EQUAL( std::string( "aaa bbb" ), vecLines[0].GetStringUtf8() );
+    CPPUNIT_ASSERT_EQUAL( std::string( " eee" ), vecLines[1].GetStringUtf8() );
+
+    painter.FinishPage();
+}
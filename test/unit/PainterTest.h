@@ -34,6 +34,7 @@ class PainterTest : public CppUnit::TestFixture
 {
   CPPUNIT_TEST_SUITE( PainterTest );
   CPPUNIT_TEST( testAppend );
+  CPPUNIT_TEST( testMultiLineTextBreaks );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -46,6 +47,12 @@ class PainterTest : public CppUnit::TestFixture
    */
   void testAppend();
 
+  /**
+   * Test that GetMultiLineTextBreaks and GetMultiLineTextAsLines
+   * divide a text into the expected lines.
+   */
+  void testMultiLineTextBreaks();
+
  private:
   /**
    * Compare the filtered contents of a PdfStream object
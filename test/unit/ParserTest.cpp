@@ -31,6 +31,7 @@
 */
 
 #include "ParserTest.h"
+#include "TestUtils.h"
 
 #include <cppunit/Asserter.h>
 
@@ -38,8 +39,13 @@
 #include <sys/resource.h>
 #endif
 
+#include <fstream>
 #include <limits>
 
+#if defined(PODOFO_MULTI_THREAD) && !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 CPPUNIT_TEST_SUITE_REGISTRATION( ParserTest );
 
 // this value is from Table C.1 in Appendix C.2 Architectural Limits in PDF 32000-1:2008
@@ -2812,6 +2818,1178 @@ void ParserTest::testRoundTripIndirectTrailerID()
     }
 }
 
+void ParserTest::testRoundTripObjectStreams()
+{
+    const int nObjects = 300;
+
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            PoDoFo::PdfMemDocument doc;
+            doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+
+            for( int i = 0; i < nObjects; i++ )
+            {
+                std::ostringstream oss;
+                oss << "String (" << i << ")";
+
+                PoDoFo::PdfObject* pObject = doc.GetObjects().CreateObject();
+                pObject->GetDictionary().AddKey( "TestIndex", static_cast<PoDoFo::pdf_int64>(i) );
+                pObject->GetDictionary().AddKey( "TestValue", PoDoFo::PdfString( oss.str() ) );
+                if( i % 50 == 0 )
+                    pObject->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+            }
+
+            PoDoFo::PdfWriter writer( &doc.GetObjects(), doc.GetTrailer() );
+            writer.SetUseObjectStreams( true );
+            writer.SetObjectStreamSize( 64 );
+            CPPUNIT_ASSERT( writer.GetUseXRefStream() );
+
+            if( nPass == 1 )
+            {
+                PoDoFo::PdfEncrypt* pEncrypt = PoDoFo::PdfEncrypt::CreatePdfEncrypt( "user", "owner" );
+                writer.SetEncrypted( *pEncrypt );
+                delete pEncrypt;
+            }
+
+            const size_t lObjects     = doc.GetObjects().GetSize();
+            const size_t lObjectCount = doc.GetObjects().GetObjectCount();
+            PoDoFo::PdfRefCountedBuffer buffer;
+            PoDoFo::PdfOutputDevice device( &buffer );
+            writer.Write( &device );
+
+            // Neither the object streams nor the XRef stream are kept
+            // after writing and their object numbers are used again.
+            // Only the number of the encryption dictionary is kept as a free object.
+            const size_t lWrittenCount = lObjectCount + (nPass == 1 ? 1 : 0);
+            CPPUNIT_ASSERT_EQUAL( lObjects, doc.GetObjects().GetSize() );
+            CPPUNIT_ASSERT_EQUAL( lWrittenCount, doc.GetObjects().GetObjectCount() );
+
+            PoDoFo::PdfRefCountedBuffer buffer2;
+            PoDoFo::PdfOutputDevice device2( &buffer2 );
+            writer.Write( &device2 );
+            CPPUNIT_ASSERT_EQUAL( lWrittenCount, doc.GetObjects().GetObjectCount() );
+            CPPUNIT_ASSERT_EQUAL( device.GetLength(), device2.GetLength() );
+
+            std::string sOutput( buffer.GetBuffer(), device.GetLength() );
+            CPPUNIT_ASSERT( sOutput.find( "/Type/ObjStm" ) != std::string::npos );
+
+            PoDoFo::PdfMemDocument result;
+            try {
+                result.LoadFromBuffer( sOutput.c_str(), sOutput.size() );
+                CPPUNIT_ASSERT( nPass == 0 );
+            } catch( PoDoFo::PdfError & error ) {
+                CPPUNIT_ASSERT( nPass == 1 && error.GetError() == PoDoFo::ePdfError_InvalidPassword );
+                result.SetPassword( "user" );
+            }
+
+            CPPUNIT_ASSERT_EQUAL( 1, result.GetPageCount() );
+
+            int nFound = 0;
+            PoDoFo::TCIVecObjects it = result.GetObjects().begin();
+            while( it != result.GetObjects().end() )
+            {
+                if( (*it)->IsDictionary() && (*it)->GetDictionary().HasKey( "TestIndex" ) )
+                {
+                    const PoDoFo::pdf_int64 i = (*it)->GetDictionary().GetKey( "TestIndex" )->GetNumber();
+
+                    std::ostringstream oss;
+                    oss << "String (" << i << ")";
+                    CPPUNIT_ASSERT_EQUAL( oss.str(), (*it)->GetDictionary().GetKey( "TestValue" )->GetString().GetStringUtf8() );
+                    CPPUNIT_ASSERT_EQUAL( i % 50 == 0, (*it)->HasStream() );
+                    ++nFound;
+                }
+
+                ++it;
+            }
+
+            CPPUNIT_ASSERT_EQUAL( nObjects, nFound );
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+void ParserTest::testWriteThreads()
+{
+    const int nObjects = 500;
+
+    // Odd passes encrypt the output, the last two passes write a
+    // document loaded on demand, whose streams have an indirect /Length
+    for( int nPass = 0; nPass < 4; nPass++ )
+    {
+        const bool bEncrypt  = (nPass % 2 == 1);
+        const bool bOnDemand = (nPass >= 2);
+
+        try {
+            PoDoFo::PdfMemDocument doc;
+            doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+
+            for( int i = 0; i < nObjects; i++ )
+            {
+                std::ostringstream oss;
+                oss << "String (" << i << ")";
+
+                PoDoFo::PdfObject* pObject = doc.GetObjects().CreateObject();
+                pObject->GetDictionary().AddKey( "TestIndex", static_cast<PoDoFo::pdf_int64>(i) );
+                if( i % 3 == 0 )
+                {
+                    pObject->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+
+                    if( bOnDemand )
+                    {
+                        PoDoFo::PdfObject* pLength = doc.GetObjects().CreateObject( 
+                            PoDoFo::PdfVariant( static_cast<PoDoFo::pdf_int64>(pObject->GetStream()->GetLength()) ) );
+                        pObject->GetDictionary().AddKey( PoDoFo::PdfName::KeyLength, pLength->Reference() );
+                    }
+                }
+                else
+                    pObject->GetDictionary().AddKey( "TestValue", PoDoFo::PdfString( oss.str() ) );
+            }
+
+            std::string sSource;
+            if( bOnDemand )
+            {
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                doc.Write( &device );
+
+                sSource = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            // Writing from several threads must not change the output
+            std::string sOutput[2];
+            for( int nWrite = 0; nWrite < 2; nWrite++ )
+            {
+                // Load the document again for each write, 
+                // so that the threads find unloaded objects
+                PoDoFo::PdfMemDocument  loaded;
+                PoDoFo::PdfMemDocument* pSource = &doc;
+                if( bOnDemand )
+                {
+                    loaded.LoadFromBuffer( sSource.c_str(), static_cast<long>(sSource.size()) );
+                    pSource = &loaded;
+
+                    // Loading sets the /ModDate, which is part of the file identifier 
+                    // and thus of the encryption key, to the current time
+                    pSource->GetInfo()->GetObject()->GetDictionary().AddKey( "ModDate", PoDoFo::PdfString( "D:20200101000000Z" ) );
+                }
+
+                PoDoFo::PdfWriter writer( &pSource->GetObjects(), pSource->GetTrailer() );
+                writer.SetWriteThreads( nWrite ? 4 : 1 );
+
+                if( bEncrypt )
+                {
+                    PoDoFo::PdfEncrypt* pEncrypt = PoDoFo::PdfEncrypt::CreatePdfEncrypt( "user", "owner" );
+                    writer.SetEncrypted( *pEncrypt );
+                    delete pEncrypt;
+                }
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                writer.Write( &device );
+
+                sOutput[nWrite] = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            CPPUNIT_ASSERT( sOutput[0] == sOutput[1] );
+
+            PoDoFo::PdfMemDocument result;
+            try {
+                result.LoadFromBuffer( sOutput[1].c_str(), sOutput[1].size() );
+                CPPUNIT_ASSERT( !bEncrypt );
+            } catch( PoDoFo::PdfError & error ) {
+                CPPUNIT_ASSERT( bEncrypt && error.GetError() == PoDoFo::ePdfError_InvalidPassword );
+                result.SetPassword( "user" );
+            }
+
+            int nFound = 0;
+            PoDoFo::TCIVecObjects it = result.GetObjects().begin();
+            while( it != result.GetObjects().end() )
+            {
+                if( (*it)->IsDictionary() && (*it)->GetDictionary().HasKey( "TestIndex" ) )
+                {
+                    const PoDoFo::pdf_int64 i = (*it)->GetDictionary().GetKey( "TestIndex" )->GetNumber();
+
+                    std::ostringstream oss;
+                    oss << "String (" << i << ")";
+                    if( i % 3 == 0 )
+                    {
+                        char*            pBuffer;
+                        PoDoFo::pdf_long lLen;
+                        (*it)->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+
+                        const std::string sData( pBuffer, lLen );
+                        PoDoFo::podofo_free( pBuffer );
+                        CPPUNIT_ASSERT_EQUAL( oss.str(), sData );
+                    }
+                    else
+                        CPPUNIT_ASSERT_EQUAL( oss.str(), (*it)->GetDictionary().GetKey( "TestValue" )->GetString().GetStringUtf8() );
+
+                    ++nFound;
+                }
+
+                ++it;
+            }
+
+            CPPUNIT_ASSERT_EQUAL( nObjects, nFound );
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+/** Loads every nThreads-th object of a document loaded on demand
+ *  and checks the objects created by testDelayedLoadThreads
+ */
+struct DelayedLoadWorker {
+    std::vector<PoDoFo::PdfObject*>* pObjects;
+    size_t                           nFirst;
+    size_t                           nStep;
+    int                              nFound;
+    bool                             bFailed;
+};
+
+static void* DelayedLoadThread( void* pData )
+{
+    DelayedLoadWorker* pWorker = static_cast<DelayedLoadWorker*>(pData);
+
+    try {
+        for( size_t i = pWorker->nFirst; i < pWorker->pObjects->size(); i += pWorker->nStep )
+        {
+            PoDoFo::PdfObject* pObject = (*pWorker->pObjects)[i];
+            if( !pObject->IsDictionary() || !pObject->GetDictionary().HasKey( "TestIndex" ) )
+                continue;
+
+            const PoDoFo::pdf_int64 lIndex = pObject->GetDictionary().GetKey( "TestIndex" )->GetNumber();
+
+            std::ostringstream oss;
+            oss << "Stream data of object " << lIndex;
+
+            char*            pBuffer;
+            PoDoFo::pdf_long lLen;
+            pObject->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+
+            const std::string sData( pBuffer, lLen );
+            PoDoFo::podofo_free( pBuffer );
+
+            if( sData != oss.str() 
+                || pObject->GetDictionary().GetKey( "TestValue" )->GetString().GetStringUtf8() != oss.str() )
+                pWorker->bFailed = true;
+
+            ++pWorker->nFound;
+        }
+    } catch( PoDoFo::PdfError & ) {
+        pWorker->bFailed = true;
+    }
+
+    return NULL;
+}
+
+void ParserTest::testDelayedLoadThreads()
+{
+    const int nObjects = 300;
+    const int nThreads = 4;
+
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            std::string sOutput;
+            {
+                PoDoFo::PdfMemDocument doc;
+                doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+
+                for( int i = 0; i < nObjects; i++ )
+                {
+                    std::ostringstream oss;
+                    oss << "Stream data of object " << i;
+
+                    PoDoFo::PdfObject* pObject = doc.GetObjects().CreateObject();
+                    pObject->GetDictionary().AddKey( "TestIndex", static_cast<PoDoFo::pdf_int64>(i) );
+                    pObject->GetDictionary().AddKey( "TestValue", PoDoFo::PdfString( oss.str() ) );
+                    pObject->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+                }
+
+                if( nPass == 1 )
+                    doc.SetEncrypted( "user", "owner", PoDoFo::PdfEncrypt::ePdfPermissions_Print, 
+                                      PoDoFo::PdfEncrypt::ePdfEncryptAlgorithm_AESV2 );
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                doc.Write( &device );
+
+                sOutput = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            PoDoFo::PdfMemDocument result;
+            try {
+                result.LoadFromBuffer( sOutput.c_str(), sOutput.size() );
+                CPPUNIT_ASSERT( nPass == 0 );
+            } catch( PoDoFo::PdfError & error ) {
+                CPPUNIT_ASSERT( nPass == 1 && error.GetError() == PoDoFo::ePdfError_InvalidPassword );
+                result.SetPassword( "user" );
+            }
+
+            // Loading objects does not change the object list,
+            // so the pointers can be collected up front
+            std::vector<PoDoFo::PdfObject*> vecObjects( result.GetObjects().begin(), result.GetObjects().end() );
+
+            DelayedLoadWorker workers[nThreads];
+            for( int i = 0; i < nThreads; i++ )
+            {
+                workers[i].pObjects = &vecObjects;
+                workers[i].nFirst   = i;
+                workers[i].nStep    = nThreads;
+                workers[i].nFound   = 0;
+                workers[i].bFailed  = false;
+            }
+
+#if defined(PODOFO_MULTI_THREAD) && !defined(_WIN32)
+            pthread_t threads[nThreads];
+            for( int i = 0; i < nThreads; i++ )
+                CPPUNIT_ASSERT_EQUAL( 0, pthread_create( &threads[i], NULL, DelayedLoadThread, &workers[i] ) );
+
+            for( int i = 0; i < nThreads; i++ )
+                pthread_join( threads[i], NULL );
+#else
+            for( int i = 0; i < nThreads; i++ )
+                DelayedLoadThread( &workers[i] );
+#endif // PODOFO_MULTI_THREAD
+
+            int nFound = 0;
+            for( int i = 0; i < nThreads; i++ )
+            {
+                CPPUNIT_ASSERT( !workers[i].bFailed );
+                nFound += workers[i].nFound;
+            }
+
+            CPPUNIT_ASSERT_EQUAL( nObjects, nFound );
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+/** Reads the hint tables of a linearized file
+ */
+class HintTableReader {
+public:
+    HintTableReader( const std::string & sData, size_t lPos )
+        : m_sData( sData ), m_lPos( lPos ), m_nBit( 0 )
+    {
+    }
+
+    PoDoFo::pdf_uint32 ReadBits( int nBits )
+    {
+        PoDoFo::pdf_uint32 value = 0;
+        while( nBits-- )
+        {
+            CPPUNIT_ASSERT( m_lPos < m_sData.size() );
+            const unsigned char c = static_cast<unsigned char>(m_sData[m_lPos]);
+            value = (value << 1) | ((c >> (7 - m_nBit)) & 0x01);
+            if( ++m_nBit == 8 )
+            {
+                m_nBit = 0;
+                ++m_lPos;
+            }
+        }
+
+        return value;
+    }
+
+    void Align()
+    {
+        if( m_nBit )
+        {
+            m_nBit = 0;
+            ++m_lPos;
+        }
+    }
+
+private:
+    const std::string & m_sData;
+    size_t              m_lPos;
+    int                 m_nBit;
+};
+
+static size_t findObjectOffset( const std::string & sFile, PoDoFo::pdf_objnum nObject )
+{
+    std::ostringstream oss;
+    oss << "\n" << nObject << " 0 obj";
+
+    const size_t lPos = sFile.find( oss.str() );
+    CPPUNIT_ASSERT( lPos != std::string::npos );
+    return lPos + 1;
+}
+
+void ParserTest::checkLinearizedFile( const std::string & sFile, const char* pszPassword )
+{
+    PoDoFo::PdfMemDocument doc;
+    try {
+        doc.LoadFromBuffer( sFile.c_str(), sFile.size() );
+        CPPUNIT_ASSERT( !pszPassword );
+    } catch( PoDoFo::PdfError & error ) {
+        CPPUNIT_ASSERT( pszPassword && error.GetError() == PoDoFo::ePdfError_InvalidPassword );
+        doc.SetPassword( pszPassword );
+    }
+
+    // The linearization dictionary is the first object after the header
+    size_t lPos = sFile.find( '\n', sFile.find( '\n' ) + 1 ) + 1;
+    const PoDoFo::pdf_objnum nLinearize = static_cast<PoDoFo::pdf_objnum>(strtol( sFile.c_str() + lPos, NULL, 10 ));
+    const PoDoFo::PdfObject* pLinearize = doc.GetObjects().GetObject( PoDoFo::PdfReference( nLinearize, 0 ) );
+    CPPUNIT_ASSERT( pLinearize && pLinearize->GetDictionary().HasKey( "Linearized" ) );
+
+    const PoDoFo::PdfDictionary & rLinearize = pLinearize->GetDictionary();
+    const PoDoFo::pdf_int64 lHintOffset = rLinearize.GetKey( "H" )->GetArray()[0].GetNumber();
+    const PoDoFo::pdf_int64 lHintLength = rLinearize.GetKey( "H" )->GetArray()[1].GetNumber();
+    const int               nPages      = doc.GetPageCount();
+
+    CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_int64>(sFile.size()), rLinearize.GetKeyAsLong( "L" ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_int64>(nPages), rLinearize.GetKeyAsLong( "N" ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_int64>(doc.GetPage( 0 )->GetObject()->Reference().ObjectNumber()), 
+                          rLinearize.GetKeyAsLong( "O" ) );
+
+    // The first page ends before the objects of the other pages start with object 1
+    const size_t lFirstPage = findObjectOffset( sFile, static_cast<PoDoFo::pdf_objnum>(rLinearize.GetKeyAsLong( "O" )) );
+    CPPUNIT_ASSERT( lFirstPage < static_cast<size_t>(rLinearize.GetKeyAsLong( "E" )) );
+    if( nPages > 1 )
+        CPPUNIT_ASSERT_EQUAL( findObjectOffset( sFile, 1 ), static_cast<size_t>(rLinearize.GetKeyAsLong( "E" )) );
+
+    // T is the end of the first line of the main XRef table
+    const size_t lMainXRef = sFile.rfind( "xref\n0 ", static_cast<size_t>(rLinearize.GetKeyAsLong( "T" )) );
+    CPPUNIT_ASSERT( lMainXRef != std::string::npos );
+    CPPUNIT_ASSERT_EQUAL( sFile.find( '\n', lMainXRef + 5 ), static_cast<size_t>(rLinearize.GetKeyAsLong( "T" )) );
+
+    // Decode the hint tables, where all offsets are given without the hint stream
+    const PoDoFo::pdf_objnum nHint = static_cast<PoDoFo::pdf_objnum>(strtol( sFile.c_str() + lHintOffset, NULL, 10 ));
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(lHintOffset), findObjectOffset( sFile, nHint ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(lHintOffset + lHintLength), findObjectOffset( sFile, nHint + 1 ) );
+
+    const PoDoFo::PdfObject* pHint = doc.GetObjects().GetObject( PoDoFo::PdfReference( nHint, 0 ) );
+    char*                    pBuffer;
+    PoDoFo::pdf_long         lLen;
+    pHint->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+
+    const std::string sHint( pBuffer, lLen );
+    PoDoFo::podofo_free( pBuffer );
+
+    HintTableReader reader( sHint, 0 );
+    const PoDoFo::pdf_uint32 nLeastObjects      = reader.ReadBits( 32 );
+    const PoDoFo::pdf_uint32 lFirstPageOffset   = reader.ReadBits( 32 );
+    const int                nBitsObjects       = reader.ReadBits( 16 );
+    const PoDoFo::pdf_uint32 lLeastLength       = reader.ReadBits( 32 );
+    const int                nBitsLength        = reader.ReadBits( 16 );
+    reader.ReadBits( 32 + 16 + 32 + 16 ); // content streams
+    const int                nBitsShared        = reader.ReadBits( 16 );
+    const int                nBitsSharedId      = reader.ReadBits( 16 );
+    const int                nBitsNumerator     = reader.ReadBits( 16 );
+    reader.ReadBits( 16 );
+
+    CPPUNIT_ASSERT_EQUAL( lFirstPage, static_cast<size_t>(lFirstPageOffset + lHintLength) );
+
+    std::vector<PoDoFo::pdf_uint32> vecObjects( nPages );
+    std::vector<PoDoFo::pdf_uint32> vecLength( nPages );
+    std::vector<PoDoFo::pdf_uint32> vecShared( nPages );
+    int i;
+    for( i = 0; i < nPages; i++ )
+        vecObjects[i] = nLeastObjects + reader.ReadBits( nBitsObjects );
+    reader.Align();
+    for( i = 0; i < nPages; i++ )
+        vecLength[i] = lLeastLength + reader.ReadBits( nBitsLength );
+    reader.Align();
+    for( i = 0; i < nPages; i++ )
+        vecShared[i] = reader.ReadBits( nBitsShared );
+    reader.Align();
+
+    // The objects of the first page are the first groups of the shared object hint table
+    PoDoFo::pdf_uint32 nMaxSharedId = 0;
+    for( i = 0; i < nPages; i++ )
+        for( PoDoFo::pdf_uint32 j = 0; j < vecShared[i]; j++ )
+            nMaxSharedId = PoDoFo::PDF_MAX( nMaxSharedId, reader.ReadBits( nBitsSharedId ) );
+    reader.Align();
+    CPPUNIT_ASSERT_EQUAL( 0, nBitsNumerator );
+    CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_uint32>(0), vecShared[0] );
+
+    // Each page starts with its page object, the pages following 
+    // the first page are numbered starting with 1
+    PoDoFo::pdf_objnum nObject = 1;
+    size_t             lOffset = lFirstPageOffset + vecLength[0] + lHintLength;
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(rLinearize.GetKeyAsLong( "E" )), lOffset );
+    for( i = 1; i < nPages; i++ )
+    {
+        CPPUNIT_ASSERT_EQUAL( nObject, doc.GetPage( i )->GetObject()->Reference().ObjectNumber() );
+        CPPUNIT_ASSERT_EQUAL( lOffset, findObjectOffset( sFile, nObject ) );
+
+        nObject += vecObjects[i];
+        lOffset += vecLength[i];
+    }
+
+    const size_t lSharedTable = static_cast<size_t>(pHint->GetDictionary().GetKeyAsLong( "S" ));
+    HintTableReader shared( sHint, lSharedTable );
+    const PoDoFo::pdf_uint32 nFirstShared      = shared.ReadBits( 32 );
+    const PoDoFo::pdf_uint32 lFirstShared      = shared.ReadBits( 32 );
+    const PoDoFo::pdf_uint32 nSharedFirstPage  = shared.ReadBits( 32 );
+    const PoDoFo::pdf_uint32 nSharedTotal      = shared.ReadBits( 32 );
+
+    CPPUNIT_ASSERT_EQUAL( vecObjects[0], nSharedFirstPage );
+    CPPUNIT_ASSERT( nMaxSharedId < nSharedTotal );
+    if( nSharedTotal > nSharedFirstPage )
+    {
+        // The shared objects follow the objects of all pages
+        CPPUNIT_ASSERT_EQUAL( nObject, nFirstShared );
+        CPPUNIT_ASSERT_EQUAL( lOffset, static_cast<size_t>(lFirstShared + lHintLength) );
+        CPPUNIT_ASSERT_EQUAL( lOffset, findObjectOffset( sFile, nFirstShared ) );
+    }
+}
+
+void ParserTest::testWriteLinearized()
+{
+    const int nPages = 5;
+
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            PoDoFo::PdfMemDocument doc;
+
+            // An object used by the first and the third page and 
+            // one used by the second to the fourth page
+            PoDoFo::PdfObject* pFirstPage = doc.GetObjects().CreateObject();
+            PoDoFo::PdfObject* pShared    = doc.GetObjects().CreateObject();
+            pFirstPage->GetStream()->Set( "first" );
+            pShared->GetStream()->Set( "shared" );
+
+            std::vector<PoDoFo::PdfReference> vecPages;
+            for( int i = 0; i < nPages; i++ )
+            {
+                PoDoFo::PdfPage* pPage = doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+
+                std::ostringstream oss;
+                oss << "Page " << i;
+
+                PoDoFo::PdfObject* pContents = doc.GetObjects().CreateObject();
+                pContents->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+                pPage->GetObject()->GetDictionary().AddKey( "Contents", pContents->Reference() );
+
+                if( i == 0 || i == 2 )
+                    pPage->GetObject()->GetDictionary().AddKey( "TestFirstPage", pFirstPage->Reference() );
+                if( i >= 1 && i <= 3 )
+                    pPage->GetObject()->GetDictionary().AddKey( "TestShared", pShared->Reference() );
+
+                vecPages.push_back( pPage->GetObject()->Reference() );
+            }
+
+            std::string sOutput;
+            {
+                PoDoFo::PdfWriter writer( &doc.GetObjects(), doc.GetTrailer() );
+                writer.SetLinearized( true );
+
+                if( nPass == 1 )
+                {
+                    PoDoFo::PdfEncrypt* pEncrypt = PoDoFo::PdfEncrypt::CreatePdfEncrypt( "user", "owner" );
+                    writer.SetEncrypted( *pEncrypt );
+                    delete pEncrypt;
+                }
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                writer.Write( &device );
+
+                sOutput = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            checkLinearizedFile( sOutput, nPass == 1 ? "user" : NULL );
+
+            // The object numbers of the document are not changed
+            for( int i = 0; i < nPages; i++ )
+                CPPUNIT_ASSERT( vecPages[i] == doc.GetPage( i )->GetObject()->Reference() );
+
+            PoDoFo::PdfMemDocument result;
+            try {
+                result.LoadFromBuffer( sOutput.c_str(), sOutput.size() );
+            } catch( PoDoFo::PdfError & error ) {
+                result.SetPassword( "user" );
+            }
+
+            CPPUNIT_ASSERT_EQUAL( nPages, result.GetPageCount() );
+            for( int i = 0; i < nPages; i++ )
+            {
+                std::ostringstream oss;
+                oss << "Page " << i;
+
+                PoDoFo::PdfObject* pPage = result.GetPage( i )->GetObject();
+                char*              pBuffer;
+                PoDoFo::pdf_long   lLen;
+                pPage->GetIndirectKey( "Contents" )->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+
+                const std::string sData( pBuffer, lLen );
+                PoDoFo::podofo_free( pBuffer );
+                CPPUNIT_ASSERT_EQUAL( oss.str(), sData );
+                CPPUNIT_ASSERT_EQUAL( i >= 1 && i <= 3, pPage->GetDictionary().HasKey( "TestShared" ) );
+            }
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+void ParserTest::testUpdateSession()
+{
+    const int nObjects = 200;
+
+    // The second pass updates a file with object streams and an XRef stream
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            PoDoFo::PdfMemDocument doc;
+            doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+
+            std::vector<PoDoFo::PdfReference> vecObjects;
+            for( int i = 0; i < nObjects; i++ )
+            {
+                std::ostringstream oss;
+                oss << "Stream " << i;
+
+                PoDoFo::PdfObject* pObject = doc.GetObjects().CreateObject();
+                pObject->GetDictionary().AddKey( "TestIndex", static_cast<PoDoFo::pdf_int64>(i) );
+                if( i % 50 == 0 )
+                    pObject->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+
+                vecObjects.push_back( pObject->Reference() );
+            }
+
+            std::string sOriginal;
+            {
+                PoDoFo::PdfWriter writer( &doc.GetObjects(), doc.GetTrailer() );
+                writer.SetUseObjectStreams( nPass == 1 );
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                writer.Write( &device );
+
+                sOriginal = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            std::string sUpdated;
+            PoDoFo::PdfReference newRef;
+            PoDoFo::PdfReference emptyRef;
+            {
+                PoDoFo::PdfRefCountedInputDevice input( sOriginal.c_str(), sOriginal.size() );
+                PoDoFo::PdfUpdateSession session( input );
+                CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(0), session.GetObjects().GetSize() );
+
+                PoDoFo::PdfObject* pChanged = session.GetObject( vecObjects[10] );
+                CPPUNIT_ASSERT( pChanged != NULL );
+                CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_int64>(10), pChanged->GetDictionary().GetKeyAsLong( "TestIndex" ) );
+                pChanged->GetDictionary().AddKey( "TestChanged", true );
+
+                // Objects which are only read are not part of the update
+                const PoDoFo::PdfObject* pStream = session.GetObject( vecObjects[50] );
+                CPPUNIT_ASSERT( pStream != NULL && pStream->HasStream() );
+
+                char*            pBuffer;
+                PoDoFo::pdf_long lLen;
+                pStream->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+                const std::string sData( pBuffer, lLen );
+                PoDoFo::podofo_free( pBuffer );
+                CPPUNIT_ASSERT_EQUAL( std::string( "Stream 50" ), sData );
+
+                CPPUNIT_ASSERT( session.GetObject( PoDoFo::PdfReference( nObjects * 2, 0 ) ) == NULL );
+
+                PoDoFo::PdfObject* pNew   = session.CreateObject();
+                PoDoFo::PdfObject* pEmpty = session.CreateObject();
+                pNew->GetDictionary().AddKey( "TestEmpty", pEmpty->Reference() );
+                session.GetCatalog()->GetDictionary().AddKey( "TestNew", pNew->Reference() );
+                newRef   = pNew->Reference();
+                emptyRef = pEmpty->Reference();
+                CPPUNIT_ASSERT( newRef.ObjectNumber() > vecObjects.back().ObjectNumber() );
+
+                // Only the accessed objects were read
+                CPPUNIT_ASSERT( session.GetObjects().GetSize() <= 6 );
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                device.Write( sOriginal.c_str(), sOriginal.size() );
+                session.Write( &device );
+
+                sUpdated = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            // The original file is left as it is and the update is small
+            CPPUNIT_ASSERT( sUpdated.compare( 0, sOriginal.size(), sOriginal ) == 0 );
+            CPPUNIT_ASSERT( sUpdated.size() - sOriginal.size() < 1024 );
+
+            PoDoFo::PdfMemDocument result;
+            result.LoadFromBuffer( sUpdated.c_str(), static_cast<long>(sUpdated.size()) );
+
+            // An XRef stream is the last object of the update
+            CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_int64>(emptyRef.ObjectNumber() + 1 + nPass), 
+                                  result.GetTrailer()->GetDictionary().GetKeyAsLong( "Size" ) );
+            CPPUNIT_ASSERT_EQUAL( 1, result.GetPageCount() );
+
+            PoDoFo::PdfObject* pNew = result.GetCatalog()->GetIndirectKey( "TestNew" );
+            CPPUNIT_ASSERT( pNew != NULL && pNew->Reference() == newRef );
+            CPPUNIT_ASSERT( pNew->GetIndirectKey( "TestEmpty" ) != NULL );
+
+            for( int i = 0; i < nObjects; i++ )
+            {
+                PoDoFo::PdfObject* pObject = result.GetObjects().GetObject( vecObjects[i] );
+                CPPUNIT_ASSERT( pObject != NULL );
+                CPPUNIT_ASSERT_EQUAL( static_cast<PoDoFo::pdf_int64>(i), pObject->GetDictionary().GetKeyAsLong( "TestIndex" ) );
+                CPPUNIT_ASSERT_EQUAL( i == 10, pObject->GetDictionary().HasKey( "TestChanged" ) );
+            }
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+void ParserTest::testUpdateIndirectLength()
+{
+    const int nStreams = 40;
+
+    // The second pass stores the lengths in object streams
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            PoDoFo::PdfMemDocument doc;
+            doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+
+            std::vector<PoDoFo::PdfReference> vecStreams;
+            for( int i = 0; i < nStreams; i++ )
+            {
+                std::ostringstream oss;
+                oss << "Stream " << i;
+
+                PoDoFo::PdfObject* pObject = doc.GetObjects().CreateObject();
+                pObject->GetDictionary().AddKey( "TestIndex", static_cast<PoDoFo::pdf_int64>(i) );
+                pObject->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+
+                PoDoFo::PdfObject* pLength = doc.GetObjects().CreateObject( 
+                    PoDoFo::PdfVariant( static_cast<PoDoFo::pdf_int64>(pObject->GetStream()->GetLength()) ) );
+                pObject->GetDictionary().AddKey( PoDoFo::PdfName::KeyLength, pLength->Reference() );
+
+                vecStreams.push_back( pObject->Reference() );
+            }
+
+            std::string sOriginal;
+            {
+                PoDoFo::PdfWriter writer( &doc.GetObjects(), doc.GetTrailer() );
+                writer.SetUseObjectStreams( nPass == 1 );
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                writer.Write( &device );
+
+                sOriginal = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            std::string sUpdated;
+            {
+                PoDoFo::PdfRefCountedInputDevice input( sOriginal.c_str(), sOriginal.size() );
+                PoDoFo::PdfUpdateSession session( input );
+
+                // Only the dictionaries are changed, so the streams are copied 
+                // unmodified and their lengths are loaded while writing
+                for( int i = 0; i < nStreams; i++ )
+                {
+                    PoDoFo::PdfObject* pObject = session.GetObject( vecStreams[i] );
+                    CPPUNIT_ASSERT( pObject != NULL );
+                    CPPUNIT_ASSERT( pObject->GetDictionary().GetKey( PoDoFo::PdfName::KeyLength )->IsReference() );
+                    pObject->GetDictionary().AddKey( "TestChanged", true );
+                }
+
+                CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(nStreams), session.GetObjects().GetSize() );
+
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice device( &buffer );
+                device.Write( sOriginal.c_str(), sOriginal.size() );
+                session.Write( &device );
+
+                CPPUNIT_ASSERT( session.GetObjects().GetSize() >= static_cast<size_t>(2 * nStreams) );
+
+                sUpdated = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            PoDoFo::PdfMemDocument result;
+            result.LoadFromBuffer( sUpdated.c_str(), static_cast<long>(sUpdated.size()) );
+
+            for( int i = 0; i < nStreams; i++ )
+            {
+                std::ostringstream oss;
+                oss << "Stream " << i;
+
+                PoDoFo::PdfObject* pObject = result.GetObjects().GetObject( vecStreams[i] );
+                CPPUNIT_ASSERT( pObject != NULL );
+                CPPUNIT_ASSERT( pObject->GetDictionary().HasKey( "TestChanged" ) );
+
+                char*            pBuffer;
+                PoDoFo::pdf_long lLen;
+                pObject->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+                const std::string sData( pBuffer, lLen );
+                PoDoFo::podofo_free( pBuffer );
+                CPPUNIT_ASSERT_EQUAL( oss.str(), sData );
+            }
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+static std::string readFile( const std::string & sFilename )
+{
+    std::ifstream stream( sFilename.c_str(), std::ios_base::binary );
+    std::ostringstream oss;
+    oss << stream.rdbuf();
+    return oss.str();
+}
+
+void ParserTest::testWriteRawStreams()
+{
+    // Binary data spanning several 64KB copy buffers
+    std::string  sData( 200000, '\0' );
+    unsigned int seed = 12345;
+    for( size_t i = 0; i < sData.size(); i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        sData[i] = static_cast<char>(seed >> 16);
+    }
+
+    std::ostringstream oss;
+    oss << "%PDF-1.4\n";
+    int objPos[5];
+
+    objPos[1] = oss.tellp();
+    oss << "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n";
+
+    objPos[2] = oss.tellp();
+    oss << "2 0 obj\n<</Type /Pages /Count 0 /Kids []>>\nendobj\n";
+
+    // A stream with an indirect /Length
+    objPos[3] = oss.tellp();
+    oss << "3 0 obj\n<</Length 4 0 R>>\nstream\n";
+    oss.write( sData.c_str(), sData.size() );
+    oss << "\nendstream\nendobj\n";
+
+    objPos[4] = oss.tellp();
+    oss << "4 0 obj\n" << sData.size() << "\nendobj\n";
+
+    int nXrefPos = oss.tellp();
+    oss << "xref\n0 5\n0000000000 65535 f \n";
+    char objRec[21];
+    for( int i = 1; i < 5; i++ ) {
+        snprintf( objRec, 21, "%010d 00000 n \n", objPos[i] );
+        oss << objRec;
+    }
+    oss << "trailer <<\n"
+        << "  /Size 5\n"
+        << "  /Root 1 0 R\n"
+        << ">>\n"
+        << "startxref\n"
+        << nXrefPos << "\n"
+        << "%%EOF\n";
+
+    std::string sInput  = TestUtils::getTempFilename();
+    std::string sOutput = TestUtils::getTempFilename();
+    try {
+        {
+            std::ofstream stream( sInput.c_str(), std::ios_base::binary );
+            stream << oss.str();
+        }
+
+        PoDoFo::PdfMemDocument doc( sInput.c_str() );
+        PoDoFo::PdfObject* pObject = doc.GetObjects().GetObject( PoDoFo::PdfReference( 3, 0 ) );
+        CPPUNIT_ASSERT( pObject != NULL );
+        CPPUNIT_ASSERT( pObject->GetDictionary().GetKey( PoDoFo::PdfName::KeyLength )->IsReference() );
+
+        // From file to file, using copy_file_range() or sendfile() if available,
+        // through the FILE* based PdfOutputDevice( const char* )
+        doc.Write( sOutput.c_str() );
+        const std::string sFile = readFile( sOutput );
+
+        // From file to memory, using the 64KB buffer
+        PoDoFo::PdfRefCountedBuffer buffer;
+        {
+            PoDoFo::PdfOutputDevice device( &buffer );
+            doc.Write( &device );
+        }
+        const std::string sBuffer( buffer.GetBuffer(), buffer.GetSize() );
+
+        const std::string* apOutputs[] = { &sFile, &sBuffer };
+        for( int i = 0; i < 2; i++ )
+        {
+            const std::string & sOut = *apOutputs[i];
+            size_t lStart = sOut.find( "stream\n" );
+            CPPUNIT_ASSERT( lStart != std::string::npos );
+            CPPUNIT_ASSERT( sOut.compare( lStart + 7, sData.size(), sData ) == 0 );
+            CPPUNIT_ASSERT( sOut.compare( lStart + 7 + sData.size(), 10, "\nendstream" ) == 0 );
+
+            PoDoFo::PdfMemDocument result;
+            result.LoadFromBuffer( sOut.c_str(), static_cast<long>(sOut.size()) );
+
+            char*            pBuffer;
+            PoDoFo::pdf_long lLen;
+            result.GetObjects().GetObject( PoDoFo::PdfReference( 3, 0 ) )->GetStream()->GetCopy( &pBuffer, &lLen );
+            const std::string sCopy( pBuffer, lLen );
+            PoDoFo::podofo_free( pBuffer );
+            CPPUNIT_ASSERT( sData == sCopy );
+        }
+
+        // Appending to an existing file keeps its contents
+        {
+            PoDoFo::PdfOutputDevice device( sOutput.c_str(), false );
+            CPPUNIT_ASSERT_EQUAL( sFile.size(), device.GetLength() );
+            CPPUNIT_ASSERT_EQUAL( sFile.size(), device.Tell() );
+            device.Print( "%%Appended\n" );
+        }
+        CPPUNIT_ASSERT( sFile + "%Appended\n" == readFile( sOutput ) );
+    } catch( PoDoFo::PdfError & error ) {
+        TestUtils::deleteFile( sInput.c_str() );
+        TestUtils::deleteFile( sOutput.c_str() );
+        error.PrintErrorMsg();
+        CPPUNIT_FAIL( "Unexpected PdfError" );
+    }
+
+    TestUtils::deleteFile( sInput.c_str() );
+    TestUtils::deleteFile( sOutput.c_str() );
+}
+
+void ParserTest::testWriteToBuffer()
+{
+    PoDoFo::PdfMemDocument doc;
+    for( int i = 0; i < 3; i++ )
+    {
+        std::ostringstream oss;
+        oss << "BT /F1 12 Tf 100 700 Td (Page " << i << ") Tj ET";
+
+        PoDoFo::PdfPage* pPage = doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+        pPage->GetContentsForAppending()->GetStream()->Set( oss.str().c_str(), oss.str().size() );
+    }
+
+    // The second pass uses object streams
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            PoDoFo::PdfWriter writer( &doc.GetObjects(), doc.GetTrailer() );
+            writer.SetUseObjectStreams( nPass == 1 );
+
+            PoDoFo::PdfRefCountedBuffer buffer;
+            PoDoFo::PdfOutputDevice     device( &buffer );
+            writer.Write( &device );
+
+            char*            pBuffer;
+            PoDoFo::pdf_long lLen;
+            writer.WriteToBuffer( &pBuffer, &lLen );
+            const std::string sWriteToBuffer( pBuffer, lLen );
+            PoDoFo::podofo_free( pBuffer );
+
+            CPPUNIT_ASSERT_EQUAL( device.GetLength(), sWriteToBuffer.size() );
+            CPPUNIT_ASSERT( std::string( buffer.GetBuffer(), device.GetLength() ) == sWriteToBuffer );
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+void ParserTest::testDeduplicateObjects()
+{
+    const int nPages = 4;
+
+    // The second pass merges the objects of a document loaded on demand
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        try {
+            PoDoFo::PdfMemDocument doc;
+
+            // Two identical fonts with identical font files, which 
+            // only become duplicates after the font files are merged.
+            // The keys are added in a different order.
+            PoDoFo::PdfObject* pFontFile[2];
+            PoDoFo::PdfObject* pFont[2];
+            for( int i = 0; i < 2; i++ )
+            {
+                pFontFile[i] = doc.GetObjects().CreateObject();
+                pFontFile[i]->GetStream()->Set( "font data" );
+
+                pFont[i] = doc.GetObjects().CreateObject( "Font" );
+                if( i == 0 )
+                {
+                    pFont[i]->GetDictionary().AddKey( "Subtype", PoDoFo::PdfName( "Type1" ) );
+                    pFont[i]->GetDictionary().AddKey( "FontFile", pFontFile[i]->Reference() );
+                }
+                else
+                {
+                    pFont[i]->GetDictionary().AddKey( "FontFile", pFontFile[i]->Reference() );
+                    pFont[i]->GetDictionary().AddKey( "Subtype", PoDoFo::PdfName( "Type1" ) );
+                }
+            }
+
+            // An object with the same dictionary but a different stream
+            PoDoFo::PdfObject* pOther = doc.GetObjects().CreateObject();
+            pOther->GetStream()->Set( "other data" );
+
+            // Identical pages are never merged
+            for( int i = 0; i < nPages; i++ )
+            {
+                PoDoFo::PdfPage* pPage = doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) );
+                pPage->GetObject()->GetDictionary().AddKey( "TestFont", pFont[i / 2]->Reference() );
+                pPage->GetObject()->GetDictionary().AddKey( "TestOther", pOther->Reference() );
+            }
+
+            PoDoFo::PdfMemDocument  loaded;
+            PoDoFo::PdfMemDocument* pDoc = &doc;
+            std::string             sSource;
+            if( nPass == 1 )
+            {
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice     device( &buffer );
+                doc.Write( &device );
+                sSource = std::string( buffer.GetBuffer(), device.GetLength() );
+
+                loaded.LoadFromBuffer( sSource.c_str(), static_cast<long>(sSource.size()) );
+                pDoc = &loaded;
+            }
+
+            const size_t nObjects = pDoc->GetObjects().GetSize();
+            CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(2), pDoc->MergeDuplicateObjects() );
+            CPPUNIT_ASSERT_EQUAL( nObjects - 2, pDoc->GetObjects().GetSize() );
+
+            const PoDoFo::PdfReference fontRef  = pDoc->GetPage( 0 )->GetObject()->GetDictionary().GetKey( "TestFont" )->GetReference();
+            const PoDoFo::PdfReference otherRef = pDoc->GetPage( 0 )->GetObject()->GetDictionary().GetKey( "TestOther" )->GetReference();
+            CPPUNIT_ASSERT( pDoc->GetPage( 3 )->GetObject()->GetDictionary().GetKey( "TestFont" )->GetReference() == fontRef );
+
+            std::string sOutput;
+            {
+                PoDoFo::PdfRefCountedBuffer buffer;
+                PoDoFo::PdfOutputDevice     device( &buffer );
+                pDoc->Write( &device );
+                sOutput = std::string( buffer.GetBuffer(), device.GetLength() );
+            }
+
+            PoDoFo::PdfMemDocument result;
+            result.LoadFromBuffer( sOutput.c_str(), static_cast<long>(sOutput.size()) );
+
+            // The second font and its font file were merged
+            CPPUNIT_ASSERT_EQUAL( nPages, result.GetPageCount() );
+            CPPUNIT_ASSERT_EQUAL( nObjects - 2, result.GetObjects().GetSize() );
+
+            for( int i = 0; i < nPages; i++ )
+            {
+                const PoDoFo::PdfObject* pPage = result.GetPage( i )->GetObject();
+                CPPUNIT_ASSERT( fontRef == pPage->GetDictionary().GetKey( "TestFont" )->GetReference() );
+                CPPUNIT_ASSERT( otherRef == pPage->GetDictionary().GetKey( "TestOther" )->GetReference() );
+            }
+
+            const char* ppszData[] = { "font data", "other data" };
+            const PoDoFo::PdfObject* ppStreams[] = {
+                result.GetObjects().MustGetObject( fontRef )->GetIndirectKey( "FontFile" ),
+                result.GetObjects().MustGetObject( otherRef )
+            };
+            for( int i = 0; i < 2; i++ )
+            {
+                char*            pBuffer;
+                PoDoFo::pdf_long lLen;
+                ppStreams[i]->GetStream()->GetFilteredCopy( &pBuffer, &lLen );
+
+                const std::string sData( pBuffer, lLen );
+                PoDoFo::podofo_free( pBuffer );
+                CPPUNIT_ASSERT_EQUAL( std::string( ppszData[i] ), sData );
+            }
+        } catch( PoDoFo::PdfError & error ) {
+            error.PrintErrorMsg();
+            CPPUNIT_FAIL( "Unexpected PdfError" );
+        }
+    }
+}
+
+void ParserTest::testDeduplicateAnnotations()
+{
+    const int nPages = 2;
+
+    try {
+        PoDoFo::PdfMemDocument doc;
+        std::vector<PoDoFo::PdfObject*> vecPages;
+        for( int i = 0; i < nPages; i++ )
+            vecPages.push_back( doc.CreatePage( PoDoFo::PdfPage::CreateStandardPageSize( PoDoFo::ePdfPageSize_A4 ) )->GetObject() );
+
+        PoDoFo::PdfRect  rect( 10.0, 10.0, 100.0, 20.0 );
+        PoDoFo::PdfVariant rectVar;
+        rect.ToVariant( rectVar );
+
+        PoDoFo::PdfArray dest;
+        dest.push_back( vecPages[0]->Reference() );
+        dest.push_back( PoDoFo::PdfName( "Fit" ) );
+
+        // Identical objects on every page, none of them with a /Type key
+        std::vector<PoDoFo::PdfObject*> vecLinks;
+        std::vector<PoDoFo::PdfObject*> vecCustom;
+        std::vector<PoDoFo::PdfObject*> vecFields;
+        std::vector<PoDoFo::PdfObject*> vecPlain;
+        for( int i = 0; i < nPages; i++ )
+        {
+            // A "back to top" link
+            PoDoFo::PdfObject* pLink = doc.GetObjects().CreateObject();
+            pLink->GetDictionary().AddKey( PoDoFo::PdfName::KeySubtype, PoDoFo::PdfName( "Link" ) );
+            pLink->GetDictionary().AddKey( "Rect", rectVar );
+            pLink->GetDictionary().AddKey( "Dest", dest );
+            vecLinks.push_back( pLink );
+
+            // An annotation of an unknown subtype is only found through /Annots
+            PoDoFo::PdfObject* pCustom = doc.GetObjects().CreateObject();
+            pCustom->GetDictionary().AddKey( PoDoFo::PdfName::KeySubtype, PoDoFo::PdfName( "TestCustom" ) );
+            pCustom->GetDictionary().AddKey( "Rect", rectVar );
+            vecCustom.push_back( pCustom );
+
+            PoDoFo::PdfArray annots;
+            annots.push_back( pLink->Reference() );
+            annots.push_back( pCustom->Reference() );
+            vecPages[i]->GetDictionary().AddKey( "Annots", annots );
+
+            // A form field and a plain dictionary, which are not annotations
+            PoDoFo::PdfObject* pField = doc.GetObjects().CreateObject();
+            pField->GetDictionary().AddKey( "FT", PoDoFo::PdfName( "Btn" ) );
+            vecPages[i]->GetDictionary().AddKey( "TestField", pField->Reference() );
+            vecFields.push_back( pField );
+
+            PoDoFo::PdfObject* pPlain = doc.GetObjects().CreateObject();
+            pPlain->GetDictionary().AddKey( "TestKey", PoDoFo::PdfName( "TestValue" ) );
+            vecPages[i]->GetDictionary().AddKey( "TestPlain", pPlain->Reference() );
+            vecPlain.push_back( pPlain );
+        }
+
+        // Only the plain dictionaries are merged
+        const size_t nObjects = doc.GetObjects().GetSize();
+        CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(nPages - 1), doc.MergeDuplicateObjects() );
+        CPPUNIT_ASSERT_EQUAL( nObjects - (nPages - 1), doc.GetObjects().GetSize() );
+
+        for( int i = 0; i < nPages; i++ )
+        {
+            const PoDoFo::PdfDictionary & rPage = vecPages[i]->GetDictionary();
+            const PoDoFo::PdfArray &      rAnnots = rPage.GetKey( "Annots" )->GetArray();
+            CPPUNIT_ASSERT( rAnnots[0].GetReference() == vecLinks[i]->Reference() );
+            CPPUNIT_ASSERT( rAnnots[1].GetReference() == vecCustom[i]->Reference() );
+            CPPUNIT_ASSERT( rPage.GetKey( "TestField" )->GetReference() == vecFields[i]->Reference() );
+            CPPUNIT_ASSERT( rPage.GetKey( "TestPlain" )->GetReference() == vecPlain[0]->Reference() );
+        }
+
+        // Removing the link from the last page keeps the link of the first page
+        PoDoFo::PdfPage* pLast = doc.GetPage( nPages - 1 );
+        pLast->DeleteAnnotation( vecLinks[nPages - 1]->Reference() );
+        CPPUNIT_ASSERT_EQUAL( 2, doc.GetPage( 0 )->GetNumAnnots() );
+        CPPUNIT_ASSERT_EQUAL( 1, pLast->GetNumAnnots() );
+        CPPUNIT_ASSERT( doc.GetObjects().GetObject( vecLinks[0]->Reference() ) != NULL );
+    } catch( PoDoFo::PdfError & error ) {
+        error.PrintErrorMsg();
+        CPPUNIT_FAIL( "Unexpected PdfError" );
+    }
+}
+
 std::string ParserTest::generateXRefEntries( size_t count )
 {
     std::string strXRefEntries;
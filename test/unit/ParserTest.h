@@ -50,6 +50,16 @@ class ParserTest : public CppUnit::TestFixture
     CPPUNIT_TEST( testNestedOutlines );
     CPPUNIT_TEST( testLoopingOutlines );
     CPPUNIT_TEST( testRoundTripIndirectTrailerID );
+    CPPUNIT_TEST( testRoundTripObjectStreams );
+    CPPUNIT_TEST( testWriteThreads );
+    CPPUNIT_TEST( testDelayedLoadThreads );
+    CPPUNIT_TEST( testWriteLinearized );
+    CPPUNIT_TEST( testUpdateSession );
+    CPPUNIT_TEST( testUpdateIndirectLength );
+    CPPUNIT_TEST( testWriteRawStreams );
+    CPPUNIT_TEST( testWriteToBuffer );
+    CPPUNIT_TEST( testDeduplicateObjects );
+    CPPUNIT_TEST( testDeduplicateAnnotations );
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -101,11 +111,22 @@ public:
     void testLoopingOutlines();
 
     void testRoundTripIndirectTrailerID();
+    void testRoundTripObjectStreams();
+    void testWriteThreads();
+    void testDelayedLoadThreads();
+    void testWriteLinearized();
+    void testUpdateSession();
+    void testUpdateIndirectLength();
+    void testWriteRawStreams();
+    void testWriteToBuffer();
+    void testDeduplicateObjects();
+    void testDeduplicateAnnotations();
 
 private:
     std::string generateXRefEntries( size_t count );
     bool canOutOfMemoryKillUnitTests();
     size_t getStackOverflowDepth();
+    void checkLinearizedFile( const std::string & sFile, const char* pszPassword );
 };
 
 #endif // _PARSER_TEST_H_
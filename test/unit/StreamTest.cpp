@@ -0,0 +1,449 @@
+/***************************************************************************
+ *   Copyright (C) 2000 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "StreamTest.h"
+#include "TestUtils.h"
+
+#include <podofo.h>
+
+using namespace PoDoFo;
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( StreamTest );
+
+static std::string ReadAll( PdfInputStream* pStream )
+{
+    std::string sData;
+    char        buffer[1000];
+    pdf_long    lRead;
+    while( (lRead = pStream->Read( buffer, sizeof(buffer) )) > 0 )
+        sData.append( buffer, lRead );
+
+    return sData;
+}
+
+static std::string GetCopy( const PdfStream* pStream )
+{
+    char*    pBuffer;
+    pdf_long lLen;
+    pStream->GetCopy( &pBuffer, &lLen );
+
+    std::string sData( pBuffer, lLen );
+    podofo_free( pBuffer );
+    return sData;
+}
+
+static std::string GetFilteredCopy( const PdfStream* pStream )
+{
+    char*    pBuffer;
+    pdf_long lLen;
+    pStream->GetFilteredCopy( &pBuffer, &lLen );
+
+    std::string sData( pBuffer, lLen );
+    podofo_free( pBuffer );
+    return sData;
+}
+
+static void SetRaw( PdfObject* pObject, const std::string & sData )
+{
+    TVecFilters vecFilters;
+    pObject->GetStream()->Set( sData.c_str(), sData.length(), vecFilters );
+}
+
+static PdfSpillStream* GetSpillStream( PdfObject* pObject )
+{
+    PdfSpillStream* pStream = dynamic_cast<PdfSpillStream*>(pObject->GetStream());
+    CPPUNIT_ASSERT( pStream != NULL );
+    return pStream;
+}
+
+/** A std::streambuf which can only be written to, like a pipe
+ */
+class NonSeekableBuffer : public std::streambuf {
+ public:
+    NonSeekableBuffer()
+        : m_bSeeked( false )
+    {
+    }
+
+    const std::string & GetData() const { return m_data; }
+    bool HasSeeked() const { return m_bSeeked; }
+
+ protected:
+    virtual int_type overflow( int_type c )
+    {
+        if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+            m_data += traits_type::to_char_type( c );
+
+        return traits_type::not_eof( c );
+    }
+
+    virtual std::streamsize xsputn( const char* pBuffer, std::streamsize lLen )
+    {
+        m_data.append( pBuffer, static_cast<size_t>(lLen) );
+        return lLen;
+    }
+
+    virtual pos_type seekoff( off_type, std::ios_base::seekdir, std::ios_base::openmode )
+    {
+        m_bSeeked = true;
+        return pos_type( off_type( -1 ) );
+    }
+
+    virtual pos_type seekpos( pos_type, std::ios_base::openmode )
+    {
+        m_bSeeked = true;
+        return pos_type( off_type( -1 ) );
+    }
+
+ private:
+    std::string m_data;
+    bool        m_bSeeked;
+};
+
+void StreamTest::setUp()
+{
+    // Data which does not compress well, so that
+    // the encoded size is close to the decoded size
+    unsigned int seed = 12345;
+    m_data.resize( 20000 );
+    for( size_t i = 0; i < m_data.size(); i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        m_data[i] = static_cast<char>(seed >> 16);
+    }
+}
+
+void StreamTest::tearDown()
+{
+}
+
+void StreamTest::testSpillThreshold()
+{
+    PdfSpillStreamFactory factory( 1024, 1024 * 1024 );
+    PdfVecObjects         objects;
+    objects.SetStreamFactory( &factory );
+
+    PdfObject* pSmall = objects.CreateObject();
+    SetRaw( pSmall, m_data.substr( 0, 1000 ) );
+    CPPUNIT_ASSERT( !GetSpillStream( pSmall )->IsSpilled() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(1000), factory.GetResidentSize() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_int64>(1000), pSmall->GetDictionary().GetKey( PdfName::KeyLength )->GetNumber() );
+
+    PdfObject* pLarge = objects.CreateObject();
+    SetRaw( pLarge, m_data );
+    CPPUNIT_ASSERT( GetSpillStream( pLarge )->IsSpilled() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(1000), factory.GetResidentSize() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(m_data.size()), pLarge->GetStream()->GetLength() );
+    CPPUNIT_ASSERT( m_data == GetCopy( pLarge->GetStream() ) );
+
+    // A stream which grows beyond the threshold while appending is spilled
+    pSmall->GetStream()->BeginAppend( TVecFilters() );
+    for( int i = 0; i < 4; i++ ) 
+        pSmall->GetStream()->Append( m_data.c_str() + i * 500, 500 );
+    pSmall->GetStream()->EndAppend();
+
+    CPPUNIT_ASSERT( GetSpillStream( pSmall )->IsSpilled() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(0), factory.GetResidentSize() );
+    CPPUNIT_ASSERT( m_data.substr( 0, 2000 ) == GetCopy( pSmall->GetStream() ) );
+
+    // New contents are kept in memory again
+    SetRaw( pLarge, m_data.substr( 0, 10 ) );
+    CPPUNIT_ASSERT( !GetSpillStream( pLarge )->IsSpilled() );
+    CPPUNIT_ASSERT( m_data.substr( 0, 10 ) == GetCopy( pLarge->GetStream() ) );
+}
+
+void StreamTest::testSpillBudget()
+{
+    PdfSpillStreamFactory factory( 64 * 1024, 8192 );
+    PdfVecObjects         objects;
+    objects.SetStreamFactory( &factory );
+
+    PdfObject* pObjects[3];
+    for( int i = 0; i < 3; i++ ) 
+    {
+        pObjects[i] = objects.CreateObject();
+        SetRaw( pObjects[i], m_data.substr( i * 3000, 3000 ) );
+    }
+
+    CPPUNIT_ASSERT( !GetSpillStream( pObjects[0] )->IsSpilled() );
+    CPPUNIT_ASSERT( !GetSpillStream( pObjects[1] )->IsSpilled() );
+    CPPUNIT_ASSERT( GetSpillStream( pObjects[2] )->IsSpilled() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(6000), factory.GetResidentSize() );
+    for( int i = 0; i < 3; i++ ) 
+        CPPUNIT_ASSERT( m_data.substr( i * 3000, 3000 ) == GetCopy( pObjects[i]->GetStream() ) );
+
+    // Buffers grow while appending, their whole capacity counts against the budget
+    SetRaw( pObjects[1], std::string() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(3000), factory.GetResidentSize() );
+
+    pObjects[1]->GetStream()->BeginAppend( TVecFilters() );
+    for( int i = 0; i < 60; i++ ) 
+    {
+        pObjects[1]->GetStream()->Append( m_data.c_str() + i * 100, 100 );
+        CPPUNIT_ASSERT( factory.GetResidentSize() <= factory.GetMemoryBudget() );
+    }
+    pObjects[1]->GetStream()->EndAppend();
+
+    CPPUNIT_ASSERT( GetSpillStream( pObjects[1] )->IsSpilled() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(3000), factory.GetResidentSize() );
+    CPPUNIT_ASSERT( m_data.substr( 0, 6000 ) == GetCopy( pObjects[1]->GetStream() ) );
+
+    // Deleting a stream returns its memory to the budget
+    delete objects.RemoveObject( pObjects[0]->Reference() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(0), factory.GetResidentSize() );
+}
+
+void StreamTest::testSpillCopy()
+{
+    PdfSpillStreamFactory factory( 256, 1024 * 1024 );
+    PdfVecObjects         objects;
+    objects.SetStreamFactory( &factory );
+
+    PdfObject*  pObject = objects.CreateObject();
+    TVecFilters vecFilters;
+    vecFilters.push_back( ePdfFilter_FlateDecode );
+    pObject->GetStream()->Set( m_data.c_str(), m_data.size(), vecFilters );
+    CPPUNIT_ASSERT( GetSpillStream( pObject )->IsSpilled() );
+
+    // Raw data through both interfaces
+    std::string sRaw = GetCopy( pObject->GetStream() );
+    CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(pObject->GetStream()->GetLength()), sRaw.size() );
+
+    PODOFO_UNIQUEU_PTR<PdfInputStream> pInput( pObject->GetStream()->CreateInputStream() );
+    CPPUNIT_ASSERT( sRaw == ReadAll( pInput.get() ) );
+
+    PdfMemoryOutputStream output;
+    pObject->GetStream()->GetCopy( &output );
+    CPPUNIT_ASSERT( sRaw == std::string( output.GetBuffer(), output.GetLength() ) );
+
+    // Decoded data
+    CPPUNIT_ASSERT( m_data == GetFilteredCopy( pObject->GetStream() ) );
+
+    PODOFO_UNIQUEU_PTR<PdfInputStream> pFiltered( pObject->GetStream()->CreateFilteredInputStream() );
+    CPPUNIT_ASSERT( m_data == ReadAll( pFiltered.get() ) );
+
+    // Copy into a PdfMemStream of another object
+    PdfVecObjects memObjects;
+    PdfObject*    pCopy = memObjects.CreateObject();
+    pCopy->GetDictionary().AddKey( PdfName::KeyFilter, PdfName( "FlateDecode" ) );
+    *(pCopy->GetStream()) = *(pObject->GetStream());
+
+    CPPUNIT_ASSERT( sRaw == GetCopy( pCopy->GetStream() ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_int64>(sRaw.size()), pCopy->GetDictionary().GetKey( PdfName::KeyLength )->GetNumber() );
+    CPPUNIT_ASSERT( m_data == GetFilteredCopy( pCopy->GetStream() ) );
+}
+
+void StreamTest::testSpillEncrypted()
+{
+    std::string sFilename = TestUtils::getTempFilename();
+    PdfReference small;
+    PdfReference large;
+
+    {
+        PdfSpillStreamFactory factory( 1024, 1024 * 1024 );
+        PdfMemDocument        doc;
+        doc.GetObjects().SetStreamFactory( &factory );
+        doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+        doc.SetEncrypted( "", "owner", PdfEncrypt::ePdfPermissions_Print, 
+                          PdfEncrypt::ePdfEncryptAlgorithm_AESV2, PdfEncrypt::ePdfKeyLength_128 );
+
+        PdfObject* pSmall = doc.GetObjects().CreateObject();
+        SetRaw( pSmall, m_data.substr( 0, 100 ) );
+        small = pSmall->Reference();
+
+        PdfObject* pLarge = doc.GetObjects().CreateObject();
+        SetRaw( pLarge, m_data );
+        CPPUNIT_ASSERT( GetSpillStream( pLarge )->IsSpilled() );
+        large = pLarge->Reference();
+
+        doc.Write( sFilename.c_str() );
+    }
+
+    // No user password is required to read the document
+    PdfMemDocument doc( sFilename.c_str() );
+    CPPUNIT_ASSERT( m_data.substr( 0, 100 ) == GetFilteredCopy( doc.GetObjects().GetObject( small )->GetStream() ) );
+    CPPUNIT_ASSERT( m_data == GetFilteredCopy( doc.GetObjects().GetObject( large )->GetStream() ) );
+
+    TestUtils::deleteFile( sFilename.c_str() );
+}
+
+void StreamTest::testSpillManyStreams()
+{
+    const int             nStreams = 2000;
+    PdfSpillStreamFactory factory( 16, 1024 * 1024 );
+    PdfVecObjects         objects;
+    objects.SetStreamFactory( &factory );
+
+    // All spilled streams share one temporary file, so
+    // this works even with a limit of 1024 open files
+    std::vector<PdfObject*> vecObjects;
+    for( int i = 0; i < nStreams; i++ )
+    {
+        PdfObject* pObject = objects.CreateObject();
+        SetRaw( pObject, m_data.substr( i, 17 + i % 50 ) );
+        CPPUNIT_ASSERT( GetSpillStream( pObject )->IsSpilled() );
+        vecObjects.push_back( pObject );
+    }
+
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(0), factory.GetResidentSize() );
+    for( int i = 0; i < nStreams; i++ )
+        CPPUNIT_ASSERT( m_data.substr( i, 17 + i % 50 ) == GetCopy( vecObjects[i]->GetStream() ) );
+
+    // Append to two streams at once, their data is interleaved in the file
+    PdfStream* pFirst  = vecObjects[0]->GetStream();
+    PdfStream* pSecond = vecObjects[1]->GetStream();
+    pFirst->BeginAppend( TVecFilters() );
+    pSecond->BeginAppend( TVecFilters() );
+    for( size_t i = 0; i < 10000; i += 100 )
+    {
+        pFirst->Append( m_data.c_str() + i, 100 );
+        pSecond->Append( m_data.c_str() + 10000 + i, 100 );
+    }
+    pFirst->EndAppend();
+    pSecond->EndAppend();
+
+    CPPUNIT_ASSERT( m_data.substr( 0, 10000 ) == GetCopy( pFirst ) );
+    CPPUNIT_ASSERT( m_data.substr( 10000 ) == GetCopy( pSecond ) );
+
+    PODOFO_UNIQUEU_PTR<PdfInputStream> pInput( pSecond->CreateInputStream() );
+    CPPUNIT_ASSERT( m_data.substr( 10000 ) == ReadAll( pInput.get() ) );
+
+    PdfMemoryOutputStream output;
+    pFirst->GetCopy( &output );
+    CPPUNIT_ASSERT( m_data.substr( 0, 10000 ) == std::string( output.GetBuffer(), output.GetLength() ) );
+
+    // Deleted and replaced streams free their space for other streams
+    for( int i = 2; i < nStreams; i += 2 )
+        delete objects.RemoveObject( vecObjects[i]->Reference() );
+
+    for( int i = 3; i < nStreams; i += 2 )
+        SetRaw( vecObjects[i], m_data.substr( nStreams + i, 30 ) );
+
+    for( int i = 3; i < nStreams; i += 2 )
+        CPPUNIT_ASSERT( m_data.substr( nStreams + i, 30 ) == GetCopy( vecObjects[i]->GetStream() ) );
+
+    CPPUNIT_ASSERT( m_data.substr( 0, 10000 ) == GetCopy( pFirst ) );
+    CPPUNIT_ASSERT( m_data.substr( 10000 ) == GetCopy( pSecond ) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<pdf_long>(0), factory.GetResidentSize() );
+}
+
+void StreamTest::testFileStreamCopy()
+{
+    std::string sFilename = TestUtils::getTempFilename();
+    PdfReference reference;
+    TVecFilters  vecFilters;
+    vecFilters.push_back( ePdfFilter_FlateDecode );
+
+    {
+        PdfStreamedDocument doc( sFilename.c_str() );
+        PdfObject* pObject = doc.GetObjects()->CreateObject();
+        pObject->GetStream()->Set( m_data.c_str(), m_data.size(), vecFilters );
+        reference = pObject->Reference();
+
+        CPPUNIT_ASSERT( m_data == GetFilteredCopy( pObject->GetStream() ) );
+        CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(pObject->GetStream()->GetLength()), 
+                              GetCopy( pObject->GetStream() ).size() );
+
+        // Writing continues behind the stream after reading it,
+        // the streamed document releases the object afterwards
+        PdfObject* pNext = doc.GetObjects()->CreateObject();
+        SetRaw( pNext, m_data.substr( 0, 100 ) );
+        CPPUNIT_ASSERT( m_data.substr( 0, 100 ) == GetCopy( pNext->GetStream() ) );
+
+        doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+        doc.Close();
+    }
+
+    PdfMemDocument doc( sFilename.c_str() );
+    CPPUNIT_ASSERT_EQUAL( 1, doc.GetPageCount() );
+    CPPUNIT_ASSERT( m_data == GetFilteredCopy( doc.GetObjects().GetObject( reference )->GetStream() ) );
+    TestUtils::deleteFile( sFilename.c_str() );
+
+    // Encrypted streams are decrypted when reading them back
+    PODOFO_UNIQUEU_PTR<PdfEncrypt> pEncrypt( PdfEncrypt::CreatePdfEncrypt( "user", "owner", PdfEncrypt::ePdfPermissions_Print, 
+                                                                           PdfEncrypt::ePdfEncryptAlgorithm_AESV2, 
+                                                                           PdfEncrypt::ePdfKeyLength_128 ) );
+    {
+        PdfStreamedDocument doc( sFilename.c_str(), ePdfVersion_Default, pEncrypt.get() );
+        PdfObject* pObject = doc.GetObjects()->CreateObject();
+        pObject->GetStream()->Set( m_data.c_str(), m_data.size(), vecFilters );
+        CPPUNIT_ASSERT( m_data == GetFilteredCopy( pObject->GetStream() ) );
+
+        doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+        doc.Close();
+    }
+
+    TestUtils::deleteFile( sFilename.c_str() );
+}
+
+void StreamTest::testFileStreamNonSeekable()
+{
+    TVecFilters vecFilters;
+    vecFilters.push_back( ePdfFilter_FlateDecode );
+
+    // The second pass encrypts the streams
+    for( int nPass = 0; nPass < 2; nPass++ )
+    {
+        PODOFO_UNIQUEU_PTR<PdfEncrypt> pEncrypt;
+        if( nPass == 1 )
+            pEncrypt.reset( PdfEncrypt::CreatePdfEncrypt( "", "owner", PdfEncrypt::ePdfPermissions_Print, 
+                                                          PdfEncrypt::ePdfEncryptAlgorithm_AESV2, 
+                                                          PdfEncrypt::ePdfKeyLength_128 ) );
+
+        NonSeekableBuffer buffer;
+        std::ostream      stream( &buffer );
+        PdfReference      filtered;
+        PdfReference      raw;
+
+        {
+            PdfOutputDevice     device( &stream );
+            PdfStreamedDocument doc( &device, ePdfVersion_Default, pEncrypt.get() );
+
+            PdfObject* pObject = doc.GetObjects()->CreateObject();
+            pObject->GetStream()->Set( m_data.c_str(), m_data.size(), vecFilters );
+            filtered = pObject->Reference();
+
+            pObject = doc.GetObjects()->CreateObject();
+            SetRaw( pObject, m_data.substr( 0, 1000 ) );
+            raw = pObject->Reference();
+
+            PdfPage*   pPage = doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+            PdfPainter painter;
+            painter.SetPage( pPage );
+            painter.DrawLine( 0.0, 0.0, 100.0, 100.0 );
+            painter.FinishPage();
+
+            doc.Close();
+        }
+
+        CPPUNIT_ASSERT( !buffer.HasSeeked() );
+        CPPUNIT_ASSERT( stream.good() );
+
+        const std::string & sData = buffer.GetData();
+        PdfMemDocument      doc;
+        doc.LoadFromBuffer( sData.c_str(), static_cast<long>(sData.size()) );
+
+        CPPUNIT_ASSERT_EQUAL( 1, doc.GetPageCount() );
+        CPPUNIT_ASSERT( doc.GetPage( 0 )->GetContents() != NULL );
+        CPPUNIT_ASSERT( m_data == GetFilteredCopy( doc.GetObjects().GetObject( filtered )->GetStream() ) );
+        CPPUNIT_ASSERT( m_data.substr( 0, 1000 ) == GetFilteredCopy( doc.GetObjects().GetObject( raw )->GetStream() ) );
+    }
+}
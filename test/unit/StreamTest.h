@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by Dominik Seichter                                *
+ *   domseichter@web.de                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef _STREAM_TEST_H_
+#define _STREAM_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+/** This test tests the stream implementations
+ *  PdfSpillStream and PdfFileStream.
+ */
+class StreamTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( StreamTest );
+    CPPUNIT_TEST( testSpillThreshold );
+    CPPUNIT_TEST( testSpillBudget );
+    CPPUNIT_TEST( testSpillCopy );
+    CPPUNIT_TEST( testSpillEncrypted );
+    CPPUNIT_TEST( testSpillManyStreams );
+    CPPUNIT_TEST( testFileStreamCopy );
+    CPPUNIT_TEST( testFileStreamNonSeekable );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+
+    /** Streams larger than the threshold are moved to a temporary file.
+     */
+    void testSpillThreshold();
+
+    /** Streams are spilled once the memory budget is used up,
+     *  counting the allocated capacity of the buffers.
+     */
+    void testSpillBudget();
+
+    /** Read spilled streams back through GetCopy, CreateInputStream,
+     *  GetFilteredCopy and operator=.
+     */
+    void testSpillCopy();
+
+    /** Write an encrypted document with spilled streams and read it again.
+     */
+    void testSpillEncrypted();
+
+    /** Spill more streams than a process can open files, append 
+     *  to two spilled streams at once and reuse freed file space.
+     */
+    void testSpillManyStreams();
+
+    /** Read the data of a PdfFileStream back from the output device.
+     */
+    void testFileStreamCopy();
+
+    /** Write a PdfStreamedDocument to a std::ostream which cannot seek.
+     */
+    void testFileStreamNonSeekable();
+
+private:
+    std::string m_data;
+};
+
+#endif // _STREAM_TEST_H_
@@ -21,8 +21,19 @@
 #ifndef _TEST_UTILS_H_
 #define _TEST_UTILS_H_
 
+#include <podofo.h>
+
 #include <string>
 
+// prefer std::unique_ptr over std::auto_ptr
+#ifndef PODOFO_UNIQUEU_PTR
+#ifdef PODOFO_HAVE_UNIQUE_PTR
+#define PODOFO_UNIQUEU_PTR std::unique_ptr
+#else
+#define PODOFO_UNIQUEU_PTR std::auto_ptr
+#endif
+#endif // PODOFO_UNIQUEU_PTR
+
 /**
  * This class contains utility methods that are
  * often needed when writing tests.
@@ -22,6 +22,8 @@
 
 #include <cppunit/Asserter.h>
 
+#include <sstream>
+
 using namespace PoDoFo;
 
 CPPUNIT_TEST_SUITE_REGISTRATION( TokenizerTest );
@@ -262,3 +264,46 @@ void TokenizerTest::testLocale()
 
     setlocale( LC_ALL, old );
 }
+
+void TokenizerTest::testContentsTokenizer()
+{
+    const int          nStrings = 500;
+    std::ostringstream oss;
+    for( int i = 0; i < nStrings; i++ )
+        oss << "BT /F1 12 Tf 100 " << i << " Td (Hello " << i << ") Tj ET\n";
+
+    std::string sContents = oss.str();
+    PdfMemDocument doc;
+    PdfPage*       pPage = doc.CreatePage( PdfPage::CreateStandardPageSize( ePdfPageSize_A4 ) );
+    pPage->GetContents()->GetStream()->Set( sContents.c_str(), sContents.length(), TVecFilters( 1, ePdfFilter_FlateDecode ) );
+
+    PdfContentsTokenizer tokenizer( pPage );
+    EPdfContentsType     eType;
+    const char*          pszKeyword;
+    PdfVariant           var;
+    PdfVariant           last;
+    int                  nTj = 0;
+    int                  nKeywords = 0;
+    while( tokenizer.ReadNext( eType, pszKeyword, var ) )
+    {
+        if( eType == ePdfContentsType_Variant )
+        {
+            last = var;
+            continue;
+        }
+
+        CPPUNIT_ASSERT_EQUAL( static_cast<int>(ePdfContentsType_Keyword), static_cast<int>(eType) );
+        ++nKeywords;
+        if( strcmp( pszKeyword, "Tj" ) == 0 )
+        {
+            std::ostringstream expected;
+            expected << "Hello " << nTj++;
+
+            CPPUNIT_ASSERT( last.IsString() );
+            CPPUNIT_ASSERT_EQUAL( expected.str(), last.GetString().GetStringUtf8() );
+        }
+    }
+
+    CPPUNIT_ASSERT_EQUAL( nStrings, nTj );
+    CPPUNIT_ASSERT_EQUAL( nStrings * 5, nKeywords );
+}
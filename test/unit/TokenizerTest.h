@@ -47,6 +47,7 @@ class TokenizerTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testComments );
   CPPUNIT_TEST( testDictionary );
   CPPUNIT_TEST( testLocale );
+  CPPUNIT_TEST( testContentsTokenizer );
   CPPUNIT_TEST_SUITE_END();
 
  public:
@@ -68,6 +69,11 @@ class TokenizerTest : public CppUnit::TestFixture
 
   void testLocale();
 
+  /** Tokenize a compressed contents stream which is 
+   *  larger than the window of the decoding stream.
+   */
+  void testContentsTokenizer();
+
  private:
   void Test( const char* pszString, PoDoFo::EPdfDataType eDataType, const char* pszExpected = NULL );
 
@@ -21,6 +21,7 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 
 #include <podofo.h>
 
@@ -36,19 +37,37 @@ int main (int argc, char *argv[])
     PdfParser     parser( &objects );
     objects.SetAutoDelete( true );
 
-    if( argc != 3 )
+    bool        bUsage       = false;
+    bool        bDeduplicate = false;
+    const char* pszInput     = NULL;
+    const char* pszOutput    = NULL;
+    for( int i = 1; i < argc; i++ )
     {
-        cerr << "Usage: podofogc <input_filename> <output_filename>\n"
+        if( strcmp( "-deduplicate", argv[i] ) == 0 )
+            bDeduplicate = true;
+        else if( !pszInput )
+            pszInput = argv[i];
+        else if( !pszOutput )
+            pszOutput = argv[i];
+        else
+            bUsage = true;
+    }
+
+    if( bUsage || !pszInput || !pszOutput )
+    {
+        cerr << "Usage: podofogc [-deduplicate] <input_filename> <output_filename>\n"
              << "    Performs garbage collection on a PDF file.\n"
              << "    All objects that are not reachable from within\n"
              << "    the trailer are deleted.\n"
+             << "    -deduplicate  objects with identical contents\n"
+             << "                  are written only once.\n"
              << flush;
         return 0;
     }
     
 
     try {
-        cerr << "Parsing  " << argv[1] << " ... (this might take a while)"
+        cerr << "Parsing  " << pszInput << " ... (this might take a while)"
              << flush;
 
         bool bIncorrectPw = false;
@@ -56,7 +75,7 @@ int main (int argc, char *argv[])
         do {
             try {
                 if( !bIncorrectPw ) 
-                    parser.ParseFile( argv[1], false );
+                    parser.ParseFile( pszInput, false );
                 else 
                     parser.SetPassword( pw );
                 
@@ -78,6 +97,13 @@ int main (int argc, char *argv[])
 
         cerr << " done" << endl;
 
+        if( bDeduplicate )
+        {
+            cerr << "Merging duplicates..." << flush;
+            size_t nRemoved = objects.MergeDuplicates( const_cast<PdfObject*>(parser.GetTrailer()) );
+            cerr << " removed " << nRemoved << " objects" << endl;
+        }
+
         cerr << "Writing..." << flush;
         PdfWriter writer( &parser );
         writer.SetPdfVersion( parser.GetPdfVersion() );
@@ -85,7 +111,7 @@ int main (int argc, char *argv[])
         {
             writer.SetEncrypted( *(parser.GetEncrypt()) );
         }
-        writer.Write( argv[2] );
+        writer.Write( pszOutput );
         cerr << " done" << endl;
     } catch( PdfError & e ) {
         e.PrintErrorMsg();